@@ -0,0 +1,217 @@
+/**
+ * @file clock.h
+ * @brief Injectable time source for time-driven components
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+
+namespace swarm {
+
+/**
+ * @brief Source of time and timed waits
+ *
+ * Components that schedule work or time out (the executor's timers, the health
+ * monitor, message timestamps) read the time and wait through a Clock instead
+ * of std::chrono and std::condition_variable directly. SystemClock is the real
+ * time; VirtualClock only moves when told to, so hours of scheduled work run in
+ * milliseconds and the same sequence of advance() calls reproduces the same
+ * timing every run.
+ *
+ * @note Implementations are thread-safe
+ */
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    /**
+     * @brief Get the monotonic time
+     *
+     * @return The time deadlines and intervals are measured in
+     */
+    virtual std::chrono::steady_clock::time_point now() const = 0;
+
+    /**
+     * @brief Get the wall-clock time
+     *
+     * @return The time timestamps are taken from
+     */
+    virtual std::chrono::system_clock::time_point wallNow() const = 0;
+
+    /**
+     * @brief Wait on a condition variable until notified or a deadline
+     *
+     * Like std::condition_variable::wait_until(), the wait may also end
+     * spuriously, so callers re-check their condition in a loop.
+     *
+     * @param lock Lock of the mutex the condition variable is used with, held
+     * @param condition The condition variable
+     * @param deadline Time of this clock at which the wait ends
+     * @return true if the deadline has passed
+     */
+    virtual bool waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                           std::chrono::steady_clock::time_point deadline) = 0;
+
+    /**
+     * @brief Block the calling thread until a time
+     *
+     * @param deadline Time of this clock to sleep until
+     */
+    virtual void sleepUntil(std::chrono::steady_clock::time_point deadline) = 0;
+
+    /**
+     * @brief Block the calling thread for a duration
+     *
+     * @param duration Time of this clock to sleep
+     */
+    void sleepFor(std::chrono::steady_clock::duration duration) { sleepUntil(now() + duration); }
+
+    /**
+     * @brief Get the real-time clock
+     *
+     * @return The process-wide SystemClock, the default of every component
+     */
+    static std::shared_ptr<Clock> system();
+};
+
+/**
+ * @brief The real time: std::chrono::steady_clock and system_clock
+ */
+class SystemClock : public Clock {
+public:
+    std::chrono::steady_clock::time_point now() const override;
+    std::chrono::system_clock::time_point wallNow() const override;
+    bool waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                   std::chrono::steady_clock::time_point deadline) override;
+    void sleepUntil(std::chrono::steady_clock::time_point deadline) override;
+};
+
+/**
+ * @brief Simulated time that moves only when advanced
+ *
+ * Threads waiting on the clock are woken when advance() moves the time past
+ * their deadline. A driver that knows how many threads wait on the clock when
+ * the system is idle steps through the schedule deterministically:
+ * @code
+ * auto clock = std::make_shared<VirtualClock>();
+ * ModuleManager manager(ExecutorOptions{1, {}, clock});
+ * ...
+ * while (clock->now() < end) {
+ *     clock->waitForWaiters(1, std::chrono::seconds(1));   // the worker is idle
+ *     clock->advanceToNextDeadline();                      // fire the next timer
+ * }
+ * @endcode
+ */
+class VirtualClock : public Clock {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param wallStart Wall-clock time at the start of the simulation
+     */
+    explicit VirtualClock(std::chrono::system_clock::time_point wallStart = std::chrono::system_clock::time_point());
+
+    std::chrono::steady_clock::time_point now() const override;
+    std::chrono::system_clock::time_point wallNow() const override;
+    bool waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                   std::chrono::steady_clock::time_point deadline) override;
+    void sleepUntil(std::chrono::steady_clock::time_point deadline) override;
+
+    /**
+     * @brief Move the time forward
+     *
+     * @param duration Time to add
+     */
+    void advance(std::chrono::steady_clock::duration duration);
+
+    /**
+     * @brief Move the time forward to a point, if it is in the future
+     *
+     * @param time The new time
+     */
+    void advanceTo(std::chrono::steady_clock::time_point time);
+
+    /**
+     * @brief Move the time to the earliest deadline a thread waits for
+     *
+     * @param limit The time is not moved past this point
+     * @return false if no thread waits with a deadline before the limit; the
+     *         time is then moved to the limit, if one was given
+     */
+    bool advanceToNextDeadline(std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::time_point::max());
+
+    /**
+     * @brief Wait, in real time, until enough threads wait on the clock
+     *
+     * Lets a driver wait for the system to become idle before it advances.
+     *
+     * @param count Number of waiting threads
+     * @param timeout Real time to wait at most
+     * @return true if at least count threads wait
+     */
+    bool waitForWaiters(size_t count, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Get the number of threads waiting on the clock
+     *
+     * @return Threads in waitUntil() or sleepUntil()
+     */
+    size_t getWaiterCount() const;
+
+private:
+    struct Waiter;
+    using WaiterMap = std::multimap<std::chrono::steady_clock::time_point, Waiter*>;
+
+    /**
+     * @brief A thread in waitUntil() or sleepUntil()
+     */
+    struct Waiter {
+        std::chrono::steady_clock::time_point deadline;  ///< When the wait ends
+        std::condition_variable* condition;               ///< Condition variable to notify, null for sleepUntil()
+        bool registered = false;                          ///< Whether the waiter is in waiters_
+        WaiterMap::iterator position;                     ///< Entry in waiters_ while registered
+    };
+
+    /**
+     * @brief Register a waiter unless its deadline has passed
+     *
+     * @param waiter The waiter
+     * @return false if the deadline has passed
+     * @note Called with mutex_ held
+     */
+    bool addWaiter(Waiter& waiter);
+
+    /**
+     * @brief Unregister a waiter if advance() has not done so already
+     *
+     * @param waiter The waiter
+     * @note Called with mutex_ held
+     */
+    void removeWaiter(Waiter& waiter);
+
+    /**
+     * @brief Move the time forward and wake the waiters that are due
+     *
+     * @param time The new time, ignored if in the past
+     * @note Called with mutex_ held
+     */
+    void advanceLocked(std::chrono::steady_clock::time_point time);
+
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::condition_variable changed_;                     ///< Notified when the time or the waiters change
+    std::chrono::steady_clock::time_point now_;           ///< The simulated time, starting at the epoch
+    std::chrono::system_clock::time_point wallStart_;     ///< Wall-clock time at the epoch
+    WaiterMap waiters_;                                   ///< Registered waiters by deadline
+};
+
+} // namespace swarm
+
+#endif // CLOCK_H
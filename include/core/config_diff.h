@@ -0,0 +1,108 @@
+/**
+ * @file config_diff.h
+ * @brief Difference between a module's current configuration and requested changes
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef CONFIG_DIFF_H
+#define CONFIG_DIFF_H
+
+#include <string>
+#include <map>
+#include <vector>
+
+namespace swarm {
+
+/**
+ * @brief The keys a reconfiguration actually changes
+ *
+ * Built from a module's current configuration and a delta of requested
+ * key-value pairs. Keys whose requested value equals the current one are left
+ * out, so modules only see, validate and apply what really changes.
+ *
+ * @see ModuleManager::reconfigure()
+ * @see Module::validateConfig()
+ */
+class ConfigDiff {
+public:
+    /**
+     * @brief A single changed key
+     */
+    struct Change {
+        std::string key;                                  ///< Configuration key
+        std::string oldValue;                             ///< Current value, empty if the key is new
+        std::string newValue;                             ///< Requested value
+        bool added = false;                               ///< Whether the key is not set yet
+    };
+
+    /**
+     * @brief Compute the changes @p delta makes to @p current
+     *
+     * @param current The current configuration
+     * @param delta The requested key-value pairs
+     * @return The diff, containing only keys whose value changes
+     */
+    static ConfigDiff between(const std::map<std::string, std::string>& current,
+                              const std::map<std::string, std::string>& delta) {
+        ConfigDiff diff;
+        for (const auto& [key, value] : delta) {
+            auto it = current.find(key);
+            if (it == current.end()) {
+                diff.changes_.push_back({key, "", value, true});
+            } else if (it->second != value) {
+                diff.changes_.push_back({key, it->second, value, false});
+            }
+        }
+        return diff;
+    }
+
+    /**
+     * @brief Whether nothing changes
+     *
+     * @return true if the diff is empty
+     */
+    bool empty() const { return changes_.empty(); }
+
+    /**
+     * @brief Get the changed keys
+     *
+     * @return The changes, ordered by key
+     */
+    const std::vector<Change>& changes() const { return changes_; }
+
+    /**
+     * @brief Look up the change to a key
+     *
+     * @param key The configuration key
+     * @return The change, or nullptr if the key does not change
+     */
+    const Change* find(const std::string& key) const {
+        for (const auto& change : changes_) {
+            if (change.key == key) {
+                return &change;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Apply the diff to a configuration
+     *
+     * @param config The configuration the diff was computed from
+     * @return @p config with the changed keys replaced
+     */
+    std::map<std::string, std::string> applyTo(std::map<std::string, std::string> config) const {
+        for (const auto& change : changes_) {
+            config[change.key] = change.newValue;
+        }
+        return config;
+    }
+
+private:
+    std::vector<Change> changes_;                         ///< Changed keys, ordered by key
+};
+
+} // namespace swarm
+
+#endif // CONFIG_DIFF_H
@@ -0,0 +1,414 @@
+/**
+ * @file executor.h
+ * @brief Shared work-stealing executor and per-module task queues
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "resource_accounting.h"
+#include "clock.h"
+#include <string>
+#include <memory>
+#include <functional>
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace swarm {
+
+class TaskQueue;
+
+/**
+ * @brief Scheduling priority of a task
+ *
+ * Workers always pick the highest-priority runnable task first.
+ */
+enum class TaskPriority {
+    High = 0,                                             ///< Lifecycle and latency-sensitive work
+    Normal = 1,                                           ///< Regular module work
+    Low = 2                                               ///< Background work
+};
+
+/**
+ * @brief Executor construction options
+ */
+struct ExecutorOptions {
+    size_t threadBudget = 0;                              ///< Total worker threads, 0 for one per hardware thread
+    std::vector<int> cpuAffinity;                         ///< CPUs the workers are pinned to (round robin), empty for no pinning
+    std::shared_ptr<Clock> clock = nullptr;               ///< Time timers are scheduled in, null for the real time
+};
+
+/**
+ * @brief Executor statistics
+ */
+struct ExecutorStats {
+    size_t threads = 0;                                   ///< Worker threads
+    size_t queued = 0;                                    ///< Tasks waiting to run
+    size_t executed = 0;                                  ///< Tasks run so far
+    size_t stolen = 0;                                    ///< Tasks taken from another worker's queue
+    size_t timers = 0;                                    ///< Timers waiting to fire
+};
+
+/**
+ * @brief Shared work-stealing thread pool
+ *
+ * A fixed number of workers runs all submitted tasks. Tasks submitted from a
+ * worker go to that worker's own queue, which it serves newest-first; tasks
+ * submitted from other threads go to a shared injection queue. Idle workers
+ * steal the oldest task of a busy worker. Timers scheduled with scheduleAfter()
+ * are fired by the workers themselves, so the executor never uses more threads
+ * than its budget.
+ *
+ * Modules normally do not use the executor directly but a named TaskQueue
+ * created with createQueue(), which can be closed as a unit when the module
+ * stops.
+ *
+ * @note This class is thread-safe. Long blocking calls in tasks occupy a worker
+ *       for their whole duration.
+ * @see ModuleManager::getExecutor()
+ */
+class Executor {
+public:
+    /**
+     * @brief Identifier of a timer, returned by scheduleAfter()
+     */
+    using TimerId = uint64_t;
+
+    /**
+     * @brief Constructor
+     *
+     * Starts the worker threads.
+     *
+     * @param options Thread budget and CPU affinity
+     */
+    explicit Executor(const ExecutorOptions& options = ExecutorOptions());
+
+    /**
+     * @brief Destructor
+     *
+     * Runs the tasks that are already queued, drops pending timers and joins
+     * the workers.
+     */
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /**
+     * @brief Submit a task
+     *
+     * @param task The task to run
+     * @param priority The task priority
+     * @return false if the executor is shutting down and the task was dropped
+     */
+    bool submit(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+    /**
+     * @brief Submit a task to run once a delay has elapsed
+     *
+     * @param delay Time to wait before the task becomes runnable
+     * @param task The task to run
+     * @param priority The task priority once runnable
+     * @return An identifier for cancel(), 0 if the executor is shutting down
+     */
+    TimerId scheduleAfter(std::chrono::milliseconds delay, std::function<void()> task,
+                          TaskPriority priority = TaskPriority::Normal);
+
+    /**
+     * @brief Cancel a timer that has not fired yet
+     *
+     * @param id The identifier returned by scheduleAfter()
+     * @return true if the timer was cancelled before it fired
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * @brief Create a named task queue
+     *
+     * @param name Queue name, usually the owning module's name
+     * @param serial Whether the queue's tasks must run one at a time, in submission order
+     * @return The queue
+     */
+    std::shared_ptr<TaskQueue> createQueue(const std::string& name, bool serial = false);
+
+    /**
+     * @brief Get the number of worker threads
+     *
+     * @return The thread budget in effect
+     */
+    size_t getThreadCount() const { return workers_.size(); }
+
+    /**
+     * @brief Whether the calling thread is one of this executor's workers
+     *
+     * Code that waits for tasks it submitted must not block a worker; it can
+     * use this to fall back to running the work inline.
+     *
+     * @return true when called from a worker
+     */
+    bool isWorkerThread() const;
+
+    /**
+     * @brief Run one queued task on the calling worker
+     *
+     * Lets a worker that waits for other tasks of the pool help running them
+     * instead of occupying its slot, which would deadlock a small pool.
+     *
+     * @return false if the caller is not a worker or no task was queued
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief Get executor statistics
+     *
+     * @return The current statistics
+     */
+    ExecutorStats getStats() const;
+
+    /**
+     * @brief Get the clock timers are scheduled in
+     *
+     * @return The clock of the options, or the system clock
+     */
+    const std::shared_ptr<Clock>& getClock() const { return clock_; }
+
+private:
+    static constexpr size_t kPriorityCount = 3;
+
+    /**
+     * @brief A worker thread and its local queues
+     */
+    struct Worker {
+        std::mutex mutex;                                 ///< Guards queues
+        std::deque<std::function<void()>> queues[kPriorityCount]; ///< Local tasks per priority
+        std::thread thread;                               ///< The worker thread
+    };
+
+    /**
+     * @brief A pending timer
+     */
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;   ///< When the task becomes runnable
+        std::function<void()> task;                       ///< The task
+        TaskPriority priority;                            ///< Priority once runnable
+    };
+
+    /**
+     * @brief Main loop of a worker
+     *
+     * @param index Index of the worker in workers_
+     * @param cpu CPU to pin the worker to, negative for no pinning
+     */
+    void workerLoop(size_t index, int cpu);
+
+    /**
+     * @brief Take the next task for a worker
+     *
+     * Looks at the worker's own queue, the injection queue and the other
+     * workers' queues, in that order, for each priority from high to low.
+     *
+     * @param index Index of the worker
+     * @param task Receives the task
+     * @return true if a task was found
+     */
+    bool takeTask(size_t index, std::function<void()>& task);
+
+    /**
+     * @brief Run a task taken by takeTask() and count it
+     *
+     * @param task The task
+     */
+    void execute(std::function<void()>& task);
+
+    /**
+     * @brief Move due timers to the injection queue
+     *
+     * @return The deadline of the next pending timer, or time_point::max()
+     * @note Must be called with mutex_ held
+     */
+    std::chrono::steady_clock::time_point fireDueTimers();
+
+    /**
+     * @brief Wake one idle worker after a task was queued
+     */
+    void wakeOne();
+
+    /**
+     * @brief Recompute nextTimer_ after timers_ changed
+     *
+     * @note Must be called with mutex_ held
+     */
+    void updateNextTimer();
+
+    std::shared_ptr<Clock> clock_;                        ///< Time timers are scheduled in
+    std::vector<std::unique_ptr<Worker>> workers_;        ///< Worker threads
+    mutable std::mutex mutex_;                            ///< Guards injected_, timers_, stopping_ and idle waits
+    std::condition_variable wakeup_;                      ///< Wakes idle workers
+    std::deque<std::function<void()>> injected_[kPriorityCount]; ///< Tasks submitted from outside the pool
+    std::map<TimerId, Timer> timers_;                     ///< Pending timers
+    std::set<std::pair<std::chrono::steady_clock::time_point, TimerId>> timerOrder_; ///< Pending timers by deadline
+    TimerId nextTimerId_ = 1;                             ///< Next identifier handed out by scheduleAfter()
+    bool stopping_ = false;                               ///< Whether the destructor is running
+    std::atomic<std::chrono::steady_clock::rep> nextTimer_; ///< Deadline of the earliest timer, checked by busy workers
+    std::atomic<size_t> queued_{0};                       ///< Tasks waiting to run
+    std::atomic<size_t> executed_{0};                     ///< Tasks run so far
+    std::atomic<size_t> stolen_{0};                       ///< Tasks stolen from other workers
+};
+
+/**
+ * @brief Named queue of tasks run by a shared Executor
+ *
+ * Tasks submitted to a serial queue run one at a time in submission order,
+ * which lets a module keep single-threaded state without locks. Tasks of a
+ * concurrent queue run in parallel. Closing a queue drops the tasks and timers
+ * that have not started and waits for the ones that are running, which makes it
+ * suitable for Module::stop().
+ *
+ * @note Created with Executor::createQueue(). The executor must outlive the queue's use.
+ */
+class TaskQueue : public std::enable_shared_from_this<TaskQueue> {
+public:
+    /**
+     * @brief Destructor; unfinished tasks leave the backlog of the queue's account
+     */
+    ~TaskQueue();
+
+    /**
+     * @brief Submit a task
+     *
+     * @param task The task to run
+     * @param priority The task priority
+     * @return false if the queue is closed and the task was dropped
+     */
+    bool submit(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+    /**
+     * @brief Submit a task to run once a delay has elapsed
+     *
+     * @param delay Time to wait before the task is submitted to the queue
+     * @param task The task to run
+     * @param priority The task priority
+     * @return An identifier for cancel(), 0 if the queue is closed
+     */
+    Executor::TimerId scheduleAfter(std::chrono::milliseconds delay, std::function<void()> task,
+                                    TaskPriority priority = TaskPriority::Normal);
+
+    /**
+     * @brief Cancel a timer of this queue
+     *
+     * @param id The identifier returned by scheduleAfter()
+     * @return true if the timer was cancelled before it fired
+     */
+    bool cancel(Executor::TimerId id);
+
+    /**
+     * @brief Close the queue
+     *
+     * Rejects new tasks, drops queued tasks and pending timers, and waits until
+     * the running tasks have finished. When called from one of the queue's own
+     * tasks, that task is not waited for.
+     */
+    void close();
+
+    /**
+     * @brief Wait until every submitted task has run
+     *
+     * Unlike close(), the queue stays open and nothing is dropped. Pending
+     * timers are not waited for. When called from an executor worker, the
+     * worker runs queued tasks while it waits.
+     */
+    void drain();
+
+    /**
+     * @brief Reopen a closed queue
+     *
+     * Lets a module restart after close().
+     */
+    void reopen();
+
+    /**
+     * @brief Get the queue name
+     *
+     * @return The name given to Executor::createQueue()
+     */
+    const std::string& getName() const { return name_; }
+
+    /**
+     * @brief Whether tasks run one at a time
+     *
+     * @return true for a serial queue
+     */
+    bool isSerial() const { return serial_; }
+
+    /**
+     * @brief Get the number of tasks submitted but not finished
+     *
+     * @return The pending task count
+     */
+    size_t getPendingCount() const;
+
+    /**
+     * @brief Get the number of tasks run to completion
+     *
+     * @return The completed task count
+     */
+    size_t getCompletedCount() const { return completed_.load(); }
+
+private:
+    friend class Executor;
+
+    TaskQueue(Executor& executor, std::string name, bool serial)
+        : executor_(executor), name_(std::move(name)), serial_(serial),
+          account_(ResourceAccounting::accountFor(name_)) {}
+
+    /**
+     * @brief Update the pending task count and the backlog of the queue's account
+     *
+     * @param pending The new count; mutex_ must be held
+     */
+    void setPending(size_t pending);
+
+    /**
+     * @brief Run one task of this queue on the calling worker
+     *
+     * @param task The task
+     * @param generation The open generation the task was submitted in
+     */
+    void runTask(const std::function<void()>& task, uint64_t generation);
+
+    /**
+     * @brief Run the next task of a serial queue and schedule the one after it
+     *
+     * @param generation The open generation the runner was scheduled in
+     */
+    void runSerial(uint64_t generation);
+
+    Executor& executor_;                                  ///< Executor running the tasks
+    std::string name_;                                    ///< Queue name
+    bool serial_;                                         ///< Whether tasks run one at a time
+    ResourceAccounting::Account* account_;                ///< Account charged for the tasks
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::condition_variable idle_;                        ///< Signalled when a running task finishes
+    bool closed_ = false;                                 ///< Whether new tasks are rejected
+    uint64_t generation_ = 0;                             ///< Incremented by close() to invalidate queued tasks
+    size_t pending_ = 0;                                  ///< Submitted tasks not finished yet
+    size_t running_ = 0;                                  ///< Tasks currently running
+    std::deque<std::pair<std::function<void()>, TaskPriority>> serialTasks_; ///< Queued tasks of a serial queue
+    bool serialScheduled_ = false;                        ///< Whether a serial runner is queued or running
+    std::set<Executor::TimerId> timers_;                  ///< Pending timers of this queue
+    std::atomic<size_t> completed_{0};                    ///< Tasks run to completion
+};
+
+} // namespace swarm
+
+#endif // EXECUTOR_H
@@ -0,0 +1,147 @@
+/**
+ * @file lifecycle_profiler.h
+ * @brief Timing of module lifecycle phases with Chrome trace output
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef LIFECYCLE_PROFILER_H
+#define LIFECYCLE_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+
+namespace swarm {
+
+/**
+ * @brief A timed lifecycle phase
+ */
+struct ProfileSpan {
+    std::string module;                                   ///< Module name, or "message-bus"
+    std::string phase;                                    ///< Phase name ("factory", "configure", "start", ...)
+    std::chrono::microseconds begin{0};                   ///< Offset from the creation of the profiler
+    std::chrono::microseconds duration{0};                ///< Time spent in the phase
+    uint32_t thread = 0;                                  ///< Small identifier of the thread that ran the phase
+};
+
+/**
+ * @brief Records how long each module lifecycle phase takes
+ *
+ * ModuleManager records the factory, configure, initialize, start, ready,
+ * stop and shutdown phases of every module, as well as the message bus setup.
+ * The spans can be exported as a Chrome trace (load it in chrome://tracing or
+ * Perfetto) and summarized as a table of per-module phase times.
+ *
+ * Setting the SWARM_PROFILE_TRACE environment variable to a file path makes
+ * the manager write the trace there and print the summary when it shuts down.
+ *
+ * @note This class is thread-safe.
+ * @see ModuleManager::getProfiler()
+ */
+class LifecycleProfiler {
+public:
+    /**
+     * @brief Times a phase from construction to destruction
+     */
+    class Span {
+    public:
+        /**
+         * @brief Start timing a phase
+         *
+         * @param profiler The profiler receiving the span
+         * @param module The module name
+         * @param phase The phase name
+         */
+        Span(LifecycleProfiler& profiler, std::string module, std::string phase)
+            : profiler_(profiler), module_(std::move(module)), phase_(std::move(phase)),
+              begin_(std::chrono::steady_clock::now()) {}
+
+        /**
+         * @brief Record the span
+         */
+        ~Span() { profiler_.record(module_, phase_, begin_, std::chrono::steady_clock::now()); }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        LifecycleProfiler& profiler_;                     ///< Profiler receiving the span
+        std::string module_;                              ///< Module name
+        std::string phase_;                               ///< Phase name
+        std::chrono::steady_clock::time_point begin_;     ///< When the phase began
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * Span offsets are measured from this point.
+     */
+    LifecycleProfiler() : origin_(std::chrono::steady_clock::now()) {}
+
+    /**
+     * @brief Record a phase that has finished
+     *
+     * @param module The module name
+     * @param phase The phase name
+     * @param begin When the phase began
+     * @param end When the phase ended
+     */
+    void record(const std::string& module, const std::string& phase,
+                std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+    /**
+     * @brief Get the recorded spans
+     *
+     * @return The spans, in the order they finished
+     */
+    std::vector<ProfileSpan> getSpans() const;
+
+    /**
+     * @brief Forget the recorded spans
+     */
+    void clear();
+
+    /**
+     * @brief Render the spans as a Chrome trace
+     *
+     * @return JSON in the Trace Event Format, one complete ("X") event per span
+     */
+    std::string toChromeTrace() const;
+
+    /**
+     * @brief Write the Chrome trace to a file
+     *
+     * @param path The file to write
+     * @return true if the file was written
+     */
+    bool writeChromeTrace(const std::string& path) const;
+
+    /**
+     * @brief Render a table of the time spent per module and phase
+     *
+     * Repeated phases of a module (restarts, reloads) are added up.
+     *
+     * @return The table, one row per module, times in milliseconds
+     */
+    std::string summary() const;
+
+    /**
+     * @brief Write the trace and summary if SWARM_PROFILE_TRACE is set
+     *
+     * @param out Stream receiving the summary
+     */
+    void reportIfRequested(std::ostream& out) const;
+
+private:
+    std::chrono::steady_clock::time_point origin_;        ///< Time zero of the span offsets
+    mutable std::mutex mutex_;                            ///< Guards spans_
+    std::vector<ProfileSpan> spans_;                      ///< Recorded spans
+};
+
+} // namespace swarm
+
+#endif // LIFECYCLE_PROFILER_H
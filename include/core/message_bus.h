@@ -8,6 +8,8 @@
 #ifndef MESSAGE_BUS_H
 #define MESSAGE_BUS_H
 
+#include "message_sink.h"
+#include "clock.h"
 #include <string>
 #include <functional>
 #include <map>
@@ -17,12 +19,45 @@
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <cstdint>
 
 // ZeroMQ includes
 #include <zmq.hpp>
 
 namespace swarm {
 
+/**
+ * @brief ZeroMQ transport the bus sockets are bound on
+ *
+ * Subscribers in the same process are always called directly; the transport
+ * only decides who else can reach the bus.
+ */
+enum class BusTransport {
+    Inproc,                                               ///< Same process only, no file or port is used
+    Ipc,                                                  ///< Processes on the same host, over Unix domain sockets
+    Tcp                                                   ///< Processes on any host
+};
+
+/**
+ * @brief Get the name of a transport
+ *
+ * @param transport The transport
+ * @return "inproc", "ipc" or "tcp"
+ */
+const char* toString(BusTransport transport);
+
+/**
+ * @brief Message bus configuration
+ */
+struct MessageBusOptions {
+    BusTransport transport = BusTransport::Tcp;           ///< Transport the sockets are bound on
+    std::string host = "127.0.0.1";                       ///< TCP address to bind
+    int publisherPort = 5555;                             ///< TCP publisher port, the next free one is tried if taken
+    int subscriberPort = 5556;                            ///< TCP subscriber port, the next free one is tried if taken
+    std::string ipcPath = "/tmp/swarm-bus";               ///< IPC socket path prefix, "-pub" and "-sub" are appended
+    std::shared_ptr<Clock> clock = nullptr;               ///< Time messages are stamped with, null for the real time
+};
+
 /**
  * @brief Message bus for inter-module communication using ZeroMQ
  * 
@@ -51,12 +86,19 @@ public:
      */
     using MessageHandler = std::function<void(const std::string&, const std::string&)>;
     
+    /**
+     * @brief Identifier of a single subscription, returned by subscribe()
+     */
+    using SubscriptionId = uint64_t;
+    
     /**
      * @brief Constructor
      * 
      * Initializes the message bus with ZeroMQ context and sockets
+     * 
+     * @param options Transport and endpoints of the sockets
      */
-    MessageBus();
+    explicit MessageBus(const MessageBusOptions& options = MessageBusOptions());
     
     /**
      * @brief Destructor
@@ -78,21 +120,68 @@ public:
      * 
      * @param topic The topic to subscribe to
      * @param handler The function to call when messages are received
+     * @return An identifier that removes exactly this subscription when passed to unsubscribe()
      * @note Multiple handlers can be registered for the same topic
      */
-    void subscribe(const std::string& topic, MessageHandler handler);
+    SubscriptionId subscribe(const std::string& topic, MessageHandler handler);
+    
+    /**
+     * @brief Subscribe a sink to a topic
+     * 
+     * Fast path for receivers that are objects: messages are handed to
+     * MessageSink::deliver() directly, and the sink is kept alive while a
+     * delivery to it is in progress.
+     * 
+     * @param topic The topic to subscribe to
+     * @param sink The receiver
+     * @return An identifier that removes exactly this subscription when passed to unsubscribe()
+     */
+    SubscriptionId subscribe(const std::string& topic, std::shared_ptr<MessageSink> sink);
     
     /**
      * @brief Unsubscribe from a topic
      * 
-     * Removes a message handler from a specific topic.
+     * Removes the message handlers from a specific topic.
      * 
      * @param topic The topic to unsubscribe from
      * @param handler The handler to remove
-     * @note Only the exact handler instance will be removed
+     * @note std::function instances cannot be compared, so all handlers of the
+     *       topic are removed. Use unsubscribe(SubscriptionId) to remove one.
      */
     void unsubscribe(const std::string& topic, MessageHandler handler);
     
+    /**
+     * @brief Remove a single subscription
+     * 
+     * @param id The identifier returned by subscribe()
+     */
+    void unsubscribe(SubscriptionId id);
+    
+    /**
+     * @brief Hold delivery on a topic
+     * 
+     * Messages published to a held topic are buffered instead of being handed to
+     * the subscribers, until releaseTopic() is called as many times as
+     * holdTopic(). Used to switch subscribers without losing messages.
+     * 
+     * Returns once deliveries already in progress on the topic have finished, so
+     * no handler of the topic runs until the topic is released.
+     * 
+     * @param topic The topic to hold
+     * @note Must not be called from a handler of the same topic
+     */
+    void holdTopic(const std::string& topic);
+    
+    /**
+     * @brief Release a held topic
+     * 
+     * Delivers the messages buffered while the topic was held, in publication
+     * order, to the subscribers registered at the time of the release.
+     * 
+     * @param topic The topic to release
+     */
+    void releaseTopic(const std::string& topic);
+    
     /**
      * @brief Publish a message synchronously
      * 
@@ -113,6 +202,19 @@ public:
      */
     void publishAsync(const std::string& topic, const std::string& message);
     
+    /**
+     * @brief Wait until every queued message has been delivered
+     * 
+     * Waits for the asynchronous queue to empty and for deliveries in progress
+     * to finish. Messages published meanwhile are waited for as well. If the
+     * bus is stopped, the queued messages are delivered on the calling thread.
+     * 
+     * @param deadline When to give up waiting
+     * @return true if nothing was left to deliver before the deadline
+     * @note Must not be called from a message handler, which would wait for itself
+     */
+    bool flush(std::chrono::steady_clock::time_point deadline);
+    
     /** @} */
     
     /**
@@ -163,6 +265,34 @@ public:
      */
     size_t getSubscriberCount(const std::string& topic) const;
     
+    /**
+     * @brief Get the transport the sockets are bound on
+     * 
+     * @return The transport
+     */
+    BusTransport getTransport() const { return options_.transport; }
+    
+    /**
+     * @brief Get the clock messages are stamped with
+     * 
+     * @return The clock of the options, or the system clock
+     */
+    const std::shared_ptr<Clock>& getClock() const { return options_.clock; }
+    
+    /**
+     * @brief Get the endpoint other processes subscribe to
+     * 
+     * @return The ZeroMQ endpoint of the publisher socket
+     */
+    const std::string& getPublisherEndpoint() const { return publisherEndpoint_; }
+    
+    /**
+     * @brief Get the endpoint other processes publish to
+     * 
+     * @return The ZeroMQ endpoint of the subscriber socket
+     */
+    const std::string& getSubscriberEndpoint() const { return subscriberEndpoint_; }
+    
     /** @} */
 
 private:
@@ -177,6 +307,66 @@ private:
         std::chrono::system_clock::time_point timestamp;     ///< Message timestamp
     };
     
+    /**
+     * @brief A registered message handler
+     */
+    struct Subscription {
+        SubscriptionId id;                                    ///< Identifier returned by subscribe()
+        MessageHandler handler;                               ///< The handler, empty for sink subscriptions
+        std::shared_ptr<MessageSink> sink;                    ///< The sink, null for handler subscriptions
+    };
+    
+    /** @brief Immutable list of a topic's subscriptions, replaced on every change */
+    using SubscriptionList = std::shared_ptr<const std::vector<Subscription>>;
+    
+    /**
+     * @brief Add a subscription to a topic
+     * 
+     * @param topic The topic
+     * @param subscription The subscription, without identifier
+     * @return The identifier assigned to the subscription
+     */
+    SubscriptionId addSubscription(const std::string& topic, Subscription subscription);
+    
+    /**
+     * @brief Messages buffered for a held topic
+     */
+    struct HeldTopic {
+        size_t holds = 0;                                     ///< Outstanding holdTopic() calls
+        std::vector<std::string> buffered;                    ///< Payloads in publication order
+    };
+    
+    /**
+     * @brief Hand a message to the topic's subscribers, or buffer it if the topic is held
+     * 
+     * @param topic The message topic
+     * @param message The message payload
+     */
+    void dispatch(const std::string& topic, const std::string& message);
+    
+    /**
+     * @brief Take the topic's subscription list and count the delivery as active
+     * 
+     * @param topic The message topic
+     * @param handlers Receives the subscriptions to invoke
+     * @return false if the topic has no subscribers
+     * @note Must be called with subscribersMutex_ held
+     */
+    bool beginDelivery(const std::string& topic, SubscriptionList& handlers);
+    
+    /**
+     * @brief Invoke handlers collected by beginDelivery() and end the delivery
+     * 
+     * Handlers are called without any bus lock held, so they may publish or
+     * change subscriptions themselves.
+     * 
+     * @param topic The message topic
+     * @param message The message payload
+     * @param handlers The handlers to invoke
+     */
+    void completeDelivery(const std::string& topic, const std::string& message,
+                          const SubscriptionList& handlers);
+    
     /**
      * @brief Process messages from the queue
      * 
@@ -198,24 +388,45 @@ private:
      */
     void cleanupZeroMQ();
     
+    /**
+     * @brief Bind a socket on the configured transport
+     * 
+     * TCP binds move to the next port range if the port is taken.
+     * 
+     * @param socket The socket
+     * @param role "pub" or "sub"
+     * @param port The TCP port to try first
+     * @return The bound endpoint
+     */
+    std::string bindSocket(zmq::socket_t& socket, const std::string& role, int port);
+    
+    MessageBusOptions options_;                          ///< Transport and endpoints
+    std::string publisherEndpoint_;                      ///< Bound publisher endpoint
+    std::string subscriberEndpoint_;                     ///< Bound subscriber endpoint
+    
     // ZeroMQ components
     std::unique_ptr<zmq::context_t> context_;        ///< ZeroMQ context
     std::unique_ptr<zmq::socket_t> publisher_socket_; ///< Publisher socket for sending messages
     std::unique_ptr<zmq::socket_t> subscriber_socket_; ///< Subscriber socket for receiving messages
     
     // Internal message handling
-    std::map<std::string, std::vector<MessageHandler>> subscribers_; ///< Topic to handlers mapping
+    std::map<std::string, SubscriptionList> subscribers_;            ///< Topic to handlers mapping
+    std::map<SubscriptionId, std::string> subscriptionTopics_;       ///< Subscription to topic mapping
+    std::map<std::string, HeldTopic> heldTopics_;                    ///< Topics whose delivery is held
+    std::map<std::string, size_t> activeDeliveries_;                 ///< Deliveries in progress per topic
+    std::condition_variable deliveriesDone_;                         ///< Signalled when a delivery finishes
+    SubscriptionId nextSubscriptionId_ = 1;                          ///< Next identifier handed out by subscribe()
     std::vector<Message> messageQueue_;                              ///< Queue for async messages
     mutable std::mutex subscribersMutex_;                            ///< Mutex for subscribers map
     std::mutex queueMutex_;                                          ///< Mutex for message queue
     std::condition_variable queueCondition_;                         ///< Condition variable for queue
+    std::condition_variable queueFlushed_;                           ///< Signalled when the worker finished a batch
+    bool batchInProgress_ = false;                                   ///< Whether the worker is publishing a batch, guarded by queueMutex_
     std::thread workerThread_;                                       ///< Thread for processing messages
     std::atomic<bool> running_;                                      ///< Flag indicating if bus is running
     std::atomic<size_t> messageCount_;                               ///< Total message count
     
     // ZeroMQ configuration
-    static constexpr const char* PUBLISHER_ENDPOINT = "tcp://127.0.0.1:5555";  ///< Publisher endpoint
-    static constexpr const char* SUBSCRIBER_ENDPOINT = "tcp://127.0.0.1:5556"; ///< Subscriber endpoint
     static constexpr int MAX_PORT_RETRIES = 5;                                 ///< Max port retry attempts
     static constexpr int PORT_INCREMENT = 10;                                  ///< Port increment for retries
 };
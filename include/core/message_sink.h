@@ -0,0 +1,43 @@
+/**
+ * @file message_sink.h
+ * @brief Receiver interface for direct message bus delivery
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef MESSAGE_SINK_H
+#define MESSAGE_SINK_H
+
+#include <string>
+
+namespace swarm {
+
+/**
+ * @brief Object the message bus delivers to without a std::function wrapper
+ *
+ * Subscribing a sink with MessageBus::subscribe(topic, sink) makes the bus call
+ * deliver() directly through a single virtual call. The bus keeps a reference
+ * to the sink for the duration of each delivery, so a sink cannot be destroyed
+ * while one of its deliveries is in progress.
+ *
+ * @see Module
+ */
+class MessageSink {
+public:
+    /**
+     * @brief Virtual destructor
+     */
+    virtual ~MessageSink() = default;
+
+    /**
+     * @brief Receive a message
+     *
+     * @param topic The topic the message was published on
+     * @param message The message payload
+     */
+    virtual void deliver(const std::string& topic, const std::string& message) = 0;
+};
+
+} // namespace swarm
+
+#endif // MESSAGE_SINK_H
@@ -8,11 +8,19 @@
 #ifndef MODULE_H
 #define MODULE_H
 
+#include "config_diff.h"
+#include "message_sink.h"
+#include "resource_accounting.h"
 #include <string>
 #include <memory>
 #include <functional>
 #include <map>
 #include <vector>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <cstdint>
+#include <chrono>
 
 namespace swarm {
 
@@ -20,6 +28,53 @@ namespace swarm {
 class ModuleManager;
 class MessageBus;
 
+/**
+ * @brief Delivery counters of a module's declared subscriptions
+ */
+struct DeliveryMetrics {
+    uint64_t delivered = 0;                               ///< Messages handed to onMessage()
+    uint64_t failed = 0;                                  ///< Deliveries whose onMessage() threw
+    std::chrono::nanoseconds totalTime{0};                ///< Time spent in onMessage()
+    std::chrono::nanoseconds maxTime{0};                  ///< Longest single onMessage() call
+};
+
+/**
+ * @brief Lifecycle state of a loaded module
+ */
+enum class ModuleState {
+    Stopped,                                              ///< Loaded but not running
+    Running,                                              ///< Started and serving
+    Restarting,                                           ///< Running, failed, and waiting to be restarted by the supervisor
+    Failed                                                ///< Stopped by the supervisor after too many failures
+};
+
+/**
+ * @brief Get the name of a module state
+ * 
+ * @param state The state
+ * @return "stopped", "running", "restarting" or "failed"
+ */
+const char* toString(ModuleState state);
+
+/**
+ * @brief Status of a loaded module as reported by ModuleManager::getModuleStatuses()
+ * 
+ * The module contributes its counters, gauges and last error through
+ * Module::fillStatus(); the manager adds the lifecycle state, delivery and
+ * supervision counters, uptime and resource usage.
+ */
+struct ModuleStatus {
+    ModuleState state = ModuleState::Stopped;             ///< Lifecycle state
+    std::chrono::milliseconds uptime{0};                  ///< Time since the module was last (re)started, 0 when not running
+    size_t replicas = 1;                                  ///< Number of instances
+    std::string summary;                                  ///< Human-readable text returned by Module::getStatus()
+    std::map<std::string, uint64_t> counters;             ///< Monotonic counters by name
+    std::map<std::string, double> gauges;                 ///< Point-in-time values by name
+    std::string lastError;                                ///< Most recent failure, empty if none
+    ResourceUsage resources;                              ///< Resources used by the module
+    uint64_t version = 0;                                 ///< Changes whenever any field but uptime and resources changes
+};
+
 /**
  * @brief Base module interface for the SwarmApp framework
  * 
@@ -31,7 +86,7 @@ class MessageBus;
  * @see ModuleManager
  * @see MessageBus
  */
-class Module {
+class Module : public MessageSink {
 public:
     /**
      * @brief Virtual destructor
@@ -61,6 +116,9 @@ public:
      * start any threads, services, or other active components.
      * 
      * @note This method is called after initialize() and should be idempotent
+     * @note This method must not block while the module is serving. Modules that
+     *       need time to become ready return true from startsAsynchronously(),
+     *       return from start() immediately and call signalReady() later.
      */
     virtual void start() = 0;
     
@@ -74,6 +132,19 @@ public:
      */
     virtual void stop() = 0;
     
+    /**
+     * @brief Finish the work in progress before a graceful shutdown
+     * 
+     * Called on a running module before stop() when the process shuts down.
+     * The module stops taking new work (connections, scheduled jobs) and waits
+     * for the work it already started, but no longer than @p deadline. Messages
+     * are still delivered while modules drain. stop() always follows.
+     * 
+     * @param deadline When the module must return
+     * @return true if all work in progress finished, true by default
+     */
+    virtual bool drain(std::chrono::steady_clock::time_point deadline) { (void)deadline; return true; }
+    
     /**
      * @brief Shutdown the module
      * 
@@ -86,6 +157,37 @@ public:
     
     /** @} */
     
+    /**
+     * @name Readiness Signalling
+     * @{
+     */
+    
+    /**
+     * @brief Whether the module becomes ready after start() returns
+     * 
+     * Modules returning true must call signalReady() once they are serving (or
+     * signalReady(false) if they failed to come up). Modules returning false are
+     * considered ready as soon as start() returns.
+     * 
+     * @return false by default
+     */
+    virtual bool startsAsynchronously() const { return false; }
+    
+    /**
+     * @brief Get a future that completes when the module is ready
+     * 
+     * The future holds true once the module is serving and false if it failed
+     * to start. A new future is armed every time the module is started.
+     * 
+     * @return The readiness future of the current start attempt
+     */
+    std::shared_future<bool> getReadyFuture() const {
+        std::lock_guard<std::mutex> lock(readinessMutex_);
+        return readyFuture_;
+    }
+    
+    /** @} */
+    
     /**
      * @name Module Identification Methods
      * @{
@@ -133,6 +235,26 @@ public:
      */
     virtual std::string getStatus() const = 0;
     
+    /**
+     * @brief Add the module's own fields to its status
+     * 
+     * Called by ModuleManager::getModuleStatuses() only after the status
+     * version changed, so it may do some work. Modules set counters, gauges and
+     * lastError; the other fields are filled by the manager. For replicated
+     * modules, the first instance reports.
+     * 
+     * @param status The status to fill in
+     * @see statusChanged()
+     */
+    virtual void fillStatus(ModuleStatus& status) const { (void)status; }
+    
+    /**
+     * @brief Get the version of the module's status
+     * 
+     * @return A counter advanced by statusChanged() and by every delivered message
+     */
+    uint64_t getStatusVersion() const { return statusVersion_.load(std::memory_order_acquire); }
+    
     /** @} */
     
     /**
@@ -148,6 +270,50 @@ public:
      */
     virtual bool configure(const std::map<std::string, std::string>& config) = 0;
     
+    /**
+     * @brief Check whether configuration changes can be applied to the live module
+     * 
+     * Called by ModuleManager::reconfigure() with only the keys that change,
+     * on every replica of the module. Nothing may be modified here; a change is
+     * either accepted as a whole or rejected as a whole.
+     * 
+     * @param diff The changed keys
+     * @param error Receives the reason when the changes are rejected
+     * @return true if applyConfig() can apply every change
+     * @note The default rejects all changes: modules opt in to live reconfiguration
+     */
+    virtual bool validateConfig(const ConfigDiff& diff, std::string& error) const {
+        (void)diff; // Suppress unused parameter warning
+        error = "module '" + getName() + "' does not support live reconfiguration";
+        return false;
+    }
+    
+    /**
+     * @brief Apply configuration changes to the live module
+     * 
+     * Only called after validateConfig() of every replica accepted the same
+     * diff. Cannot fail, so that the replicas of a module never end up on
+     * different settings: whatever may go wrong belongs in validateConfig().
+     * May be called while the module is running.
+     * 
+     * @param diff The changed keys
+     */
+    virtual void applyConfig(const ConfigDiff& diff) noexcept { (void)diff; }
+    
+    /**
+     * @brief Get the topics this module receives through onMessage()
+     * 
+     * ModuleManager subscribes the module to these topics once it has started
+     * and unsubscribes it before stopping it. Messages are delivered on the
+     * publishing thread, so onMessage() must not block for long and must not
+     * load, unload, start or stop modules. When the module runs as several
+     * replicas, each message goes to a single replica, on that replica's
+     * executor lane.
+     * 
+     * @return The topics, none by default
+     */
+    virtual std::vector<std::string> getSubscriptions() const { return {}; }
+    
     /**
      * @brief Handle incoming messages
      * 
@@ -159,6 +325,54 @@ public:
      */
     virtual void onMessage(const std::string& topic, const std::string& message) = 0;
     
+    /**
+     * @brief Receive a message for a declared subscription
+     * 
+     * Called by the message bus; forwards to onMessage() and records the
+     * delivery metrics.
+     * 
+     * @param topic The topic the message was published on
+     * @param message The message payload
+     */
+    void deliver(const std::string& topic, const std::string& message) final;
+    
+    /**
+     * @brief Get the delivery counters of the declared subscriptions
+     * 
+     * @return The counters since the module instance was created
+     */
+    DeliveryMetrics getDeliveryMetrics() const;
+    
+    /** @} */
+    
+    /**
+     * @name State Transfer
+     * @{
+     */
+    
+    /**
+     * @brief Serialize the state a replacement instance should take over
+     * 
+     * Called by ModuleManager::reloadModule() on the instance being replaced,
+     * while delivery on its topics is held. Work the module does outside of
+     * message handlers keeps running and is not captured after this call.
+     * 
+     * @return An opaque state blob, empty if the module has no state to transfer
+     * @see StateWriter
+     */
+    virtual std::string exportState() const { return ""; }
+    
+    /**
+     * @brief Take over the state exported by the instance being replaced
+     * 
+     * Called after configure() and before initialize().
+     * 
+     * @param state The blob returned by exportState() of the old instance
+     * @return true if the state was accepted, false to abort the reload
+     * @see StateReader
+     */
+    virtual bool importState(const std::string& state) { (void)state; return true; }
+    
     /** @} */
     
     /**
@@ -197,14 +411,133 @@ public:
     /** @} */
 
 protected:
+    /**
+     * @brief Mark the values reported by getStatus() and fillStatus() as changed
+     * 
+     * Cheap enough to call on every change. Cached statuses are rebuilt on the
+     * next poll.
+     */
+    void statusChanged() { statusVersion_.fetch_add(1, std::memory_order_release); }
+    
+    /**
+     * @brief Report the outcome of an asynchronous start
+     * 
+     * Only the first call after a start takes effect; later calls are ignored.
+     * 
+     * @param ready true if the module is serving, false if it failed to start
+     */
+    void signalReady(bool ready = true) {
+        std::lock_guard<std::mutex> lock(readinessMutex_);
+        if (!readySignalled_) {
+            readySignalled_ = true;
+            readyPromise_.set_value(ready);
+        }
+    }
+    
+    /**
+     * @brief Subscribe to a topic on behalf of this module
+     * 
+     * Subscriptions made through this method are owned by the module: they are
+     * removed when the module is unloaded and switched over to the new instance
+     * without losing messages when the module is reloaded.
+     * 
+     * @param topic The topic to subscribe to
+     * @param handler The function to call when messages are received
+     * @note Requires the message bus to be set, which is the case from configure() on
+     */
+    void subscribe(const std::string& topic,
+                   std::function<void(const std::string&, const std::string&)> handler);
+    
+    /**
+     * @brief Run work of a module-owned thread or task under supervision
+     * 
+     * An exception escaping @p body is reported to the ModuleManager, which
+     * restarts the module with backoff while the bus and the other modules keep
+     * serving. Without a manager, the exception propagates as before.
+     * 
+     * @param body The work, typically a thread's main loop or an executor task
+     * @return true if @p body returned normally, false if it failed and the failure was reported
+     * @see ModuleManager::setRestartPolicy()
+     */
+    bool runSupervised(const std::function<void()>& body);
+    
     /** @brief Reference to the module manager */
     ModuleManager* moduleManager_ = nullptr;
     
     /** @brief Reference to the message bus */
     MessageBus* messageBus_ = nullptr;
     
-    /** @brief Flag indicating if the module is currently running */
-    bool running_ = false;
+    /** @brief Flag indicating if the module is currently running; read from other threads */
+    std::atomic<bool> running_{false};
+
+private:
+    friend class ModuleManager;
+    
+    /**
+     * @brief Arm a fresh readiness future before the module is started
+     */
+    void resetReadiness() {
+        std::lock_guard<std::mutex> lock(readinessMutex_);
+        readyPromise_ = std::promise<bool>();
+        readyFuture_ = readyPromise_.get_future().share();
+        readySignalled_ = false;
+    }
+    
+    /**
+     * @brief Get the topics of the subscriptions owned by this module
+     * 
+     * @return The topics, without duplicates
+     */
+    std::vector<std::string> getSubscribedTopics() const;
+    
+    /**
+     * @brief Remove all subscriptions owned by this module
+     */
+    void unsubscribeAll();
+    
+    /**
+     * @brief Subscribe to the topics returned by getSubscriptions()
+     * 
+     * @param sink Receiver of the messages: this module, or the replica set
+     *             spreading them across the module's instances
+     */
+    void wireSubscriptions(const std::shared_ptr<MessageSink>& sink);
+    
+    /**
+     * @brief Remove the subscriptions made by wireSubscriptions()
+     */
+    void unwireSubscriptions();
+    
+    /**
+     * @brief Install the callback receiving failures caught by runSupervised()
+     * 
+     * @param handler Called with the failure reason; must be set before start()
+     */
+    void setFailureHandler(std::function<void(const std::string&)> handler) { failureHandler_ = std::move(handler); }
+    
+    /**
+     * @brief A subscription owned by the module
+     */
+    struct OwnedSubscription {
+        std::string topic;                                ///< Subscribed topic
+        uint64_t id;                                      ///< Bus subscription identifier
+        bool declared;                                    ///< Whether it comes from getSubscriptions()
+    };
+    
+    mutable std::mutex subscriptionsMutex_;               ///< Guards subscriptions_
+    std::vector<OwnedSubscription> subscriptions_;        ///< Owned subscriptions
+    std::atomic<uint64_t> delivered_{0};                  ///< Messages delivered to onMessage()
+    std::atomic<uint64_t> deliveryFailures_{0};           ///< Deliveries whose onMessage() threw
+    std::atomic<int64_t> deliveryTimeNs_{0};              ///< Total time spent in onMessage()
+    std::atomic<int64_t> maxDeliveryTimeNs_{0};           ///< Longest onMessage() call
+    mutable std::mutex readinessMutex_;                   ///< Guards the readiness state
+    std::promise<bool> readyPromise_;                     ///< Fulfilled by signalReady()
+    std::shared_future<bool> readyFuture_ = readyPromise_.get_future().share(); ///< Future handed out by getReadyFuture()
+    bool readySignalled_ = false;                         ///< Whether the current promise was fulfilled
+    std::function<void(const std::string&)> failureHandler_; ///< Supervisor notified by runSupervised()
+    std::atomic<bool> supervised_{false};                 ///< Whether failures trigger a restart; false while stopping
+    ResourceAccounting::Account* account_ = nullptr;      ///< Account charged for deliveries
+    std::atomic<uint64_t> statusVersion_{0};              ///< Advanced by statusChanged()
 };
 
 } // namespace swarm
@@ -10,11 +10,21 @@
 
 #include "module.h"
 #include "message_bus.h"
+#include "rcu_ptr.h"
+#include "executor.h"
+#include "lifecycle_profiler.h"
+#include "state_snapshot.h"
+#include "socket_handoff.h"
 #include <string>
 #include <memory>
 #include <map>
 #include <vector>
 #include <functional>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <set>
 
 namespace swarm {
 
@@ -25,6 +35,65 @@ namespace swarm {
  */
 using ModuleFactory = std::function<std::unique_ptr<Module>()>;
 
+/**
+ * @brief Startup timing for a single module
+ * 
+ * Filled in by ModuleManager::startAllModules() for every module it attempted to start
+ */
+struct ModuleStartupTiming {
+    bool started = false;                                ///< Whether the module started successfully
+    std::chrono::milliseconds startTime{0};              ///< Time spent starting this module alone
+    std::chrono::milliseconds readyAt{0};                ///< Offset from the beginning of startup until the module was ready
+    std::chrono::milliseconds criticalPath{0};           ///< Longest chain of dependency start times ending at this module
+};
+
+/**
+ * @brief Report produced by the most recent ModuleManager::startAllModules() call
+ */
+struct StartupReport {
+    std::chrono::milliseconds totalTime{0};              ///< Wall-clock time of the whole startup
+    std::vector<std::string> startOrder;                 ///< Topological order of the modules that were scheduled
+    std::map<std::string, ModuleStartupTiming> modules;  ///< Per-module timings
+};
+
+/**
+ * @brief When and how fast failed modules are restarted
+ * 
+ * The delay before a restart starts at initialBackoff and doubles with every
+ * consecutive failure, up to maxBackoff. A module that failed maxRestarts
+ * times in a row is stopped instead. A module that ran for resetAfter without
+ * failing starts over with the initial delay.
+ */
+struct RestartPolicy {
+    std::chrono::milliseconds initialBackoff{100};       ///< Delay before the first restart
+    std::chrono::milliseconds maxBackoff{30000};         ///< Upper bound of the delay
+    size_t maxRestarts = 5;                              ///< Consecutive restarts before giving up, 0 to never restart
+    std::chrono::milliseconds resetAfter{60000};         ///< Failure-free time after which the backoff starts over
+};
+
+/**
+ * @brief Supervision counters of a module
+ */
+struct SupervisionStats {
+    uint64_t crashes = 0;                                ///< Failures reported through Module::runSupervised()
+    uint64_t restarts = 0;                               ///< Restarts that brought the module back
+    uint64_t failedRestarts = 0;                         ///< Restarts that did not
+    std::chrono::milliseconds lastRestartTime{0};        ///< From the last failure until the module was serving again
+    std::string lastFailure;                             ///< Reason of the last failure
+    bool gaveUp = false;                                 ///< Whether the module was stopped after too many failures
+};
+
+/**
+ * @brief How the messages of a replicated module are spread across its instances
+ * 
+ * Selected with the "load_balancing" configuration key.
+ */
+enum class LoadBalancing {
+    RoundRobin,                                          ///< Instances take turns ("round_robin", the default)
+    KeyHash,                                             ///< Messages with the same key go to the same instance ("key_hash")
+    LeastLoaded                                          ///< The instance with the fewest queued messages ("least_loaded")
+};
+
 /**
  * @brief Module manager for handling module lifecycle and dependencies
  * 
@@ -35,11 +104,25 @@ using ModuleFactory = std::function<std::unique_ptr<Module>()>;
  * Features:
  * - Module registration and factory management
  * - Dependency resolution and management
+ * - Parallel, dependency-ordered startup and shutdown
+ * - A shared executor with a fixed thread budget for module work
  * - Module lifecycle control (load, start, stop, unload)
  * - Status monitoring and reporting
  * - Message bus integration
  * 
- * @note This class is not thread-safe and should be used from a single thread
+ * The module registry is a snapshot published through an RcuPtr. Its map and
+ * the factory, instances and configuration of its entries do not change once
+ * published; only each entry's lifecycle flags (running, hung and the start
+ * time) are atomics written in place. Lookups (getModule(), acquireModule(),
+ * isModuleRunning(), getLoadedModules(), ...) never take a lock, while
+ * registration and lifecycle changes are serialized and publish a new
+ * snapshot. getModuleStatuses() reads the snapshot without a lock but takes
+ * the status cache and supervision locks to refresh stale statuses. Module
+ * instances are reference counted, so an instance obtained through
+ * acquireModule() stays alive even if the module is unloaded concurrently.
+ * 
+ * @note This class is thread-safe. Module lifecycle callbacks (start(), stop(),
+ *       ...) must not load, unload, start or stop other modules.
  * @see Module
  * @see MessageBus
  */
@@ -52,6 +135,26 @@ public:
      */
     ModuleManager();
     
+    /**
+     * @brief Constructor with an explicit thread budget
+     * 
+     * With a clock in the options, executor timers (and so scheduled module
+     * work, restart backoffs and periodic snapshots) and message timestamps
+     * run in that clock's time.
+     * 
+     * @param executorOptions Options of the shared executor
+     */
+    explicit ModuleManager(const ExecutorOptions& executorOptions);
+    
+    /**
+     * @brief Constructor with an explicit thread budget and bus transport
+     * 
+     * @param executorOptions Options of the shared executor
+     * @param busOptions Transport and endpoints of the message bus; without a
+     *                   clock of its own, the bus uses the executor's
+     */
+    ModuleManager(const ExecutorOptions& executorOptions, const MessageBusOptions& busOptions);
+    
     /**
      * @brief Destructor
      * 
@@ -83,6 +186,39 @@ public:
      */
     void unregisterModule(const std::string& name);
     
+    /**
+     * @brief Register the module plugins found in a directory
+     * 
+     * Every shared object in @p directory is registered under the module name
+     * derived from its file name (see pluginModuleName()). Nothing is loaded at
+     * this point: a plugin is dlopen()ed the first time its module is loaded.
+     * Names that are already registered are left untouched.
+     * 
+     * @param directory The directory to scan
+     * @return The number of plugins registered
+     */
+    size_t scanPluginDirectory(const std::string& directory);
+    
+    /**
+     * @brief Load a module plugin immediately and register its module
+     * 
+     * @param path Path of the shared object
+     * @return true if the plugin was loaded and its module registered
+     */
+    bool registerPlugin(const std::string& path);
+    
+    /**
+     * @brief Derive a module name from a plugin file name
+     * 
+     * Strips the "lib" prefix, the ".so" extension and, when present, the
+     * "swarm-" prefix and "-plugin" suffix: "libswarm-health-monitor-plugin.so"
+     * provides "health-monitor".
+     * 
+     * @param fileName The plugin file name, without directory
+     * @return The module name, or an empty string if the file is not a plugin
+     */
+    static std::string pluginModuleName(const std::string& fileName);
+    
     /** @} */
     
     /**
@@ -95,11 +231,23 @@ public:
      * 
      * Creates a module instance and initializes it with the given configuration.
      * 
+     * With more than one replica, every instance is created, configured and
+     * initialized the same way and gets its own serial lane on the shared
+     * executor. Each message on the module's declared subscriptions
+     * (Module::getSubscriptions()) is then handed to a single instance, picked
+     * according to the "load_balancing" configuration key; for "key_hash" the
+     * key is the first line of the payload. Messages of one key keep their
+     * order, other messages may be handled concurrently by different replicas.
+     * Lifecycle calls, reloads and reconfigurations apply to every instance,
+     * while getModule() and acquireModule() return the first one.
+     * 
      * @param name The name of the module to load
      * @param config Configuration parameters for the module
+     * @param replicas Number of instances to run in this process
      * @return true if the module was loaded successfully, false otherwise
      */
-    bool loadModule(const std::string& name, const std::map<std::string, std::string>& config = {});
+    bool loadModule(const std::string& name, const std::map<std::string, std::string>& config = {},
+                    size_t replicas = 1);
     
     /**
      * @brief Unload a module
@@ -114,23 +262,102 @@ public:
     /**
      * @brief Start a module
      * 
-     * Starts a loaded module.
+     * Starts a loaded module and waits until it reports ready. The call fails if
+     * the module does not become ready within its start deadline.
      * 
      * @param name The name of the module to start
-     * @return true if the module was started successfully, false otherwise
+     * @return true if the module was started and is ready, false otherwise
+     * @see setStartTimeout()
      */
     bool startModule(const std::string& name);
     
     /**
      * @brief Stop a module
      * 
-     * Stops a running module.
+     * Stops a running module. The call fails if the module's stop() does not
+     * return within its stop deadline.
      * 
      * @param name The name of the module to stop
      * @return true if the module was stopped successfully, false otherwise
+     * @see setStopTimeout()
      */
     bool stopModule(const std::string& name);
     
+    /**
+     * @brief Replace a loaded module with a fresh instance without losing messages
+     * 
+     * A new instance is created from the module's factory and configured with
+     * @p config. Delivery on the topics the old instance subscribed to is held,
+     * the old instance's exportState() is handed to the new instance's
+     * importState(), and the new instance is initialized and, if the old one was
+     * running, started alongside it. The subscriptions are then switched over,
+     * the held messages are delivered to the new instance in order, and the old
+     * instance is stopped and shut down.
+     * 
+     * If any step fails before the switch, the new instance is discarded and the
+     * old one keeps serving, including the messages held in the meantime.
+     * 
+     * @param name The name of the module to reload
+     * @param config Configuration for the new instance
+     * @return true if the new instance took over, false otherwise
+     * @note Must not be called from a message handler of the module being reloaded
+     */
+    bool reloadModule(const std::string& name, const std::map<std::string, std::string>& config);
+    
+    /**
+     * @brief Change the configuration of a loaded module in place
+     * 
+     * Only the keys of @p delta whose value differs from the module's current
+     * configuration are considered. The keys "start_timeout_ms",
+     * "stop_timeout_ms" and "load_balancing" are handled by the manager; all
+     * other changed keys are passed to validateConfig() of every replica and,
+     * if all of them accept every change, to applyConfig() of every replica.
+     * Either all changes take effect on all replicas or none does.
+     * 
+     * The same operation is available on the message bus: a message published
+     * to "config.<module>" carries "key=value" lines, and the outcome ("ok" or
+     * "error: <reason>") is published to "config.<module>.result".
+     * 
+     * @param name The name of the module
+     * @param delta The keys to change and their new values
+     * @param error Receives the reason when the changes are rejected, may be nullptr
+     * @return true if the changes were applied (or nothing changed), false otherwise
+     * @note The "config.<module>" topic is served on the publishing thread, so it
+     *       must not be published from module lifecycle callbacks
+     */
+    bool reconfigure(const std::string& name, const std::map<std::string, std::string>& delta,
+                     std::string* error = nullptr);
+    
+    /**
+     * @brief Get the current configuration of a loaded module
+     * 
+     * @param name The name of the module
+     * @return The configuration the module was loaded with plus applied changes
+     */
+    std::map<std::string, std::string> getModuleConfig(const std::string& name) const;
+    
+    /**
+     * @brief Get the delivery counters of the modules' declared subscriptions
+     * 
+     * @return The counters of every loaded module, summed over its replicas
+     * @see Module::getSubscriptions()
+     */
+    std::map<std::string, DeliveryMetrics> getDeliveryMetrics() const;
+    
+    /**
+     * @brief Parse the payload of a "config.<module>" message
+     * 
+     * Every non-empty line that does not start with '#' must have the form
+     * "key=value"; whitespace around keys and values is ignored.
+     * 
+     * @param message The message payload
+     * @param delta Receives the parsed key-value pairs
+     * @param error Receives the reason when the payload is malformed
+     * @return true if the payload was parsed
+     */
+    static bool parseConfigMessage(const std::string& message, std::map<std::string, std::string>& delta,
+                                   std::string& error);
+    
     /** @} */
     
     /**
@@ -141,24 +368,127 @@ public:
     /**
      * @brief Start all loaded modules
      * 
-     * Starts all modules that are currently loaded but not running.
+     * Starts all modules that are currently loaded but not running. The modules
+     * are ordered by their declared dependencies: a module is started as soon as
+     * every module it depends on is running, and modules without a pending
+     * dependency are started concurrently.
+     * 
+     * @return false if the dependency graph contains a cycle (nothing is started)
+     *         or if any module failed to start, true otherwise
+     * @see getStartupReport()
      */
-    void startAllModules();
+    bool startAllModules();
     
     /**
      * @brief Stop all running modules
      * 
-     * Stops all modules that are currently running.
+     * Stops all modules that are currently running, in reverse dependency order.
+     * A module is stopped once every running module that depends on it has been
+     * stopped; independent modules are stopped concurrently.
      */
     void stopAllModules();
     
     /**
      * @brief Shutdown all modules
      * 
-     * Stops and unloads all modules, performing a complete shutdown.
+     * Stops and unloads all modules, performing a complete shutdown. When
+     * snapshots are enabled, the state of the stopped modules is saved before
+     * they are unloaded and periodic snapshots end. Then waits up to the
+     * default stop deadline for start() and stop() calls that overran their
+     * deadline and reports those still running; the executor finishes them
+     * when the manager is destroyed.
      */
     void shutdownAllModules();
     
+    /**
+     * @brief Prepare a graceful shutdown
+     * 
+     * Stops restarting failed modules, lets every running module finish its
+     * work in progress with Module::drain(), dependents first, and then waits
+     * for the message bus to deliver everything queued. Modules keep running;
+     * call shutdownAllModules() afterwards.
+     * 
+     * @param deadline When draining must end
+     * @return true if everything was drained before the deadline
+     */
+    bool drain(std::chrono::steady_clock::time_point deadline);
+    
+    /**
+     * @brief Set the default start deadline
+     * 
+     * Time a module may take from the call to start() until it is ready. A module
+     * can override it with the "start_timeout_ms" configuration key. Zero disables
+     * the deadline.
+     * 
+     * @param timeout The deadline, 30 seconds by default
+     */
+    void setStartTimeout(std::chrono::milliseconds timeout) { startTimeoutMs_ = timeout.count(); }
+    
+    /**
+     * @brief Set the default stop deadline
+     * 
+     * Time a module's stop() may take. A module can override it with the
+     * "stop_timeout_ms" configuration key. Zero disables the deadline.
+     * 
+     * @param timeout The deadline, 10 seconds by default
+     */
+    void setStopTimeout(std::chrono::milliseconds timeout) { stopTimeoutMs_ = timeout.count(); }
+    
+    /**
+     * @brief Set the restart policy of the supervisor
+     * 
+     * Modules report failures of their own threads and tasks through
+     * Module::runSupervised(). The supervisor then replaces the failed module
+     * with a fresh instance, like reloadModule() with its current configuration
+     * and the state exported by the failed instance, after the backoff delay.
+     * A failure of any replica restarts all of them.
+     * 
+     * @param policy The policy for all modules
+     */
+    void setRestartPolicy(const RestartPolicy& policy);
+    
+    /**
+     * @brief Get the supervision counters of every module that failed so far
+     * 
+     * @return The counters keyed by module name
+     */
+    std::map<std::string, SupervisionStats> getSupervisionStats() const;
+    
+    /** @} */
+    
+    /**
+     * @name State Snapshots
+     * @{
+     */
+    
+    /**
+     * @brief Save module state to a file and restore it on the next start
+     * 
+     * Reads the snapshot left in @p path by a previous run, if any. Every
+     * module loaded afterwards whose state is in the snapshot gets it through
+     * importState() between configure() and initialize(), so it serves its
+     * previous data as soon as it starts. A module that rejects its state
+     * starts cold. Each module's state is handed out once.
+     * 
+     * From then on, the state of every loaded module is written to @p path
+     * every @p interval and by shutdownAllModules(). Modules' exportState()
+     * may therefore be called while they run.
+     * 
+     * @param path The snapshot file
+     * @param interval Time between periodic snapshots, zero to only save at shutdown
+     * @return true if a valid snapshot from a previous run was found
+     * @note Call before loading modules
+     */
+    bool enableSnapshots(const std::string& path, std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+    
+    /**
+     * @brief Write a snapshot now
+     * 
+     * @return true if the snapshot was written, false if snapshots are not
+     *         enabled or the file could not be written
+     */
+    bool saveSnapshot();
+    
     /** @} */
     
     /**
@@ -171,9 +501,30 @@ public:
      * 
      * @param name The name of the module
      * @return Pointer to the module, or nullptr if not found
+     * @note The pointer is only valid while the module stays loaded. Threads that
+     *       may race with unloadModule() should use acquireModule() instead.
      */
     Module* getModule(const std::string& name) const;
     
+    /**
+     * @brief Get a counted reference to a module by name
+     * 
+     * The returned reference keeps the instance alive even if the module is
+     * unloaded concurrently.
+     * 
+     * @param name The name of the module
+     * @return Shared pointer to the module, or nullptr if not loaded
+     */
+    std::shared_ptr<Module> acquireModule(const std::string& name) const;
+    
+    /**
+     * @brief Get counted references to every instance of a module
+     * 
+     * @param name The name of the module
+     * @return The instances, first one first, or an empty vector if not loaded
+     */
+    std::vector<std::shared_ptr<Module>> acquireReplicas(const std::string& name) const;
+    
     /**
      * @brief Get list of loaded modules
      * 
@@ -227,6 +578,17 @@ public:
      */
     MessageBus* getMessageBus() { return &messageBus_; }
     
+    /**
+     * @brief Get the shared executor
+     * 
+     * Modules submit their work here, normally through a TaskQueue named after
+     * the module, instead of creating their own threads. The manager also uses
+     * it to start and stop modules in parallel.
+     * 
+     * @return The executor owned by the module manager
+     */
+    Executor* getExecutor() { return &executor_; }
+    
     /** @} */
     
     /**
@@ -237,9 +599,25 @@ public:
     /**
      * @brief Get status of all modules
      * 
-     * @return Map of module names to their status strings
+     * Statuses are cached: getStatus() and fillStatus() are only called for a
+     * module whose status version or lifecycle changed since the last call.
+     * Uptime and resource usage (CPU time, threads, allocations, task backlog)
+     * are read on every call.
+     * 
+     * @return Map of module names to their status
+     * @see ResourceAccounting
      */
-    std::map<std::string, std::string> getModuleStatuses() const;
+    std::map<std::string, ModuleStatus> getModuleStatuses() const;
+    
+    /**
+     * @brief Get the version of the module statuses
+     * 
+     * Pollers can skip getModuleStatuses() while the version stays the same.
+     * 
+     * @return A counter advanced whenever a field of a status other than
+     *         uptime and resources changes, or a module is loaded or unloaded
+     */
+    uint64_t getStatusVersion() const;
     
     /**
      * @brief Check if a module is running
@@ -249,22 +627,233 @@ public:
      */
     bool isModuleRunning(const std::string& name) const;
     
+    /**
+     * @brief Get the number of start() and stop() calls running past their deadline
+     * 
+     * Such calls keep an executor worker busy until they return.
+     * 
+     * @return The overdue call count
+     */
+    size_t getOverdueCallCount() const;
+    
+    /**
+     * @brief Get the timings of the most recent startAllModules() call
+     * 
+     * @return The startup report, empty if startAllModules() was never called
+     */
+    StartupReport getStartupReport() const;
+    
+    /**
+     * @brief Get the lifecycle profiler
+     * 
+     * Holds the duration of every lifecycle phase of every module (factory,
+     * configure, initialize, start, ready, stop, shutdown) and of the message
+     * bus setup, for the lifetime of the manager.
+     * 
+     * @return The profiler owned by the module manager
+     */
+    LifecycleProfiler* getProfiler() { return &profiler_; }
+    
+    /**
+     * @brief Get the listening sockets of the process
+     * 
+     * Modules that accept connections get their listening sockets here, so a
+     * replacement process can inherit them and take over without refusing
+     * connections.
+     * 
+     * @return The socket handoff owned by the module manager
+     */
+    SocketHandoff* getSocketHandoff() { return &socketHandoff_; }
+    
     /** @} */
 
 private:
+    /**
+     * @brief The instances of a replicated module and their executor lanes
+     */
+    class ReplicaSet;
+    
     /**
      * @brief Internal module information structure
      * 
-     * Contains all information about a registered module
+     * Contains all information about a registered module. Once published, only
+     * the atomic lifecycle flags (running, hung, startedAt) change in place;
+     * loading, unloading and reconfiguring publish a replacement entry.
      */
     struct ModuleInfo {
-        std::unique_ptr<Module> module;                    ///< The module instance
         ModuleFactory factory;                             ///< Factory function to create the module
-        bool loaded;                                       ///< Whether the module is loaded
-        bool running;                                      ///< Whether the module is running
+        std::shared_ptr<Module> module;                    ///< The module instance (the first replica), null while not loaded
+        std::shared_ptr<ReplicaSet> replicas;              ///< All instances when the module has several, null otherwise
         std::map<std::string, std::string> config;         ///< Module configuration
+        std::atomic<bool> running{false};                  ///< Whether the module is running
+        std::atomic<bool> hung{false};                     ///< Whether a start() or stop() call overran its deadline
+        std::atomic<std::chrono::steady_clock::time_point> startedAt{}; ///< When the module was last started
+        
+        /** @brief Whether the module is loaded */
+        bool loaded() const { return module != nullptr; }
+        
+        /**
+         * @brief Take over the in-place lifecycle state of the entry this one replaces
+         * 
+         * Used when an entry is rebuilt around the same, still running instances.
+         * 
+         * @param previous The entry being replaced
+         */
+        void keepLifecycleOf(const ModuleInfo& previous) {
+            running = previous.running.load();
+            hung = previous.hung.load();
+            startedAt = previous.startedAt.load();
+        }
     };
     
+    /** @brief Registry snapshot; the map itself never changes once published */
+    using Registry = std::map<std::string, std::shared_ptr<ModuleInfo>>;
+    
+    /**
+     * @brief Get every instance of a loaded entry
+     * 
+     * @param info The module's registry entry
+     * @return The replicas, or the single instance
+     */
+    static std::vector<std::shared_ptr<Module>> instancesOf(const ModuleInfo& info);
+    
+    /**
+     * @brief Look up a registry entry without locking
+     * 
+     * @param name The name of the module
+     * @return The entry, or nullptr if the module is not registered
+     */
+    std::shared_ptr<ModuleInfo> findEntry(const std::string& name) const;
+    
+    /**
+     * @brief Publish a registry snapshot with one entry replaced or removed
+     * 
+     * @param name The name of the module
+     * @param entry The new entry, or nullptr to remove the module
+     * @note Callers hold mutationMutex_; concurrent publishers (parallel
+     *       shutdown workers) are serialized by publishMutex_
+     */
+    void publishEntry(const std::string& name, std::shared_ptr<ModuleInfo> entry);
+    
+    /**
+     * @name Lifecycle implementations
+     * 
+     * Called with mutationMutex_ held (or from workers of a caller holding it).
+     * @{
+     */
+    bool unloadModuleLocked(const std::string& name);
+    bool reloadModuleLocked(const std::string& name, const std::map<std::string, std::string>& config);
+    bool startModuleLocked(const std::string& name);
+    bool stopModuleLocked(const std::string& name);
+    /** @} */
+    
+    /**
+     * @brief Start the instance of an entry and wait until it is ready
+     * 
+     * The entry does not need to be published, which lets reloadModule() start a
+     * replacement instance before it takes over.
+     * 
+     * @param name The name of the module, for logging
+     * @param entry The entry whose instance to start
+     * @return true if the instance started and is ready
+     */
+    bool startEntry(const std::string& name, ModuleInfo& entry);
+    
+    /**
+     * @brief Stop the instance of an entry
+     * 
+     * @param name The name of the module, for logging
+     * @param entry The entry whose instance to stop
+     * @return true if stop() returned within the deadline
+     */
+    bool stopEntry(const std::string& name, ModuleInfo& entry);
+    
+    /**
+     * @brief Route the failures of a module instance to the supervisor
+     * 
+     * @param name The name of the module
+     * @param instance The instance to supervise
+     */
+    void supervise(const std::string& name, Module& instance);
+    
+    /**
+     * @brief Handle a failure reported by a module instance
+     * 
+     * @param name The name of the module
+     * @param instance The instance that failed
+     * @param reason The failure reason
+     */
+    void onModuleFailure(const std::string& name, const Module* instance, const std::string& reason);
+    
+    /**
+     * @brief Schedule the next restart attempt of a failed module, or give up
+     * 
+     * @param name The name of the module
+     * @note Must be called with supervisorMutex_ held
+     */
+    void scheduleRestartLocked(const std::string& name);
+    
+    /**
+     * @brief Replace a failed module with a fresh instance
+     * 
+     * @param name The name of the module
+     */
+    void restartModule(const std::string& name);
+    
+    /**
+     * @brief Stop restarting failed modules and cancel pending restarts
+     */
+    void stopSupervisor();
+    
+    /**
+     * @brief Serve a message published to a module's configuration topic
+     * 
+     * @param name The name of the module
+     * @param message The message payload
+     */
+    void handleConfigMessage(const std::string& name, const std::string& message);
+    
+    /**
+     * @brief Rebuild the cached statuses that are out of date
+     * 
+     * @return The cached statuses of the loaded modules, without uptime and resources
+     */
+    std::map<std::string, ModuleStatus> refreshStatuses() const;
+    
+    /**
+     * @brief Build the status of a module
+     * 
+     * @param name The name of the module
+     * @param entry The module's registry entry
+     * @return The status, without uptime and resources
+     */
+    ModuleStatus buildStatus(const std::string& name, const ModuleInfo& entry) const;
+    
+    /**
+     * @brief Write the state of every loaded module to the snapshot file
+     * 
+     * @return true if the snapshot was written
+     * @note Must be called with snapshotMutex_ held
+     */
+    bool writeSnapshotLocked();
+    
+    /**
+     * @brief Schedule the next periodic snapshot
+     * 
+     * @note Must be called with snapshotMutex_ held
+     */
+    void scheduleSnapshot();
+    
+    /**
+     * @brief Look up the state of a module in the snapshot of the previous run
+     * 
+     * loadModule() removes the state once the module is loaded.
+     * 
+     * @param name The name of the module
+     * @return The state of each replica, empty if the snapshot has none
+     */
+    std::vector<std::string> restoredStateOf(const std::string& name);
+    
     /**
      * @brief Check if all dependencies are satisfied
      * 
@@ -280,7 +869,93 @@ private:
      */
     void loadModuleDependencies(const std::string& moduleName);
     
-    std::map<std::string, ModuleInfo> modules_;           ///< Registry of all modules
+    /**
+     * @brief Order modules so that every module follows its dependencies
+     * 
+     * Dependencies outside of @p names are ignored.
+     * 
+     * @param names The modules to order
+     * @param order Receives the topological order
+     * @return false if the dependencies among @p names contain a cycle
+     */
+    bool sortByDependencies(const std::vector<std::string>& names, std::vector<std::string>& order) const;
+    
+    /**
+     * @brief Resolve a lifecycle deadline for a module
+     * 
+     * @param info The module's registry entry
+     * @param key The configuration key that overrides the default
+     * @param fallback The manager-wide default
+     * @return The deadline to apply
+     */
+    static std::chrono::milliseconds deadlineFor(const ModuleInfo& info, const std::string& key,
+                                                 std::chrono::milliseconds fallback);
+    
+    /**
+     * @brief Run a start() or stop() call within a deadline
+     * 
+     * The call runs as a high-priority executor task; a worker waiting for it
+     * runs queued tasks meanwhile. When the deadline passes first, a call no
+     * worker has picked up is dropped, and a running one is counted as overdue
+     * until it returns. A zero timeout runs @p fn inline without a deadline.
+     * 
+     * @param name The module the call belongs to
+     * @param fn The call; exceptions it throws are rethrown
+     * @param timeout The deadline
+     * @return false if the deadline passed before the call returned
+     */
+    bool runWithDeadline(const std::string& name, std::function<void()> fn, std::chrono::milliseconds timeout);
+    
+    RcuPtr<Registry> modules_;                            ///< Registry of all modules
+    mutable std::mutex mutationMutex_;                    ///< Serializes registry and lifecycle changes
+    std::mutex publishMutex_;                             ///< Serializes snapshot publication
+    std::map<std::string, MessageBus::SubscriptionId> configSubscriptions_; ///< Configuration topic subscriptions of loaded modules, guarded by mutationMutex_
+    StartupReport startupReport_;                         ///< Timings of the last startAllModules() call
+    mutable std::mutex reportMutex_;                      ///< Guards startupReport_
+    std::atomic<std::chrono::milliseconds::rep> startTimeoutMs_{30000}; ///< Default start deadline
+    std::atomic<std::chrono::milliseconds::rep> stopTimeoutMs_{10000};  ///< Default stop deadline
+    mutable std::mutex overdueMutex_;                     ///< Guards overdueCalls_
+    std::condition_variable overdueReturned_;             ///< Signalled when an overdue call returns
+    std::multiset<std::string> overdueCalls_;             ///< Modules of the calls running past their deadline
+    /**
+     * @brief A status built by buildStatus() and the versions it reflects
+     */
+    struct CachedStatus {
+        const Module* module = nullptr;                    ///< First instance the status was built from
+        uint64_t moduleVersion = 0;                        ///< Sum of the instances' status versions
+        uint64_t lifecycleVersion = 0;                     ///< lifecycleVersion_ when it was built
+        ModuleStatus status;                               ///< The status, without uptime and resources
+    };
+    
+    std::atomic<uint64_t> lifecycleVersion_{0};           ///< Advanced by every lifecycle and supervision change
+    mutable std::mutex statusMutex_;                      ///< Guards statusCache_ and statusVersion_
+    mutable std::map<std::string, CachedStatus> statusCache_; ///< Statuses by module name
+    mutable uint64_t statusVersion_ = 0;                  ///< Advanced whenever a cached status is rebuilt or dropped
+    /**
+     * @brief Supervisor bookkeeping of a module
+     */
+    struct SupervisionState {
+        SupervisionStats stats;                            ///< Exposed counters
+        size_t consecutive = 0;                            ///< Restarts since the backoff was last reset
+        bool restartPending = false;                       ///< Whether a restart (or giving up) is scheduled or running
+        std::chrono::steady_clock::time_point failedAt;    ///< Time of the last failure
+        Executor::TimerId timer = 0;                       ///< Scheduled restart
+    };
+    
+    mutable std::mutex supervisorMutex_;                  ///< Guards the supervisor members
+    std::map<std::string, SupervisionState> supervision_; ///< Supervisor bookkeeping of modules that failed
+    RestartPolicy restartPolicy_;                         ///< Restart policy
+    bool supervisorStopped_ = false;                      ///< Whether the destructor stopped the supervisor
+    std::mutex snapshotMutex_;                            ///< Guards the snapshot members and serializes snapshot writes
+    std::string snapshotPath_;                            ///< Snapshot file, empty while snapshots are disabled
+    StateSnapshot restoredSnapshot_;                      ///< States from the previous run not handed out yet
+    std::chrono::milliseconds snapshotInterval_{0};       ///< Time between periodic snapshots
+    Executor::TimerId snapshotTimer_ = 0;                 ///< Pending periodic snapshot
+    bool snapshotsStopped_ = false;                       ///< Whether shutdownAllModules() took the final snapshot
+    SocketHandoff socketHandoff_;                         ///< Listening sockets, outlive the modules
+    LifecycleProfiler profiler_;                          ///< Lifecycle phase timings
+    Executor executor_;                                   ///< Shared thread pool, outlives the message bus
+    std::chrono::steady_clock::time_point busSetupBegin_ = std::chrono::steady_clock::now(); ///< When the message bus construction began
     MessageBus messageBus_;                               ///< Message bus for inter-module communication
     bool initialized_;                                     ///< Whether the manager has been initialized
 };
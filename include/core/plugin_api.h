@@ -0,0 +1,67 @@
+/**
+ * @file plugin_api.h
+ * @brief C entry point exported by modules built as shared-object plugins
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef PLUGIN_API_H
+#define PLUGIN_API_H
+
+#include "module.h"
+#include <cstdint>
+
+/**
+ * @brief Version of the plugin ABI
+ *
+ * Bumped whenever SwarmPluginDescriptor or the Module class layout changes.
+ * ModuleManager refuses plugins built against a different version.
+ */
+#define SWARM_PLUGIN_ABI_VERSION 7u
+
+/**
+ * @brief Name of the symbol every plugin exports
+ */
+#define SWARM_PLUGIN_ENTRY_POINT "swarm_plugin_descriptor"
+
+extern "C" {
+
+/**
+ * @brief Description of the module a plugin provides
+ *
+ * Returned by the plugin's entry point. All pointers must stay valid for as
+ * long as the plugin is loaded.
+ */
+struct SwarmPluginDescriptor {
+    uint32_t abiVersion;                                  ///< Must equal SWARM_PLUGIN_ABI_VERSION
+    const char* name;                                     ///< Module name, as used with ModuleManager::loadModule()
+    const char* version;                                  ///< Module version
+    swarm::Module* (*create)();                           ///< Creates a new module instance
+};
+
+/**
+ * @brief Signature of the plugin entry point
+ */
+typedef const SwarmPluginDescriptor* (*SwarmPluginEntryPoint)();
+
+}
+
+/**
+ * @brief Define the entry point of a plugin providing module @p Type
+ *
+ * Use exactly once per plugin, at namespace scope:
+ * @code
+ * SWARM_DECLARE_PLUGIN(swarm::HealthMonitorModule, "health-monitor", "1.0.0")
+ * @endcode
+ */
+#define SWARM_DECLARE_PLUGIN(Type, Name, Version)                                   \
+    extern "C" __attribute__((visibility("default")))                               \
+    const SwarmPluginDescriptor* swarm_plugin_descriptor() {                        \
+        static const SwarmPluginDescriptor descriptor = {                           \
+            SWARM_PLUGIN_ABI_VERSION, Name, Version,                                \
+            []() -> swarm::Module* { return new Type(); }                           \
+        };                                                                          \
+        return &descriptor;                                                         \
+    }
+
+#endif // PLUGIN_API_H
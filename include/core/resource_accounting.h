@@ -0,0 +1,134 @@
+/**
+ * @file resource_accounting.h
+ * @brief Per-module CPU time, allocation, thread and backlog accounting
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef RESOURCE_ACCOUNTING_H
+#define RESOURCE_ACCOUNTING_H
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace swarm {
+
+/**
+ * @brief Resources used by a module
+ */
+struct ResourceUsage {
+    std::chrono::nanoseconds cpuTime{0};                  ///< CPU time of the module's threads and of the work run for it
+    size_t threads = 0;                                   ///< Live threads owned by the module
+    uint64_t allocatedBytes = 0;                          ///< Bytes allocated on its behalf in total, 0 unless allocation accounting is built in
+    uint64_t liveBytes = 0;                               ///< Of those, bytes not freed yet
+    uint64_t allocations = 0;                             ///< Allocations made on its behalf
+    size_t queueBacklog = 0;                              ///< Tasks submitted to its task queues and not finished yet
+};
+
+/**
+ * @brief Attributes process resources to modules
+ *
+ * Work is charged to a module in two ways:
+ * - Threads the module owns call attachThread() when they begin. The thread is
+ *   named after the module (visible in top -H and /proc) and its CPU time
+ *   from then on, read from /proc/self/task/TID/stat, is charged to the module.
+ * - Work done for the module on shared threads (executor tasks of the
+ *   module's task queues, message deliveries, lifecycle calls) runs inside a
+ *   Scope, which charges the thread CPU time (CLOCK_THREAD_CPUTIME_ID) spent
+ *   in it. Nested scopes charge their own time only.
+ *
+ * Allocations are counted when the core is built with SWARM_ALLOC_ACCOUNTING,
+ * which replaces the global operator new and charges every allocation to the
+ * module the calling thread works for. Each allocation carries a small header
+ * naming that module, so freeing it, on any thread, lowers the module's live
+ * bytes again. Task queues named after a module, or
+ * "module#N" for replica lanes, report their backlog to that module.
+ *
+ * @note This class is thread-safe. Accounts live for the whole process.
+ * @see ModuleManager::getModuleStatuses()
+ */
+class ResourceAccounting {
+public:
+    /**
+     * @brief Counters of one module
+     */
+    struct Account {
+        std::string module;                               ///< Module name
+        std::atomic<int64_t> cpuNs{0};                    ///< CPU time of scopes and of exited threads
+        std::atomic<uint64_t> allocatedBytes{0};          ///< Bytes allocated
+        std::atomic<int64_t> liveBytes{0};                ///< Bytes allocated and not freed yet
+        std::atomic<uint64_t> allocations{0};             ///< Allocation count
+        std::atomic<int64_t> backlog{0};                  ///< Unfinished tasks of the module's queues
+        std::map<long, int64_t> threads;                  ///< Attached live threads and their CPU time in ns when attached, guarded by the registry lock
+    };
+
+    /**
+     * @brief Charges the work of the calling thread to an account while in scope
+     */
+    class Scope {
+    public:
+        /**
+         * @brief Start charging to an account
+         *
+         * @param account The account, or nullptr to charge nobody
+         */
+        explicit Scope(Account* account);
+
+        /**
+         * @brief Charge the time spent and return to the enclosing account
+         */
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Account* previous_;                               ///< Account of the enclosing scope
+    };
+
+    /**
+     * @brief Get the account of a module, creating it on first use
+     *
+     * A "#N" suffix, as used by replica lanes, is ignored.
+     *
+     * @param module The module or task queue name
+     * @return The account; the pointer stays valid for the whole process
+     */
+    static Account* accountFor(const std::string& module);
+
+    /**
+     * @brief Charge the calling thread to a module until it exits
+     *
+     * @param module The module owning the thread
+     */
+    static void attachThread(const std::string& module);
+
+    /**
+     * @brief Get the resources used by a module
+     *
+     * @param module The module name
+     * @return The usage; all zero for a module that never used anything
+     */
+    static ResourceUsage getUsage(const std::string& module);
+
+    /**
+     * @brief Whether allocations are counted
+     *
+     * @return true if the core was built with SWARM_ALLOC_ACCOUNTING
+     */
+    static bool tracksAllocations();
+
+    /**
+     * @brief CPU time of the calling thread
+     *
+     * @return The thread CPU time so far
+     */
+    static std::chrono::nanoseconds threadCpuTime();
+};
+
+} // namespace swarm
+
+#endif // RESOURCE_ACCOUNTING_H
@@ -0,0 +1,139 @@
+/**
+ * @file runtime.h
+ * @brief Event loop of a swarm-app process: signals, periodic work and graceful drain
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <functional>
+#include <chrono>
+#include <csignal>
+
+namespace swarm {
+
+/**
+ * @brief Runtime options
+ */
+struct RuntimeOptions {
+    std::chrono::milliseconds drainTimeout{5000};         ///< Time the drain may take before the process is ended anyway
+    std::chrono::milliseconds tickInterval{0};            ///< Period of the tick handler, 0 for none
+};
+
+/**
+ * @brief Main loop of a process
+ *
+ * The runtime blocks SIGINT and SIGTERM and receives them through a signalfd,
+ * so signals are handled as ordinary events on the loop thread instead of in
+ * a signal handler. requestStop() wakes the loop through an eventfd. On either,
+ * the loop stops ticking and calls the drain handler immediately, with a
+ * deadline of drainTimeout. A watchdog thread ends the process with exit code
+ * 1 if the drain is not done by then, or when a second signal arrives, so a
+ * shutdown never takes longer than the deadline:
+ * @code
+ * Runtime runtime(options);                    // before any other thread starts
+ * ModuleManager manager(...);
+ * runtime.onDrain([&](auto deadline) {
+ *     bool drained = manager.drain(deadline);
+ *     manager.shutdownAllModules();            // also covered by the deadline
+ *     return drained;
+ * });
+ * return runtime.run();
+ * @endcode
+ *
+ * @note The signal mask is inherited by threads created afterwards, so the
+ *       runtime must be created before any other thread, or those threads
+ *       receive the signals instead.
+ */
+class Runtime {
+public:
+    /** @brief Periodic work */
+    using TickHandler = std::function<void()>;
+
+    /** @brief Graceful shutdown work, returns true if everything was drained */
+    using DrainHandler = std::function<bool(std::chrono::steady_clock::time_point deadline)>;
+
+    /**
+     * @brief Block the shutdown signals and create the loop's descriptors
+     *
+     * @param options Runtime options
+     */
+    explicit Runtime(const RuntimeOptions& options = RuntimeOptions());
+
+    /**
+     * @brief Close the descriptors and restore the signal mask
+     */
+    ~Runtime();
+
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
+    /**
+     * @brief Set the periodic work
+     *
+     * @param handler Called on the loop thread every tickInterval
+     */
+    void onTick(TickHandler handler);
+
+    /**
+     * @brief Set the graceful shutdown work
+     *
+     * @param handler Called on the loop thread when a stop is requested
+     */
+    void onDrain(DrainHandler handler);
+
+    /**
+     * @brief Run the loop until a stop is requested and the drain is done
+     *
+     * @return 0 if the drain handler drained everything, 1 otherwise
+     */
+    int run();
+
+    /**
+     * @brief Ask the loop to stop
+     *
+     * @note Thread-safe and async-signal-safe
+     */
+    void requestStop();
+
+    /**
+     * @brief Get the signal that stopped the loop
+     *
+     * @return The signal number, or 0 if the loop was stopped by requestStop()
+     *         or is still running
+     */
+    int getStopSignal() const { return stopSignal_; }
+
+private:
+    /**
+     * @brief Close the descriptors and restore the signal mask
+     */
+    void release();
+
+    /**
+     * @brief Wait for a stop event, running the tick handler meanwhile
+     */
+    void waitForStop();
+
+    /**
+     * @brief End the process if the drain overruns its deadline or a second signal arrives
+     *
+     * @param deadline The drain deadline
+     */
+    void watchdog(std::chrono::steady_clock::time_point deadline);
+
+    RuntimeOptions options_;                              ///< Runtime options
+    TickHandler tickHandler_;                             ///< Periodic work
+    DrainHandler drainHandler_;                           ///< Graceful shutdown work
+    sigset_t previousMask_;                               ///< Signal mask before the runtime blocked the signals
+    int signalFd_ = -1;                                   ///< signalfd of SIGINT and SIGTERM
+    int stopFd_ = -1;                                     ///< eventfd written by requestStop()
+    int drainedFd_ = -1;                                  ///< eventfd that releases the watchdog
+    int stopSignal_ = 0;                                  ///< Signal that stopped the loop
+};
+
+} // namespace swarm
+
+#endif // RUNTIME_H
@@ -0,0 +1,183 @@
+/**
+ * @file runtime_config.h
+ * @brief Deployment configuration of the swarm-app runtime
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include "executor.h"
+#include "message_bus.h"
+#include <string>
+#include <map>
+#include <vector>
+#include <chrono>
+
+namespace swarm {
+
+/**
+ * @brief A module the runtime loads
+ */
+struct RuntimeModuleSpec {
+    std::string name;                                     ///< Module name
+    size_t replicas = 1;                                  ///< Number of replicas
+    std::map<std::string, std::string> config;            ///< Configuration passed to the module
+};
+
+/**
+ * @brief Configuration of one swarm-app process
+ *
+ * The configuration is an INI-style file. The modules are loaded in the order
+ * of their sections; "replicas" is read by the runtime, all other keys of a
+ * module section are passed to the module:
+ * @code
+ * [runtime]
+ * threads = 4
+ * snapshot = /var/lib/swarm/state.snap
+ *
+ * [bus]
+ * transport = auto        # auto, inproc, ipc or tcp
+ * peers = api             # hosts of the other processes of the deployment
+ *
+ * [module health-monitor]
+ * default_interval_ms = 10000
+ *
+ * [check api-server]
+ * type = http
+ * endpoint = http://api:8083/health
+ * @endcode
+ *
+ * The environment overrides the file, in two ways:
+ * - SWARM_<SECTION>__<KEY>, e.g. SWARM_BUS__TRANSPORT or
+ *   SWARM_MODULE_HEALTH_MONITOR__MAX_FAILURES, sets any key of an existing
+ *   section. Names are upper-cased with '-' written as '_'. SWARM_MODULES
+ *   replaces the module list with a comma-separated list of NAME[:REPLICAS].
+ * - The variables the compose files set (API_PORT, HEALTH_CHECK_INTERVAL,
+ *   ZMQ_PUB_PORT, ...) set the matching key of the module or bus section.
+ *   They have a lower precedence than SWARM_ variables.
+ *
+ * With transport = auto the bus uses the cheapest transport that reaches every
+ * peer: inproc when all modules of the deployment run in this process, ipc
+ * when the peers are on the same host and tcp otherwise. A monolith and a
+ * split deployment therefore only differ in their configuration files.
+ */
+class RuntimeConfig {
+public:
+    /**
+     * @brief A section of the configuration
+     */
+    struct Section {
+        std::string kind;                                 ///< First word of the header, e.g. "module"
+        std::string name;                                 ///< Rest of the header, empty for [runtime] and [bus]
+        std::map<std::string, std::string> values;        ///< Keys and values
+    };
+
+    /**
+     * @brief Parse configuration text, replacing the current configuration
+     *
+     * @param text The configuration
+     * @param error Receives the line and reason when parsing fails
+     * @return true if the text was valid
+     */
+    bool parse(const std::string& text, std::string& error);
+
+    /**
+     * @brief Parse a configuration file
+     *
+     * @param path The file
+     * @param error Receives the reason when loading fails
+     * @return true if the file was read and valid
+     */
+    bool load(const std::string& path, std::string& error);
+
+    /**
+     * @brief Apply environment overrides
+     *
+     * @param environment Variable names and values
+     * @param error Receives the reason when an override is invalid
+     * @return true if all overrides were valid
+     */
+    bool applyEnvironment(const std::map<std::string, std::string>& environment, std::string& error);
+
+    /**
+     * @brief Get the environment of the process
+     *
+     * @return Variable names and values
+     */
+    static std::map<std::string, std::string> processEnvironment();
+
+    /**
+     * @brief Get a value
+     *
+     * @param section Section kind, or "kind name"
+     * @param key The key
+     * @param defaultValue Returned if the section or key does not exist
+     * @return The value
+     */
+    std::string get(const std::string& section, const std::string& key,
+                    const std::string& defaultValue = "") const;
+
+    /**
+     * @brief Get all sections of a kind, in file order
+     *
+     * @param kind The section kind, e.g. "check"
+     * @return The sections
+     */
+    std::vector<const Section*> sections(const std::string& kind) const;
+
+    /**
+     * @brief Get the modules to load, in file order
+     *
+     * @return The module specifications
+     */
+    std::vector<RuntimeModuleSpec> modules() const;
+
+    /**
+     * @brief Get the executor options of the [runtime] section
+     *
+     * @return The options
+     */
+    ExecutorOptions executorOptions() const;
+
+    /**
+     * @brief Get the message bus options of the [bus] section
+     *
+     * @return The options, with transport = auto resolved
+     */
+    MessageBusOptions busOptions() const;
+
+    /**
+     * @brief Write the configuration in file syntax
+     *
+     * @return The configuration, with overrides applied
+     */
+    std::string toString() const;
+
+private:
+    /**
+     * @brief Find a section
+     *
+     * @param kind The section kind
+     * @param name The section name
+     * @return The section, or nullptr
+     */
+    Section* find(const std::string& kind, const std::string& name);
+    const Section* find(const std::string& kind, const std::string& name) const;
+
+    /**
+     * @brief Replace the module sections with a NAME[:REPLICAS] list
+     *
+     * @param list Comma-separated module list
+     * @param error Receives the reason when the list is invalid
+     * @return true if the list was valid
+     */
+    bool setModuleList(const std::string& list, std::string& error);
+
+    std::vector<Section> sections_;                       ///< Sections in file order
+};
+
+} // namespace swarm
+
+#endif // RUNTIME_CONFIG_H
@@ -0,0 +1,170 @@
+/**
+ * @file socket_handoff.h
+ * @brief Listening sockets passed from a running process to its replacement
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef SOCKET_HANDOFF_H
+#define SOCKET_HANDOFF_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+namespace swarm {
+
+/**
+ * @brief Listening sockets shared by the modules of a process and handed to its successor
+ *
+ * Modules get their listening sockets from acquireListener() instead of binding
+ * them, so a restart can keep them open. The running process serves a Unix
+ * socket; a new process started with the same path connects to it and receives
+ * every listening socket with SCM_RIGHTS before its modules start:
+ * @code
+ * // new process
+ * handoff.inherit(path, error);         // before the modules are initialized
+ * manager.startAllModules();            // acquireListener() returns the inherited sockets
+ * handoff.complete();                   // the old process stops accepting and drains
+ * handoff.serve(path, [&runtime]() { runtime.requestStop(); }, error);
+ * @endcode
+ * Both processes accept on the same kernel socket until the old one drains, so
+ * no connection is refused during the upgrade. If the new process exits or
+ * disconnects before complete(), the old process keeps serving.
+ *
+ * @note Thread-safe
+ */
+class SocketHandoff {
+public:
+    /** @brief Called once the successor took over */
+    using HandedOffHandler = std::function<void()>;
+
+    SocketHandoff() = default;
+
+    /**
+     * @brief Stop serving and close the sockets
+     *
+     * The Unix socket is unlinked unless a successor took over, which serves
+     * on the same path by then.
+     */
+    ~SocketHandoff();
+
+    SocketHandoff(const SocketHandoff&) = delete;
+    SocketHandoff& operator=(const SocketHandoff&) = delete;
+
+    /**
+     * @brief Get a listening TCP socket, inherited or newly bound
+     *
+     * The sockets are shared by address, so replicas and reloaded modules
+     * accept on the same socket.
+     *
+     * @param host Address to bind
+     * @param port Port to bind
+     * @param error Receives the reason when binding fails
+     * @return A descriptor the caller owns and closes, or -1
+     */
+    int acquireListener(const std::string& host, int port, std::string& error);
+
+    /**
+     * @brief Give up a socket returned by acquireListener()
+     *
+     * The handoff's copy is closed with the last user, so the port is freed
+     * once the users closed their descriptors as well.
+     *
+     * @param host Address of the socket
+     * @param port Port of the socket
+     */
+    void releaseListener(const std::string& host, int port);
+
+    /**
+     * @brief Receive the listening sockets of a running predecessor
+     *
+     * @param path Unix socket of the predecessor
+     * @param error Receives the reason when the transfer fails
+     * @return true if the sockets were received or no predecessor runs
+     */
+    bool inherit(const std::string& path, std::string& error);
+
+    /**
+     * @brief Tell the predecessor that this process serves now
+     *
+     * Inherited sockets no module acquired are closed.
+     *
+     * @return true if a predecessor was told
+     */
+    bool complete();
+
+    /**
+     * @brief Hand the listening sockets to a successor on request
+     *
+     * @param path Unix socket to serve, replaced if it exists
+     * @param onHandedOff Called on the handoff thread once a successor called complete()
+     * @param error Receives the reason when the socket cannot be bound
+     * @return true if serving
+     */
+    bool serve(const std::string& path, HandedOffHandler onHandedOff, std::string& error);
+
+    /**
+     * @brief Get the addresses of the inherited listening sockets
+     *
+     * @return "host:port" of every socket received from a predecessor
+     */
+    std::vector<std::string> getInherited() const;
+
+    /**
+     * @brief Check whether a successor took over
+     *
+     * @return true after the successor called complete()
+     */
+    bool isHandedOff() const;
+
+    /**
+     * @brief Bind a listening TCP socket
+     *
+     * @param host Address to bind, empty or "0.0.0.0" for any
+     * @param port Port to bind
+     * @param error Receives the reason when binding fails
+     * @return The descriptor, or -1
+     */
+    static int bindTcpListener(const std::string& host, int port, std::string& error);
+
+private:
+    /**
+     * @brief A listening socket
+     */
+    struct Listener {
+        int fd = -1;                                      ///< The handoff's copy of the socket
+        bool inherited = false;                           ///< Whether it came from a predecessor
+        size_t users = 0;                                 ///< acquireListener() calls not released yet
+    };
+
+    /**
+     * @brief Accept successors until one takes over or the handoff is destroyed
+     */
+    void serveLoop();
+
+    /**
+     * @brief Send the listening sockets to a successor and wait for complete()
+     *
+     * @param client Connection to the successor
+     * @return true if the successor took over
+     */
+    bool handOff(int client);
+
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::map<std::string, Listener> listeners_;           ///< Listening sockets by "host:port"
+    int predecessorFd_ = -1;                              ///< Connection to the predecessor until complete()
+    int serverFd_ = -1;                                   ///< Unix socket successors connect to
+    int wakeFd_ = -1;                                     ///< eventfd that ends the serving thread
+    std::string path_;                                    ///< Path of serverFd_
+    bool handedOff_ = false;                              ///< Whether a successor took over
+    HandedOffHandler onHandedOff_;                        ///< Called once a successor took over
+    std::thread serverThread_;                            ///< Serves serverFd_
+};
+
+} // namespace swarm
+
+#endif // SOCKET_HANDOFF_H
@@ -0,0 +1,185 @@
+/**
+ * @file state_codec.h
+ * @brief Helpers for encoding module state handed over during a reload
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef STATE_CODEC_H
+#define STATE_CODEC_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace swarm {
+
+/**
+ * @brief Appends fields to a state blob
+ *
+ * Integers are stored as 8 little-endian bytes and strings are length
+ * prefixed, so blobs may contain arbitrary binary data. Fields carry no type
+ * tags: a StateReader must read them back in the order they were written.
+ *
+ * @see Module::exportState()
+ */
+class StateWriter {
+public:
+    /**
+     * @brief Append an unsigned integer
+     *
+     * @param value The value to append
+     */
+    void writeUInt(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            data_.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    /**
+     * @brief Append a signed integer
+     *
+     * @param value The value to append
+     */
+    void writeInt(int64_t value) { writeUInt(static_cast<uint64_t>(value)); }
+
+    /**
+     * @brief Append a boolean
+     *
+     * @param value The value to append
+     */
+    void writeBool(bool value) { data_.push_back(value ? 1 : 0); }
+
+    /**
+     * @brief Append a string
+     *
+     * @param value The value to append
+     */
+    void writeString(const std::string& value) {
+        writeUInt(value.size());
+        data_.append(value);
+    }
+
+    /**
+     * @brief Get the encoded blob
+     *
+     * @return The fields written so far
+     */
+    const std::string& str() const { return data_; }
+
+private:
+    std::string data_;                                    ///< Encoded fields
+};
+
+/**
+ * @brief Reads fields from a blob produced by StateWriter
+ *
+ * Reads past the end of the blob fail and put the reader into a failed state,
+ * after which every read fails; check ok() once all fields were read.
+ *
+ * @see Module::importState()
+ */
+class StateReader {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param data The blob to read; must outlive the reader
+     */
+    explicit StateReader(const std::string& data) : data_(data) {}
+
+    /**
+     * @brief Read an unsigned integer
+     *
+     * @param value Receives the value
+     * @return true if the field was read
+     */
+    bool readUInt(uint64_t& value) {
+        if (!require(8)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[offset_++])) << (8 * i);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read a signed integer
+     *
+     * @param value Receives the value
+     * @return true if the field was read
+     */
+    bool readInt(int64_t& value) {
+        uint64_t raw = 0;
+        if (!readUInt(raw)) {
+            return false;
+        }
+        value = static_cast<int64_t>(raw);
+        return true;
+    }
+
+    /**
+     * @brief Read a boolean
+     *
+     * @param value Receives the value
+     * @return true if the field was read
+     */
+    bool readBool(bool& value) {
+        if (!require(1)) {
+            return false;
+        }
+        value = data_[offset_++] != 0;
+        return true;
+    }
+
+    /**
+     * @brief Read a string
+     *
+     * @param value Receives the value
+     * @return true if the field was read
+     */
+    bool readString(std::string& value) {
+        uint64_t size = 0;
+        if (!readUInt(size) || !require(size)) {
+            return false;
+        }
+        value.assign(data_, offset_, static_cast<size_t>(size));
+        offset_ += static_cast<size_t>(size);
+        return true;
+    }
+
+    /**
+     * @brief Whether every read so far succeeded
+     *
+     * @return false once a read ran past the end of the blob
+     */
+    bool ok() const { return ok_; }
+
+    /**
+     * @brief Whether the whole blob has been consumed
+     *
+     * @return true if no bytes are left
+     */
+    bool atEnd() const { return offset_ == data_.size(); }
+
+private:
+    /**
+     * @brief Check that @p size more bytes are available
+     */
+    bool require(uint64_t size) {
+        if (!ok_ || size > data_.size() - offset_) {
+            ok_ = false;
+        }
+        return ok_;
+    }
+
+    const std::string& data_;                             ///< The blob being read
+    size_t offset_ = 0;                                   ///< Read position
+    bool ok_ = true;                                      ///< Whether all reads succeeded
+};
+
+} // namespace swarm
+
+#endif // STATE_CODEC_H
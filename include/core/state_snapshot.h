@@ -0,0 +1,122 @@
+/**
+ * @file state_snapshot.h
+ * @brief File holding the exported state of every module for a warm restart
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace swarm {
+
+/**
+ * @brief The exported state of a set of modules
+ *
+ * Each module contributes the blobs returned by Module::exportState(), one per
+ * replica. The file format is a fixed magic number and format version, the
+ * time the snapshot was taken, the module entries, and a trailing FNV-1a
+ * checksum over everything before it, all encoded with StateWriter. Files are
+ * replaced atomically: the snapshot is written to a temporary file, flushed to
+ * disk and renamed over the previous one, so a crash leaves either the old or
+ * the new snapshot.
+ *
+ * @see ModuleManager::enableSnapshots()
+ */
+class StateSnapshot {
+public:
+    /** @brief First field of every snapshot file ("SWSNAP01") */
+    static constexpr uint64_t kMagic = 0x313050414e535753ull;
+
+    /** @brief Current file format version */
+    static constexpr uint64_t kVersion = 1;
+
+    /**
+     * @brief Set the state of a module
+     *
+     * @param module The module name
+     * @param states The exported state of each replica
+     */
+    void set(const std::string& module, std::vector<std::string> states) { entries_[module] = std::move(states); }
+
+    /**
+     * @brief Look up the state of a module
+     *
+     * @param module The module name
+     * @return The exported state of each replica, or nullptr if the module is not in the snapshot
+     */
+    const std::vector<std::string>* find(const std::string& module) const {
+        auto it = entries_.find(module);
+        return (it != entries_.end()) ? &it->second : nullptr;
+    }
+
+    /**
+     * @brief Remove a module from the snapshot
+     *
+     * @param module The module name
+     */
+    void erase(const std::string& module) { entries_.erase(module); }
+
+    /**
+     * @brief Get all module entries
+     *
+     * @return The states keyed by module name
+     */
+    const std::map<std::string, std::vector<std::string>>& entries() const { return entries_; }
+
+    /**
+     * @brief Get the time the snapshot was taken
+     *
+     * @return The time set by save() or read by load()
+     */
+    std::chrono::system_clock::time_point getSavedAt() const { return savedAt_; }
+
+    /**
+     * @brief Encode the snapshot
+     *
+     * @param savedAt The time to record as the snapshot time
+     * @return The file contents
+     */
+    std::string encode(std::chrono::system_clock::time_point savedAt) const;
+
+    /**
+     * @brief Decode a snapshot
+     *
+     * @param data The file contents
+     * @param error Receives the reason when the data is not a valid snapshot
+     * @return true if the snapshot was decoded
+     */
+    bool decode(const std::string& data, std::string& error);
+
+    /**
+     * @brief Write the snapshot to a file, replacing it atomically
+     *
+     * @param path The snapshot file
+     * @param error Receives the reason when the file cannot be written
+     * @return true if the snapshot was written
+     */
+    bool save(const std::string& path, std::string& error);
+
+    /**
+     * @brief Read a snapshot file
+     *
+     * @param path The snapshot file
+     * @param error Receives the reason when the file cannot be read or is invalid
+     * @return true if the snapshot was read
+     */
+    bool load(const std::string& path, std::string& error);
+
+private:
+    std::map<std::string, std::vector<std::string>> entries_; ///< Replica states by module name
+    std::chrono::system_clock::time_point savedAt_;       ///< When the snapshot was taken
+};
+
+} // namespace swarm
+
+#endif // STATE_SNAPSHOT_H
@@ -0,0 +1,178 @@
+/**
+ * @file static_module_set.h
+ * @brief Compile-time registry of the modules built into a binary
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef STATIC_MODULE_SET_H
+#define STATIC_MODULE_SET_H
+
+#include "module_manager.h"
+#include <array>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
+
+namespace swarm {
+
+/**
+ * @brief Stands for a module type in StaticModuleSet::forEach()
+ */
+template <typename M>
+struct ModuleTag {
+    using type = M;                                       ///< The module type
+};
+
+/**
+ * @brief Check that no name appears twice
+ *
+ * @param names The names
+ * @return true if all names differ
+ */
+template <size_t N>
+constexpr bool distinctNames(const std::array<std::string_view, N>& names) {
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            if (names[i] == names[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief A set of module types fixed at compile time
+ *
+ * Every module type names itself with a `static constexpr const char
+ * kModuleName[]` member, which is also what its getName() returns. The set
+ * gives each module a compile-time ID (its position in the list), looks names
+ * up in constant expressions, and registers a factory per module with a
+ * ModuleManager, so a binary contains exactly the modules listed:
+ * @code
+ * using AppModules = StaticModuleSet<HealthMonitorModule, ApiModule>;
+ * AppModules::registerAll(manager);
+ * AppModules::get<HealthMonitorModule>(manager)->addHealthCheck(check);
+ * @endcode
+ *
+ * get() and acquire() return the concrete type without a dynamic_cast. When
+ * the module class is final, calls made through them are devirtualized.
+ *
+ * @tparam Modules The module types, derived from Module and default-constructible
+ */
+template <typename... Modules>
+class StaticModuleSet {
+    static_assert((std::is_base_of_v<Module, Modules> && ...), "StaticModuleSet members must derive from Module");
+    static_assert((std::is_default_constructible_v<Modules> && ...),
+                  "StaticModuleSet members must be default-constructible");
+
+public:
+    /** @brief Number of modules in the set */
+    static constexpr size_t kSize = sizeof...(Modules);
+
+    /** @brief Module names, indexed by ID */
+    static constexpr std::array<std::string_view, kSize> kNames = {std::string_view(Modules::kModuleName)...};
+
+    /**
+     * @brief Look up a module ID by name
+     *
+     * @param name The module name
+     * @return The ID, or kSize if no module of the set has that name
+     */
+    static constexpr size_t find(std::string_view name) {
+        for (size_t i = 0; i < kSize; i++) {
+            if (kNames[i] == name) {
+                return i;
+            }
+        }
+        return kSize;
+    }
+
+    /**
+     * @brief Check whether a module type is part of the set
+     *
+     * @tparam M The module type
+     * @return true if @p M is in the set
+     */
+    template <typename M>
+    static constexpr bool contains() {
+        return (std::is_same_v<M, Modules> || ...);
+    }
+
+    /**
+     * @brief Get the ID of a module type
+     *
+     * @tparam M The module type, which must be part of the set
+     * @return The position of @p M in the set
+     */
+    template <typename M>
+    static constexpr size_t idOf() {
+        static_assert(contains<M>(), "Module type is not part of this StaticModuleSet");
+        constexpr bool matches[] = {std::is_same_v<M, Modules>..., false};
+        size_t id = 0;
+        while (!matches[id]) {
+            id++;
+        }
+        return id;
+    }
+
+    /**
+     * @brief Register a factory for every module of the set
+     *
+     * @param manager The module manager
+     */
+    static void registerAll(ModuleManager& manager) {
+        (manager.registerModule(Modules::kModuleName, []() { return std::make_unique<Modules>(); }), ...);
+    }
+
+    /**
+     * @brief Get the loaded instance of a module
+     *
+     * @tparam M The module type, which must be part of the set
+     * @param manager The module manager the set was registered with
+     * @return The module, or nullptr if it is not loaded
+     * @note The same lifetime rules as ModuleManager::getModule() apply.
+     */
+    template <typename M>
+    static M* get(const ModuleManager& manager) {
+        static_assert(contains<M>(), "Module type is not part of this StaticModuleSet");
+        return static_cast<M*>(manager.getModule(M::kModuleName));
+    }
+
+    /**
+     * @brief Get a counted reference to the loaded instance of a module
+     *
+     * @tparam M The module type, which must be part of the set
+     * @param manager The module manager the set was registered with
+     * @return The module, or nullptr if it is not loaded
+     */
+    template <typename M>
+    static std::shared_ptr<M> acquire(const ModuleManager& manager) {
+        static_assert(contains<M>(), "Module type is not part of this StaticModuleSet");
+        return std::static_pointer_cast<M>(manager.acquireModule(M::kModuleName));
+    }
+
+    /**
+     * @brief Call a function once per module type, in ID order
+     *
+     * @param fn Called with a ModuleTag<M> for every module type M
+     */
+    template <typename Fn>
+    static void forEach(Fn&& fn) {
+        (fn(ModuleTag<Modules>{}), ...);
+    }
+
+    /**
+     * @brief The set extended with more module types
+     */
+    template <typename... More>
+    using With = StaticModuleSet<Modules..., More...>;
+
+    static_assert(distinctNames(kNames), "StaticModuleSet members must have distinct kModuleName values");
+};
+
+} // namespace swarm
+
+#endif // STATIC_MODULE_SET_H
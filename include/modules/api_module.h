@@ -1,8 +1,9 @@
 #pragma once
 
 #include "core/module.h"
+#include "core/socket_handoff.h"
 #include <oatpp/network/Server.hpp>
-#include <oatpp/network/tcp/server/ConnectionProvider.hpp>
+#include <oatpp/network/ConnectionProvider.hpp>
 #include <oatpp/web/server/HttpConnectionHandler.hpp>
 #include <oatpp/web/server/HttpRouter.hpp>
 #include <oatpp/Environment.hpp>
@@ -10,19 +11,74 @@
 #include <string>
 #include <map>
 #include <atomic>
+#include <thread>
+#include <mutex>
 
 namespace swarm {
 
 // Simple HTTP Request Handler
 class SimpleHttpHandler : public oatpp::web::server::HttpRequestHandler {
 public:
+    // inFlight counts the requests being handled
+    explicit SimpleHttpHandler(std::shared_ptr<std::atomic<int>> inFlight);
+    
     std::shared_ptr<oatpp::web::protocol::http::outgoing::Response> handle(
         const std::shared_ptr<oatpp::web::protocol::http::incoming::Request>& request) override;
+    
+private:
+    std::shared_ptr<oatpp::web::protocol::http::outgoing::Response> respond(
+        const std::shared_ptr<oatpp::web::protocol::http::incoming::Request>& request);
+    
+    std::shared_ptr<std::atomic<int>> m_inFlight;
+};
+
+// Accepts connections on a listening socket that was bound by the module's
+// SocketHandoff or inherited from a previous process. Unlike the Oat++ TCP
+// provider it never shuts the socket down, so another process can keep
+// accepting on it after this one stopped.
+class ListenerConnectionProvider : public oatpp::network::ServerConnectionProvider {
+public:
+    // Takes ownership of listenerFd
+    ListenerConnectionProvider(int listenerFd, const std::string& host, int port);
+    ~ListenerConnectionProvider() override;
+    
+    oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> get() override;
+    
+    // Synchronous only: throws. The module serves through the blocking
+    // HttpConnectionHandler, and stop()/interrupt() wake a get() blocked in
+    // poll() through the eventfd; an async accept would need its own wake-up
+    // and non-blocking accepted sockets. Switching to the async handler means
+    // implementing this with a non-blocking accept4() on the shared socket.
+    oatpp::async::CoroutineStarterForResult<const oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>&> getAsync() override;
+    
+    // Wakes a blocked get() and closes this process's descriptor of the socket
+    void stop() override;
+    
+    // Wakes a blocked get() so the server re-checks its run condition; the socket stays open
+    void interrupt();
+    
+private:
+    class ConnectionInvalidator : public oatpp::provider::Invalidator<oatpp::data::stream::IOStream> {
+    public:
+        void invalidate(const std::shared_ptr<oatpp::data::stream::IOStream>& connection) override;
+    };
+    
+    void closeListener();
+    
+    std::mutex m_mutex;
+    int m_listenerFd;
+    int m_wakeFd;
+    bool m_accepting;
+    bool m_closed;
+    std::shared_ptr<ConnectionInvalidator> m_invalidator;
 };
 
 // API Module class
-class ApiModule : public Module {
+class ApiModule final : public Module {
 public:
+    // Name the module is registered under
+    static constexpr const char kModuleName[] = "api";
+    
     ApiModule();
     ~ApiModule() override;
     
@@ -31,14 +87,27 @@ public:
     void start() override;
     void stop() override;
     void shutdown() override;
+    
+    // Closes the listening socket and waits for the requests being handled;
+    // the server cannot be started again afterwards, only stopped
+    bool drain(std::chrono::steady_clock::time_point deadline) override;
     std::string getName() const override;
     std::string getVersion() const override;
     std::vector<std::string> getDependencies() const override;
     bool isRunning() const override;
     std::string getStatus() const override;
+    void fillStatus(ModuleStatus& status) const override;
     bool configure(const std::map<std::string, std::string>& config) override;
     void onMessage(const std::string& topic, const std::string& message) override;
     
+    // The server runs on its own thread; readiness is signalled once it accepts connections
+    bool startsAsynchronously() const override { return true; }
+    
+    // Live reconfiguration: max_connections and enable_cors apply in place,
+    // host and port are bound by the listening socket and need a reload
+    bool validateConfig(const ConfigDiff& diff, std::string& error) const override;
+    void applyConfig(const ConfigDiff& diff) noexcept override;
+    
     // API-specific methods
     void setCorsEnabled(bool enabled);
     void setMaxConnections(int maxConnections);
@@ -48,17 +117,20 @@ private:
     std::shared_ptr<oatpp::network::Server> m_server;
     std::shared_ptr<oatpp::web::server::HttpRouter> m_router;
     std::shared_ptr<oatpp::web::server::HttpConnectionHandler> m_connectionHandler;
-    std::shared_ptr<oatpp::network::tcp::server::ConnectionProvider> m_connectionProvider;
+    std::shared_ptr<ListenerConnectionProvider> m_connectionProvider;
     std::shared_ptr<SimpleHttpHandler> m_httpHandler;
+    std::thread m_serverThread;
     
     // Configuration
     std::string m_host;
     int m_port;
-    int m_maxConnections;
-    bool m_corsEnabled;
+    std::atomic<int> m_maxConnections;
+    std::atomic<bool> m_corsEnabled;
     std::atomic<bool> m_running;
     std::atomic<int> m_requestCount;
     std::atomic<int> m_activeConnections;
+    std::shared_ptr<std::atomic<int>> m_requestsInFlight; // Shared with the handler, which may outlive the module
+    SocketHandoff* m_handoff;                              // Where the listening socket came from, null without a manager
     
     // Internal methods
     void setupRouter();
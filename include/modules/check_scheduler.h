@@ -0,0 +1,171 @@
+/**
+ * @file check_scheduler.h
+ * @brief Per-check schedule of the health monitor
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef CHECK_SCHEDULER_H
+#define CHECK_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <functional>
+#include <random>
+#include <chrono>
+
+namespace swarm {
+
+/**
+ * @brief Scheduling metrics of one check
+ */
+struct CheckScheduleStats {
+    uint64_t runs = 0;                                    ///< Times the check was started
+    uint64_t overruns = 0;                                ///< Due times skipped because the check was still running or the scheduler was late by a whole interval
+    std::chrono::microseconds lastDrift{0};               ///< How late the last run started after its due time
+    std::chrono::microseconds maxDrift{0};                ///< Latest start so far
+    std::chrono::microseconds totalDrift{0};              ///< Sum of the drifts of all runs
+    std::chrono::microseconds lastDuration{0};            ///< How long the last completed run took
+    std::chrono::milliseconds interval{0};                ///< Current interval
+    std::chrono::steady_clock::time_point nextDue;        ///< When the check is due next
+};
+
+/**
+ * @brief Runs every check on its own interval, spread by jitter
+ *
+ * Checks are kept in a min-heap by due time. A check's due times lie on a
+ * fixed grid of its interval, so late starts do not accumulate; each due time
+ * is delayed by a random part of the interval up to the jitter fraction, so
+ * checks with the same interval do not all fire at once. With a jitter of 1
+ * they are spread evenly over the interval.
+ *
+ * The scheduler does no I/O and keeps no time of its own: the caller passes
+ * the current time, takes the due checks and reports their completion.
+ *
+ * @note Not thread-safe; the health monitor guards it with its wake mutex
+ */
+class CheckScheduler {
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Constructor
+     *
+     * @param seed Seed of the jitter
+     */
+    explicit CheckScheduler(uint64_t seed = std::random_device()());
+
+    /**
+     * @brief Set the share of the interval due times are randomly delayed by
+     *
+     * @param jitter Fraction between 0 and 1, applied from the next due time on
+     */
+    void setJitter(double jitter);
+
+    /**
+     * @brief Add a check, or change the interval of a scheduled one
+     *
+     * A new check is first due at now plus its jitter. A changed interval
+     * applies from the last grid point on, so a shorter interval can make
+     * the check due right away. A removed check whose run is still in
+     * progress is added afresh, but is not started again until that run
+     * completes.
+     *
+     * @param name Name of the check
+     * @param interval Time between runs
+     * @param now The current time
+     */
+    void schedule(const std::string& name, std::chrono::milliseconds interval, TimePoint now);
+
+    /**
+     * @brief Remove a check
+     *
+     * A running check stays counted by getRunning() until complete() reports
+     * its run; scheduling it again before then keeps that run.
+     *
+     * @param name Name of the check
+     */
+    void remove(const std::string& name);
+
+    /**
+     * @brief Take the checks that are due and mark them running
+     *
+     * A check that is still running when due again skips that run, which
+     * counts as an overrun.
+     *
+     * @param now The current time
+     * @return Names of the checks to start
+     */
+    std::vector<std::string> takeDue(TimePoint now);
+
+    /**
+     * @brief Report that a check returned by takeDue() finished
+     *
+     * @param name Name of the check
+     * @param now The current time
+     */
+    void complete(const std::string& name, TimePoint now);
+
+    /**
+     * @brief Get the earliest due time
+     *
+     * @return When takeDue() next returns or skips a check, TimePoint::max() without checks
+     */
+    TimePoint nextDue();
+
+    /**
+     * @brief Get the number of running checks
+     *
+     * @return Checks taken and not completed
+     */
+    size_t getRunning() const { return running_; }
+
+    /**
+     * @brief Get the scheduling metrics of every check
+     *
+     * @return Metrics by check name
+     */
+    std::map<std::string, CheckScheduleStats> getStats() const;
+
+private:
+    /**
+     * @brief Schedule state of one check
+     */
+    struct Entry {
+        std::chrono::milliseconds interval{0};            ///< Time between grid points
+        TimePoint slot;                                   ///< Next grid point
+        TimePoint due;                                    ///< slot plus jitter
+        TimePoint started;                                ///< Start of the current run
+        bool running = false;                             ///< Whether a run is in progress
+        bool removed = false;                             ///< Removed while running; erased once the run completes
+        uint64_t generation = 0;                          ///< Matches the entry's valid heap item
+        CheckScheduleStats stats;                         ///< Metrics
+    };
+
+    /** @brief Heap item: due time, generation and check name */
+    using HeapItem = std::tuple<TimePoint, uint64_t, std::string>;
+
+    /**
+     * @brief Set the due time of the entry's slot and push it on the heap
+     */
+    void push(const std::string& name, Entry& entry);
+
+    /**
+     * @brief Drop heap items of removed or rescheduled checks from the top
+     */
+    void dropStale();
+
+    std::map<std::string, Entry> entries_;                ///< Checks by name
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap_; ///< Due times, earliest first
+    double jitter_ = 0.0;                                 ///< Fraction of the interval added at random
+    uint64_t nextGeneration_ = 1;                         ///< Generation of the next heap item
+    size_t running_ = 0;                                  ///< Checks taken and not completed
+    std::mt19937_64 random_;                              ///< Jitter source
+};
+
+} // namespace swarm
+
+#endif // CHECK_SCHEDULER_H
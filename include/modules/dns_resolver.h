@@ -0,0 +1,234 @@
+/**
+ * @file dns_resolver.h
+ * @brief Asynchronous host name resolution with a TTL cache
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#include "../core/clock.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <sys/socket.h>
+
+namespace swarm {
+
+/**
+ * @brief One address of a resolved name
+ */
+struct ResolvedAddress {
+    struct sockaddr_storage address {};                   ///< IPv4 or IPv6 socket address
+    socklen_t length = 0;                                 ///< Used size of address
+
+    /**
+     * @brief Get the address family
+     *
+     * @return AF_INET or AF_INET6
+     */
+    int family() const { return address.ss_family; }
+
+    /**
+     * @brief Set the port
+     *
+     * @param port Port in host byte order
+     */
+    void setPort(uint16_t port);
+
+    /**
+     * @brief Format the address without the port
+     *
+     * @return e.g. "10.0.1.5" or "fd00::5"
+     */
+    std::string toString() const;
+};
+
+/**
+ * @brief Outcome of a name lookup
+ */
+struct DnsAnswer {
+    std::vector<ResolvedAddress> addresses;               ///< Every A and AAAA record, IPv4 first; ports are 0
+    std::chrono::seconds ttl{-1};                         ///< Smallest TTL of the records, negative if the source has none
+    bool notFound = false;                                ///< The name does not exist, rather than a failed lookup
+    std::string error;                                    ///< Why there are no addresses
+};
+
+/**
+ * @brief Counters of the resolver cache
+ */
+struct DnsCacheStats {
+    uint64_t hits = 0;                                    ///< Names answered from the cache
+    uint64_t negativeHits = 0;                            ///< Failures answered from the cache
+    uint64_t lookups = 0;                                 ///< Lookups run by the resolver threads
+    uint64_t coalesced = 0;                               ///< Requests that joined a running lookup
+    uint64_t stale = 0;                                   ///< Failed refreshes answered with the expired addresses
+    size_t entries = 0;                                   ///< Names in the cache
+};
+
+/**
+ * @brief Resolves host names on its own threads and caches the answers
+ *
+ * Lookups never block the caller: a name that is not cached is queued for one
+ * of the resolver threads, and requests for a name already being looked up
+ * wait for that lookup. Addresses are kept for the TTL of their DNS records,
+ * capped by setTtls(); names whose lookup failed are kept as failures for the
+ * negative TTL. When a refresh fails for any reason other than the name not
+ * existing, the expired addresses are used for another negative TTL, so a DNS
+ * outage does not make every target look down.
+ *
+ * The system lookup asks the DNS servers of resolv.conf for A and AAAA
+ * records, which carry the TTL, and falls back to getaddrinfo() for names DNS
+ * does not answer, such as those in /etc/hosts. A Docker swarm service name
+ * (`api`) resolves to its virtual IP and `tasks.api` to the address of every
+ * replica; all of them are returned.
+ *
+ * @note Thread-safe
+ */
+class DnsResolver {
+public:
+    /** @brief Looks up a name, blocking; run on the resolver threads */
+    using Lookup = std::function<DnsAnswer(const std::string& host)>;
+
+    /** @brief Receives the answer of resolve() */
+    using Callback = std::function<void(const DnsAnswer& answer)>;
+
+    /**
+     * @brief Constructor
+     *
+     * @param threads Lookups run at a time; the threads start with the first one
+     * @param clock Time the TTLs are measured in
+     */
+    explicit DnsResolver(size_t threads = 2, std::shared_ptr<Clock> clock = Clock::system());
+
+    /**
+     * @brief Destructor
+     *
+     * Waits for running lookups; requests still queued are answered with an error.
+     */
+    ~DnsResolver();
+
+    DnsResolver(const DnsResolver&) = delete;
+    DnsResolver& operator=(const DnsResolver&) = delete;
+
+    /**
+     * @brief Answer from the cache only
+     *
+     * @param host The name
+     * @param answer Set to the cached answer, addresses or a failure
+     * @return true if the cache holds an answer that has not expired
+     */
+    bool lookup(const std::string& host, DnsAnswer& answer);
+
+    /**
+     * @brief Resolve a name
+     *
+     * @param host The name
+     * @param onResolved Called once with the answer: right away on a cache hit,
+     *                   else on a resolver thread
+     */
+    void resolve(const std::string& host, Callback onResolved);
+
+    /**
+     * @brief Replace the system lookup, e.g. with a fixed table in tests
+     *
+     * @param lookup The lookup, used from the next lookup on
+     */
+    void setLookup(Lookup lookup);
+
+    /**
+     * @brief Change how long answers are cached
+     *
+     * @param maxTtl Limit of record TTLs, and the TTL of answers without one
+     * @param negativeTtl How long failures and stale answers are kept
+     */
+    void setTtls(std::chrono::milliseconds maxTtl, std::chrono::milliseconds negativeTtl);
+
+    /**
+     * @brief Forget every cached answer
+     */
+    void clear();
+
+    /**
+     * @brief Get the cache counters
+     *
+     * @return Counters since the resolver was created
+     */
+    DnsCacheStats getStats() const;
+
+    /**
+     * @brief Look a name up in DNS, then with getaddrinfo()
+     *
+     * @param host The name
+     * @return The addresses and their TTL, or the error
+     */
+    static DnsAnswer systemLookup(const std::string& host);
+
+    /**
+     * @brief Add the A and AAAA records of a DNS response to an answer
+     *
+     * @param message The response
+     * @param length Size of the response
+     * @param answer Receives the addresses; its TTL is lowered to the smallest record TTL
+     * @return false if the response is malformed or reports an error
+     */
+    static bool parseResponse(const unsigned char* message, size_t length, DnsAnswer& answer);
+
+    /**
+     * @brief Parse a literal IPv4 or IPv6 address
+     *
+     * @param host The address; "localhost" is taken as 127.0.0.1
+     * @param address Set to the address, with port 0
+     * @return true if host is a literal address
+     */
+    static bool parseLiteral(const std::string& host, ResolvedAddress& address);
+
+private:
+    /** @brief A cached answer */
+    struct Entry {
+        DnsAnswer answer;                                 ///< Addresses, or the failure
+        std::chrono::steady_clock::time_point expires;    ///< When the name is looked up again
+    };
+
+    /**
+     * @brief Take queued names and look them up until destroyed
+     */
+    void work();
+
+    /**
+     * @brief Cache the answer of a lookup
+     *
+     * @param host The name
+     * @param answer The answer, replaced by the stale addresses when those are kept
+     * @note Called with mutex_ held
+     */
+    void store(const std::string& host, DnsAnswer& answer);
+
+    std::shared_ptr<Clock> clock_;                        ///< Time of the TTLs
+    size_t threadCount_;                                  ///< Resolver threads to start
+
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::condition_variable wake_;                        ///< Signals queued names and stopping_
+    Lookup lookup_;                                       ///< Runs a lookup
+    std::chrono::milliseconds maxTtl_{60000};             ///< Cap of record TTLs
+    std::chrono::milliseconds negativeTtl_{5000};         ///< TTL of failures
+    std::map<std::string, Entry> cache_;                  ///< Answers by name
+    std::map<std::string, std::vector<Callback>> waiting_; ///< Requests by name being looked up
+    std::deque<std::string> queue_;                       ///< Names not taken by a thread yet
+    std::vector<std::thread> threads_;                    ///< Run work()
+    bool stopping_ = false;                               ///< Set by the destructor
+    DnsCacheStats stats_;                                 ///< Counters, entries filled in by getStats()
+};
+
+} // namespace swarm
+
+#endif // DNS_RESOLVER_H
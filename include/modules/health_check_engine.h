@@ -0,0 +1,514 @@
+/**
+ * @file health_check_engine.h
+ * @brief Non-blocking engine running many TCP and HTTP health checks at once
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef HEALTH_CHECK_ENGINE_H
+#define HEALTH_CHECK_ENGINE_H
+
+#include "health_monitor_module.h"
+#include "http_response_parser.h"
+#include "dns_resolver.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <ctime>
+#include <netinet/in.h>
+
+namespace swarm {
+
+class IoUringQueue;
+
+/**
+ * @brief How the health check engine waits for its sockets
+ */
+enum class CheckBackend {
+    Auto,                                                 ///< io_uring where the kernel supports it, epoll otherwise
+    Epoll,                                                ///< Readiness notifications, one system call per socket operation
+    IoUring                                               ///< Batched submissions, falls back to epoll without kernel support
+};
+
+/**
+ * @brief Get the configuration name of a backend
+ *
+ * @param backend The backend
+ * @return "auto", "epoll" or "io_uring"
+ */
+const char* toString(CheckBackend backend);
+
+/**
+ * @brief Parse a backend name
+ *
+ * @param name "auto", "epoll" or "io_uring"
+ * @param backend Set to the backend on success
+ * @return true if the name is known
+ */
+bool parseCheckBackend(const std::string& name, CheckBackend& backend);
+
+/**
+ * @brief Connection reuse counters of the health check engine
+ */
+struct ConnectionPoolStats {
+    uint64_t opened = 0;                                  ///< HTTP connections opened
+    uint64_t reused = 0;                                  ///< Requests sent on a connection that already served one
+    uint64_t pipelined = 0;                               ///< Requests sent before the previous response arrived
+    uint64_t stale = 0;                                   ///< Idle connections found closed by the target
+    uint64_t retried = 0;                                 ///< Requests repeated after a reused connection failed
+    size_t idle = 0;                                      ///< Open connections waiting for a check
+};
+
+/**
+ * @brief Runs health checks concurrently on one epoll loop or io_uring
+ *
+ * Every check is a socket driven through connect, request and response by a
+ * single I/O thread, with its own deadline taken from
+ * HealthCheckConfig::timeoutMs. A round of thousands of checks therefore
+ * takes about as long as its slowest check, instead of the sum of all of
+ * them. The thread is started with the first check.
+ *
+ * With the io_uring backend, the next operation of every ready check is
+ * queued together with a linked timeout and the whole batch is submitted in
+ * the same io_uring_enter() that waits for completions, instead of a
+ * connect(), send(), recv() and epoll_ctl() per check. Responses are read
+ * into registered buffers.
+ *
+ * On epoll, HTTP checks keep their connections open: each target has a pool
+ * of up to a configured number of HTTP/1.1 keep-alive connections. A check
+ * takes an idle one, opens a new one below the limit, or is pipelined onto a
+ * connection that already kept a response alive; otherwise it waits for one.
+ * Idle connections closed by the target are dropped, and a request lost on a
+ * reused connection is repeated on a new one.
+ *
+ * Host names are resolved by a DnsResolver on its own threads, so a slow DNS
+ * server holds up only the checks of that name. A name with several addresses,
+ * such as the replicas of a swarm service, is spread over: each check starts
+ * at the next address and moves on to the following ones when a connection
+ * is refused.
+ *
+ * Checks beyond the in-flight limit wait for a free slot, so a round never
+ * runs out of file descriptors; raise RLIMIT_NOFILE for very large rounds.
+ *
+ * @note Thread-safe
+ */
+class HealthCheckEngine {
+public:
+    /** @brief Called on the engine's thread with the result of a check */
+    using CompletionHandler = std::function<void(const HealthCheckResult&)>;
+
+    /**
+     * @brief Constructor
+     *
+     * @param maxInFlight Checks with an open socket at a time, 0 for half
+     *                    the file descriptor limit
+     * @param backend How to wait for the sockets
+     */
+    explicit HealthCheckEngine(size_t maxInFlight = 0, CheckBackend backend = CheckBackend::Epoll);
+
+    /**
+     * @brief Destructor
+     *
+     * Checks still running or waiting complete as cancelled.
+     */
+    ~HealthCheckEngine();
+
+    HealthCheckEngine(const HealthCheckEngine&) = delete;
+    HealthCheckEngine& operator=(const HealthCheckEngine&) = delete;
+
+    /**
+     * @brief Start a check
+     *
+     * @param config The check; a timeoutMs of 0 or less means 5 seconds
+     * @param onComplete Called once with the result, on the engine's thread
+     */
+    void submit(const HealthCheckConfig& config, CompletionHandler onComplete);
+
+    /**
+     * @brief Run checks concurrently and wait for all of them
+     *
+     * @param configs The checks
+     * @return The results, in the order of the checks
+     */
+    std::vector<HealthCheckResult> runAll(const std::vector<HealthCheckConfig>& configs);
+
+    /**
+     * @brief Change the number of checks with an open socket at a time
+     *
+     * @param maxInFlight The new limit, 0 for half the file descriptor limit
+     */
+    void setMaxInFlight(size_t maxInFlight);
+
+    /**
+     * @brief Get the number of checks submitted and not completed
+     *
+     * @return Running and waiting checks
+     */
+    size_t getPending() const;
+
+    /**
+     * @brief Choose how to wait for the sockets
+     *
+     * @param backend The backend
+     * @return false once the first check started the engine
+     */
+    bool setBackend(CheckBackend backend);
+
+    /**
+     * @brief Get the backend
+     *
+     * @return The backend in use once the first check started the engine,
+     *         the requested one before
+     */
+    CheckBackend getBackend() const;
+
+    /**
+     * @brief Get the number of times the I/O thread waited for its sockets
+     *
+     * @return epoll_wait() or io_uring_enter() calls
+     */
+    uint64_t getWaits() const { return waits_; }
+
+    /**
+     * @brief Choose whether HTTP checks reuse connections
+     *
+     * @param enabled true for keep-alive connections (epoll backend only),
+     *                false for a connection per check
+     */
+    void setKeepAlive(bool enabled);
+
+    /**
+     * @brief Change the number of keep-alive connections per target
+     *
+     * @param maxConnections Connections per host and port, at least 1
+     */
+    void setMaxConnectionsPerTarget(size_t maxConnections);
+
+    /**
+     * @brief Get the connection reuse counters
+     *
+     * @return Counters since the engine was created
+     */
+    ConnectionPoolStats getConnectionStats() const;
+
+    /**
+     * @brief Get the resolver of host names
+     *
+     * @return The resolver, for its cache settings and counters
+     */
+    DnsResolver& getResolver() { return *resolver_; }
+
+private:
+    /** @brief Stage of a running check */
+    enum class Phase {
+        Resolving,                                        ///< Waiting for the resolver
+        Connecting,                                       ///< Waiting for the connection
+        Sending,                                          ///< Writing the HTTP request
+        Receiving                                         ///< Waiting for the HTTP response
+    };
+
+    /**
+     * @brief A submitted check
+     */
+    struct Check {
+        uint64_t id = 0;                                  ///< Key in active_ and epoll data
+        HealthCheckConfig config;                         ///< The check
+        CompletionHandler onComplete;                     ///< Receives the result
+        int fd = -1;                                      ///< The check's socket
+        Phase phase = Phase::Connecting;                  ///< Current stage
+        std::string host;                                 ///< Name or address of the target
+        uint16_t port = 0;                                ///< Port of the target
+        std::string target;                               ///< "host:port" for messages
+        std::string request;                              ///< HTTP request, empty for TCP checks
+        size_t sent = 0;                                  ///< Bytes of the request written
+        std::chrono::steady_clock::time_point started;    ///< When the check was started
+        std::chrono::steady_clock::time_point deadline;   ///< When the check times out
+        std::vector<ResolvedAddress> addresses;           ///< Addresses of host, with the port
+        size_t firstAddress = 0;                          ///< Index of the address tried first
+        size_t addressesTried = 0;                        ///< Addresses whose connection failed
+        ResolvedAddress address;                          ///< Target of the connection
+        struct timespec deadlineSpec {};                  ///< deadline for io_uring linked timeouts
+        bool resolveTimer = false;                        ///< io_uring timeout queued while resolving
+        int bufferSlot = -1;                              ///< Registered buffer slot of the response
+        std::unique_ptr<char[]> buffer;                   ///< Response buffer without a slot
+        uint64_t connection = 0;                          ///< Pooled connection carrying the request
+        bool queued = false;                              ///< Waiting for a pooled connection
+        unsigned attempts = 0;                            ///< Connections the request was sent on
+        bool fresh = false;                               ///< Lost on a reused connection, so needs a new one
+        bool pooled = false;                              ///< Sent on a keep-alive connection
+    };
+
+    /**
+     * @brief A keep-alive connection of an HTTP target
+     */
+    struct Connection {
+        uint64_t id = 0;                                  ///< Key in connections_
+        std::string target;                               ///< "host:port" of the pool
+        int fd = -1;                                      ///< The socket
+        bool connected = false;                           ///< Whether connect() completed
+        bool writing = false;                             ///< Whether epoll watches for writability
+        bool idle = false;                                ///< Whether in idleExpiry_
+        std::string output;                               ///< Requests not written yet
+        size_t sent = 0;                                  ///< Bytes of output written
+        std::deque<uint64_t> checks;                      ///< Checks whose requests were queued, oldest first
+        HttpResponseParser parser;                        ///< Response of checks.front()
+        uint64_t responses = 0;                           ///< Responses read
+        std::chrono::steady_clock::time_point idleUntil;  ///< When an idle connection is closed
+    };
+
+    /**
+     * @brief Create the epoll instance and start the thread if not done yet
+     *
+     * @note Called with mutex_ held
+     */
+    bool ensureStarted();
+
+    /**
+     * @brief Run checks until the engine is destroyed
+     */
+    void loop();
+
+    /**
+     * @brief Run checks on epoll until the engine is destroyed
+     */
+    void loopEpoll();
+
+    /**
+     * @brief Run checks on io_uring until the engine is destroyed
+     *
+     * Returns once the kernel holds no more requests of the checks.
+     */
+    void loopUring();
+
+    /**
+     * @brief Take the waiting checks that fit under the in-flight limit
+     *
+     * @param starting Receives the checks
+     * @param resolved Receives the resolver's answers, by check
+     * @return false once the engine is stopping
+     */
+    bool takeStarting(std::vector<std::unique_ptr<Check>>& starting,
+                      std::vector<std::pair<uint64_t, DnsAnswer>>& resolved);
+
+    /**
+     * @brief Complete every check left as cancelled
+     */
+    void cancelAll();
+
+    /**
+     * @brief Parse the endpoint and resolve its host, or start connecting
+     *
+     * @param check The check, completed right away on failure
+     */
+    void startCheck(std::unique_ptr<Check> check);
+
+    /**
+     * @brief Continue a check with the addresses of its host
+     *
+     * @param check The check, completed right away if the name did not resolve
+     * @param answer The resolver's answer
+     */
+    void useAnswer(Check& check, const DnsAnswer& answer);
+
+    /**
+     * @brief Open the socket of a check and start connecting to its current address
+     *
+     * @param check The check, completed right away on failure
+     */
+    void connectCheck(Check& check);
+
+    /**
+     * @brief Move a check whose connection failed on to the next address of its host
+     *
+     * @param check The check
+     * @return true if another address is being tried, false if none is left
+     */
+    bool tryNextAddress(Check& check);
+
+    /**
+     * @brief Queue the io_uring operation of a check's phase with its timeout
+     *
+     * @param check The check, completed right away if the queue is full
+     */
+    void queueOperation(Check& check);
+
+    /**
+     * @brief Queue or remove the io_uring timeout of a check that is resolving
+     *
+     * A resolving check has no operation in the ring to link a timeout to,
+     * so a standalone one fires at its deadline instead.
+     *
+     * @param check The check
+     * @param remove Remove the queued timeout rather than queue one
+     */
+    void queueResolveTimeout(Check& check, bool remove);
+
+    /**
+     * @brief Queue a read of the wake-up eventfd on io_uring
+     */
+    void queueWake();
+
+    /**
+     * @brief Advance a check on an io_uring completion
+     *
+     * @param userData Check identifier and kind of operation
+     * @param result Result of the operation
+     */
+    void handleCompletion(uint64_t userData, int result);
+
+    /**
+     * @brief Send an HTTP check on an idle, new or pipelined connection of its target
+     *
+     * @param check The check; waits for a connection when none is available
+     */
+    void dispatch(Check& check);
+
+    /**
+     * @brief Open a connection to a check's target
+     *
+     * @param check The check, completed right away on failure
+     * @return The connection, nullptr on failure
+     */
+    Connection* openConnection(Check& check);
+
+    /**
+     * @brief Queue a check's request on a connection
+     *
+     * @param check The check
+     * @param connection The connection
+     */
+    void assign(Check& check, Connection& connection);
+
+    /**
+     * @brief Write queued requests
+     *
+     * @param connection The connection, closed on failure
+     * @return false if the connection was closed
+     */
+    bool flush(Connection& connection);
+
+    /**
+     * @brief Advance a connection on socket readiness
+     *
+     * @param connection The connection
+     * @param events The epoll events
+     */
+    void handleConnectionEvent(Connection& connection, uint32_t events);
+
+    /**
+     * @brief Read and frame responses
+     *
+     * @param connection The connection, closed at the end of the stream
+     */
+    void readResponses(Connection& connection);
+
+    /**
+     * @brief Complete the oldest check of a connection with its response
+     *
+     * @param connection The connection
+     * @return false if the connection was closed
+     */
+    bool completeResponse(Connection& connection);
+
+    /**
+     * @brief Give an idle connection waiting checks or keep it for later ones
+     *
+     * @param connection The connection
+     */
+    void release(Connection& connection);
+
+    /**
+     * @brief Close a connection and repeat or fail the checks it carried
+     *
+     * @param connection The connection, destroyed
+     * @param retry Whether the checks may be sent on another connection
+     * @param status Status of checks not repeated
+     * @param error Error message of checks not repeated
+     */
+    void closeConnection(Connection& connection, bool retry, const std::string& status, const std::string& error);
+
+    /**
+     * @brief Complete a check whose deadline passed
+     *
+     * @param check The check
+     */
+    void timeOut(Check& check);
+
+    /**
+     * @brief Advance a check on socket readiness
+     *
+     * @param check The check
+     * @param events The epoll events
+     */
+    void handleEvent(Check& check, uint32_t events);
+
+    /**
+     * @brief Write the rest of an HTTP request
+     *
+     * @param check The check
+     */
+    void sendRequest(Check& check);
+
+    /**
+     * @brief Close a check's socket and report its result
+     *
+     * @param check The check, destroyed before the handler runs
+     * @param healthy Whether the target is healthy
+     * @param status Human-readable status
+     * @param error Error message of a failed check
+     */
+    void finish(Check& check, bool healthy, const std::string& status, const std::string& error = "");
+
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::deque<std::unique_ptr<Check>> waiting_;          ///< Checks not started yet
+    size_t maxInFlight_;                                  ///< Limit of active_, 0 until resolved
+    size_t pending_ = 0;                                  ///< Checks submitted and not completed
+    bool stopping_ = false;                               ///< Set by the destructor
+    int epollFd_ = -1;                                    ///< The epoll instance
+    int wakeFd_ = -1;                                     ///< eventfd waking the loop for new checks
+    CheckBackend backend_;                                ///< Requested, then used backend
+    bool keepAlive_ = true;                               ///< Requested keep-alive
+    size_t maxConnectionsPerTarget_ = 2;                  ///< Requested pool limit
+    std::thread thread_;                                  ///< Runs loop()
+    std::vector<std::pair<uint64_t, DnsAnswer>> resolved_; ///< Answers not seen by the loop yet
+    std::unique_ptr<DnsResolver> resolver_;               ///< Resolves host names off the loop
+    std::atomic<uint64_t> waits_{0};                      ///< Waits of the I/O thread
+
+    // Owned by the engine's thread
+    uint64_t nextId_ = 1;                                 ///< Identifier of the next started check
+    std::map<uint64_t, std::unique_ptr<Check>> active_;   ///< Checks with an open socket
+    std::set<std::pair<std::chrono::steady_clock::time_point, uint64_t>> deadlines_; ///< Deadlines of active_ on epoll
+    std::vector<char> buffers_;                           ///< Registered response buffer slots
+    std::vector<int> freeSlots_;                          ///< Slots of buffers_ not in use
+    std::unique_ptr<IoUringQueue> ring_;                  ///< The io_uring, null on epoll
+    size_t ringInFlight_ = 0;                             ///< Operations the kernel has not completed
+    uint64_t wakeValue_ = 0;                              ///< Target of the eventfd read
+    bool draining_ = false;                               ///< Set while cancelling the remaining checks
+    bool pooling_ = true;                                 ///< keepAlive_ as seen by the loop
+    size_t poolLimit_ = 2;                                ///< maxConnectionsPerTarget_ as seen by the loop
+    std::map<uint64_t, std::unique_ptr<Connection>> connections_; ///< Keep-alive connections
+    std::map<std::string, std::vector<uint64_t>> pools_;  ///< Connections by target
+    std::map<std::string, std::deque<uint64_t>> queued_;  ///< Checks waiting for a connection, by target
+    std::set<std::pair<std::chrono::steady_clock::time_point, uint64_t>> idleExpiry_; ///< Idle connections by closing time
+    std::map<std::string, size_t> rotation_;              ///< Address to start the next check of a host at
+
+    // Connection reuse counters, written by the engine's thread
+    std::atomic<uint64_t> opened_{0};                     ///< ConnectionPoolStats::opened
+    std::atomic<uint64_t> reused_{0};                     ///< ConnectionPoolStats::reused
+    std::atomic<uint64_t> pipelined_{0};                  ///< ConnectionPoolStats::pipelined
+    std::atomic<uint64_t> stale_{0};                      ///< ConnectionPoolStats::stale
+    std::atomic<uint64_t> retried_{0};                    ///< ConnectionPoolStats::retried
+    std::atomic<size_t> idleCount_{0};                    ///< ConnectionPoolStats::idle
+};
+
+} // namespace swarm
+
+#endif // HEALTH_CHECK_ENGINE_H
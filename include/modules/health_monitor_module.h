@@ -9,16 +9,23 @@
 #define HEALTH_MONITOR_MODULE_H
 
 #include "../core/module.h"
+#include "../core/executor.h"
+#include "../core/clock.h"
+#include "check_scheduler.h"
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
 
 namespace swarm {
 
+class HealthCheckEngine;
+
 /**
  * @brief Health check result structure
  * 
@@ -42,8 +49,8 @@ struct HealthCheckConfig {
     std::string moduleName;                              ///< Name of the module to monitor
     std::string checkType;                               ///< Type of check: "http", "tcp", "custom"
     std::string endpoint;                                ///< Endpoint to check (URL, host:port, etc.)
-    int timeoutMs;                                       ///< Timeout in milliseconds
-    int intervalMs;                                      ///< Check interval in milliseconds
+    int timeoutMs;                                       ///< Timeout in milliseconds, 0 or less for the monitor's default
+    int intervalMs;                                      ///< Check interval in milliseconds, 0 or less for the monitor's default
     int maxFailures;                                     ///< Maximum consecutive failures before marking unhealthy
 };
 
@@ -56,6 +63,8 @@ struct HealthCheckConfig {
  * 
  * Features:
  * - Multiple health check types (HTTP, TCP, custom)
+ * - Concurrent, non-blocking checks with per-check timeouts
+ * - Per-check intervals with jitter, and drift and overrun metrics
  * - Configurable check intervals and timeouts
  * - Failure tracking and threshold management
  * - Real-time health status reporting
@@ -67,8 +76,11 @@ struct HealthCheckConfig {
  * @see HealthCheckResult
  * @see HealthCheckConfig
  */
-class HealthMonitorModule : public Module {
+class HealthMonitorModule final : public Module {
 public:
+    /** @brief Name the module is registered under */
+    static constexpr const char kModuleName[] = "health-monitor";
+    
     /**
      * @brief Constructor
      * 
@@ -111,6 +123,14 @@ public:
      */
     void stop() override;
     
+    /**
+     * @brief Stop scheduling checks and wait for the round in progress
+     * 
+     * @param deadline When to give up waiting
+     * @return true if no check is in progress any more
+     */
+    bool drain(std::chrono::steady_clock::time_point deadline) override;
+    
     /**
      * @brief Shutdown the health monitor
      * 
@@ -123,7 +143,7 @@ public:
      * 
      * @return The module name: "health-monitor"
      */
-    std::string getName() const override { return "health-monitor"; }
+    std::string getName() const override { return kModuleName; }
     
     /**
      * @brief Get the module version
@@ -153,6 +173,13 @@ public:
      */
     std::string getStatus() const override;
     
+    /**
+     * @brief Report check counters, success rate and the latest failure
+     * 
+     * @param status The status to fill in
+     */
+    void fillStatus(ModuleStatus& status) const override;
+    
     /**
      * @brief Configure the health monitor
      * 
@@ -161,6 +188,13 @@ public:
      */
     bool configure(const std::map<std::string, std::string>& config) override;
     
+    /**
+     * @brief Get the topics delivered to onMessage()
+     * 
+     * @return "health.check", whose payload names the module to check
+     */
+    std::vector<std::string> getSubscriptions() const override { return {"health.check"}; }
+    
     /**
      * @brief Handle incoming messages
      * 
@@ -171,6 +205,46 @@ public:
      */
     void onMessage(const std::string& topic, const std::string& message) override;
     
+    /**
+     * @brief Export health checks, current results and counters for a reload
+     * 
+     * @return The encoded state
+     */
+    std::string exportState() const override;
+    
+    /**
+     * @brief Take over health checks, results and counters from a previous instance
+     * 
+     * @param state The blob produced by exportState()
+     * @return false if the blob is malformed or of an unknown version
+     */
+    bool importState(const std::string& state) override;
+    
+    /**
+     * @brief Check live changes to the check defaults
+     * 
+     * default_timeout_ms, default_interval_ms, max_failures,
+     * enable_notifications, max_concurrent_checks, check_jitter,
+     * http_keep_alive, max_connections_per_target, dns_max_ttl_ms and
+     * dns_negative_ttl_ms can be changed while the monitor is running;
+     * check_backend requires a reload.
+     * 
+     * @param diff The changed keys
+     * @param error Receives the reason when a change is rejected
+     * @return true if every change can be applied
+     */
+    bool validateConfig(const ConfigDiff& diff, std::string& error) const override;
+    
+    /**
+     * @brief Apply validated changes to the check defaults
+     * 
+     * A new default interval takes effect immediately for the checks without
+     * an interval of their own, without waiting for the current one to elapse.
+     * 
+     * @param diff The changed keys
+     */
+    void applyConfig(const ConfigDiff& diff) noexcept override;
+    
     /** @} */
     
     /**
@@ -254,6 +328,9 @@ public:
     
     /**
      * @brief Perform health checks for all monitored modules
+     * 
+     * The checks run concurrently, so a round takes about as long as its
+     * slowest check.
      */
     void performAllHealthChecks();
     
@@ -286,30 +363,95 @@ public:
     double getSuccessRate() const;
     
     /** @} */
+    
+    /**
+     * @brief Get the scheduling metrics of every check
+     * 
+     * @return Runs, overruns, start drift and duration by check name
+     */
+    std::map<std::string, CheckScheduleStats> getScheduleStats() const;
+    
+    /**
+     * @brief Set the clock checks are scheduled and stamped in
+     * 
+     * A managed module uses the clock of the manager's executor and ignores
+     * this. Call before start().
+     * 
+     * @param clock The clock, the system clock by default
+     */
+    void setClock(std::shared_ptr<Clock> clock);
 
 private:
     /**
      * @brief Main monitoring loop
      * 
-     * Runs in a separate thread and performs periodic health checks
+     * Runs in a separate thread and starts checks as they become due. Only
+     * used when the module is not managed by a ModuleManager.
      */
     void monitoringLoop();
     
     /**
-     * @brief Perform an HTTP health check
+     * @brief Start the checks that are due, unless the monitor is stopping
+     */
+    void runDueChecks();
+    
+    /**
+     * @brief Run due checks on the shared executor and schedule the next wake-up
+     */
+    void runScheduledChecks();
+    
+    /**
+     * @brief Set the executor timer to the earliest due check
      * 
-     * @param config The health check configuration
-     * @return The health check result
+     * @note Must be called with wakeMutex_ held
      */
-    HealthCheckResult performHttpHealthCheck(const HealthCheckConfig& config);
+    void scheduleNextChecks();
     
     /**
-     * @brief Perform a TCP health check
+     * @brief Wake the scheduler after the schedule changed
      * 
-     * @param config The health check configuration
-     * @return The health check result
+     * @note Must be called with wakeMutex_ held
+     */
+    void rescheduleLocked();
+    
+    /**
+     * @brief Record the result of a scheduled check
+     * 
+     * @param name Name of the check
+     * @param result The result reported by the engine
+     */
+    void completeCheck(const std::string& name, HealthCheckResult result);
+    
+    /**
+     * @brief Get the interval a check runs at
+     * 
+     * @param config The check
+     * @return Its own interval, or the default one
+     */
+    std::chrono::milliseconds intervalOf(const HealthCheckConfig& config) const;
+    
+    /**
+     * @brief Fill in the default timeout of a check
+     * 
+     * @param config The check
+     * @return The check with a positive timeout
+     */
+    HealthCheckConfig withDefaults(HealthCheckConfig config) const;
+    
+    /**
+     * @brief Stamp and count a check result
+     * 
+     * @param result The result
+     */
+    void recordResult(HealthCheckResult& result);
+    
+    /**
+     * @brief Run health checks concurrently and count their results
+     * 
+     * @param configs The checks; a timeout of 0 or less means the default timeout
+     * @return The results, in the order of the checks
      */
-    HealthCheckResult performTcpHealthCheck(const HealthCheckConfig& config);
+    std::vector<HealthCheckResult> runHealthChecks(std::vector<HealthCheckConfig> configs);
     
     /**
      * @brief Update health status for a module
@@ -327,7 +469,14 @@ private:
      */
     void notifyHealthChange(const std::string& moduleName, bool healthy);
     
-    std::thread monitoringThread_;                         ///< Monitoring thread
+    std::shared_ptr<Clock> clock_;                         ///< Time checks are scheduled and stamped in
+    std::unique_ptr<HealthCheckEngine> engine_;            ///< Runs the checks' network I/O
+    std::thread monitoringThread_;                         ///< Monitoring thread when not managed
+    std::shared_ptr<TaskQueue> taskQueue_;                 ///< Serial queue on the manager's executor when managed
+    Executor::TimerId nextChecks_ = 0;                     ///< Timer of the next due check, guarded by wakeMutex_
+    bool dispatching_ = false;                             ///< Whether runScheduledChecks() is running, guarded by wakeMutex_
+    CheckScheduler scheduler_;                             ///< Due times of the checks, guarded by wakeMutex_
+    std::atomic<bool> discardResults_{false};              ///< Set while the module is destroyed
     std::atomic<bool> shouldStop_;                         ///< Flag to stop monitoring
     std::atomic<size_t> totalChecks_;                      ///< Total health checks performed
     std::atomic<size_t> failedChecks_;                     ///< Failed health checks count
@@ -340,10 +489,15 @@ private:
     mutable std::mutex healthStatusMutex_;                 ///< Mutex for health status
     
     // Configuration
-    int defaultTimeoutMs_;                                 ///< Default timeout in milliseconds
-    int defaultIntervalMs_;                                ///< Default check interval in milliseconds
-    int maxFailures_;                                      ///< Maximum consecutive failures
-    bool enableNotifications_;                             ///< Enable health change notifications
+    std::atomic<int> defaultTimeoutMs_;                    ///< Default timeout in milliseconds
+    std::atomic<int> defaultIntervalMs_;                   ///< Default check interval in milliseconds
+    std::atomic<int> maxFailures_;                         ///< Maximum consecutive failures
+    std::atomic<bool> enableNotifications_;                ///< Enable health change notifications
+    std::atomic<int> dnsMaxTtlMs_{60000};                  ///< Longest time a resolved name is cached
+    std::atomic<int> dnsNegativeTtlMs_{5000};              ///< Time a failed lookup is cached
+    
+    mutable std::mutex wakeMutex_;                         ///< Guards the schedule and waits of the monitoring thread
+    std::condition_variable wakeCondition_;                ///< Wakes the monitoring thread on stop or schedule change, and drain() after a check
 };
 
 } // namespace swarm
@@ -0,0 +1,133 @@
+/**
+ * @file http_response_parser.h
+ * @brief Incremental HTTP/1.x response framing for reused connections
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace swarm {
+
+/**
+ * @brief Finds where an HTTP/1.x response ends
+ *
+ * A connection can only carry the next request once the previous response
+ * was read to its last byte, so the parser follows Content-Length, chunked
+ * transfer coding and close-delimited bodies. Only the status line and the
+ * framing headers are kept; the body is skipped.
+ *
+ * @note Not thread-safe
+ */
+class HttpResponseParser {
+public:
+    /** @brief Framing state */
+    enum class State {
+        Incomplete,                                       ///< More bytes are needed
+        Complete,                                         ///< The response ended; feed() stops there
+        Invalid                                           ///< Not an HTTP response; the connection cannot be reused
+    };
+
+    /**
+     * @brief Feed bytes received on the connection
+     *
+     * @param data The bytes
+     * @param length Number of bytes
+     * @return Bytes consumed; fewer than length once the response is complete,
+     *         the rest belongs to the next response
+     */
+    size_t feed(const char* data, size_t length);
+
+    /**
+     * @brief Report that the peer closed the connection
+     *
+     * Completes a response whose body is delimited by the close.
+     */
+    void finishAtClose();
+
+    /**
+     * @brief Start over for the next response on the connection
+     */
+    void reset();
+
+    /**
+     * @brief Get the framing state
+     *
+     * @return Whether the response is complete, incomplete or invalid
+     */
+    State getState() const { return state_; }
+
+    /**
+     * @brief Check whether any byte of the response arrived
+     *
+     * @return true once feed() received data
+     */
+    bool hasStarted() const { return started_; }
+
+    /**
+     * @brief Get the status code
+     *
+     * @return The code of the status line, 0 before it is complete
+     */
+    int getStatusCode() const { return statusCode_; }
+
+    /**
+     * @brief Check whether the connection can carry another request
+     *
+     * @return true for a complete HTTP/1.1 response without "Connection: close"
+     *         (or HTTP/1.0 with keep-alive) whose end was not the close
+     */
+    bool isReusable() const;
+
+    /**
+     * @brief Whether the request was HEAD, whose response has no body
+     *
+     * @param head true for a HEAD request
+     */
+    void setHeadRequest(bool head) { head_ = head; }
+
+private:
+    /** @brief Part of the response being read */
+    enum class Part {
+        Head,                                             ///< Status line and headers
+        Body,                                             ///< Body of known length
+        ChunkSize,                                        ///< Size line of a chunk
+        ChunkData,                                        ///< Data of a chunk
+        ChunkEnd,                                         ///< CRLF after a chunk
+        Trailer,                                          ///< Trailer fields after the last chunk
+        UntilClose                                        ///< Body ending with the connection
+    };
+
+    /**
+     * @brief Parse the collected status line and headers
+     */
+    void parseHead();
+
+    /**
+     * @brief Take one CRLF-terminated line
+     *
+     * @return true if line_ holds a complete line
+     */
+    bool takeLine(const char*& data, const char* end);
+
+    State state_ = State::Incomplete;                     ///< Framing state
+    Part part_ = Part::Head;                              ///< Part being read
+    bool started_ = false;                                ///< Whether any byte arrived
+    bool head_ = false;                                   ///< Whether the request was HEAD
+    std::string line_;                                    ///< Partial line, or the whole head
+    int statusCode_ = 0;                                  ///< Code of the status line
+    bool http11_ = false;                                 ///< HTTP/1.1 or later
+    bool closeRequested_ = false;                         ///< "Connection: close"
+    bool keepAliveRequested_ = false;                     ///< "Connection: keep-alive"
+    bool closeDelimited_ = false;                         ///< The body ended with the connection
+    uint64_t remaining_ = 0;                              ///< Bytes left of the body or chunk
+};
+
+} // namespace swarm
+
+#endif // HTTP_RESPONSE_PARSER_H
@@ -0,0 +1,138 @@
+/**
+ * @file io_uring_queue.h
+ * @brief Minimal io_uring submission and completion queue
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef IO_URING_QUEUE_H
+#define IO_URING_QUEUE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Built with the kernel's own interface, no liburing needed; configure with
+// -DSWARM_WITH_IO_URING=OFF to leave it out
+#if defined(__linux__) && !defined(SWARM_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#define SWARM_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+
+namespace swarm {
+
+#ifdef SWARM_HAVE_IO_URING
+
+/**
+ * @brief One io_uring instance driven through the raw system calls
+ *
+ * Requests are queued with getSqe() and handed to the kernel together by the
+ * next submit(), one io_uring_enter() for the whole batch, which also waits
+ * for completions.
+ *
+ * @note Not thread-safe; owned by one thread
+ */
+class IoUringQueue {
+public:
+    IoUringQueue() = default;
+
+    /**
+     * @brief Destructor
+     *
+     * The caller must have reaped every request that refers to its memory.
+     */
+    ~IoUringQueue();
+
+    IoUringQueue(const IoUringQueue&) = delete;
+    IoUringQueue& operator=(const IoUringQueue&) = delete;
+
+    /**
+     * @brief Create the ring and check the kernel supports what the engine uses
+     *
+     * @param entries Submission queue size
+     * @param error Set to the reason when the ring cannot be used
+     * @return true if the ring is ready
+     */
+    bool setup(unsigned entries, std::string& error);
+
+    /**
+     * @brief Register one buffer for fixed reads
+     *
+     * @param base Start of the buffer
+     * @param length Size of the buffer
+     * @return true if IORING_OP_READ_FIXED can use buffer index 0
+     */
+    bool registerBuffer(void* base, size_t length);
+
+    /**
+     * @brief Get a zeroed submission queue entry
+     *
+     * @return The entry, nullptr while the queue is full
+     */
+    struct io_uring_sqe* getSqe();
+
+    /**
+     * @brief Submit the queued entries and wait for completions
+     *
+     * @param waitFor Completions to wait for, 0 to return right away
+     * @return Entries submitted, or a negative errno
+     */
+    int submit(unsigned waitFor);
+
+    /**
+     * @brief Call a handler with every completion posted so far
+     *
+     * @param handler Called with the user data and result of each completion
+     * @return Number of completions handled
+     */
+    template <typename Handler>
+    unsigned reap(Handler&& handler) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count) {
+            const struct io_uring_cqe& cqe = cqes_[head & *cqMask_];
+            uint64_t userData = cqe.user_data;
+            int result = cqe.res;
+            // Freed before the handler runs, which may submit more requests
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+            handler(userData, result);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Get the number of free submission queue entries
+     *
+     * @return Entries getSqe() can hand out before the next submit()
+     */
+    unsigned getSpace() const { return sqEntries_ - (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)); }
+
+private:
+    int fd_ = -1;                                         ///< The ring
+    void* ringMemory_ = nullptr;                          ///< Shared submission and completion rings
+    size_t ringSize_ = 0;                                 ///< Size of ringMemory_
+    struct io_uring_sqe* sqes_ = nullptr;                 ///< Submission queue entries
+    size_t sqesSize_ = 0;                                 ///< Size of sqes_
+    unsigned* sqHead_ = nullptr;                          ///< Advanced by the kernel
+    unsigned* sqTail_ = nullptr;                          ///< Advanced by submit()
+    unsigned* sqMask_ = nullptr;                          ///< Submission index mask
+    unsigned* sqArray_ = nullptr;                         ///< Submission order of the entries
+    unsigned sqEntries_ = 0;                              ///< Submission queue size
+    unsigned sqeTail_ = 0;                                ///< Entries handed out by getSqe()
+    unsigned* cqHead_ = nullptr;                          ///< Advanced by reap()
+    unsigned* cqTail_ = nullptr;                          ///< Advanced by the kernel
+    unsigned* cqMask_ = nullptr;                          ///< Completion index mask
+    struct io_uring_cqe* cqes_ = nullptr;                 ///< Completion queue entries
+};
+
+#else
+
+/** @brief Placeholder where io_uring is not available */
+class IoUringQueue {};
+
+#endif // SWARM_HAVE_IO_URING
+
+} // namespace swarm
+
+#endif // IO_URING_QUEUE_H
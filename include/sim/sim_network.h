@@ -0,0 +1,189 @@
+/**
+ * @file sim_network.h
+ * @brief Simulated links between the nodes of an in-process swarm
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef SIM_NETWORK_H
+#define SIM_NETWORK_H
+
+#include "../core/executor.h"
+#include "../core/clock.h"
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <random>
+#include <memory>
+#include <functional>
+#include <chrono>
+
+namespace swarm {
+
+/**
+ * @brief Behaviour of a directed link between two nodes
+ */
+struct LinkProfile {
+    std::chrono::milliseconds latency{0};                 ///< Delay of every message
+    std::chrono::milliseconds jitter{0};                  ///< Uniform random delay added to the latency
+    double lossRate = 0.0;                                ///< Probability a message is dropped, 1 for a cut link
+};
+
+/**
+ * @brief Traffic counters of a SimNetwork
+ */
+struct NetworkStats {
+    uint64_t sent = 0;                                    ///< Messages handed to send()
+    uint64_t delivered = 0;                               ///< Messages that reached their node
+    uint64_t lost = 0;                                    ///< Messages dropped by a link's loss rate
+    uint64_t partitioned = 0;                             ///< Messages dropped between partitions
+    uint64_t inFlight = 0;                                ///< Messages sent but not delivered yet
+    std::chrono::microseconds latencyMean{0};             ///< Mean time from send() to delivery
+    std::chrono::microseconds latencyP50{0};              ///< Median delivery time
+    std::chrono::microseconds latencyP99{0};              ///< 99th percentile delivery time
+    std::chrono::microseconds latencyMax{0};              ///< Slowest delivery
+};
+
+/**
+ * @brief Lossy, delayed, partitionable network between simulated nodes
+ *
+ * Messages sent between two nodes are dropped with the link's loss rate or
+ * when a partition separates the nodes, and are otherwise delivered to the
+ * delivery handler once the link's latency has passed. Delays are timers on
+ * the network's own executor, so with a VirtualClock they elapse in simulated
+ * time. Random decisions come from a seeded generator, so a run with the same
+ * seed and the same sends drops the same messages.
+ *
+ * @note Thread-safe
+ */
+class SimNetwork {
+public:
+    /** @brief Called on a network thread with the destination, topic and payload of a message */
+    using DeliveryHandler = std::function<void(size_t, const std::string&, const std::string&)>;
+
+    /**
+     * @brief Constructor
+     *
+     * @param nodes Number of nodes
+     * @param defaultLink Profile of every link without one of its own
+     * @param clock Time the latencies elapse in, null for the real time
+     * @param seed Seed of the loss and jitter decisions
+     * @param threads Threads delivering messages
+     */
+    SimNetwork(size_t nodes, const LinkProfile& defaultLink, std::shared_ptr<Clock> clock = nullptr,
+               uint64_t seed = 1, size_t threads = 1);
+
+    /**
+     * @brief Destructor
+     *
+     * Messages still in flight are dropped.
+     */
+    ~SimNetwork();
+
+    SimNetwork(const SimNetwork&) = delete;
+    SimNetwork& operator=(const SimNetwork&) = delete;
+
+    /**
+     * @brief Set where delivered messages go
+     *
+     * @param handler The delivery handler
+     * @note Set before the first send()
+     */
+    void setDeliveryHandler(DeliveryHandler handler);
+
+    /**
+     * @brief Give a directed link its own profile
+     *
+     * @param from Sending node
+     * @param to Receiving node
+     * @param profile The link's profile
+     */
+    void setLink(size_t from, size_t to, const LinkProfile& profile);
+
+    /**
+     * @brief Split the network in two
+     *
+     * Messages between the given nodes and the rest are dropped until heal().
+     *
+     * @param side Nodes on one side of the partition
+     */
+    void partition(const std::set<size_t>& side);
+
+    /**
+     * @brief Remove the partition
+     */
+    void heal();
+
+    /**
+     * @brief Check whether two nodes can reach each other
+     *
+     * @param from Sending node
+     * @param to Receiving node
+     * @return false if a partition separates them
+     */
+    bool isReachable(size_t from, size_t to) const;
+
+    /**
+     * @brief Send a message to a node
+     *
+     * @param from Sending node
+     * @param to Receiving node
+     * @param topic Topic of the message
+     * @param message Payload of the message
+     * @return false if the message was dropped
+     */
+    bool send(size_t from, size_t to, const std::string& topic, const std::string& message);
+
+    /**
+     * @brief Get the traffic counters and delivery latencies
+     *
+     * @return The counters since construction or resetStats()
+     */
+    NetworkStats getStats() const;
+
+    /**
+     * @brief Clear the traffic counters and latency samples
+     */
+    void resetStats();
+
+    /**
+     * @brief Get the executor delivering messages
+     *
+     * @return The network's executor
+     */
+    Executor& getExecutor() { return executor_; }
+
+private:
+    /**
+     * @brief Get the profile of a link
+     *
+     * @note Called with mutex_ held
+     */
+    const LinkProfile& linkLocked(size_t from, size_t to) const;
+
+    /**
+     * @brief Hand a message to the delivery handler and record its latency
+     */
+    void deliver(size_t to, const std::string& topic, const std::string& message,
+                 std::chrono::steady_clock::time_point sentAt);
+
+    size_t nodes_;                                        ///< Number of nodes
+    LinkProfile defaultLink_;                             ///< Profile of links without their own
+    std::shared_ptr<Clock> clock_;                        ///< Time latencies are measured in
+    DeliveryHandler deliveryHandler_;                     ///< Receives delivered messages
+
+    mutable std::mutex mutex_;                            ///< Guards the members below
+    std::map<std::pair<size_t, size_t>, LinkProfile> links_; ///< Links with their own profile
+    std::vector<bool> partitionSide_;                     ///< Side of each node, empty without a partition
+    std::mt19937_64 random_;                              ///< Loss and jitter decisions
+    NetworkStats stats_;                                  ///< Counters, without the latencies
+    std::vector<std::chrono::microseconds> latencies_;    ///< Latency of every delivery
+
+    Executor executor_;                                   ///< Fires delivery timers, destroyed first
+};
+
+} // namespace swarm
+
+#endif // SIM_NETWORK_H
@@ -0,0 +1,229 @@
+/**
+ * @file swarm_simulator.h
+ * @brief In-process swarm of many nodes for scale testing
+ * @author SwarmApp Development Team
+ * @version 1.0.0
+ */
+
+#ifndef SWARM_SIMULATOR_H
+#define SWARM_SIMULATOR_H
+
+#include "../core/module_manager.h"
+#include "sim_network.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+namespace swarm {
+
+/**
+ * @brief Options of a SwarmSimulator
+ */
+struct SimulatorOptions {
+    size_t nodes = 10;                                    ///< Number of nodes
+    size_t threadsPerNode = 1;                            ///< Executor threads of every node
+    size_t networkThreads = 1;                            ///< Threads delivering messages between nodes
+    LinkProfile defaultLink;                              ///< Profile of every link without one of its own
+    uint64_t seed = 1;                                    ///< Seed of the network's loss and jitter decisions
+    std::shared_ptr<Clock> clock = nullptr;               ///< Time of the nodes and links, null for the real time
+};
+
+/**
+ * @brief Aggregate results of a simulation
+ */
+struct SimulationStats {
+    size_t nodes = 0;                                     ///< Number of nodes
+    NetworkStats network;                                 ///< Traffic between the nodes
+    uint64_t busMessages = 0;                             ///< Messages published on all node buses, local and delivered
+    uint64_t minNodeMessages = 0;                         ///< Messages published on the least busy node's bus
+    uint64_t maxNodeMessages = 0;                         ///< Messages published on the busiest node's bus
+    std::chrono::steady_clock::duration elapsed{0};       ///< Clock time since start()
+    double deliveredPerSecond = 0.0;                      ///< Network deliveries per second of clock time
+};
+
+/**
+ * @brief Many logical nodes, each with its own ModuleManager, in one process
+ *
+ * Every node runs the real modules on its own executor and an inproc message
+ * bus. Topics passed to bridge() are forwarded between the nodes' buses over a
+ * SimNetwork, whose links add latency, lose messages and can be partitioned.
+ * With a VirtualClock, runFor() steps through the nodes' timers and the link
+ * delays in simulated time, so a minute of swarm traffic takes as long as the
+ * work it causes:
+ * @code
+ * SimulatorOptions options;
+ * options.nodes = 200;
+ * options.defaultLink.latency = std::chrono::milliseconds(20);
+ * options.clock = std::make_shared<VirtualClock>();
+ * SwarmSimulator simulator(options);
+ * simulator.registerModule("worker", []() { return std::make_unique<WorkerModule>(); });
+ * simulator.loadModule("worker");
+ * simulator.bridge("work.result");
+ * simulator.start();
+ * simulator.runFor(std::chrono::minutes(1));
+ * std::cout << simulator.summary();
+ * @endcode
+ *
+ * @note The nodes are driven from one thread; the methods are not thread-safe
+ */
+class SwarmSimulator {
+public:
+    /** @brief Configuration of a module on a node, by node index */
+    using NodeConfig = std::function<std::map<std::string, std::string>(size_t)>;
+
+    /** @brief Nodes a message published on a node is forwarded to, by node index */
+    using Route = std::function<std::vector<size_t>(size_t)>;
+
+    /**
+     * @brief Constructor
+     *
+     * Creates the nodes and their buses; modules are loaded and started separately.
+     *
+     * @param options Number of nodes, threads, links and clock
+     */
+    explicit SwarmSimulator(const SimulatorOptions& options);
+
+    /**
+     * @brief Destructor
+     *
+     * Stops forwarding, drops the messages in flight and shuts the nodes down.
+     */
+    ~SwarmSimulator();
+
+    SwarmSimulator(const SwarmSimulator&) = delete;
+    SwarmSimulator& operator=(const SwarmSimulator&) = delete;
+
+    /**
+     * @brief Get the number of nodes
+     *
+     * @return The number of nodes
+     */
+    size_t getNodeCount() const { return nodes_.size(); }
+
+    /**
+     * @brief Get a node
+     *
+     * @param index Index of the node
+     * @return The node's module manager
+     */
+    ModuleManager& getNode(size_t index) { return *nodes_.at(index); }
+
+    /**
+     * @brief Get the network between the nodes
+     *
+     * @return The network, for link profiles and partitions
+     */
+    SimNetwork& getNetwork() { return *network_; }
+
+    /**
+     * @brief Register a module factory on every node
+     *
+     * @param name The unique name of the module
+     * @param factory The factory function to create module instances
+     */
+    void registerModule(const std::string& name, ModuleFactory factory);
+
+    /**
+     * @brief Load a module on every node
+     *
+     * @param name Name of a registered module
+     * @param config Configuration per node, null for none
+     * @param replicas Number of instances per node
+     * @return true if the module was loaded on every node
+     */
+    bool loadModule(const std::string& name, NodeConfig config = nullptr, size_t replicas = 1);
+
+    /**
+     * @brief Forward a topic between the nodes
+     *
+     * Messages published on a node's bus are sent over the network and
+     * published on the receiving nodes' buses. Messages received from the
+     * network are not forwarded again.
+     *
+     * @param topic Topic to forward
+     * @param route Receivers of the messages of a node, null for all other nodes
+     */
+    void bridge(const std::string& topic, Route route = nullptr);
+
+    /**
+     * @brief Start the modules of every node and the statistics
+     *
+     * @return true if every node started all its modules
+     */
+    bool start();
+
+    /**
+     * @brief Publish a message on a node's bus
+     *
+     * @param node Index of the node
+     * @param topic Topic of the message
+     * @param message Payload of the message
+     */
+    void publish(size_t node, const std::string& topic, const std::string& message);
+
+    /**
+     * @brief Wait, in real time, until no node or link has work to do now
+     *
+     * Work scheduled for later (timers, messages in flight) does not count.
+     *
+     * @param timeout Real time to wait at most
+     * @return true if the swarm became idle
+     */
+    bool settle(std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+    /**
+     * @brief Let the swarm run
+     *
+     * With a VirtualClock, the clock is moved from deadline to deadline, and
+     * the swarm settled at each, until the duration has passed; otherwise the
+     * calling thread sleeps.
+     *
+     * @param duration Clock time to run
+     */
+    void runFor(std::chrono::steady_clock::duration duration);
+
+    /**
+     * @brief Get the aggregate statistics
+     *
+     * @return Traffic and throughput since start()
+     */
+    SimulationStats getStats() const;
+
+    /**
+     * @brief Render the aggregate statistics
+     *
+     * @return One line per figure, times in milliseconds
+     */
+    std::string summary() const;
+
+private:
+    /**
+     * @brief Sum of the work done by all nodes and links
+     *
+     * @return A counter that changes whenever anything ran
+     */
+    uint64_t activity() const;
+
+    /**
+     * @brief Check whether every thread waits for a later deadline
+     *
+     * @return true if no node or link has runnable work
+     */
+    bool isIdle() const;
+
+    std::shared_ptr<Clock> clock_;                        ///< Time of the nodes and links
+    std::shared_ptr<VirtualClock> virtualClock_;          ///< clock_ if it is simulated time, null otherwise
+    std::vector<std::unique_ptr<ModuleManager>> nodes_;   ///< The nodes
+    std::unique_ptr<SimNetwork> network_;                 ///< Links between the nodes, destroyed before them
+    std::vector<std::pair<size_t, MessageBus::SubscriptionId>> bridges_; ///< Forwarding subscriptions by node
+    std::atomic<bool> stopping_{false};                   ///< Set once forwarding stops
+    std::chrono::steady_clock::time_point startTime_;     ///< Clock time of start()
+};
+
+} // namespace swarm
+
+#endif // SWARM_SIMULATOR_H
@@ -66,13 +66,13 @@ build_module() {
     log_success "$module module built successfully"
 }
 
-# Run a specific module
+# Run a specific module with the split deployment configuration
 run_module() {
     local module=$1
-    local executable="$BUILD_DIR/${module}-standalone"
+    local executable="$BUILD_DIR/swarm-app"
     
     if [ ! -f "$executable" ]; then
-        log_error "Module $module not built. Run 'build' first."
+        log_error "swarm-app not built. Run 'build all' first."
         exit 1
     fi
     
@@ -80,7 +80,7 @@ run_module() {
     log_info "Press Ctrl+C to stop"
     
     cd "$BUILD_DIR"
-    ./"${module}-standalone"
+    ./swarm-app --config "$PROJECT_ROOT/config/split-${module}.conf"
 }
 
 # Show available modules
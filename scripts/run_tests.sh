@@ -119,6 +119,8 @@ run_specific_tests() {
             ;;
         "core")
             ./test-swarm-app --gtest_brief=1
+            ./test-module-manager --gtest_brief=1
+            ./test-health-monitor --gtest_brief=1
             ./test-zeromq-message-bus --gtest_brief=1
             ;;
         *)
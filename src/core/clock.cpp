@@ -0,0 +1,148 @@
+#include "../../include/core/clock.h"
+#include <thread>
+
+namespace swarm {
+
+namespace {
+
+// A notification advance() sends between a waiter's registration and its wait
+// is lost; the waiter then notices the new time after at most this much real time
+constexpr std::chrono::milliseconds kWakeSlice{1};
+
+} // namespace
+
+std::shared_ptr<Clock> Clock::system() {
+    static std::shared_ptr<Clock> clock = std::make_shared<SystemClock>();
+    return clock;
+}
+
+std::chrono::steady_clock::time_point SystemClock::now() const {
+    return std::chrono::steady_clock::now();
+}
+
+std::chrono::system_clock::time_point SystemClock::wallNow() const {
+    return std::chrono::system_clock::now();
+}
+
+bool SystemClock::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                            std::chrono::steady_clock::time_point deadline) {
+    return condition.wait_until(lock, deadline) == std::cv_status::timeout;
+}
+
+void SystemClock::sleepUntil(std::chrono::steady_clock::time_point deadline) {
+    std::this_thread::sleep_until(deadline);
+}
+
+VirtualClock::VirtualClock(std::chrono::system_clock::time_point wallStart) : wallStart_(wallStart) {
+}
+
+std::chrono::steady_clock::time_point VirtualClock::now() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return now_;
+}
+
+std::chrono::system_clock::time_point VirtualClock::wallNow() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return wallStart_ + std::chrono::duration_cast<std::chrono::system_clock::duration>(now_.time_since_epoch());
+}
+
+bool VirtualClock::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                             std::chrono::steady_clock::time_point deadline) {
+    Waiter waiter{deadline, &condition, false, {}};
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!addWaiter(waiter)) {
+            return true;
+        }
+    }
+    changed_.notify_all();
+
+    // The waiter stays registered across slices, so getWaiterCount() is stable while it idles
+    while (true) {
+        bool notified = condition.wait_for(lock, kWakeSlice) == std::cv_status::no_timeout;
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (notified || !waiter.registered) {
+            removeWaiter(waiter);
+            return now_ >= deadline;
+        }
+    }
+}
+
+void VirtualClock::sleepUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Waiter waiter{deadline, nullptr, false, {}};
+    if (!addWaiter(waiter)) {
+        return;
+    }
+    changed_.notify_all();
+    changed_.wait(lock, [this, deadline]() { return now_ >= deadline; });
+    removeWaiter(waiter);
+}
+
+void VirtualClock::advance(std::chrono::steady_clock::duration duration) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advanceLocked(now_ + duration);
+}
+
+void VirtualClock::advanceTo(std::chrono::steady_clock::time_point time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advanceLocked(time);
+}
+
+bool VirtualClock::advanceToNextDeadline(std::chrono::steady_clock::time_point limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool found = !waiters_.empty() && waiters_.begin()->first <= limit;
+    if (found) {
+        advanceLocked(waiters_.begin()->first);
+    } else if (limit != std::chrono::steady_clock::time_point::max()) {
+        advanceLocked(limit);
+    }
+    return found;
+}
+
+bool VirtualClock::waitForWaiters(size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, timeout, [this, count]() { return waiters_.size() >= count; });
+}
+
+size_t VirtualClock::getWaiterCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiters_.size();
+}
+
+bool VirtualClock::addWaiter(Waiter& waiter) {
+    if (now_ >= waiter.deadline) {
+        return false;
+    }
+    waiter.position = waiters_.emplace(waiter.deadline, &waiter);
+    waiter.registered = true;
+    return true;
+}
+
+void VirtualClock::removeWaiter(Waiter& waiter) {
+    if (waiter.registered) {
+        waiters_.erase(waiter.position);
+        waiter.registered = false;
+    }
+}
+
+void VirtualClock::advanceLocked(std::chrono::steady_clock::time_point time) {
+    if (time > now_) {
+        now_ = time;
+    }
+    // Woken waiters stop counting as waiting right away, so a driver's next
+    // waitForWaiters() waits for them to run and wait again
+    while (!waiters_.empty() && waiters_.begin()->first <= now_) {
+        Waiter* waiter = waiters_.begin()->second;
+        waiter->registered = false;
+        if (waiter->condition) {
+            // The waiter cannot return, and its condition variable cannot go
+            // away, before it removed itself under mutex_
+            waiter->condition->notify_all();
+        }
+        waiters_.erase(waiters_.begin());
+    }
+    changed_.notify_all();
+}
+
+} // namespace swarm
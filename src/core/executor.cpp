@@ -0,0 +1,451 @@
+#include "../../include/core/executor.h"
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
+
+namespace swarm {
+
+namespace {
+
+/** Executor the calling thread is a worker of, if any */
+thread_local Executor* tlsExecutor = nullptr;
+
+/** Index of the calling worker in its executor */
+thread_local size_t tlsWorkerIndex = 0;
+
+/** Task queue whose task the calling thread is running, if any */
+thread_local const TaskQueue* tlsTaskQueue = nullptr;
+
+constexpr std::chrono::steady_clock::rep kNoTimer = std::numeric_limits<std::chrono::steady_clock::rep>::max();
+
+} // namespace
+
+Executor::Executor(const ExecutorOptions& options)
+    : clock_(options.clock ? options.clock : Clock::system()), nextTimer_(kNoTimer) {
+    size_t threads = options.threadBudget;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    // All workers must exist before any of them starts stealing
+    for (size_t i = 0; i < threads; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        int cpu = options.cpuAffinity.empty() ? -1 : options.cpuAffinity[i % options.cpuAffinity.size()];
+        workers_[i]->thread = std::thread(&Executor::workerLoop, this, i, cpu);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        timers_.clear();
+        timerOrder_.clear();
+        updateNextTimer();
+    }
+    wakeup_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+bool Executor::submit(std::function<void()> task, TaskPriority priority) {
+    size_t p = static_cast<size_t>(priority);
+    if (tlsExecutor == this) {
+        Worker& worker = *workers_[tlsWorkerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[p].push_back(std::move(task));
+        queued_++;
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        injected_[p].push_back(std::move(task));
+        queued_++;
+    }
+    wakeOne();
+    return true;
+}
+
+Executor::TimerId Executor::scheduleAfter(std::chrono::milliseconds delay, std::function<void()> task,
+                                          TaskPriority priority) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return 0;
+        }
+        id = nextTimerId_++;
+        auto deadline = clock_->now() + delay;
+        timers_[id] = {deadline, std::move(task), priority};
+        timerOrder_.insert({deadline, id});
+        updateNextTimer();
+    }
+    // Let an idle worker shorten its wait if this timer is the earliest
+    wakeup_.notify_one();
+    return id;
+}
+
+bool Executor::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+        return false;
+    }
+    timerOrder_.erase({it->second.deadline, id});
+    timers_.erase(it);
+    updateNextTimer();
+    return true;
+}
+
+std::shared_ptr<TaskQueue> Executor::createQueue(const std::string& name, bool serial) {
+    return std::shared_ptr<TaskQueue>(new TaskQueue(*this, name, serial));
+}
+
+bool Executor::isWorkerThread() const {
+    return tlsExecutor == this;
+}
+
+bool Executor::runPendingTask() {
+    if (tlsExecutor != this) {
+        return false;
+    }
+    std::function<void()> task;
+    if (!takeTask(tlsWorkerIndex, task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+ExecutorStats Executor::getStats() const {
+    ExecutorStats stats;
+    stats.threads = workers_.size();
+    stats.queued = queued_.load();
+    stats.executed = executed_.load();
+    stats.stolen = stolen_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.timers = timers_.size();
+    return stats;
+}
+
+void Executor::workerLoop(size_t index, int cpu) {
+    tlsExecutor = this;
+    tlsWorkerIndex = index;
+    
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            std::cerr << "Executor: cannot pin worker " << index << " to CPU " << cpu << std::endl;
+        }
+    }
+    
+    while (true) {
+        // Busy workers fire due timers too, so timers do not starve under load
+        if (clock_->now().time_since_epoch().count() >= nextTimer_.load()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fireDueTimers();
+        }
+        
+        std::function<void()> task;
+        if (takeTask(index, task)) {
+            execute(task);
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto nextTimer = fireDueTimers();
+        if (queued_.load() > 0) {
+            continue;
+        }
+        if (stopping_) {
+            break;
+        }
+        if (nextTimer == std::chrono::steady_clock::time_point::max()) {
+            wakeup_.wait(lock);
+        } else {
+            clock_->waitUntil(lock, wakeup_, nextTimer);
+        }
+    }
+    
+    tlsExecutor = nullptr;
+}
+
+bool Executor::takeTask(size_t index, std::function<void()>& task) {
+    for (size_t p = 0; p < kPriorityCount; p++) {
+        {
+            Worker& own = *workers_[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.queues[p].empty()) {
+                task = std::move(own.queues[p].back());
+                own.queues[p].pop_back();
+                queued_--;
+                return true;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!injected_[p].empty()) {
+                task = std::move(injected_[p].front());
+                injected_[p].pop_front();
+                queued_--;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < workers_.size(); i++) {
+            Worker& victim = *workers_[(index + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queues[p].empty()) {
+                task = std::move(victim.queues[p].front());
+                victim.queues[p].pop_front();
+                queued_--;
+                stolen_++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Executor::execute(std::function<void()>& task) {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        std::cerr << "Executor task failed: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Executor task failed with an unknown exception" << std::endl;
+    }
+    executed_++;
+}
+
+std::chrono::steady_clock::time_point Executor::fireDueTimers() {
+    auto now = clock_->now();
+    size_t fired = 0;
+    while (!timerOrder_.empty() && timerOrder_.begin()->first <= now) {
+        TimerId id = timerOrder_.begin()->second;
+        timerOrder_.erase(timerOrder_.begin());
+        auto it = timers_.find(id);
+        injected_[static_cast<size_t>(it->second.priority)].push_back(std::move(it->second.task));
+        timers_.erase(it);
+        queued_++;
+        fired++;
+    }
+    updateNextTimer();
+    if (fired > 1) {
+        wakeup_.notify_all();
+    }
+    return timerOrder_.empty() ? std::chrono::steady_clock::time_point::max() : timerOrder_.begin()->first;
+}
+
+void Executor::updateNextTimer() {
+    nextTimer_ = timerOrder_.empty() ? kNoTimer : timerOrder_.begin()->first.time_since_epoch().count();
+}
+
+void Executor::wakeOne() {
+    // Taking the lock orders the notification after an idle worker's last
+    // check of queued_, so the wake-up cannot be missed
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wakeup_.notify_one();
+}
+
+TaskQueue::~TaskQueue() {
+    account_->backlog.fetch_sub(static_cast<int64_t>(pending_));
+}
+
+bool TaskQueue::submit(std::function<void()> task, TaskPriority priority) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+        return false;
+    }
+    setPending(pending_ + 1);
+    uint64_t generation = generation_;
+    
+    if (serial_) {
+        serialTasks_.emplace_back(std::move(task), priority);
+        if (serialScheduled_) {
+            return true;
+        }
+        serialScheduled_ = true;
+        lock.unlock();
+        auto self = shared_from_this();
+        if (executor_.submit([self, generation]() { self->runSerial(generation); }, priority)) {
+            return true;
+        }
+        lock.lock();
+        if (generation == generation_) {
+            serialTasks_.clear();
+            serialScheduled_ = false;
+            setPending(running_);
+        }
+        return false;
+    }
+    
+    lock.unlock();
+    auto self = shared_from_this();
+    if (executor_.submit([self, task = std::move(task), generation]() { self->runTask(task, generation); },
+                         priority)) {
+        return true;
+    }
+    lock.lock();
+    if (generation == generation_) {
+        setPending(pending_ - 1);
+    }
+    return false;
+}
+
+Executor::TimerId TaskQueue::scheduleAfter(std::chrono::milliseconds delay, std::function<void()> task,
+                                           TaskPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return 0;
+    }
+    
+    // The timer id is only known once scheduled; the queue lock held here keeps
+    // the timer from touching timers_ before the id is recorded
+    auto id = std::make_shared<Executor::TimerId>(0);
+    std::weak_ptr<TaskQueue> weak = shared_from_this();
+    *id = executor_.scheduleAfter(delay, [weak, id, task = std::move(task), priority]() {
+        if (auto self = weak.lock()) {
+            {
+                std::lock_guard<std::mutex> lock(self->mutex_);
+                self->timers_.erase(*id);
+            }
+            self->submit(task, priority);
+        }
+    }, priority);
+    if (*id != 0) {
+        timers_.insert(*id);
+    }
+    return *id;
+}
+
+bool TaskQueue::cancel(Executor::TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timers_.erase(id) == 0) {
+        return false;
+    }
+    return executor_.cancel(id);
+}
+
+void TaskQueue::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    generation_++;
+    serialTasks_.clear();
+    serialScheduled_ = false;
+    setPending(running_);
+    for (auto id : timers_) {
+        executor_.cancel(id);
+    }
+    timers_.clear();
+    
+    size_t self = (tlsTaskQueue == this) ? 1 : 0;
+    idle_.wait(lock, [this, self]() { return running_ <= self; });
+}
+
+void TaskQueue::drain() {
+    size_t self = (tlsTaskQueue == this) ? 1 : 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (pending_ > self) {
+        if (!executor_.isWorkerThread()) {
+            idle_.wait(lock, [this, self]() { return pending_ <= self; });
+            break;
+        }
+        // The tasks may be waiting for this very worker
+        lock.unlock();
+        bool ran = executor_.runPendingTask();
+        lock.lock();
+        if (!ran) {
+            idle_.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void TaskQueue::reopen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+}
+
+void TaskQueue::setPending(size_t pending) {
+    account_->backlog.fetch_add(static_cast<int64_t>(pending) - static_cast<int64_t>(pending_));
+    pending_ = pending;
+}
+
+size_t TaskQueue::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void TaskQueue::runTask(const std::function<void()>& task, uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            return;
+        }
+        running_++;
+    }
+    
+    const TaskQueue* outer = tlsTaskQueue;
+    tlsTaskQueue = this;
+    try {
+        ResourceAccounting::Scope scope(account_);
+        task();
+    } catch (const std::exception& e) {
+        std::cerr << "Task of queue '" << name_ << "' failed: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Task of queue '" << name_ << "' failed with an unknown exception" << std::endl;
+    }
+    tlsTaskQueue = outer;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_--;
+    if (generation == generation_) {
+        setPending(pending_ - 1);
+    }
+    completed_++;
+    idle_.notify_all();
+}
+
+void TaskQueue::runSerial(uint64_t generation) {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            return;
+        }
+        if (serialTasks_.empty()) {
+            serialScheduled_ = false;
+            return;
+        }
+        task = std::move(serialTasks_.front().first);
+        serialTasks_.pop_front();
+    }
+    
+    runTask(task, generation);
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (generation != generation_) {
+        return;
+    }
+    if (serialTasks_.empty()) {
+        serialScheduled_ = false;
+        return;
+    }
+    TaskPriority next = serialTasks_.front().second;
+    lock.unlock();
+    auto self = shared_from_this();
+    executor_.submit([self, generation]() { self->runSerial(generation); }, next);
+}
+
+} // namespace swarm
@@ -0,0 +1,153 @@
+#include "../../include/core/lifecycle_profiler.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+
+namespace swarm {
+
+namespace {
+
+/** Phases in the order the summary lists them */
+const char* const kPhases[] = {"factory", "configure", "initialize", "start", "ready", "stop", "shutdown"};
+
+/** Small, stable identifier of the calling thread */
+uint32_t currentThreadId() {
+    static std::atomic<uint32_t> nextId{1};
+    thread_local uint32_t id = nextId++;
+    return id;
+}
+
+/** Escape a string for a JSON string literal */
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+                escaped += buffer;
+            } else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+void LifecycleProfiler::record(const std::string& module, const std::string& phase,
+                               std::chrono::steady_clock::time_point begin,
+                               std::chrono::steady_clock::time_point end) {
+    ProfileSpan span;
+    span.module = module;
+    span.phase = phase;
+    span.begin = std::chrono::duration_cast<std::chrono::microseconds>(begin - origin_);
+    span.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+    span.thread = currentThreadId();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back(std::move(span));
+}
+
+std::vector<ProfileSpan> LifecycleProfiler::getSpans() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spans_;
+}
+
+void LifecycleProfiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.clear();
+}
+
+std::string LifecycleProfiler::toChromeTrace() const {
+    auto spans = getSpans();
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < spans.size(); i++) {
+        const auto& span = spans[i];
+        json << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(span.module + " " + span.phase)
+             << "\",\"cat\":\"lifecycle\",\"ph\":\"X\",\"ts\":" << span.begin.count()
+             << ",\"dur\":" << span.duration.count() << ",\"pid\":" << getpid()
+             << ",\"tid\":" << span.thread << ",\"args\":{\"module\":\"" << jsonEscape(span.module)
+             << "\",\"phase\":\"" << jsonEscape(span.phase) << "\"}}";
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+bool LifecycleProfiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Cannot write profile trace to '" << path << "'" << std::endl;
+        return false;
+    }
+    file << toChromeTrace();
+    return static_cast<bool>(file);
+}
+
+std::string LifecycleProfiler::summary() const {
+    // Module -> phase -> accumulated time; phases outside kPhases (such as the
+    // bus setup) get their own column after the standard ones
+    std::map<std::string, std::map<std::string, std::chrono::microseconds>> totals;
+    std::vector<std::string> columns(std::begin(kPhases), std::end(kPhases));
+    for (const auto& span : getSpans()) {
+        totals[span.module][span.phase] += span.duration;
+        if (std::find(columns.begin(), columns.end(), span.phase) == columns.end()) {
+            columns.push_back(span.phase);
+        }
+    }
+
+    size_t nameWidth = 6;
+    for (const auto& [module, phases] : totals) {
+        nameWidth = std::max(nameWidth, module.size());
+    }
+
+    std::ostringstream table;
+    table << std::left << std::setw(static_cast<int>(nameWidth)) << "module";
+    for (const auto& column : columns) {
+        table << "  " << std::right << std::setw(10) << column;
+    }
+    table << "  " << std::setw(10) << "total" << "\n";
+
+    table << std::fixed << std::setprecision(1);
+    for (const auto& [module, phases] : totals) {
+        table << std::left << std::setw(static_cast<int>(nameWidth)) << module << std::right;
+        std::chrono::microseconds total{0};
+        for (const auto& column : columns) {
+            auto it = phases.find(column);
+            if (it == phases.end()) {
+                table << "  " << std::setw(10) << "-";
+            } else {
+                table << "  " << std::setw(10) << it->second.count() / 1000.0;
+                total += it->second;
+            }
+        }
+        table << "  " << std::setw(10) << total.count() / 1000.0 << "\n";
+    }
+    return table.str();
+}
+
+void LifecycleProfiler::reportIfRequested(std::ostream& out) const {
+    const char* path = std::getenv("SWARM_PROFILE_TRACE");
+    if (!path || !*path) {
+        return;
+    }
+    if (writeChromeTrace(path)) {
+        out << "Lifecycle profile written to " << path << " (times in ms):\n" << summary() << std::flush;
+    }
+}
+
+} // namespace swarm
@@ -2,11 +2,24 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <atomic>
 #include <zmq.hpp>
 
 namespace swarm {
 
-MessageBus::MessageBus() : running_(false), messageCount_(0) {
+const char* toString(BusTransport transport) {
+    switch (transport) {
+        case BusTransport::Inproc: return "inproc";
+        case BusTransport::Ipc: return "ipc";
+        case BusTransport::Tcp: return "tcp";
+    }
+    return "unknown";
+}
+
+MessageBus::MessageBus(const MessageBusOptions& options) : options_(options), running_(false), messageCount_(0) {
+    if (!options_.clock) {
+        options_.clock = Clock::system();
+    }
     setupZeroMQ();
 }
 
@@ -15,56 +28,53 @@ MessageBus::~MessageBus() {
     cleanupZeroMQ();
 }
 
+std::string MessageBus::bindSocket(zmq::socket_t& socket, const std::string& role, int port) {
+    if (options_.transport == BusTransport::Inproc) {
+        // Every bus has its own context; the number tells the buses of a process apart
+        static std::atomic<unsigned> nextBus{0};
+        std::string endpoint = "inproc://swarm-bus-" + std::to_string(nextBus++) + "-" + role;
+        socket.bind(endpoint);
+        return endpoint;
+    }
+    if (options_.transport == BusTransport::Ipc) {
+        std::string endpoint = "ipc://" + options_.ipcPath + "-" + role;
+        socket.bind(endpoint);
+        return endpoint;
+    }
+    for (int i = 0;; i++) {
+        try {
+            std::string endpoint = "tcp://" + options_.host + ":" + std::to_string(port);
+            socket.bind(endpoint);
+            return endpoint;
+        } catch (const zmq::error_t& e) {
+            if (i >= MAX_PORT_RETRIES - 1) {
+                throw;
+            }
+            port += PORT_INCREMENT;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
 void MessageBus::setupZeroMQ() {
     try {
         // Create ZeroMQ context
         context_ = std::make_unique<zmq::context_t>(1);
         
-        // Try to bind publisher socket with port retry logic
         publisher_socket_ = std::make_unique<zmq::socket_t>(*context_, ZMQ_PUB);
         publisher_socket_->set(zmq::sockopt::linger, 0); // Don't wait on close
+        publisherEndpoint_ = bindSocket(*publisher_socket_, "pub", options_.publisherPort);
         
-        int pub_port = 5555;
-        bool pub_bound = false;
-        for (int i = 0; i < MAX_PORT_RETRIES && !pub_bound; i++) {
-            try {
-                std::string endpoint = "tcp://127.0.0.1:" + std::to_string(pub_port);
-                publisher_socket_->bind(endpoint);
-                pub_bound = true;
-            } catch (const zmq::error_t& e) {
-                if (i < MAX_PORT_RETRIES - 1) {
-                    pub_port += PORT_INCREMENT;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                } else {
-                    throw;
-                }
-            }
-        }
-        
-        // Try to bind subscriber socket with port retry logic
         subscriber_socket_ = std::make_unique<zmq::socket_t>(*context_, ZMQ_SUB);
         subscriber_socket_->set(zmq::sockopt::linger, 0); // Don't wait on close
+        subscriberEndpoint_ = bindSocket(*subscriber_socket_, "sub", options_.subscriberPort);
         
-        int sub_port = 5556;
-        bool sub_bound = false;
-        for (int i = 0; i < MAX_PORT_RETRIES && !sub_bound; i++) {
-            try {
-                std::string endpoint = "tcp://127.0.0.1:" + std::to_string(sub_port);
-                subscriber_socket_->bind(endpoint);
-                sub_bound = true;
-            } catch (const zmq::error_t& e) {
-                if (i < MAX_PORT_RETRIES - 1) {
-                    sub_port += PORT_INCREMENT;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                } else {
-                    throw;
-                }
-            }
+        // Nothing to wait for when no other process can connect
+        if (options_.transport != BusTransport::Inproc) {
+            // Allow time for sockets to bind
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         
-        // Allow time for sockets to bind
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        
     } catch (const zmq::error_t& e) {
         std::cerr << "ZeroMQ setup error: " << e.what() << std::endl;
         throw;
@@ -85,16 +95,34 @@ void MessageBus::cleanupZeroMQ() {
             context_->close();
             context_.reset();
         }
-        // Allow time for sockets to fully close
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        // Allow time for sockets to fully close; inproc sockets close with the context
+        if (options_.transport != BusTransport::Inproc) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
     } catch (const zmq::error_t& e) {
         std::cerr << "ZeroMQ cleanup error: " << e.what() << std::endl;
     }
 }
 
-void MessageBus::subscribe(const std::string& topic, MessageHandler handler) {
+MessageBus::SubscriptionId MessageBus::subscribe(const std::string& topic, MessageHandler handler) {
+    return addSubscription(topic, {0, std::move(handler), nullptr});
+}
+
+MessageBus::SubscriptionId MessageBus::subscribe(const std::string& topic, std::shared_ptr<MessageSink> sink) {
+    return addSubscription(topic, {0, nullptr, std::move(sink)});
+}
+
+MessageBus::SubscriptionId MessageBus::addSubscription(const std::string& topic, Subscription subscription) {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
-    subscribers_[topic].push_back(handler);
+    subscription.id = nextSubscriptionId_++;
+    
+    // Deliveries in progress keep using the list they took, so it is replaced rather than modified
+    auto& list = subscribers_[topic];
+    auto updated = list ? std::make_shared<std::vector<Subscription>>(*list)
+                        : std::make_shared<std::vector<Subscription>>();
+    updated->push_back(subscription);
+    list = std::move(updated);
+    subscriptionTopics_[subscription.id] = topic;
     
     // Subscribe to topic in ZeroMQ
     try {
@@ -102,6 +130,7 @@ void MessageBus::subscribe(const std::string& topic, MessageHandler handler) {
     } catch (const zmq::error_t& e) {
         std::cerr << "ZeroMQ subscribe error: " << e.what() << std::endl;
     }
+    return subscription.id;
 }
 
 void MessageBus::unsubscribe(const std::string& topic, MessageHandler handler) {
@@ -109,10 +138,11 @@ void MessageBus::unsubscribe(const std::string& topic, MessageHandler handler) {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
     auto it = subscribers_.find(topic);
     if (it != subscribers_.end()) {
-        auto& handlers = it->second;
-        // Note: This is a simplified implementation
-        // In a real implementation, you'd need a way to identify specific handlers
-        handlers.clear(); // Remove all handlers for this topic
+        // std::function cannot be compared, so every handler of the topic is removed
+        for (const auto& subscription : *it->second) {
+            subscriptionTopics_.erase(subscription.id);
+        }
+        subscribers_.erase(it); // Remove all handlers for this topic
     }
     
     // Unsubscribe from topic in ZeroMQ
@@ -123,6 +153,77 @@ void MessageBus::unsubscribe(const std::string& topic, MessageHandler handler) {
     }
 }
 
+void MessageBus::unsubscribe(SubscriptionId id) {
+    std::lock_guard<std::mutex> lock(subscribersMutex_);
+    auto topicIt = subscriptionTopics_.find(id);
+    if (topicIt == subscriptionTopics_.end()) {
+        return;
+    }
+    std::string topic = topicIt->second;
+    subscriptionTopics_.erase(topicIt);
+    
+    auto it = subscribers_.find(topic);
+    auto updated = std::make_shared<std::vector<Subscription>>();
+    for (const auto& subscription : *it->second) {
+        if (subscription.id != id) {
+            updated->push_back(subscription);
+        }
+    }
+    
+    if (!updated->empty()) {
+        it->second = std::move(updated);
+        return;
+    }
+    subscribers_.erase(it);
+    try {
+        subscriber_socket_->set(zmq::sockopt::unsubscribe, topic);
+    } catch (const zmq::error_t& e) {
+        std::cerr << "ZeroMQ unsubscribe error: " << e.what() << std::endl;
+    }
+}
+
+void MessageBus::holdTopic(const std::string& topic) {
+    std::unique_lock<std::mutex> lock(subscribersMutex_);
+    heldTopics_[topic].holds++;
+    deliveriesDone_.wait(lock, [this, &topic]() {
+        return activeDeliveries_.find(topic) == activeDeliveries_.end();
+    });
+}
+
+void MessageBus::releaseTopic(const std::string& topic) {
+    while (true) {
+        std::vector<std::string> buffered;
+        {
+            std::lock_guard<std::mutex> lock(subscribersMutex_);
+            auto it = heldTopics_.find(topic);
+            if (it == heldTopics_.end()) {
+                return;
+            }
+            if (it->second.holds > 1) {
+                it->second.holds--;
+                return;
+            }
+            // Keep holding while the backlog is replayed so that messages
+            // published meanwhile queue up behind it instead of overtaking it
+            if (it->second.buffered.empty()) {
+                heldTopics_.erase(it);
+                return;
+            }
+            buffered.swap(it->second.buffered);
+        }
+        for (const auto& message : buffered) {
+            SubscriptionList handlers;
+            {
+                std::lock_guard<std::mutex> lock(subscribersMutex_);
+                if (!beginDelivery(topic, handlers)) {
+                    continue;
+                }
+            }
+            completeDelivery(topic, message, handlers);
+        }
+    }
+}
+
 void MessageBus::publish(const std::string& topic, const std::string& message) {
     try {
         // Send message via ZeroMQ publisher
@@ -131,17 +232,7 @@ void MessageBus::publish(const std::string& topic, const std::string& message) {
         publisher_socket_->send(zmq_msg, zmq::send_flags::none);
         
         // Also handle locally for immediate subscribers
-        std::lock_guard<std::mutex> lock(subscribersMutex_);
-        auto it = subscribers_.find(topic);
-        if (it != subscribers_.end()) {
-            for (const auto& handler : it->second) {
-                try {
-                    handler(topic, message);
-                } catch (const std::exception& e) {
-                    std::cerr << "Error in message handler: " << e.what() << std::endl;
-                }
-            }
-        }
+        dispatch(topic, message);
         
         messageCount_++;
         
@@ -150,14 +241,85 @@ void MessageBus::publish(const std::string& topic, const std::string& message) {
     }
 }
 
+void MessageBus::dispatch(const std::string& topic, const std::string& message) {
+    SubscriptionList handlers;
+    {
+        std::lock_guard<std::mutex> lock(subscribersMutex_);
+        auto held = heldTopics_.find(topic);
+        if (held != heldTopics_.end()) {
+            held->second.buffered.push_back(message);
+            return;
+        }
+        if (!beginDelivery(topic, handlers)) {
+            return;
+        }
+    }
+    completeDelivery(topic, message, handlers);
+}
+
+bool MessageBus::beginDelivery(const std::string& topic, SubscriptionList& handlers) {
+    auto it = subscribers_.find(topic);
+    if (it == subscribers_.end()) {
+        return false;
+    }
+    handlers = it->second;
+    activeDeliveries_[topic]++;
+    return true;
+}
+
+void MessageBus::completeDelivery(const std::string& topic, const std::string& message,
+                                  const SubscriptionList& handlers) {
+    for (const auto& subscription : *handlers) {
+        try {
+            if (subscription.sink) {
+                subscription.sink->deliver(topic, message);
+            } else {
+                subscription.handler(topic, message);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error in message handler: " << e.what() << std::endl;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(subscribersMutex_);
+    auto active = activeDeliveries_.find(topic);
+    if (--active->second == 0) {
+        activeDeliveries_.erase(active);
+        deliveriesDone_.notify_all();
+    }
+}
+
 void MessageBus::publishAsync(const std::string& topic, const std::string& message) {
     {
         std::lock_guard<std::mutex> lock(queueMutex_);
-        messageQueue_.push_back({topic, message, std::chrono::system_clock::now()});
+        messageQueue_.push_back({topic, message, options_.clock->wallNow()});
     }
     queueCondition_.notify_one();
 }
 
+bool MessageBus::flush(std::chrono::steady_clock::time_point deadline) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        if (!running_.load()) {
+            // Nobody processes the queue any more
+            std::vector<Message> messages;
+            messages.swap(messageQueue_);
+            lock.unlock();
+            for (const auto& msg : messages) {
+                publish(msg.topic, msg.payload);
+            }
+        } else if (!queueFlushed_.wait_until(lock, deadline, [this] {
+                       return messageQueue_.empty() && !batchInProgress_;
+                   })) {
+            return false;
+        }
+    }
+    
+    // Deliveries of synchronous publish() calls
+    std::unique_lock<std::mutex> lock(subscribersMutex_);
+    return deliveriesDone_.wait_until(lock, deadline, [this] { return activeDeliveries_.empty(); });
+}
+
 void MessageBus::start() {
     if (!running_.exchange(true)) {
         workerThread_ = std::thread(&MessageBus::processMessages, this);
@@ -184,7 +346,7 @@ size_t MessageBus::getMessageCount() const {
 size_t MessageBus::getSubscriberCount(const std::string& topic) const {
     std::lock_guard<std::mutex> lock(subscribersMutex_);
     auto it = subscribers_.find(topic);
-    return (it != subscribers_.end()) ? it->second.size() : 0;
+    return (it != subscribers_.end()) ? it->second->size() : 0;
 }
 
 void MessageBus::processMessages() {
@@ -211,17 +373,7 @@ void MessageBus::processMessages() {
                         std::string message = received_msg.substr(space_pos + 1);
                         
                         // Handle message locally
-                        std::lock_guard<std::mutex> lock(subscribersMutex_);
-                        auto it = subscribers_.find(topic);
-                        if (it != subscribers_.end()) {
-                            for (const auto& handler : it->second) {
-                                try {
-                                    handler(topic, message);
-                                } catch (const std::exception& e) {
-                                    std::cerr << "Error in message handler: " << e.what() << std::endl;
-                                }
-                            }
-                        }
+                        dispatch(topic, message);
                         messageCount_++;
                     }
                 }
@@ -236,12 +388,18 @@ void MessageBus::processMessages() {
                     
                     if (!running_.load()) break;
                     messages.swap(messageQueue_);
+                    batchInProgress_ = !messages.empty();
                 }
             }
             
             for (const auto& msg : messages) {
                 publish(msg.topic, msg.payload);
             }
+            if (!messages.empty()) {
+                std::lock_guard<std::mutex> lock(queueMutex_);
+                batchInProgress_ = false;
+                queueFlushed_.notify_all();
+            }
             
         } catch (const zmq::error_t& e) {
             std::cerr << "ZeroMQ processing error: " << e.what() << std::endl;
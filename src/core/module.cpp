@@ -0,0 +1,136 @@
+#include "../../include/core/module.h"
+#include "../../include/core/message_bus.h"
+#include <iostream>
+#include <algorithm>
+#include <set>
+
+namespace swarm {
+
+const char* toString(ModuleState state) {
+    switch (state) {
+    case ModuleState::Running: return "running";
+    case ModuleState::Restarting: return "restarting";
+    case ModuleState::Failed: return "failed";
+    case ModuleState::Stopped: break;
+    }
+    return "stopped";
+}
+
+void Module::subscribe(const std::string& topic,
+                       std::function<void(const std::string&, const std::string&)> handler) {
+    if (!messageBus_) {
+        std::cerr << "Module '" << getName() << "' cannot subscribe to '" << topic
+                  << "' without a message bus" << std::endl;
+        return;
+    }
+    
+    MessageBus::SubscriptionId id = messageBus_->subscribe(topic, std::move(handler));
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    subscriptions_.push_back({topic, id, false});
+}
+
+std::vector<std::string> Module::getSubscribedTopics() const {
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    std::set<std::string> topics;
+    for (const auto& subscription : subscriptions_) {
+        topics.insert(subscription.topic);
+    }
+    return std::vector<std::string>(topics.begin(), topics.end());
+}
+
+void Module::unsubscribeAll() {
+    std::vector<OwnedSubscription> subscriptions;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        subscriptions.swap(subscriptions_);
+    }
+    if (messageBus_) {
+        for (const auto& subscription : subscriptions) {
+            messageBus_->unsubscribe(subscription.id);
+        }
+    }
+}
+
+void Module::wireSubscriptions(const std::shared_ptr<MessageSink>& sink) {
+    if (!messageBus_) {
+        return;
+    }
+    for (const auto& topic : getSubscriptions()) {
+        MessageBus::SubscriptionId id = messageBus_->subscribe(topic, sink);
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        subscriptions_.push_back({topic, id, true});
+    }
+}
+
+void Module::unwireSubscriptions() {
+    std::vector<OwnedSubscription> declared;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        auto split = std::stable_partition(subscriptions_.begin(), subscriptions_.end(),
+                                           [](const OwnedSubscription& s) { return !s.declared; });
+        declared.assign(split, subscriptions_.end());
+        subscriptions_.erase(split, subscriptions_.end());
+    }
+    if (messageBus_) {
+        for (const auto& subscription : declared) {
+            messageBus_->unsubscribe(subscription.id);
+        }
+    }
+}
+
+void Module::deliver(const std::string& topic, const std::string& message) {
+    ResourceAccounting::Scope scope(account_);
+    auto start = std::chrono::steady_clock::now();
+    auto record = [this, start]() {
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        deliveryTimeNs_.fetch_add(elapsed, std::memory_order_relaxed);
+        int64_t longest = maxDeliveryTimeNs_.load(std::memory_order_relaxed);
+        while (elapsed > longest &&
+               !maxDeliveryTimeNs_.compare_exchange_weak(longest, elapsed, std::memory_order_relaxed)) {
+        }
+    };
+    
+    try {
+        onMessage(topic, message);
+    } catch (...) {
+        record();
+        deliveryFailures_.fetch_add(1, std::memory_order_relaxed);
+        statusChanged();
+        throw;
+    }
+    record();
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+    statusChanged();
+}
+
+bool Module::runSupervised(const std::function<void()>& body) {
+    std::string reason;
+    try {
+        body();
+        return true;
+    } catch (const std::exception& e) {
+        if (!failureHandler_) {
+            throw;
+        }
+        reason = e.what();
+    } catch (...) {
+        if (!failureHandler_) {
+            throw;
+        }
+        reason = "unknown exception";
+    }
+    failureHandler_(reason);
+    return false;
+}
+
+DeliveryMetrics Module::getDeliveryMetrics() const {
+    DeliveryMetrics metrics;
+    metrics.delivered = delivered_.load(std::memory_order_relaxed);
+    metrics.failed = deliveryFailures_.load(std::memory_order_relaxed);
+    metrics.totalTime = std::chrono::nanoseconds(deliveryTimeNs_.load(std::memory_order_relaxed));
+    metrics.maxTime = std::chrono::nanoseconds(maxDeliveryTimeNs_.load(std::memory_order_relaxed));
+    return metrics;
+}
+
+} // namespace swarm
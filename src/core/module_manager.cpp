@@ -1,170 +1,1612 @@
 #include "../../include/core/module_manager.h"
+#include "../../include/core/plugin_api.h"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <cstdlib>
+#include <dlfcn.h>
 
 namespace swarm {
 
-ModuleManager::ModuleManager() : initialized_(false) {
+namespace {
+
+/**
+ * Runs @p task once for every node on the shared executor. A node is only run
+ * after every node listed as its prerequisite has finished, so nodes without
+ * pending prerequisites run concurrently. When @p skipAfterFailure is set,
+ * nodes whose prerequisites failed are not run and are reported as failed.
+ * The graph formed by @p prerequisites must be acyclic. When called from an
+ * executor worker, the nodes run one by one on the calling thread instead, so
+ * that waiting for them cannot exhaust the thread budget.
+ */
+std::map<std::string, bool> runDependencyGraph(
+    Executor& executor,
+    const std::vector<std::string>& nodes,
+    const std::map<std::string, std::vector<std::string>>& prerequisites,
+    const std::function<bool(const std::string&)>& task,
+    bool skipAfterFailure) {
+    std::map<std::string, size_t> pending;
+    std::map<std::string, std::vector<std::string>> successors;
+    std::set<std::string> prerequisiteFailed;
+    for (const auto& node : nodes) {
+        pending[node] = 0;
+    }
+    for (const auto& node : nodes) {
+        auto it = prerequisites.find(node);
+        if (it == prerequisites.end()) {
+            continue;
+        }
+        for (const auto& pre : it->second) {
+            if (pre != node && pending.count(pre)) {
+                pending[node]++;
+                successors[pre].push_back(node);
+            }
+        }
+    }
+    
+    const bool runInline = executor.isWorkerThread();
+    std::deque<std::string> ready;
+    std::vector<std::string> launch;
+    std::map<std::string, bool> results;
+    std::mutex mutex;
+    std::condition_variable cv;
+    
+    // Called with the mutex held; nodes that become runnable are collected in
+    // launch and handed to the executor once the mutex is released
+    std::function<void(const std::string&, bool)> complete = [&](const std::string& node, bool ok) {
+        results[node] = ok;
+        for (const auto& next : successors[node]) {
+            if (!ok) {
+                prerequisiteFailed.insert(next);
+            }
+            if (--pending[next] == 0) {
+                if (skipAfterFailure && prerequisiteFailed.count(next)) {
+                    complete(next, false);
+                } else {
+                    launch.push_back(next);
+                }
+            }
+        }
+    };
+    
+    // Executor tasks still touching this frame; the caller waits for them too
+    size_t active = 0;
+    std::function<void(std::vector<std::string>)> submit;
+    auto run = [&](const std::string& node, bool pooled) {
+        bool ok = false;
+        try {
+            ok = task(node);
+        } catch (const std::exception& e) {
+            std::cerr << "Error processing module '" << node << "': " << e.what() << std::endl;
+        }
+        std::vector<std::string> next;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            complete(node, ok);
+            next.swap(launch);
+        }
+        submit(std::move(next));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pooled) {
+            active--;
+        }
+        cv.notify_all();
+    };
+    
+    // Nodes the executor does not take are run by the caller
+    submit = [&](std::vector<std::string> nodesToRun) {
+        for (const auto& node : nodesToRun) {
+            if (!runInline) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    active++;
+                }
+                if (executor.submit([&run, node]() { run(node, true); }, TaskPriority::High)) {
+                    continue;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!runInline) {
+                active--;
+            }
+            ready.push_back(node);
+        }
+    };
+    
+    std::vector<std::string> roots;
+    for (const auto& node : nodes) {
+        if (pending[node] == 0) {
+            roots.push_back(node);
+        }
+    }
+    submit(std::move(roots));
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    while (results.size() < nodes.size() || !ready.empty() || active > 0) {
+        if (!ready.empty()) {
+            std::string node = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            run(node, false);
+            lock.lock();
+            continue;
+        }
+        cv.wait(lock);
+    }
+    return results;
+}
+
+/**
+ * A start() or stop() call handed to the executor by
+ * ModuleManager::runWithDeadline().
+ */
+struct DeadlineCall {
+    std::function<void()> fn;                             ///< The call
+    std::mutex mutex;                                     ///< Guards the members below
+    std::condition_variable finished;                     ///< Signalled when the call returns
+    bool started = false;                                 ///< Whether a worker began running the call
+    bool done = false;                                    ///< Whether the call returned
+    bool abandoned = false;                               ///< Whether the caller stopped waiting
+    std::exception_ptr error;                             ///< Exception thrown by the call
+};
+
+/**
+ * A module plugin. The shared object is opened on first use and stays mapped
+ * for the rest of the process, since module instances (and code they handed
+ * out, such as vtables and callbacks) may outlive the manager that loaded them.
+ */
+class PluginLibrary {
+public:
+    explicit PluginLibrary(std::string path) : path_(std::move(path)) {}
+    
+    /**
+     * Returns the plugin's descriptor, opening the shared object if needed, or
+     * nullptr if the plugin cannot be loaded.
+     */
+    const SwarmPluginDescriptor* descriptor() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (descriptor_ || failed_) {
+            return descriptor_;
+        }
+        failed_ = true;
+        
+        void* handle = dlopen(path_.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            std::cerr << "Failed to load plugin '" << path_ << "': " << dlerror() << std::endl;
+            return nullptr;
+        }
+        auto entryPoint = reinterpret_cast<SwarmPluginEntryPoint>(dlsym(handle, SWARM_PLUGIN_ENTRY_POINT));
+        if (!entryPoint) {
+            std::cerr << "Plugin '" << path_ << "' does not export " << SWARM_PLUGIN_ENTRY_POINT << std::endl;
+            dlclose(handle);
+            return nullptr;
+        }
+        const SwarmPluginDescriptor* descriptor = entryPoint();
+        if (!descriptor || descriptor->abiVersion != SWARM_PLUGIN_ABI_VERSION || !descriptor->create) {
+            std::cerr << "Plugin '" << path_ << "' has an incompatible ABI version (expected "
+                      << SWARM_PLUGIN_ABI_VERSION << ")" << std::endl;
+            dlclose(handle);
+            return nullptr;
+        }
+        
+        failed_ = false;
+        descriptor_ = descriptor;
+        return descriptor_;
+    }
+    
+    const std::string& path() const { return path_; }
+    
+private:
+    std::string path_;
+    std::mutex mutex_;
+    const SwarmPluginDescriptor* descriptor_ = nullptr;
+    bool failed_ = false;
+};
+
+/**
+ * Builds a factory that creates module @p name from @p library.
+ */
+ModuleFactory pluginFactory(std::shared_ptr<PluginLibrary> library, const std::string& name) {
+    return [library, name]() -> std::unique_ptr<Module> {
+        const SwarmPluginDescriptor* descriptor = library->descriptor();
+        if (!descriptor) {
+            return nullptr;
+        }
+        if (name != descriptor->name) {
+            std::cerr << "Plugin '" << library->path() << "' provides module '" << descriptor->name
+                      << "', expected '" << name << "'" << std::endl;
+            return nullptr;
+        }
+        return std::unique_ptr<Module>(descriptor->create());
+    };
+}
+
+/**
+ * Runs @p fn, records it as @p phase of @p module and charges its CPU time to
+ * the module.
+ */
+template <typename Fn>
+auto profiled(LifecycleProfiler& profiler, const std::string& module, const char* phase, Fn&& fn) {
+    LifecycleProfiler::Span span(profiler, module, phase);
+    ResourceAccounting::Scope scope(ResourceAccounting::accountFor(module));
+    return fn();
+}
+
+/**
+ * Parses the "load_balancing" configuration value.
+ */
+bool parseLoadBalancing(const std::string& text, LoadBalancing& strategy) {
+    if (text == "round_robin") {
+        strategy = LoadBalancing::RoundRobin;
+    } else if (text == "key_hash") {
+        strategy = LoadBalancing::KeyHash;
+    } else if (text == "least_loaded") {
+        strategy = LoadBalancing::LeastLoaded;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the load balancing strategy from a module configuration, defaulting to
+ * round robin when the key is absent.
+ */
+bool loadBalancingFrom(const std::map<std::string, std::string>& config, LoadBalancing& strategy) {
+    strategy = LoadBalancing::RoundRobin;
+    auto it = config.find("load_balancing");
+    return it == config.end() || parseLoadBalancing(it->second, strategy);
+}
+
+/**
+ * Gives the message bus the executor's clock unless the options name their own,
+ * so a manager built on a VirtualClock stamps its messages in simulated time.
+ */
+MessageBusOptions withClock(MessageBusOptions options, const std::shared_ptr<Clock>& clock) {
+    if (!options.clock) {
+        options.clock = clock;
+    }
+    return options;
+}
+
+} // namespace
+
+/**
+ * Receives the declared subscriptions of a replicated module and hands every
+ * message to one replica, on that replica's serial lane.
+ */
+class ModuleManager::ReplicaSet : public MessageSink {
+public:
+    ReplicaSet(Executor& executor, const std::string& name, std::vector<std::shared_ptr<Module>> instances,
+               LoadBalancing strategy)
+        : instances_(std::move(instances)), strategy_(strategy) {
+        for (size_t i = 0; i < instances_.size(); i++) {
+            lanes_.push_back(executor.createQueue(name + "#" + std::to_string(i), true));
+            lanes_.back()->close();
+        }
+    }
+    
+    void deliver(const std::string& topic, const std::string& message) override {
+        size_t index = pick(message);
+        auto instance = instances_[index];
+        lanes_[index]->submit([instance, topic, message]() { instance->deliver(topic, message); });
+    }
+    
+    const std::vector<std::shared_ptr<Module>>& instances() const { return instances_; }
+    
+    LoadBalancing strategy() const { return strategy_.load(); }
+    void setStrategy(LoadBalancing strategy) { strategy_ = strategy; }
+    
+    /** Accepts messages; lanes start closed and are opened once the replicas run. */
+    void open() {
+        for (const auto& lane : lanes_) {
+            lane->reopen();
+        }
+    }
+    
+    /** Waits until the replicas handled every message handed to them. */
+    void drain() {
+        for (const auto& lane : lanes_) {
+            lane->drain();
+        }
+    }
+    
+    /** Drops messages that have not been handed to a replica yet. */
+    void close() {
+        for (const auto& lane : lanes_) {
+            lane->close();
+        }
+    }
+    
+private:
+    size_t pick(const std::string& message) {
+        switch (strategy_.load()) {
+        case LoadBalancing::KeyHash:
+            return std::hash<std::string>{}(message.substr(0, message.find('\n'))) % instances_.size();
+        case LoadBalancing::LeastLoaded: {
+            // Start the scan at a rotating offset so ties do not pile up on one replica
+            size_t offset = next_++;
+            size_t best = offset % lanes_.size();
+            size_t bestPending = lanes_[best]->getPendingCount();
+            for (size_t i = 1; i < lanes_.size() && bestPending > 0; i++) {
+                size_t index = (offset + i) % lanes_.size();
+                size_t pending = lanes_[index]->getPendingCount();
+                if (pending < bestPending) {
+                    best = index;
+                    bestPending = pending;
+                }
+            }
+            return best;
+        }
+        case LoadBalancing::RoundRobin:
+        default:
+            return next_++ % instances_.size();
+        }
+    }
+    
+    std::vector<std::shared_ptr<Module>> instances_;
+    std::vector<std::shared_ptr<TaskQueue>> lanes_;
+    std::atomic<LoadBalancing> strategy_;
+    std::atomic<size_t> next_{0};
+};
+
+ModuleManager::ModuleManager() : ModuleManager(ExecutorOptions()) {
+}
+
+ModuleManager::ModuleManager(const ExecutorOptions& executorOptions)
+    : ModuleManager(executorOptions, MessageBusOptions()) {
+}
+
+ModuleManager::ModuleManager(const ExecutorOptions& executorOptions, const MessageBusOptions& busOptions)
+    : executor_(executorOptions), messageBus_(withClock(busOptions, executor_.getClock())), initialized_(false) {
+    profiler_.record("message-bus", "setup", busSetupBegin_, std::chrono::steady_clock::now());
+    LifecycleProfiler::Span span(profiler_, "message-bus", "start");
     messageBus_.start();
 }
 
 ModuleManager::~ModuleManager() {
+    stopSupervisor();
     shutdownAllModules();
-    messageBus_.stop();
+    {
+        LifecycleProfiler::Span span(profiler_, "message-bus", "stop");
+        messageBus_.stop();
+    }
+    profiler_.reportIfRequested(std::cout);
+}
+
+bool ModuleManager::runWithDeadline(const std::string& name, std::function<void()> fn,
+                                    std::chrono::milliseconds timeout) {
+    if (timeout.count() <= 0) {
+        fn();
+        return true;
+    }
+    
+    auto call = std::make_shared<DeadlineCall>();
+    call->fn = std::move(fn);
+    bool submitted = executor_.submit([this, call, name]() {
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            if (call->abandoned) {
+                return;
+            }
+            call->started = true;
+        }
+        std::exception_ptr error;
+        try {
+            call->fn();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        bool overdue = false;
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            call->done = true;
+            call->error = error;
+            overdue = call->abandoned;
+        }
+        call->finished.notify_all();
+        if (overdue) {
+            std::lock_guard<std::mutex> lock(overdueMutex_);
+            overdueCalls_.erase(overdueCalls_.find(name));
+            overdueReturned_.notify_all();
+        }
+    }, TaskPriority::High);
+    if (!submitted) {
+        call->fn();
+        return true;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(call->mutex);
+    while (!call->done && std::chrono::steady_clock::now() < deadline) {
+        if (!executor_.isWorkerThread()) {
+            call->finished.wait_until(lock, deadline);
+            continue;
+        }
+        // The call may be queued behind this very worker
+        lock.unlock();
+        bool ran = executor_.runPendingTask();
+        lock.lock();
+        if (!ran) {
+            call->finished.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+    if (!call->done) {
+        // A call no worker picked up is dropped; one that is running is
+        // tracked until it returns
+        call->abandoned = true;
+        if (call->started) {
+            std::lock_guard<std::mutex> overdueLock(overdueMutex_);
+            overdueCalls_.insert(name);
+        }
+        return false;
+    }
+    if (call->error) {
+        std::rethrow_exception(call->error);
+    }
+    return true;
+}
+
+size_t ModuleManager::getOverdueCallCount() const {
+    std::lock_guard<std::mutex> lock(overdueMutex_);
+    return overdueCalls_.size();
+}
+
+std::vector<std::shared_ptr<Module>> ModuleManager::instancesOf(const ModuleInfo& info) {
+    if (info.replicas) {
+        return info.replicas->instances();
+    }
+    if (info.module) {
+        return {info.module};
+    }
+    return {};
+}
+
+std::shared_ptr<ModuleManager::ModuleInfo> ModuleManager::findEntry(const std::string& name) const {
+    auto registry = modules_.read();
+    auto it = registry->find(name);
+    return (it != registry->end()) ? it->second : nullptr;
+}
+
+void ModuleManager::publishEntry(const std::string& name, std::shared_ptr<ModuleInfo> entry) {
+    std::lock_guard<std::mutex> lock(publishMutex_);
+    auto next = std::make_unique<Registry>(*modules_.read());
+    if (entry) {
+        (*next)[name] = std::move(entry);
+    } else {
+        next->erase(name);
+    }
+    modules_.publish(std::move(next));
+    lifecycleVersion_++;
 }
 
 void ModuleManager::registerModule(const std::string& name, ModuleFactory factory) {
-    modules_[name] = {nullptr, factory, false, false, {}};
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    auto entry = std::make_shared<ModuleInfo>();
+    entry->factory = std::move(factory);
+    publishEntry(name, std::move(entry));
 }
 
 void ModuleManager::unregisterModule(const std::string& name) {
-    auto it = modules_.find(name);
-    if (it != modules_.end()) {
-        if (it->second.running) {
-            stopModule(name);
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    auto entry = findEntry(name);
+    if (entry) {
+        if (entry->running) {
+            stopModuleLocked(name);
         }
-        if (it->second.loaded) {
-            unloadModule(name);
+        if (entry->loaded()) {
+            unloadModuleLocked(name);
         }
-        modules_.erase(it);
+        publishEntry(name, nullptr);
     }
 }
 
-bool ModuleManager::loadModule(const std::string& name, const std::map<std::string, std::string>& config) {
-    auto it = modules_.find(name);
-    if (it == modules_.end()) {
+size_t ModuleManager::scanPluginDirectory(const std::string& directory) {
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error);
+    if (error) {
+        std::cerr << "Cannot scan plugin directory '" << directory << "': " << error.message() << std::endl;
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    size_t registered = 0;
+    for (const auto& file : it) {
+        if (!file.is_regular_file(error)) {
+            continue;
+        }
+        std::string name = pluginModuleName(file.path().filename().string());
+        if (name.empty() || findEntry(name)) {
+            continue;
+        }
+        
+        auto entry = std::make_shared<ModuleInfo>();
+        entry->factory = pluginFactory(std::make_shared<PluginLibrary>(file.path().string()), name);
+        publishEntry(name, std::move(entry));
+        registered++;
+        std::cout << "Plugin '" << name << "' registered from " << file.path().string() << std::endl;
+    }
+    return registered;
+}
+
+bool ModuleManager::registerPlugin(const std::string& path) {
+    auto library = std::make_shared<PluginLibrary>(path);
+    const SwarmPluginDescriptor* descriptor = library->descriptor();
+    if (!descriptor) {
+        return false;
+    }
+    
+    registerModule(descriptor->name, pluginFactory(library, descriptor->name));
+    std::cout << "Plugin '" << descriptor->name << "' " << descriptor->version
+              << " loaded from " << path << std::endl;
+    return true;
+}
+
+std::string ModuleManager::pluginModuleName(const std::string& fileName) {
+    const std::string libPrefix = "lib";
+    const std::string extension = ".so";
+    const std::string swarmPrefix = "swarm-";
+    const std::string pluginSuffix = "-plugin";
+    
+    if (fileName.size() <= libPrefix.size() + extension.size() ||
+        fileName.compare(0, libPrefix.size(), libPrefix) != 0 ||
+        fileName.compare(fileName.size() - extension.size(), extension.size(), extension) != 0) {
+        return "";
+    }
+    
+    std::string name = fileName.substr(libPrefix.size(), fileName.size() - libPrefix.size() - extension.size());
+    if (name.size() > swarmPrefix.size() && name.compare(0, swarmPrefix.size(), swarmPrefix) == 0) {
+        name = name.substr(swarmPrefix.size());
+    }
+    if (name.size() > pluginSuffix.size() &&
+        name.compare(name.size() - pluginSuffix.size(), pluginSuffix.size(), pluginSuffix) == 0) {
+        name = name.substr(0, name.size() - pluginSuffix.size());
+    }
+    return name;
+}
+
+bool ModuleManager::loadModule(const std::string& name, const std::map<std::string, std::string>& config,
+                               size_t replicas) {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    auto entry = findEntry(name);
+    if (!entry) {
         std::cerr << "Module '" << name << "' not registered" << std::endl;
         return false;
     }
     
-    if (it->second.loaded) {
+    if (entry->loaded()) {
         std::cerr << "Module '" << name << "' already loaded" << std::endl;
         return false;
     }
     
+    if (replicas == 0) {
+        std::cerr << "Module '" << name << "' needs at least one replica" << std::endl;
+        return false;
+    }
+    LoadBalancing strategy;
+    if (!loadBalancingFrom(config, strategy)) {
+        std::cerr << "Module '" << name << "' has an unknown load_balancing value '"
+                  << config.at("load_balancing") << "'" << std::endl;
+        return false;
+    }
+    
+    std::vector<std::string> restored = restoredStateOf(name);
+    
+    // Replicas initialized so far are shut down again if a later one fails
+    std::vector<std::shared_ptr<Module>> instances;
+    auto discardInstances = [this, &instances, &name]() {
+        for (const auto& instance : instances) {
+            instance->unsubscribeAll();
+            profiled(profiler_, name, "shutdown", [&]() { instance->shutdown(); });
+        }
+    };
+    
+    std::shared_ptr<Module> module;
     try {
-        auto module = it->second.factory();
-        if (!module) {
-            std::cerr << "Failed to create module '" << name << "'" << std::endl;
-            return false;
+        for (size_t i = 0; i < replicas; i++) {
+            module = profiled(profiler_, name, "factory", [&]() { return entry->factory(); });
+            if (!module) {
+                std::cerr << "Failed to create module '" << name << "'" << std::endl;
+                discardInstances();
+                return false;
+            }
+            
+            module->setModuleManager(this);
+            module->setMessageBus(&messageBus_);
+            module->account_ = ResourceAccounting::accountFor(name);
+            supervise(name, *module);
+            
+            if (!profiled(profiler_, name, "configure", [&]() { return module->configure(config); })) {
+                std::cerr << "Failed to configure module '" << name << "'" << std::endl;
+                discardInstances();
+                return false;
+            }
+            
+            if (!restored.empty()) {
+                const std::string& state = restored[i % restored.size()];
+                if (!profiled(profiler_, name, "import_state", [&]() { return module->importState(state); })) {
+                    std::cerr << "Module '" << name << "' rejected its snapshot state, starting cold" << std::endl;
+                }
+            }
+            
+            if (!profiled(profiler_, name, "initialize", [&]() { return module->initialize(); })) {
+                std::cerr << "Failed to initialize module '" << name << "'" << std::endl;
+                module->unsubscribeAll();
+                discardInstances();
+                return false;
+            }
+            instances.push_back(std::move(module));
         }
         
-        module->setModuleManager(this);
-        module->setMessageBus(&messageBus_);
-        
-        if (!module->configure(config)) {
-            std::cerr << "Failed to configure module '" << name << "'" << std::endl;
-            return false;
+        auto loaded = std::make_shared<ModuleInfo>();
+        loaded->factory = entry->factory;
+        loaded->module = instances.front();
+        if (replicas > 1) {
+            loaded->replicas = std::make_shared<ReplicaSet>(executor_, name, instances, strategy);
         }
-        
-        if (!module->initialize()) {
-            std::cerr << "Failed to initialize module '" << name << "'" << std::endl;
-            return false;
+        loaded->config = config;
+        publishEntry(name, std::move(loaded));
+        if (!restored.empty()) {
+            std::lock_guard<std::mutex> snapshotLock(snapshotMutex_);
+            restoredSnapshot_.erase(name);
+        }
+        {
+            // A fresh load gets a fresh restart budget
+            std::lock_guard<std::mutex> supervisorLock(supervisorMutex_);
+            auto state = supervision_.find(name);
+            if (state != supervision_.end()) {
+                state->second.consecutive = 0;
+                state->second.stats.gaveUp = false;
+                lifecycleVersion_++;
+            }
         }
         
-        it->second.module = std::move(module);
-        it->second.loaded = true;
-        it->second.config = config;
+        configSubscriptions_[name] = messageBus_.subscribe(
+            "config." + name, [this, name](const std::string& topic, const std::string& message) {
+                (void)topic; // Suppress unused parameter warning
+                handleConfigMessage(name, message);
+            });
         
-        std::cout << "Module '" << name << "' loaded successfully" << std::endl;
+        if (replicas > 1) {
+            std::cout << "Module '" << name << "' loaded successfully (" << replicas << " replicas)" << std::endl;
+        } else {
+            std::cout << "Module '" << name << "' loaded successfully" << std::endl;
+        }
         return true;
         
     } catch (const std::exception& e) {
         std::cerr << "Error loading module '" << name << "': " << e.what() << std::endl;
+        if (module) {
+            module->unsubscribeAll();
+        }
+        discardInstances();
         return false;
     }
 }
 
 bool ModuleManager::unloadModule(const std::string& name) {
-    auto it = modules_.find(name);
-    if (it == modules_.end() || !it->second.loaded) {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    return unloadModuleLocked(name);
+}
+
+bool ModuleManager::unloadModuleLocked(const std::string& name) {
+    auto entry = findEntry(name);
+    if (!entry || !entry->loaded()) {
         return false;
     }
     
-    if (it->second.running) {
-        stopModule(name);
+    if (entry->running) {
+        stopModuleLocked(name);
     }
     
-    it->second.module->shutdown();
-    it->second.module.reset();
-    it->second.loaded = false;
+    auto instances = instancesOf(*entry);
+    for (const auto& instance : instances) {
+        instance->unsubscribeAll();
+    }
+    auto configSubscription = configSubscriptions_.find(name);
+    if (configSubscription != configSubscriptions_.end()) {
+        messageBus_.unsubscribe(configSubscription->second);
+        configSubscriptions_.erase(configSubscription);
+    }
+    
+    if (entry->hung) {
+        // A lifecycle call is still executing on an executor worker, which holds its
+        // own reference; the instance is destroyed once that call returns.
+        std::cerr << "Module '" << name << "' missed a lifecycle deadline, skipping shutdown" << std::endl;
+    } else {
+        for (const auto& instance : instances) {
+            profiled(profiler_, name, "shutdown", [&]() { instance->shutdown(); });
+        }
+    }
+    
+    auto unloaded = std::make_shared<ModuleInfo>();
+    unloaded->factory = entry->factory;
+    publishEntry(name, std::move(unloaded));
     
     std::cout << "Module '" << name << "' unloaded" << std::endl;
     return true;
 }
 
-bool ModuleManager::startModule(const std::string& name) {
-    auto it = modules_.find(name);
-    if (it == modules_.end() || !it->second.loaded) {
+bool ModuleManager::reloadModule(const std::string& name, const std::map<std::string, std::string>& config) {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    return reloadModuleLocked(name, config);
+}
+
+bool ModuleManager::reloadModuleLocked(const std::string& name, const std::map<std::string, std::string>& config) {
+    auto old = findEntry(name);
+    if (!old || !old->loaded()) {
+        std::cerr << "Module '" << name << "' not loaded, cannot reload" << std::endl;
+        return false;
+    }
+    if (old->hung) {
+        std::cerr << "Module '" << name << "' missed a lifecycle deadline, cannot reload" << std::endl;
         return false;
     }
     
-    if (it->second.running) {
-        return true;
+    LoadBalancing strategy;
+    if (!loadBalancingFrom(config, strategy)) {
+        std::cerr << "Module '" << name << "' has an unknown load_balancing value '"
+                  << config.at("load_balancing") << "'" << std::endl;
+        return false;
     }
     
+    auto oldInstances = instancesOf(*old);
+    std::vector<std::shared_ptr<Module>> instances;
     try {
-        it->second.module->start();
-        it->second.running = true;
-        std::cout << "Module '" << name << "' started" << std::endl;
-        return true;
+        for (size_t i = 0; i < oldInstances.size(); i++) {
+            std::shared_ptr<Module> module = profiled(profiler_, name, "factory", [&]() { return old->factory(); });
+            if (!module) {
+                break;
+            }
+            module->setModuleManager(this);
+            module->setMessageBus(&messageBus_);
+            module->account_ = ResourceAccounting::accountFor(name);
+            supervise(name, *module);
+            instances.push_back(std::move(module));
+        }
     } catch (const std::exception& e) {
-        std::cerr << "Error starting module '" << name << "': " << e.what() << std::endl;
+        std::cerr << "Error creating module '" << name << "': " << e.what() << std::endl;
+    }
+    if (instances.size() != oldInstances.size()) {
+        std::cerr << "Failed to create module '" << name << "'" << std::endl;
         return false;
     }
+    
+    auto next = std::make_shared<ModuleInfo>();
+    next->factory = old->factory;
+    next->module = instances.front();
+    if (old->replicas) {
+        next->replicas = std::make_shared<ReplicaSet>(executor_, name, instances, strategy);
+    }
+    next->config = config;
+    
+    // From here on, messages for the old instances queue up in the bus
+    std::set<std::string> topics;
+    for (const auto& instance : oldInstances) {
+        for (const auto& topic : instance->getSubscribedTopics()) {
+            topics.insert(topic);
+        }
+    }
+    std::vector<std::string> heldTopics(topics.begin(), topics.end());
+    for (const auto& topic : heldTopics) {
+        messageBus_.holdTopic(topic);
+    }
+    auto releaseTopics = [this, &heldTopics]() {
+        for (const auto& topic : heldTopics) {
+            messageBus_.releaseTopic(topic);
+        }
+    };
+    // Messages already handed to the replicas are part of the exported state
+    if (old->replicas) {
+        old->replicas->drain();
+    }
+    
+    size_t initialized = 0;
+    auto discardNext = [&]() {
+        for (size_t i = 0; i < instances.size(); i++) {
+            instances[i]->unsubscribeAll();
+            if (i < initialized && !next->hung) {
+                profiled(profiler_, name, "shutdown", [&]() { instances[i]->shutdown(); });
+            }
+        }
+        releaseTopics();
+    };
+    
+    try {
+        for (size_t i = 0; i < instances.size(); i++) {
+            if (!profiled(profiler_, name, "configure", [&]() { return instances[i]->configure(config); })) {
+                std::cerr << "Failed to configure module '" << name << "'" << std::endl;
+                discardNext();
+                return false;
+            }
+            if (!profiled(profiler_, name, "import_state",
+                          [&]() { return instances[i]->importState(oldInstances[i]->exportState()); })) {
+                std::cerr << "Module '" << name << "' rejected the state of the running instance" << std::endl;
+                discardNext();
+                return false;
+            }
+            if (!profiled(profiler_, name, "initialize", [&]() { return instances[i]->initialize(); })) {
+                std::cerr << "Failed to initialize module '" << name << "'" << std::endl;
+                discardNext();
+                return false;
+            }
+            initialized++;
+        }
+        
+        if (old->running) {
+            if (!startEntry(name, *next)) {
+                std::cerr << "Failed to start new instance of module '" << name << "'" << std::endl;
+                discardNext();
+                return false;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error reloading module '" << name << "': " << e.what() << std::endl;
+        discardNext();
+        return false;
+    }
+    
+    // Switch over: the old instances lose their subscriptions while their
+    // topics are still held, so the backlog goes to the new instances only
+    for (const auto& instance : oldInstances) {
+        instance->unsubscribeAll();
+        instance->supervised_ = false;
+    }
+    publishEntry(name, next);
+    releaseTopics();
+    
+    if (old->running) {
+        stopEntry(name, *old);
+    }
+    if (!old->hung) {
+        for (const auto& instance : oldInstances) {
+            profiled(profiler_, name, "shutdown", [&]() { instance->shutdown(); });
+        }
+    }
+    
+    std::cout << "Module '" << name << "' reloaded" << std::endl;
+    return true;
 }
 
-bool ModuleManager::stopModule(const std::string& name) {
-    auto it = modules_.find(name);
-    if (it == modules_.end() || !it->second.loaded || !it->second.running) {
+bool ModuleManager::reconfigure(const std::string& name, const std::map<std::string, std::string>& delta,
+                                std::string* error) {
+    auto reject = [&](const std::string& reason) {
+        std::cerr << "Reconfiguration of module '" << name << "' rejected: " << reason << std::endl;
+        if (error) {
+            *error = reason;
+        }
         return false;
+    };
+    
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    auto entry = findEntry(name);
+    if (!entry || !entry->loaded()) {
+        return reject("module not loaded");
     }
     
-    try {
-        it->second.module->stop();
-        it->second.running = false;
-        std::cout << "Module '" << name << "' stopped" << std::endl;
+    ConfigDiff diff = ConfigDiff::between(entry->config, delta);
+    if (diff.empty()) {
         return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Error stopping module '" << name << "': " << e.what() << std::endl;
+    }
+    
+    // The lifecycle deadlines belong to the manager; everything else is the module's
+    std::map<std::string, std::string> moduleDelta;
+    for (const auto& change : diff.changes()) {
+        if (change.key == "start_timeout_ms" || change.key == "stop_timeout_ms") {
+            char* end = nullptr;
+            long long value = std::strtoll(change.newValue.c_str(), &end, 10);
+            if (change.newValue.empty() || *end != '\0' || value < 0) {
+                return reject("invalid value '" + change.newValue + "' for " + change.key);
+            }
+        } else if (change.key == "load_balancing") {
+            LoadBalancing strategy;
+            if (!parseLoadBalancing(change.newValue, strategy)) {
+                return reject("invalid value '" + change.newValue + "' for " + change.key);
+            }
+        } else {
+            moduleDelta[change.key] = change.newValue;
+        }
+    }
+    ConfigDiff moduleDiff = ConfigDiff::between(entry->config, moduleDelta);
+    
+    if (!moduleDiff.empty()) {
+        // Every replica has to accept the changes before any of them applies
+        // them; applyConfig() cannot fail, so they all end up on the new settings
+        auto instances = instancesOf(*entry);
+        try {
+            for (const auto& instance : instances) {
+                std::string reason;
+                if (!instance->validateConfig(moduleDiff, reason)) {
+                    return reject(reason);
+                }
+            }
+        } catch (const std::exception& e) {
+            return reject(e.what());
+        }
+        for (const auto& instance : instances) {
+            instance->applyConfig(moduleDiff);
+        }
+    }
+    
+    auto updated = std::make_shared<ModuleInfo>();
+    updated->factory = entry->factory;
+    updated->module = entry->module;
+    updated->replicas = entry->replicas;
+    updated->config = diff.applyTo(entry->config);
+    updated->keepLifecycleOf(*entry);
+    if (updated->replicas) {
+        LoadBalancing strategy;
+        loadBalancingFrom(updated->config, strategy);
+        updated->replicas->setStrategy(strategy);
+    }
+    publishEntry(name, std::move(updated));
+    
+    std::cout << "Module '" << name << "' reconfigured (" << diff.changes().size() << " key(s) changed)" << std::endl;
+    return true;
+}
+
+bool ModuleManager::enableSnapshots(const std::string& path, std::chrono::milliseconds interval) {
+    StateSnapshot previous;
+    std::string error;
+    bool found = previous.load(path, error);
+    if (!found && std::ifstream(path).good()) {
+        std::cerr << "Ignoring snapshot '" << path << "': " << error << std::endl;
+    }
+    
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    executor_.cancel(snapshotTimer_);
+    snapshotPath_ = path;
+    restoredSnapshot_ = found ? previous : StateSnapshot();
+    snapshotInterval_ = interval;
+    snapshotsStopped_ = false;
+    scheduleSnapshot();
+    
+    if (found) {
+        std::cout << "Snapshot '" << path << "' restored (" << previous.entries().size() << " module(s))" << std::endl;
+    }
+    return found;
+}
+
+bool ModuleManager::saveSnapshot() {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    if (snapshotPath_.empty()) {
         return false;
     }
+    return writeSnapshotLocked();
 }
 
-void ModuleManager::startAllModules() {
-    for (auto& [name, info] : modules_) {
-        if (info.loaded && !info.running) {
-            startModule(name);
+bool ModuleManager::writeSnapshotLocked() {
+    std::vector<std::pair<std::string, std::vector<std::shared_ptr<Module>>>> loaded;
+    {
+        auto registry = modules_.read();
+        for (const auto& [name, entry] : *registry) {
+            if (entry->loaded()) {
+                loaded.emplace_back(name, instancesOf(*entry));
+            }
         }
     }
+    
+    // Modules that were not loaded again yet keep their previous state
+    StateSnapshot snapshot = restoredSnapshot_;
+    for (const auto& [name, instances] : loaded) {
+        std::vector<std::string> states;
+        try {
+            for (const auto& instance : instances) {
+                states.push_back(instance->exportState());
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error exporting the state of module '" << name << "': " << e.what() << std::endl;
+            continue;
+        }
+        snapshot.set(name, std::move(states));
+    }
+    
+    std::string error;
+    if (!snapshot.save(snapshotPath_, error)) {
+        std::cerr << "Failed to write snapshot: " << error << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void ModuleManager::stopAllModules() {
-    for (auto& [name, info] : modules_) {
-        if (info.loaded && info.running) {
+void ModuleManager::scheduleSnapshot() {
+    if (snapshotInterval_.count() <= 0 || snapshotsStopped_) {
+        return;
+    }
+    snapshotTimer_ = executor_.scheduleAfter(snapshotInterval_, [this]() {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (snapshotsStopped_) {
+            return;
+        }
+        writeSnapshotLocked();
+        scheduleSnapshot();
+    }, TaskPriority::Low);
+}
+
+std::vector<std::string> ModuleManager::restoredStateOf(const std::string& name) {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    const std::vector<std::string>* states = restoredSnapshot_.find(name);
+    return states ? *states : std::vector<std::string>{};
+}
+
+void ModuleManager::setRestartPolicy(const RestartPolicy& policy) {
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    restartPolicy_ = policy;
+}
+
+std::map<std::string, SupervisionStats> ModuleManager::getSupervisionStats() const {
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    std::map<std::string, SupervisionStats> stats;
+    for (const auto& [name, state] : supervision_) {
+        stats[name] = state.stats;
+    }
+    return stats;
+}
+
+void ModuleManager::supervise(const std::string& name, Module& instance) {
+    const Module* failed = &instance;
+    instance.setFailureHandler([this, name, failed](const std::string& reason) {
+        onModuleFailure(name, failed, reason);
+    });
+}
+
+void ModuleManager::onModuleFailure(const std::string& name, const Module* instance, const std::string& reason) {
+    // Instances that are stopping or were replaced may fail on their way out
+    if (!instance->supervised_) {
+        std::cerr << "Module '" << name << "' failed while stopping: " << reason << std::endl;
+        return;
+    }
+    std::cerr << "Module '" << name << "' failed: " << reason << std::endl;
+    
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    auto& state = supervision_[name];
+    state.stats.crashes++;
+    state.stats.lastFailure = reason;
+    lifecycleVersion_++;
+    if (state.restartPending || supervisorStopped_) {
+        return;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    if (now - state.failedAt >= restartPolicy_.resetAfter) {
+        state.consecutive = 0;
+    }
+    state.failedAt = now;
+    scheduleRestartLocked(name);
+}
+
+void ModuleManager::scheduleRestartLocked(const std::string& name) {
+    auto& state = supervision_[name];
+    state.restartPending = true;
+    lifecycleVersion_++;
+    
+    if (state.consecutive >= restartPolicy_.maxRestarts) {
+        std::cerr << "Module '" << name << "' failed " << state.consecutive
+                  << " time(s) in a row, stopping it" << std::endl;
+        state.stats.gaveUp = true;
+        state.timer = 0;
+        bool submitted = executor_.submit([this, name]() {
             stopModule(name);
+            std::lock_guard<std::mutex> lock(supervisorMutex_);
+            supervision_[name].restartPending = false;
+            lifecycleVersion_++;
+        }, TaskPriority::High);
+        state.restartPending = submitted;
+        return;
+    }
+    
+    auto backoff = restartPolicy_.initialBackoff;
+    for (size_t i = 0; i < state.consecutive && backoff < restartPolicy_.maxBackoff; i++) {
+        backoff *= 2;
+    }
+    backoff = std::min(backoff, restartPolicy_.maxBackoff);
+    state.consecutive++;
+    state.timer = executor_.scheduleAfter(backoff, [this, name]() { restartModule(name); }, TaskPriority::High);
+    state.restartPending = (state.timer != 0);
+    std::cerr << "Restarting module '" << name << "' in " << backoff.count() << " ms" << std::endl;
+}
+
+void ModuleManager::stopSupervisor() {
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    supervisorStopped_ = true;
+    for (const auto& [name, state] : supervision_) {
+        executor_.cancel(state.timer);
+    }
+}
+
+void ModuleManager::restartModule(const std::string& name) {
+    // A new instance failing while it starts schedules the next restart itself
+    std::chrono::steady_clock::time_point failedAt;
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        auto& state = supervision_[name];
+        state.restartPending = false;
+        state.timer = 0;
+        failedAt = state.failedAt;
+        if (supervisorStopped_) {
+            return;
         }
     }
+    
+    bool restarted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutationMutex_);
+        auto entry = findEntry(name);
+        if (!entry || !entry->loaded() || !entry->running) {
+            // Stopped or unloaded in the meantime, nothing left to restart
+            return;
+        }
+        restarted = reloadModuleLocked(name, entry->config);
+    }
+    
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    auto& state = supervision_[name];
+    lifecycleVersion_++;
+    if (restarted) {
+        state.stats.restarts++;
+        state.stats.lastRestartTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - failedAt);
+        std::cout << "Module '" << name << "' restarted " << state.stats.lastRestartTime.count()
+                  << " ms after its failure" << std::endl;
+    } else {
+        state.stats.failedRestarts++;
+        if (!state.restartPending && !supervisorStopped_) {
+            scheduleRestartLocked(name);
+        }
+    }
+}
+
+std::map<std::string, std::string> ModuleManager::getModuleConfig(const std::string& name) const {
+    auto entry = findEntry(name);
+    return (entry && entry->loaded()) ? entry->config : std::map<std::string, std::string>{};
+}
+
+std::map<std::string, DeliveryMetrics> ModuleManager::getDeliveryMetrics() const {
+    std::map<std::string, DeliveryMetrics> metrics;
+    auto registry = modules_.read();
+    for (const auto& [name, entry] : *registry) {
+        for (const auto& instance : instancesOf(*entry)) {
+            DeliveryMetrics replica = instance->getDeliveryMetrics();
+            DeliveryMetrics& total = metrics[name];
+            total.delivered += replica.delivered;
+            total.failed += replica.failed;
+            total.totalTime += replica.totalTime;
+            total.maxTime = std::max(total.maxTime, replica.maxTime);
+        }
+    }
+    return metrics;
+}
+
+bool ModuleManager::parseConfigMessage(const std::string& message, std::map<std::string, std::string>& delta,
+                                       std::string& error) {
+    auto trim = [](const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    };
+    
+    std::istringstream lines(message);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t separator = line.find('=');
+        std::string key = trim(line.substr(0, separator));
+        if (separator == std::string::npos || key.empty()) {
+            error = "malformed line '" + line + "'";
+            return false;
+        }
+        delta[key] = trim(line.substr(separator + 1));
+    }
+    return true;
+}
+
+void ModuleManager::handleConfigMessage(const std::string& name, const std::string& message) {
+    std::map<std::string, std::string> delta;
+    std::string error;
+    bool applied = parseConfigMessage(message, delta, error) && reconfigure(name, delta, &error);
+    messageBus_.publish("config." + name + ".result", applied ? "ok" : "error: " + error);
+}
+
+bool ModuleManager::startModule(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    return startModuleLocked(name);
+}
+
+bool ModuleManager::startModuleLocked(const std::string& name) {
+    auto entry = findEntry(name);
+    if (!entry || !entry->loaded()) {
+        return false;
+    }
+    
+    if (entry->running) {
+        return true;
+    }
+    
+    return startEntry(name, *entry);
+}
+
+bool ModuleManager::startEntry(const std::string& name, ModuleInfo& entry) {
+    auto timeout = deadlineFor(entry, "start_timeout_ms", std::chrono::milliseconds(startTimeoutMs_.load()));
+    auto stopTimeout = deadlineFor(entry, "stop_timeout_ms", std::chrono::milliseconds(stopTimeoutMs_.load()));
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    
+    auto startInstance = [&](const std::shared_ptr<Module>& module) {
+        try {
+            module->resetReadiness();
+            module->supervised_ = true;
+            bool returned = profiled(profiler_, name, "start", [&]() {
+                return runWithDeadline(name, [module]() { module->start(); }, timeout);
+            });
+            if (!returned) {
+                entry.hung = true;
+                std::cerr << "Module '" << name << "' did not return from start() within "
+                          << timeout.count() << " ms" << std::endl;
+                return false;
+            }
+            if (!module->startsAsynchronously()) {
+                module->signalReady(true);
+            }
+            
+            auto ready = module->getReadyFuture();
+            bool inTime = profiled(profiler_, name, "ready", [&]() {
+                if (timeout.count() > 0) {
+                    return ready.wait_until(deadline) == std::future_status::ready;
+                }
+                ready.wait();
+                return true;
+            });
+            if (!inTime || !ready.get()) {
+                if (!inTime) {
+                    std::cerr << "Module '" << name << "' not ready within " << timeout.count() << " ms" << std::endl;
+                } else {
+                    std::cerr << "Module '" << name << "' failed to become ready" << std::endl;
+                }
+                // Tear down whatever the module managed to bring up
+                if (!runWithDeadline(name, [module]() { module->stop(); }, stopTimeout)) {
+                    entry.hung = true;
+                }
+                return false;
+            }
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "Error starting module '" << name << "': " << e.what() << std::endl;
+            return false;
+        }
+    };
+    
+    // Replicas start one after the other within the same deadline
+    auto instances = instancesOf(entry);
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (!startInstance(instances[i])) {
+            for (const auto& instance : instances) {
+                instance->supervised_ = false;
+            }
+            for (size_t j = 0; j < i; j++) {
+                auto started = instances[j];
+                try {
+                    if (!runWithDeadline(name, [started]() { started->stop(); }, stopTimeout)) {
+                        entry.hung = true;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error stopping module '" << name << "': " << e.what() << std::endl;
+                }
+            }
+            return false;
+        }
+    }
+    
+    entry.startedAt = std::chrono::steady_clock::now();
+    entry.running = true;
+    lifecycleVersion_++;
+    if (entry.replicas) {
+        entry.replicas->open();
+        entry.module->wireSubscriptions(entry.replicas);
+    } else {
+        entry.module->wireSubscriptions(entry.module);
+    }
+    std::cout << "Module '" << name << "' started" << std::endl;
+    return true;
+}
+
+bool ModuleManager::stopModule(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    return stopModuleLocked(name);
+}
+
+bool ModuleManager::stopModuleLocked(const std::string& name) {
+    auto entry = findEntry(name);
+    if (!entry || !entry->loaded() || !entry->running) {
+        return false;
+    }
+    
+    return stopEntry(name, *entry);
+}
+
+bool ModuleManager::stopEntry(const std::string& name, ModuleInfo& entry) {
+    auto timeout = deadlineFor(entry, "stop_timeout_ms", std::chrono::milliseconds(stopTimeoutMs_.load()));
+    
+    // No new deliveries once the module starts stopping; replicas finish the
+    // messages they were already handed
+    entry.module->unwireSubscriptions();
+    if (entry.replicas) {
+        entry.replicas->drain();
+        entry.replicas->close();
+    }
+    
+    bool stopped = true;
+    for (const auto& module : instancesOf(entry)) {
+        module->supervised_ = false;
+    }
+    for (const auto& module : instancesOf(entry)) {
+        try {
+            bool returned = profiled(profiler_, name, "stop", [&]() {
+                return runWithDeadline(name, [module]() { module->stop(); }, timeout);
+            });
+            if (!returned) {
+                entry.hung = true;
+                std::cerr << "Module '" << name << "' did not stop within " << timeout.count() << " ms" << std::endl;
+                stopped = false;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error stopping module '" << name << "': " << e.what() << std::endl;
+            stopped = false;
+        }
+    }
+    entry.running = false;
+    lifecycleVersion_++;
+    if (stopped) {
+        std::cout << "Module '" << name << "' stopped" << std::endl;
+    }
+    return stopped;
+}
+
+bool ModuleManager::startAllModules() {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    std::vector<std::string> toStart;
+    std::map<std::string, std::vector<std::string>> dependencies;
+    {
+        auto registry = modules_.read();
+        for (const auto& [name, entry] : *registry) {
+            if (entry->loaded() && !entry->running) {
+                toStart.push_back(name);
+                dependencies[name] = entry->module->getDependencies();
+            }
+        }
+    }
+    
+    std::vector<std::string> order;
+    if (!sortByDependencies(toStart, order)) {
+        return false;
+    }
+    
+    StartupReport report;
+    report.startOrder = order;
+    std::mutex timingMutex;
+    auto begin = std::chrono::steady_clock::now();
+    
+    auto results = runDependencyGraph(executor_, order, dependencies, [&](const std::string& name) {
+        // Dependencies outside of this startup must already be running
+        for (const auto& dep : dependencies[name]) {
+            if (!dependencies.count(dep) && !isModuleRunning(dep)) {
+                std::cerr << "Module '" << name << "' depends on '" << dep << "', which is not running" << std::endl;
+                std::lock_guard<std::mutex> timingLock(timingMutex);
+                report.modules[name].started = false;
+                return false;
+            }
+        }
+        
+        auto startedAt = std::chrono::steady_clock::now();
+        bool ok = startModuleLocked(name);
+        auto readyAt = std::chrono::steady_clock::now();
+        
+        std::lock_guard<std::mutex> timingLock(timingMutex);
+        auto& timing = report.modules[name];
+        timing.started = ok;
+        timing.startTime = std::chrono::duration_cast<std::chrono::milliseconds>(readyAt - startedAt);
+        timing.readyAt = std::chrono::duration_cast<std::chrono::milliseconds>(readyAt - begin);
+        return ok;
+    }, true);
+    
+    report.totalTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin);
+    
+    // Modules appear after their dependencies in the order, so critical paths can be accumulated in one pass
+    bool allStarted = true;
+    for (const auto& name : order) {
+        if (!report.modules.count(name)) {
+            std::cerr << "Module '" << name << "' not started: a dependency failed to start" << std::endl;
+        }
+        auto& timing = report.modules[name];
+        if (!results[name]) {
+            allStarted = false;
+            continue;
+        }
+        std::chrono::milliseconds longestDependency{0};
+        for (const auto& dep : dependencies[name]) {
+            auto it = report.modules.find(dep);
+            if (it != report.modules.end()) {
+                longestDependency = std::max(longestDependency, it->second.criticalPath);
+            }
+        }
+        timing.criticalPath = longestDependency + timing.startTime;
+    }
+    
+    if (!order.empty()) {
+        std::cout << "Started " << order.size() << " module(s) in " << report.totalTime.count() << " ms" << std::endl;
+        for (const auto& name : order) {
+            const auto& timing = report.modules[name];
+            std::cout << "   " << name << ": " << (timing.started ? "started" : "failed")
+                      << ", start " << timing.startTime.count() << " ms"
+                      << ", ready at " << timing.readyAt.count() << " ms"
+                      << ", critical path " << timing.criticalPath.count() << " ms" << std::endl;
+        }
+    }
+    
+    std::lock_guard<std::mutex> reportLock(reportMutex_);
+    startupReport_ = std::move(report);
+    return allStarted;
+}
+
+void ModuleManager::stopAllModules() {
+    std::lock_guard<std::mutex> lock(mutationMutex_);
+    std::vector<std::string> toStop;
+    std::map<std::string, std::vector<std::string>> dependents;
+    {
+        auto registry = modules_.read();
+        for (const auto& [name, entry] : *registry) {
+            if (entry->loaded() && entry->running) {
+                toStop.push_back(name);
+                // A module is stopped only after every running module that depends on it
+                for (const auto& dep : entry->module->getDependencies()) {
+                    dependents[dep].push_back(name);
+                }
+            }
+        }
+    }
+    
+    std::vector<std::string> order;
+    if (!sortByDependencies(toStop, order)) {
+        // Still stop everything, just without any ordering guarantee
+        for (auto it = toStop.rbegin(); it != toStop.rend(); ++it) {
+            stopModuleLocked(*it);
+        }
+        return;
+    }
+    
+    runDependencyGraph(executor_, order, dependents, [this](const std::string& name) {
+        return stopModuleLocked(name);
+    }, false);
+}
+
+bool ModuleManager::drain(std::chrono::steady_clock::time_point deadline) {
+    stopSupervisor();
+    
+    std::vector<std::pair<std::string, std::shared_ptr<Module>>> instances;
+    {
+        std::lock_guard<std::mutex> lock(mutationMutex_);
+        std::vector<std::string> running;
+        auto registry = modules_.read();
+        for (const auto& [name, entry] : *registry) {
+            if (entry->loaded() && entry->running) {
+                running.push_back(name);
+            }
+        }
+        std::vector<std::string> order;
+        if (!sortByDependencies(running, order)) {
+            order = running;
+        }
+        // Dependents first, so nothing hands work to a module that already drained
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            for (auto& instance : instancesOf(*registry->at(*it))) {
+                instances.emplace_back(*it, std::move(instance));
+            }
+        }
+    }
+    
+    // Modules are drained on this thread: their work in progress may need the executor
+    bool drained = true;
+    for (const auto& [name, instance] : instances) {
+        if (!profiled(profiler_, name, "drain", [&]() { return instance->drain(deadline); })) {
+            std::cerr << "Module '" << name << "' did not drain before the deadline" << std::endl;
+            drained = false;
+        }
+    }
+    
+    LifecycleProfiler::Span span(profiler_, "message-bus", "drain");
+    if (!messageBus_.flush(deadline)) {
+        std::cerr << "Message bus did not drain before the deadline" << std::endl;
+        drained = false;
+    }
+    return drained;
 }
 
 void ModuleManager::shutdownAllModules() {
     stopAllModules();
-    for (auto& [name, info] : modules_) {
-        if (info.loaded) {
-            unloadModule(name);
+    
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (!snapshotPath_.empty() && !snapshotsStopped_) {
+            snapshotsStopped_ = true;
+            executor_.cancel(snapshotTimer_);
+            writeSnapshotLocked();
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutationMutex_);
+        std::vector<std::string> toUnload;
+        std::map<std::string, std::vector<std::string>> dependents;
+        {
+            auto registry = modules_.read();
+            for (const auto& [name, entry] : *registry) {
+                if (entry->loaded()) {
+                    toUnload.push_back(name);
+                    for (const auto& dep : entry->module->getDependencies()) {
+                        dependents[dep].push_back(name);
+                    }
+                }
+            }
+        }
+        
+        std::vector<std::string> order;
+        if (!sortByDependencies(toUnload, order)) {
+            for (auto it = toUnload.rbegin(); it != toUnload.rend(); ++it) {
+                unloadModuleLocked(*it);
+            }
+        } else {
+            runDependencyGraph(executor_, order, dependents, [this](const std::string& name) {
+                return unloadModuleLocked(name);
+            }, false);
+        }
+    }
+    
+    // start() and stop() calls that overran their deadline still occupy workers
+    std::unique_lock<std::mutex> lock(overdueMutex_);
+    if (!overdueReturned_.wait_for(lock, std::chrono::milliseconds(stopTimeoutMs_.load()),
+                                   [this]() { return overdueCalls_.empty(); })) {
+        for (const auto& name : overdueCalls_) {
+            std::cerr << "Module '" << name << "' is still running a start() or stop() call past its deadline"
+                      << std::endl;
         }
     }
 }
 
 Module* ModuleManager::getModule(const std::string& name) const {
-    auto it = modules_.find(name);
-    return (it != modules_.end() && it->second.loaded) ? it->second.module.get() : nullptr;
+    auto entry = findEntry(name);
+    return entry ? entry->module.get() : nullptr;
+}
+
+std::shared_ptr<Module> ModuleManager::acquireModule(const std::string& name) const {
+    auto registry = modules_.read();
+    auto it = registry->find(name);
+    return (it != registry->end()) ? it->second->module : nullptr;
+}
+
+std::vector<std::shared_ptr<Module>> ModuleManager::acquireReplicas(const std::string& name) const {
+    auto entry = findEntry(name);
+    return entry ? instancesOf(*entry) : std::vector<std::shared_ptr<Module>>{};
 }
 
 std::vector<std::string> ModuleManager::getLoadedModules() const {
     std::vector<std::string> loaded;
-    for (const auto& [name, info] : modules_) {
-        if (info.loaded) {
+    auto registry = modules_.read();
+    for (const auto& [name, entry] : *registry) {
+        if (entry->loaded()) {
             loaded.push_back(name);
         }
     }
@@ -173,8 +1615,9 @@ std::vector<std::string> ModuleManager::getLoadedModules() const {
 
 std::vector<std::string> ModuleManager::getRunningModules() const {
     std::vector<std::string> running;
-    for (const auto& [name, info] : modules_) {
-        if (info.loaded && info.running) {
+    auto registry = modules_.read();
+    for (const auto& [name, entry] : *registry) {
+        if (entry->loaded() && entry->running) {
             running.push_back(name);
         }
     }
@@ -182,7 +1625,7 @@ std::vector<std::string> ModuleManager::getRunningModules() const {
 }
 
 bool ModuleManager::resolveDependencies(const std::string& moduleName) {
-    auto module = getModule(moduleName);
+    auto module = acquireModule(moduleName);
     if (!module) {
         return false;
     }
@@ -192,23 +1635,147 @@ bool ModuleManager::resolveDependencies(const std::string& moduleName) {
 }
 
 std::vector<std::string> ModuleManager::getModuleDependencies(const std::string& moduleName) const {
-    auto module = getModule(moduleName);
+    auto module = acquireModule(moduleName);
     return module ? module->getDependencies() : std::vector<std::string>{};
 }
 
-std::map<std::string, std::string> ModuleManager::getModuleStatuses() const {
-    std::map<std::string, std::string> statuses;
-    for (const auto& [name, info] : modules_) {
-        if (info.loaded) {
-            statuses[name] = info.module->getStatus();
+std::map<std::string, ModuleStatus> ModuleManager::getModuleStatuses() const {
+    auto statuses = refreshStatuses();
+    auto now = std::chrono::steady_clock::now();
+    for (auto& [name, status] : statuses) {
+        auto entry = findEntry(name);
+        if (entry && entry->running) {
+            status.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry->startedAt.load());
+        }
+        status.resources = ResourceAccounting::getUsage(name);
+    }
+    return statuses;
+}
+
+uint64_t ModuleManager::getStatusVersion() const {
+    refreshStatuses();
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    return statusVersion_;
+}
+
+std::map<std::string, ModuleStatus> ModuleManager::refreshStatuses() const {
+    // Versions are read before the statuses are built, so a change made while
+    // building shows up as out of date on the next call
+    uint64_t lifecycleVersion = lifecycleVersion_.load();
+    struct Current {
+        std::shared_ptr<ModuleInfo> entry;
+        uint64_t moduleVersion = 0;
+    };
+    std::map<std::string, Current> current;
+    {
+        auto registry = modules_.read();
+        for (const auto& [name, entry] : *registry) {
+            if (entry->loaded()) {
+                current[name].entry = entry;
+            }
+        }
+    }
+    for (auto& [name, module] : current) {
+        for (const auto& instance : instancesOf(*module.entry)) {
+            module.moduleVersion += instance->getStatusVersion();
+        }
+    }
+    
+    std::vector<std::string> stale;
+    {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        for (auto it = statusCache_.begin(); it != statusCache_.end();) {
+            if (!current.count(it->first)) {
+                it = statusCache_.erase(it);
+                statusVersion_++;
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& [name, module] : current) {
+            auto cached = statusCache_.find(name);
+            if (cached == statusCache_.end() || cached->second.module != module.entry->module.get() ||
+                cached->second.moduleVersion != module.moduleVersion ||
+                cached->second.lifecycleVersion != lifecycleVersion) {
+                stale.push_back(name);
+            }
+        }
+    }
+    
+    // Module callbacks run without the cache lock
+    std::map<std::string, ModuleStatus> rebuilt;
+    for (const auto& name : stale) {
+        rebuilt[name] = buildStatus(name, *current[name].entry);
+    }
+    
+    std::lock_guard<std::mutex> lock(statusMutex_);
+    for (auto& [name, status] : rebuilt) {
+        auto& cached = statusCache_[name];
+        cached.module = current[name].entry->module.get();
+        cached.moduleVersion = current[name].moduleVersion;
+        cached.lifecycleVersion = lifecycleVersion;
+        cached.status = std::move(status);
+        cached.status.version = ++statusVersion_;
+    }
+    std::map<std::string, ModuleStatus> statuses;
+    for (const auto& [name, module] : current) {
+        auto cached = statusCache_.find(name);
+        if (cached != statusCache_.end()) {
+            statuses[name] = cached->second.status;
         }
     }
     return statuses;
 }
 
+ModuleStatus ModuleManager::buildStatus(const std::string& name, const ModuleInfo& entry) const {
+    ModuleStatus status;
+    auto instances = instancesOf(entry);
+    status.replicas = instances.size();
+    status.state = entry.running ? ModuleState::Running : ModuleState::Stopped;
+    
+    DeliveryMetrics delivery;
+    for (const auto& instance : instances) {
+        auto metrics = instance->getDeliveryMetrics();
+        delivery.delivered += metrics.delivered;
+        delivery.failed += metrics.failed;
+    }
+    status.counters["messages_delivered"] = delivery.delivered;
+    status.counters["messages_failed"] = delivery.failed;
+    
+    try {
+        status.summary = entry.module->getStatus();
+        entry.module->fillStatus(status);
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading status of module '" << name << "': " << e.what() << std::endl;
+    }
+    
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    auto supervised = supervision_.find(name);
+    if (supervised != supervision_.end()) {
+        const auto& state = supervised->second;
+        status.counters["crashes"] = state.stats.crashes;
+        status.counters["restarts"] = state.stats.restarts;
+        if (status.lastError.empty()) {
+            status.lastError = state.stats.lastFailure;
+        }
+        if (entry.running && state.restartPending) {
+            status.state = ModuleState::Restarting;
+        } else if (!entry.running && state.stats.gaveUp) {
+            status.state = ModuleState::Failed;
+        }
+    }
+    return status;
+}
+
 bool ModuleManager::isModuleRunning(const std::string& name) const {
-    auto it = modules_.find(name);
-    return (it != modules_.end() && it->second.loaded && it->second.running);
+    auto registry = modules_.read();
+    auto it = registry->find(name);
+    return (it != registry->end() && it->second->loaded() && it->second->running);
+}
+
+StartupReport ModuleManager::getStartupReport() const {
+    std::lock_guard<std::mutex> lock(reportMutex_);
+    return startupReport_;
 }
 
 bool ModuleManager::checkDependencies(const std::vector<std::string>& dependencies) const {
@@ -221,8 +1788,75 @@ bool ModuleManager::checkDependencies(const std::vector<std::string>& dependenci
     return true;
 }
 
+std::chrono::milliseconds ModuleManager::deadlineFor(const ModuleInfo& info, const std::string& key,
+                                                     std::chrono::milliseconds fallback) {
+    auto it = info.config.find(key);
+    if (it == info.config.end()) {
+        return fallback;
+    }
+    try {
+        return std::chrono::milliseconds(std::stoll(it->second));
+    } catch (const std::exception&) {
+        std::cerr << "Ignoring invalid " << key << " value '" << it->second << "'" << std::endl;
+        return fallback;
+    }
+}
+
+bool ModuleManager::sortByDependencies(const std::vector<std::string>& names, std::vector<std::string>& order) const {
+    std::map<std::string, size_t> pending;
+    std::map<std::string, std::vector<std::string>> dependents;
+    for (const auto& name : names) {
+        pending[name] = 0;
+    }
+    for (const auto& name : names) {
+        auto module = acquireModule(name);
+        if (!module) {
+            continue;
+        }
+        for (const auto& dep : module->getDependencies()) {
+            if (dep != name && pending.count(dep)) {
+                pending[name]++;
+                dependents[dep].push_back(name);
+            } else if (dep == name) {
+                std::cerr << "Module '" << name << "' depends on itself" << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    order.clear();
+    std::deque<std::string> ready;
+    for (const auto& name : names) {
+        if (pending[name] == 0) {
+            ready.push_back(name);
+        }
+    }
+    while (!ready.empty()) {
+        std::string name = ready.front();
+        ready.pop_front();
+        order.push_back(name);
+        for (const auto& next : dependents[name]) {
+            if (--pending[next] == 0) {
+                ready.push_back(next);
+            }
+        }
+    }
+    
+    if (order.size() != names.size()) {
+        std::cerr << "Dependency cycle detected among modules:";
+        for (const auto& [name, count] : pending) {
+            if (count > 0) {
+                std::cerr << " " << name;
+            }
+        }
+        std::cerr << std::endl;
+        return false;
+    }
+    return true;
+}
+
 void ModuleManager::loadModuleDependencies(const std::string& moduleName) {
-    auto module = getModule(moduleName);
+    auto module = acquireModule(moduleName);
     if (!module) {
         return;
     }
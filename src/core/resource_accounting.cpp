@@ -0,0 +1,272 @@
+#include "../../include/core/resource_accounting.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace swarm {
+
+namespace {
+
+/** All accounts; never destroyed, allocations may be charged during exit */
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<ResourceAccounting::Account>> accounts;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+/** Account the calling thread currently works for */
+thread_local ResourceAccounting::Account* tlsAccount = nullptr;
+
+/** Thread CPU time when tlsAccount was last charged */
+thread_local int64_t tlsSince = 0;
+
+/** Charges an attached thread's CPU time to its module when the thread exits */
+struct ThreadAttachment {
+    ResourceAccounting::Account* account = nullptr;
+    long tid = 0;
+    int64_t attachedCpuNs = 0;                            // Charged before the thread was attached
+
+    ~ThreadAttachment() {
+        if (!account) {
+            return;
+        }
+        account->cpuNs += ResourceAccounting::threadCpuTime().count() - attachedCpuNs;
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        account->threads.erase(tid);
+    }
+};
+
+thread_local ThreadAttachment tlsAttachment;
+
+/** Charge the CPU time since tlsSince to the current account */
+void chargeCurrent() {
+    // Attached threads are charged from /proc
+    if (tlsAttachment.account) {
+        return;
+    }
+    int64_t now = ResourceAccounting::threadCpuTime().count();
+    if (tlsAccount) {
+        tlsAccount->cpuNs.fetch_add(now - tlsSince, std::memory_order_relaxed);
+    }
+    tlsSince = now;
+}
+
+/** CPU time of a thread of this process from /proc, in clock ticks */
+bool readThreadTicks(long tid, int64_t& ticks) {
+    std::ifstream file("/proc/self/task/" + std::to_string(tid) + "/stat");
+    std::string line;
+    if (!std::getline(file, line)) {
+        return false;
+    }
+    // The thread name may contain spaces; the fields resume after its ')'
+    size_t end = line.rfind(')');
+    if (end == std::string::npos) {
+        return false;
+    }
+    std::istringstream fields(line.substr(end + 1));
+    std::string field;
+    int64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+        if (i == 14) {
+            utime = std::atoll(field.c_str());
+        } else if (i == 15) {
+            stime = std::atoll(field.c_str());
+        }
+    }
+    ticks = utime + stime;
+    return true;
+}
+
+} // namespace
+
+ResourceAccounting::Scope::Scope(Account* account) {
+    chargeCurrent();
+    previous_ = tlsAccount;
+    tlsAccount = account;
+}
+
+ResourceAccounting::Scope::~Scope() {
+    chargeCurrent();
+    tlsAccount = previous_;
+}
+
+ResourceAccounting::Account* ResourceAccounting::accountFor(const std::string& module) {
+    std::string name = module.substr(0, module.find('#'));
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto& account = reg.accounts[name];
+    if (!account) {
+        account = std::make_unique<Account>();
+        account->module = name;
+    }
+    return account.get();
+}
+
+void ResourceAccounting::attachThread(const std::string& module) {
+    Account* account = accountFor(module);
+    // Thread names are limited to 15 characters
+    pthread_setname_np(pthread_self(), module.substr(0, 15).c_str());
+
+    // Time up to here belongs to the enclosing scope, not to the module
+    chargeCurrent();
+    tlsAccount = account;
+    tlsAttachment.account = account;
+    tlsAttachment.tid = static_cast<long>(syscall(SYS_gettid));
+    tlsAttachment.attachedCpuNs = threadCpuTime().count();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    account->threads[tlsAttachment.tid] = tlsAttachment.attachedCpuNs;
+}
+
+ResourceUsage ResourceAccounting::getUsage(const std::string& module) {
+    Account* account = accountFor(module);
+    std::map<long, int64_t> attached;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        attached = account->threads;
+    }
+
+    ResourceUsage usage;
+    int64_t cpuNs = account->cpuNs.load(std::memory_order_relaxed);
+    if (!attached.empty()) {
+        static const int64_t ticksPerSecond = sysconf(_SC_CLK_TCK);
+        if (DIR* tasks = opendir("/proc/self/task")) {
+            while (dirent* task = readdir(tasks)) {
+                long tid = std::atol(task->d_name);
+                auto thread = attached.find(tid);
+                int64_t ticks = 0;
+                if (tid > 0 && thread != attached.end() && readThreadTicks(tid, ticks)) {
+                    cpuNs += std::max<int64_t>(ticks * 1000000000 / ticksPerSecond - thread->second, 0);
+                    usage.threads++;
+                }
+            }
+            closedir(tasks);
+        }
+    }
+    usage.cpuTime = std::chrono::nanoseconds(cpuNs);
+    usage.allocatedBytes = account->allocatedBytes.load(std::memory_order_relaxed);
+    usage.liveBytes = static_cast<uint64_t>(std::max<int64_t>(0, account->liveBytes.load(std::memory_order_relaxed)));
+    usage.allocations = account->allocations.load(std::memory_order_relaxed);
+    usage.queueBacklog = static_cast<size_t>(std::max<int64_t>(0, account->backlog.load()));
+    return usage;
+}
+
+bool ResourceAccounting::tracksAllocations() {
+#ifdef SWARM_ALLOC_ACCOUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::chrono::nanoseconds ResourceAccounting::threadCpuTime() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+#ifdef SWARM_ALLOC_ACCOUNTING
+namespace {
+
+/** Precedes every allocation: the account its bytes are returned to when freed */
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+    ResourceAccounting::Account* account;
+    std::size_t size;
+};
+
+void* allocate(std::size_t size) noexcept {
+    auto* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->account = tlsAccount;
+    header->size = size;
+    if (ResourceAccounting::Account* account = header->account) {
+        account->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        account->liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+        account->allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return header + 1;
+}
+
+void deallocate(void* memory) noexcept {
+    if (!memory) {
+        return;
+    }
+    // Credited to the account that allocated it, whichever thread frees it
+    auto* header = static_cast<AllocationHeader*>(memory) - 1;
+    if (ResourceAccounting::Account* account = header->account) {
+        account->liveBytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+    }
+    std::free(header);
+}
+
+} // namespace
+#endif
+
+} // namespace swarm
+
+#ifdef SWARM_ALLOC_ACCOUNTING
+// Replacement allocation functions; over-aligned allocations are not counted
+// and keep the default functions, which do not see the header.
+// GCC cannot tell that the inlined operator delete pairs with this operator new.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    void* memory = swarm::allocate(size);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return swarm::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return swarm::allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    swarm::deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    swarm::deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    swarm::deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    swarm::deallocate(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    swarm::deallocate(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    swarm::deallocate(memory);
+}
+#endif
@@ -0,0 +1,154 @@
+#include "../../include/core/runtime.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+namespace swarm {
+
+namespace {
+
+/** Milliseconds from now until a point in time, for poll() */
+int pollTimeout(std::chrono::steady_clock::time_point until) {
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<int64_t>(0, remaining.count()));
+}
+
+} // namespace
+
+Runtime::Runtime(const RuntimeOptions& options) : options_(options) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previousMask_);
+
+    signalFd_ = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    stopFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    drainedFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (signalFd_ < 0 || stopFd_ < 0 || drainedFd_ < 0) {
+        std::string error = std::strerror(errno);
+        release();
+        throw std::runtime_error("Cannot create runtime event descriptors: " + error);
+    }
+}
+
+Runtime::~Runtime() {
+    release();
+}
+
+void Runtime::release() {
+    for (int* fd : {&signalFd_, &stopFd_, &drainedFd_}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previousMask_, nullptr);
+}
+
+void Runtime::onTick(TickHandler handler) {
+    tickHandler_ = std::move(handler);
+}
+
+void Runtime::onDrain(DrainHandler handler) {
+    drainHandler_ = std::move(handler);
+}
+
+void Runtime::requestStop() {
+    uint64_t one = 1;
+    // eventfd writes are async-signal-safe; the result needs no handling
+    ssize_t written = ::write(stopFd_, &one, sizeof(one));
+    (void)written;
+}
+
+int Runtime::run() {
+    waitForStop();
+
+    auto deadline = std::chrono::steady_clock::now() + options_.drainTimeout;
+    if (stopSignal_ != 0) {
+        std::cout << "\nReceived signal " << stopSignal_ << " (" << strsignal(stopSignal_) << "), draining..." << std::endl;
+    }
+    std::thread watchdogThread(&Runtime::watchdog, this, deadline);
+
+    bool drained = drainHandler_ ? drainHandler_(deadline) : true;
+
+    uint64_t one = 1;
+    ssize_t written = ::write(drainedFd_, &one, sizeof(one));
+    (void)written;
+    watchdogThread.join();
+
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    std::cout << (drained ? "Drained" : "Drain incomplete") << " with " << left.count()
+              << " ms of the deadline left" << std::endl;
+    return drained ? 0 : 1;
+}
+
+void Runtime::waitForStop() {
+    auto nextTick = std::chrono::steady_clock::now() + options_.tickInterval;
+    while (true) {
+        pollfd fds[] = {{signalFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+        bool ticking = tickHandler_ && options_.tickInterval.count() > 0;
+        int ready = ::poll(fds, 2, ticking ? pollTimeout(nextTick) : -1);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Runtime poll error: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            signalfd_siginfo info{};
+            if (::read(signalFd_, &info, sizeof(info)) == sizeof(info)) {
+                stopSignal_ = static_cast<int>(info.ssi_signo);
+                return;
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t count = 0;
+            ssize_t received = ::read(stopFd_, &count, sizeof(count));
+            (void)received;
+            return;
+        }
+        if (ticking && std::chrono::steady_clock::now() >= nextTick) {
+            tickHandler_();
+            // Skip ticks missed while the handler ran instead of running them back to back
+            auto now = std::chrono::steady_clock::now();
+            while (nextTick <= now) {
+                nextTick += options_.tickInterval;
+            }
+        }
+    }
+}
+
+void Runtime::watchdog(std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        pollfd fds[] = {{signalFd_, POLLIN, 0}, {drainedFd_, POLLIN, 0}};
+        int ready = ::poll(fds, 2, pollTimeout(deadline));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            return;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            signalfd_siginfo info{};
+            if (::read(signalFd_, &info, sizeof(info)) != sizeof(info)) {
+                continue;
+            }
+            std::cerr << "Received signal " << info.ssi_signo << " while draining, exiting now" << std::endl;
+        } else {
+            std::cerr << "Drain deadline of " << options_.drainTimeout.count() << " ms exceeded, exiting now" << std::endl;
+        }
+        // Whatever is stuck would block a normal exit as well
+        std::cerr.flush();
+        std::cout.flush();
+        ::_exit(1);
+    }
+}
+
+} // namespace swarm
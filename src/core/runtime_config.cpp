@@ -0,0 +1,387 @@
+#include "../../include/core/runtime_config.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace swarm {
+
+namespace {
+
+/** Variables of the compose files and old binaries, and the section and key they set */
+struct LegacyVariable {
+    const char* variable;
+    const char* kind;
+    const char* name;
+    const char* key;
+};
+
+const LegacyVariable kLegacyVariables[] = {
+    {"API_HOST", "module", "api", "host"},
+    {"API_PORT", "module", "api", "port"},
+    {"API_MAX_CONNECTIONS", "module", "api", "max_connections"},
+    {"API_ENABLE_CORS", "module", "api", "enable_cors"},
+    {"HEALTH_CHECK_INTERVAL", "module", "health-monitor", "default_interval_ms"},
+    {"HEALTH_CHECK_TIMEOUT", "module", "health-monitor", "default_timeout_ms"},
+    {"ZMQ_PUB_PORT", "bus", "", "pub_port"},
+    {"ZMQ_SUB_PORT", "bus", "", "sub_port"},
+    {"SWARM_PLUGIN_DIR", "runtime", "", "plugin_dir"},
+};
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        item = trim(item);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+/** Environment spelling of a section or key name */
+std::string toVariableName(const std::string& text) {
+    std::string name;
+    for (char c : text) {
+        name += (c == '-' || c == '.' || c == ' ') ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return name;
+}
+
+bool isNumber(const std::string& value) {
+    return !value.empty() && std::all_of(value.begin(), value.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+bool isLocalHost(const std::string& host) {
+    if (host == "localhost" || host == "127.0.0.1" || host == "::1") {
+        return true;
+    }
+    char name[256] = {};
+    return gethostname(name, sizeof(name) - 1) == 0 && host == name;
+}
+
+/** Check the values the runtime itself interprets */
+bool validate(const std::vector<RuntimeConfig::Section>& sections, std::string& error) {
+    static const std::set<std::string> numericRuntimeKeys = {"threads", "snapshot_interval_ms", "status_interval_ms", "drain_timeout_ms"};
+    static const std::set<std::string> numericBusKeys = {"pub_port", "sub_port"};
+    static const std::set<std::string> transports = {"auto", "inproc", "ipc", "tcp"};
+    for (const auto& section : sections) {
+        for (const auto& [key, value] : section.values) {
+            bool numeric = (section.kind == "runtime" && numericRuntimeKeys.count(key)) ||
+                           (section.kind == "bus" && numericBusKeys.count(key)) ||
+                           (section.kind == "module" && key == "replicas");
+            std::string where = "[" + section.kind + (section.name.empty() ? "" : " " + section.name) + "] " + key;
+            if (numeric && !isNumber(value)) {
+                error = where + ": expected a number, got '" + value + "'";
+                return false;
+            }
+            if (section.kind == "module" && key == "replicas" && value == "0") {
+                error = where + ": must be at least 1";
+                return false;
+            }
+            if (section.kind == "bus" && key == "transport" && !transports.count(value)) {
+                error = where + ": expected auto, inproc, ipc or tcp, got '" + value + "'";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool RuntimeConfig::parse(const std::string& text, std::string& error) {
+    std::vector<Section> sections;
+    std::istringstream stream(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+        // Comments start a line or follow whitespace, so URLs keep their '#'
+        size_t comment = line.find_first_of("#;");
+        while (comment != std::string::npos && comment > 0 && line[comment - 1] != ' ' && line[comment - 1] != '\t') {
+            comment = line.find_first_of("#;", comment + 1);
+        }
+        line = trim(line.substr(0, comment));
+        if (line.empty()) {
+            continue;
+        }
+
+        std::string where = "line " + std::to_string(lineNumber) + ": ";
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                error = where + "unterminated section header";
+                return false;
+            }
+            std::string header = trim(line.substr(1, line.size() - 2));
+            size_t space = header.find_first_of(" \t");
+            Section section;
+            section.kind = header.substr(0, space);
+            section.name = space == std::string::npos ? "" : trim(header.substr(space));
+            if (section.kind.empty()) {
+                error = where + "empty section header";
+                return false;
+            }
+            if ((section.kind == "module" || section.kind == "check") && section.name.empty()) {
+                error = where + "[" + section.kind + "] needs a name";
+                return false;
+            }
+            for (const auto& existing : sections) {
+                if (existing.kind == section.kind && existing.name == section.name) {
+                    error = where + "duplicate section [" + header + "]";
+                    return false;
+                }
+            }
+            sections.push_back(std::move(section));
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = where + "expected 'key = value'";
+            return false;
+        }
+        if (sections.empty()) {
+            error = where + "key outside of a section";
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        if (key.empty()) {
+            error = where + "empty key";
+            return false;
+        }
+        sections.back().values[key] = trim(line.substr(equals + 1));
+    }
+
+    // The runtime and bus sections always exist, so the environment can set them
+    for (const char* kind : {"runtime", "bus"}) {
+        bool present = std::any_of(sections.begin(), sections.end(), [kind](const Section& section) {
+            return section.kind == kind && section.name.empty();
+        });
+        if (!present) {
+            sections.push_back({kind, "", {}});
+        }
+    }
+    if (!validate(sections, error)) {
+        return false;
+    }
+    sections_ = std::move(sections);
+    return true;
+}
+
+bool RuntimeConfig::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    if (!parse(contents.str(), error)) {
+        error = path + ", " + error;
+        return false;
+    }
+    return true;
+}
+
+bool RuntimeConfig::applyEnvironment(const std::map<std::string, std::string>& environment, std::string& error) {
+    std::vector<Section> original = sections_;
+
+    auto modules = environment.find("SWARM_MODULES");
+    if (modules != environment.end() && !setModuleList(modules->second, error)) {
+        sections_ = std::move(original);
+        return false;
+    }
+
+    for (const auto& legacy : kLegacyVariables) {
+        auto it = environment.find(legacy.variable);
+        Section* section = find(legacy.kind, legacy.name);
+        if (it != environment.end() && section) {
+            section->values[legacy.key] = it->second;
+        }
+    }
+
+    for (auto& section : sections_) {
+        std::string prefix = "SWARM_" + toVariableName(section.kind) +
+                             (section.name.empty() ? "" : "_" + toVariableName(section.name)) + "__";
+        for (auto it = environment.lower_bound(prefix); it != environment.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            std::string key = it->first.substr(prefix.size());
+            std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (!key.empty()) {
+                section.values[key] = it->second;
+            }
+        }
+    }
+
+    if (!validate(sections_, error)) {
+        sections_ = std::move(original);
+        return false;
+    }
+    return true;
+}
+
+std::map<std::string, std::string> RuntimeConfig::processEnvironment() {
+    std::map<std::string, std::string> environment;
+    for (char** variable = environ; variable && *variable; variable++) {
+        std::string entry = *variable;
+        size_t equals = entry.find('=');
+        if (equals != std::string::npos) {
+            environment[entry.substr(0, equals)] = entry.substr(equals + 1);
+        }
+    }
+    return environment;
+}
+
+std::string RuntimeConfig::get(const std::string& section, const std::string& key,
+                               const std::string& defaultValue) const {
+    size_t space = section.find(' ');
+    const Section* found = find(section.substr(0, space), space == std::string::npos ? "" : section.substr(space + 1));
+    if (!found) {
+        return defaultValue;
+    }
+    auto it = found->values.find(key);
+    return it != found->values.end() ? it->second : defaultValue;
+}
+
+std::vector<const RuntimeConfig::Section*> RuntimeConfig::sections(const std::string& kind) const {
+    std::vector<const Section*> result;
+    for (const auto& section : sections_) {
+        if (section.kind == kind) {
+            result.push_back(&section);
+        }
+    }
+    return result;
+}
+
+std::vector<RuntimeModuleSpec> RuntimeConfig::modules() const {
+    std::vector<RuntimeModuleSpec> modules;
+    for (const auto* section : sections("module")) {
+        RuntimeModuleSpec spec;
+        spec.name = section->name;
+        spec.config = section->values;
+        auto replicas = spec.config.find("replicas");
+        if (replicas != spec.config.end()) {
+            spec.replicas = std::stoul(replicas->second);
+            spec.config.erase(replicas);
+        }
+        modules.push_back(std::move(spec));
+    }
+    return modules;
+}
+
+ExecutorOptions RuntimeConfig::executorOptions() const {
+    ExecutorOptions options;
+    std::string threads = get("runtime", "threads");
+    if (!threads.empty()) {
+        options.threadBudget = std::stoul(threads);
+    }
+    for (const auto& cpu : splitList(get("runtime", "cpu_affinity"))) {
+        if (isNumber(cpu)) {
+            options.cpuAffinity.push_back(std::stoi(cpu));
+        }
+    }
+    return options;
+}
+
+MessageBusOptions RuntimeConfig::busOptions() const {
+    MessageBusOptions options;
+    options.host = get("bus", "host", options.host);
+    options.ipcPath = get("bus", "ipc_path", options.ipcPath);
+    std::string pubPort = get("bus", "pub_port");
+    std::string subPort = get("bus", "sub_port");
+    if (!pubPort.empty()) {
+        options.publisherPort = std::stoi(pubPort);
+    }
+    if (!subPort.empty()) {
+        options.subscriberPort = std::stoi(subPort);
+    }
+
+    std::string transport = get("bus", "transport", "auto");
+    if (transport == "inproc") {
+        options.transport = BusTransport::Inproc;
+    } else if (transport == "ipc") {
+        options.transport = BusTransport::Ipc;
+    } else if (transport == "tcp") {
+        options.transport = BusTransport::Tcp;
+    } else {
+        // The cheapest transport that still reaches every peer
+        auto peers = splitList(get("bus", "peers"));
+        if (peers.empty()) {
+            options.transport = BusTransport::Inproc;
+        } else if (std::all_of(peers.begin(), peers.end(), isLocalHost)) {
+            options.transport = BusTransport::Ipc;
+        } else {
+            options.transport = BusTransport::Tcp;
+        }
+    }
+    return options;
+}
+
+std::string RuntimeConfig::toString() const {
+    std::ostringstream out;
+    for (const auto& section : sections_) {
+        if (&section != &sections_.front()) {
+            out << "\n";
+        }
+        out << "[" << section.kind << (section.name.empty() ? "" : " " + section.name) << "]\n";
+        for (const auto& [key, value] : section.values) {
+            out << key << " = " << value << "\n";
+        }
+    }
+    return out.str();
+}
+
+RuntimeConfig::Section* RuntimeConfig::find(const std::string& kind, const std::string& name) {
+    for (auto& section : sections_) {
+        if (section.kind == kind && section.name == name) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+
+const RuntimeConfig::Section* RuntimeConfig::find(const std::string& kind, const std::string& name) const {
+    return const_cast<RuntimeConfig*>(this)->find(kind, name);
+}
+
+bool RuntimeConfig::setModuleList(const std::string& list, std::string& error) {
+    std::vector<Section> modules;
+    for (const auto& item : splitList(list)) {
+        size_t colon = item.rfind(':');
+        std::string name = trim(item.substr(0, colon));
+        if (name.empty()) {
+            error = "SWARM_MODULES: empty module name";
+            return false;
+        }
+        const Section* existing = find("module", name);
+        Section section = existing ? *existing : Section{"module", name, {}};
+        if (colon != std::string::npos) {
+            section.values["replicas"] = trim(item.substr(colon + 1));
+        }
+        modules.push_back(std::move(section));
+    }
+
+    sections_.erase(std::remove_if(sections_.begin(), sections_.end(),
+                                   [](const Section& section) { return section.kind == "module"; }),
+                    sections_.end());
+    sections_.insert(sections_.end(), modules.begin(), modules.end());
+    return true;
+}
+
+} // namespace swarm
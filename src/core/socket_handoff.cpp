@@ -0,0 +1,382 @@
+#include "../../include/core/socket_handoff.h"
+#include <iostream>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace swarm {
+
+namespace {
+
+// Sockets passed in one message; the kernel allows up to SCM_MAX_FD (253)
+constexpr size_t kMaxListeners = 64;
+
+// Sent by the successor once it serves
+constexpr char kReady[] = "ready\n";
+
+std::string listenerKey(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+bool makeUnixAddress(const std::string& path, sockaddr_un& address, std::string& error) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "invalid handoff socket path '" + path + "'";
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+SocketHandoff::~SocketHandoff() {
+    if (serverThread_.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd_, &one, sizeof(one));
+        (void)written;
+        serverThread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int fd : {serverFd_, wakeFd_, predecessorFd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    // After a handoff the path belongs to the successor
+    if (!path_.empty() && !handedOff_) {
+        ::unlink(path_.c_str());
+    }
+    for (auto& [key, listener] : listeners_) {
+        ::close(listener.fd);
+    }
+}
+
+int SocketHandoff::bindTcpListener(const std::string& host, int port, std::string& error) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    const char* node = (host.empty() || host == "0.0.0.0") ? nullptr : host.c_str();
+    int result = ::getaddrinfo(node, service.c_str(), &hints, &addresses);
+    if (result != 0) {
+        error = "cannot resolve " + listenerKey(host, port) + ": " + gai_strerror(result);
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* address = addresses; address; address = address->ai_next) {
+        // Without a host, prefer the IPv4 wildcard as Oat++'s own provider does
+        if (!node && address->ai_family != AF_INET && address->ai_next) {
+            continue;
+        }
+        fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            break;
+        }
+        error = "cannot listen on " + listenerKey(host, port) + ": " + std::strerror(errno);
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(addresses);
+    if (fd < 0 && error.empty()) {
+        error = "no address to listen on for " + listenerKey(host, port);
+    }
+    return fd;
+}
+
+int SocketHandoff::acquireListener(const std::string& host, int port, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = listenerKey(host, port);
+    auto it = listeners_.find(key);
+    if (it == listeners_.end()) {
+        int fd = bindTcpListener(host, port, error);
+        if (fd < 0) {
+            return -1;
+        }
+        it = listeners_.emplace(key, Listener{fd, false, 0}).first;
+    }
+    int fd = ::fcntl(it->second.fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+        error = "cannot duplicate listener " + key + ": " + std::strerror(errno);
+        return -1;
+    }
+    it->second.users++;
+    return fd;
+}
+
+void SocketHandoff::releaseListener(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = listeners_.find(listenerKey(host, port));
+    if (it != listeners_.end() && it->second.users > 0 && --it->second.users == 0) {
+        ::close(it->second.fd);
+        listeners_.erase(it);
+    }
+}
+
+bool SocketHandoff::inherit(const std::string& path, std::string& error) {
+    sockaddr_un address;
+    if (!makeUnixAddress(path, address, error)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("cannot create handoff socket: ") + std::strerror(errno);
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        int reason = errno;
+        ::close(fd);
+        // No predecessor, or a stale socket file it left behind
+        if (reason == ENOENT || reason == ECONNREFUSED) {
+            return true;
+        }
+        error = "cannot connect to " + path + ": " + std::strerror(reason);
+        return false;
+    }
+
+    char payload[4096];
+    iovec data{payload, sizeof(payload) - 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxListeners)];
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t received;
+    do {
+        received = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0) {
+        error = "predecessor on " + path + " sent no sockets";
+        ::close(fd);
+        return false;
+    }
+    payload[received] = '\0';
+
+    std::vector<int> fds;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* passed = reinterpret_cast<const int*>(CMSG_DATA(header));
+            fds.insert(fds.end(), passed, passed + count);
+        }
+    }
+
+    std::vector<std::string> keys;
+    std::istringstream lines(payload);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty()) {
+            keys.push_back(line);
+        }
+    }
+    if (keys.size() != fds.size() || (message.msg_flags & MSG_CTRUNC)) {
+        error = "predecessor on " + path + " sent " + std::to_string(fds.size()) + " sockets for " +
+                std::to_string(keys.size()) + " addresses";
+        for (int passed : fds) {
+            ::close(passed);
+        }
+        ::close(fd);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto& listener = listeners_[keys[i]];
+        if (listener.fd >= 0) {
+            ::close(listener.fd);
+        }
+        listener = Listener{fds[i], true, listener.users};
+        std::cout << "Inherited listening socket " << keys[i] << std::endl;
+    }
+    predecessorFd_ = fd;
+    return true;
+}
+
+bool SocketHandoff::complete() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (predecessorFd_ < 0) {
+        return false;
+    }
+    bool sent = ::send(predecessorFd_, kReady, sizeof(kReady) - 1, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(kReady) - 1);
+    ::close(predecessorFd_);
+    predecessorFd_ = -1;
+    for (auto it = listeners_.begin(); it != listeners_.end();) {
+        if (it->second.inherited && it->second.users == 0) {
+            std::cout << "Closing inherited listening socket " << it->first << ": no module uses it" << std::endl;
+            ::close(it->second.fd);
+            it = listeners_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return sent;
+}
+
+bool SocketHandoff::serve(const std::string& path, HandedOffHandler onHandedOff, std::string& error) {
+    sockaddr_un address;
+    if (!makeUnixAddress(path, address, error)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (serverThread_.joinable()) {
+        error = "already serving on " + path_;
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("cannot create handoff socket: ") + std::strerror(errno);
+        return false;
+    }
+    // The predecessor's socket, if any, is no longer needed
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 4) != 0) {
+        error = "cannot serve handoff on " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    wakeFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd_ < 0) {
+        error = std::string("cannot create handoff eventfd: ") + std::strerror(errno);
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+    serverFd_ = fd;
+    path_ = path;
+    onHandedOff_ = std::move(onHandedOff);
+    serverThread_ = std::thread(&SocketHandoff::serveLoop, this);
+    return true;
+}
+
+void SocketHandoff::serveLoop() {
+    while (true) {
+        pollfd fds[] = {{serverFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Socket handoff poll error: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        int client = ::accept4(serverFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        bool tookOver = handOff(client);
+        ::close(client);
+        if (tookOver) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handedOff_ = true;
+        ::close(serverFd_);
+        serverFd_ = -1;
+    }
+    std::cout << "Listening sockets handed off to the new process" << std::endl;
+    if (onHandedOff_) {
+        onHandedOff_();
+    }
+}
+
+bool SocketHandoff::handOff(int client) {
+    std::string payload;
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [key, listener] : listeners_) {
+            if (fds.size() == kMaxListeners) {
+                std::cerr << "Not handing off listener " << key << ": too many listeners" << std::endl;
+                continue;
+            }
+            payload += key + "\n";
+            fds.push_back(listener.fd);
+        }
+        if (payload.empty()) {
+            payload = "\n";
+        }
+
+        // The descriptors are duplicated into the message while the lock keeps them open
+        iovec data{payload.data(), payload.size()};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxListeners)] = {};
+        msghdr message{};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        if (!fds.empty()) {
+            message.msg_control = control;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            std::memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+        }
+        if (::sendmsg(client, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(payload.size())) {
+            std::cerr << "Cannot hand off listening sockets: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    // The successor keeps the connection open until it serves, or closes it when it fails
+    std::string reply;
+    while (reply.size() < sizeof(kReady) - 1) {
+        pollfd fds[] = {{client, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (fds[1].revents & POLLIN) {
+            return false;
+        }
+        char buffer[sizeof(kReady)];
+        ssize_t received = ::recv(client, buffer, sizeof(kReady) - 1 - reply.size(), 0);
+        if (received <= 0) {
+            std::cerr << "New process disconnected before taking over, still serving" << std::endl;
+            return false;
+        }
+        reply.append(buffer, static_cast<size_t>(received));
+    }
+    return reply == kReady;
+}
+
+std::vector<std::string> SocketHandoff::getInherited() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> keys;
+    for (const auto& [key, listener] : listeners_) {
+        if (listener.inherited) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+bool SocketHandoff::isHandedOff() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return handedOff_;
+}
+
+} // namespace swarm
@@ -0,0 +1,152 @@
+#include "../../include/core/state_snapshot.h"
+#include "../../include/core/state_codec.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace swarm {
+
+namespace {
+
+/** 64-bit FNV-1a hash, used to detect torn or corrupted snapshot files */
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+std::string StateSnapshot::encode(std::chrono::system_clock::time_point savedAt) const {
+    StateWriter writer;
+    writer.writeUInt(kMagic);
+    writer.writeUInt(kVersion);
+    writer.writeInt(std::chrono::duration_cast<std::chrono::milliseconds>(savedAt.time_since_epoch()).count());
+    writer.writeUInt(entries_.size());
+    for (const auto& [module, states] : entries_) {
+        writer.writeString(module);
+        writer.writeUInt(states.size());
+        for (const auto& state : states) {
+            writer.writeString(state);
+        }
+    }
+
+    std::string data = writer.str();
+    StateWriter trailer;
+    trailer.writeUInt(checksum(data.data(), data.size()));
+    return data + trailer.str();
+}
+
+bool StateSnapshot::decode(const std::string& data, std::string& error) {
+    if (data.size() < 8) {
+        error = "file too short";
+        return false;
+    }
+    std::string trailer = data.substr(data.size() - 8);
+    StateReader checksumReader(trailer);
+    uint64_t expected = 0;
+    checksumReader.readUInt(expected);
+    if (checksum(data.data(), data.size() - 8) != expected) {
+        error = "checksum mismatch";
+        return false;
+    }
+
+    std::string body = data.substr(0, data.size() - 8);
+    StateReader reader(body);
+    uint64_t magic = 0, version = 0, count = 0;
+    int64_t savedAtMs = 0;
+    if (!reader.readUInt(magic) || magic != kMagic) {
+        error = "not a snapshot file";
+        return false;
+    }
+    if (!reader.readUInt(version) || version != kVersion) {
+        error = "unsupported snapshot version " + std::to_string(version);
+        return false;
+    }
+    reader.readInt(savedAtMs);
+    reader.readUInt(count);
+
+    std::map<std::string, std::vector<std::string>> entries;
+    for (uint64_t i = 0; i < count && reader.ok(); i++) {
+        std::string module;
+        uint64_t replicas = 0;
+        reader.readString(module);
+        reader.readUInt(replicas);
+        std::vector<std::string> states;
+        for (uint64_t j = 0; j < replicas && reader.ok(); j++) {
+            std::string state;
+            reader.readString(state);
+            states.push_back(std::move(state));
+        }
+        entries[module] = std::move(states);
+    }
+    if (!reader.ok() || !reader.atEnd()) {
+        error = "malformed snapshot";
+        return false;
+    }
+
+    entries_ = std::move(entries);
+    savedAt_ = std::chrono::system_clock::time_point(std::chrono::milliseconds(savedAtMs));
+    return true;
+}
+
+bool StateSnapshot::save(const std::string& path, std::string& error) {
+    auto savedAt = std::chrono::system_clock::now();
+    std::string data = encode(savedAt);
+    std::string temporary = path + ".tmp";
+
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot create " + temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            error = "cannot write " + temporary + ": " + std::strerror(errno);
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    // The data must be on disk before the rename makes it the current snapshot
+    if (::fsync(fd) != 0) {
+        error = "cannot flush " + temporary + ": " + std::strerror(errno);
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    if (::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path + ": " + std::strerror(errno);
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    savedAt_ = savedAt;
+    return true;
+}
+
+bool StateSnapshot::load(const std::string& path, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return decode(contents.str(), error);
+}
+
+} // namespace swarm
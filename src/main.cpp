@@ -1,119 +1,236 @@
 #include "../include/core/module_manager.h"
+#include "../include/core/runtime.h"
+#include "../include/core/runtime_config.h"
+#include "../include/core/static_module_set.h"
 
+#ifndef SWARM_CORE_ONLY
 #include "../include/modules/health_monitor_module.h"
 #include "../include/modules/api_module.h"
+#endif
 #include <iostream>
-#include <signal.h>
-#include <unistd.h>
+#include <cstdlib>
 
 using namespace swarm;
 
-ModuleManager* g_moduleManager = nullptr;
+// Modules built into this binary; others are loaded from [runtime] plugin_dir.
+// The core-only runtime (swarm-core-app) has none and loads every module as a plugin.
+#ifdef SWARM_CORE_ONLY
+using AppModules = StaticModuleSet<>;
+#else
+using AppModules = StaticModuleSet<HealthMonitorModule, ApiModule>;
+#endif
 
-void signalHandler(int signum) {
-    std::cout << "\nReceived signal " << signum << ", shutting down..." << std::endl;
-    if (g_moduleManager) {
-        g_moduleManager->shutdownAllModules();
+// Used when neither --config nor SWARM_CONFIG names a file: everything in one process
+const char* kDefaultConfig = R"(
+[runtime]
+status_interval_ms = 10000
+
+[bus]
+transport = auto
+
+[module health-monitor]
+default_timeout_ms = 5000
+default_interval_ms = 10000
+check_jitter = 0.1
+max_failures = 3
+enable_notifications = true
+
+[module api]
+host = 0.0.0.0
+port = 8084
+max_connections = 100
+enable_cors = true
+
+[check api-server]
+type = http
+endpoint = http://localhost:8084/health
+interval_ms = 10000
+
+[check main-endpoint]
+type = http
+endpoint = http://localhost:8084/
+interval_ms = 15000
+)";
+
+// Print the state of every module
+void printStatus(ModuleManager& moduleManager) {
+    auto statuses = moduleManager.getModuleStatuses();
+    std::cout << "\n📈 Module Status (" << moduleManager.getMessageBus()->getMessageCount() << " messages):" << std::endl;
+    for (const auto& [name, status] : statuses) {
+        const auto& usage = status.resources;
+        std::cout << "   " << name << ": " << toString(status.state) << ", " << status.summary
+                  << " (cpu " << std::chrono::duration_cast<std::chrono::milliseconds>(usage.cpuTime).count()
+                  << " ms, threads " << usage.threads << ", backlog " << usage.queueBacklog;
+        if (ResourceAccounting::tracksAllocations()) {
+            std::cout << ", allocated " << usage.allocatedBytes / 1024 << " KiB, live " << usage.liveBytes / 1024 << " KiB";
+        }
+        std::cout << ")" << std::endl;
+        if (!status.lastError.empty()) {
+            std::cout << "     last error: " << status.lastError << std::endl;
+        }
     }
-    exit(0);
 }
 
-int main() {
-    std::cout << "🚀 Starting SwarmApp with Multiple Modules" << std::endl;
-    
-    // Set up signal handling
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
-    
-    try {
-        // Create module manager
-        ModuleManager moduleManager;
-        g_moduleManager = &moduleManager;
-        
-        // Register modules
-        moduleManager.registerModule("health-monitor", []() {
-            return std::make_unique<HealthMonitorModule>();
-        });
-        
-        moduleManager.registerModule("api", []() {
-            return std::make_unique<ApiModule>();
-        });
-        
-        std::cout << "📦 Registered modules: health-monitor, api" << std::endl;
-        
-        // Load and configure health monitor module
-        std::map<std::string, std::string> healthConfig = {
-            {"default_timeout_ms", "5000"},
-            {"default_interval_ms", "10000"},
-            {"max_failures", "3"},
-            {"enable_notifications", "true"}
+// Hand the [check NAME] sections to the health monitor
+void addHealthChecks(const RuntimeConfig& config, ModuleManager& moduleManager) {
+    auto checks = config.sections("check");
+    if (checks.empty()) {
+        return;
+    }
+#ifdef SWARM_CORE_ONLY
+    // A plugin's classes are not visible to the runtime, so its checks cannot be handed over
+    (void)moduleManager;
+    std::cerr << "⚠️  Ignoring " << checks.size() << " health check(s): health-monitor is not built into this runtime" << std::endl;
+#else
+    auto* hm = AppModules::get<HealthMonitorModule>(moduleManager);
+    if (!hm) {
+        std::cerr << "⚠️  Ignoring " << checks.size() << " health check(s): health-monitor is not loaded" << std::endl;
+        return;
+    }
+    for (const auto* check : checks) {
+        auto value = [check](const std::string& key, const std::string& defaultValue) {
+            auto it = check->values.find(key);
+            return it != check->values.end() ? it->second : defaultValue;
         };
-        
-        // Load and configure API module
-        std::map<std::string, std::string> apiConfig = {
-            {"port", "8084"},
-            {"host", "0.0.0.0"},
-            {"max_connections", "100"},
-            {"enable_cors", "true"}
+        // Without timeout_ms or interval_ms the monitor's defaults apply
+        HealthCheckConfig healthCheck = {
+            check->name, value("type", "http"), value("endpoint", ""),
+            std::atoi(value("timeout_ms", "0").c_str()),
+            std::atoi(value("interval_ms", "0").c_str()),
+            std::atoi(value("max_failures", "3").c_str())
         };
-        
-        // Load modules
-        if (!moduleManager.loadModule("health-monitor", healthConfig)) {
-            std::cerr << "❌ Failed to load health-monitor module" << std::endl;
-            return 1;
+        hm->addHealthCheck(healthCheck);
+        std::cout << "📋 Added health check " << healthCheck.moduleName << " (" << healthCheck.endpoint << ")" << std::endl;
+    }
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    const char* configEnv = std::getenv("SWARM_CONFIG");
+    std::string configPath = configEnv ? configEnv : "";
+    bool printConfig = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "--print-config") {
+            printConfig = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "  --config FILE         Deployment configuration (default: $SWARM_CONFIG, else all modules in-process)" << std::endl;
+            std::cout << "  --print-config        Print the configuration with environment overrides applied and exit" << std::endl;
+            std::cout << "  --help, -h            Show this help message" << std::endl;
+            std::cout << "Environment:" << std::endl;
+            std::cout << "  SWARM_MODULES=NAME[:N],...        Replace the module list" << std::endl;
+            std::cout << "  SWARM_<SECTION>__<KEY>=VALUE      Override a key, e.g. SWARM_MODULE_API__PORT=8083" << std::endl;
+            std::cout << "  API_PORT, HEALTH_CHECK_INTERVAL, ZMQ_PUB_PORT, ...  Compose file variables" << std::endl;
+            return 0;
         }
-        
-        if (!moduleManager.loadModule("api", apiConfig)) {
-            std::cerr << "❌ Failed to load api module" << std::endl;
-            return 1;
+    }
+
+    RuntimeConfig config;
+    std::string error;
+    bool parsed = configPath.empty() ? config.parse(kDefaultConfig, error) : config.load(configPath, error);
+    if (!parsed || !config.applyEnvironment(RuntimeConfig::processEnvironment(), error)) {
+        std::cerr << "❌ Invalid configuration: " << error << std::endl;
+        return 1;
+    }
+    if (printConfig) {
+        std::cout << config.toString();
+        return 0;
+    }
+
+    std::cout << "🚀 Starting SwarmApp" << (configPath.empty() ? "" : " (" + configPath + ")") << std::endl;
+
+    try {
+        // Signals are received by the runtime's loop, so it must exist before any thread
+        RuntimeOptions runtimeOptions;
+        runtimeOptions.drainTimeout = std::chrono::milliseconds(std::atol(config.get("runtime", "drain_timeout_ms", "5000").c_str()));
+        runtimeOptions.tickInterval = std::chrono::milliseconds(std::atol(config.get("runtime", "status_interval_ms", "10000").c_str()));
+        Runtime runtime(runtimeOptions);
+
+        // Create module manager (this starts the message bus)
+        ModuleManager moduleManager(config.executorOptions(), config.busOptions());
+
+        auto* bus = moduleManager.getMessageBus();
+        std::cout << "📡 Message bus on " << toString(bus->getTransport()) << ": publishing on "
+                  << bus->getPublisherEndpoint() << ", receiving on " << bus->getSubscriberEndpoint() << std::endl;
+
+        std::string snapshotPath = config.get("runtime", "snapshot");
+        if (!snapshotPath.empty()) {
+            long intervalMs = std::atol(config.get("runtime", "snapshot_interval_ms", "0").c_str());
+            moduleManager.enableSnapshots(snapshotPath, std::chrono::milliseconds(intervalMs));
         }
-        
-        // Add health checks to monitor the API server
-        auto healthMonitor = moduleManager.getModule("health-monitor");
-        if (auto* hm = dynamic_cast<HealthMonitorModule*>(healthMonitor)) {
-            HealthCheckConfig apiCheck = {
-                "api-server", "http", "http://localhost:8084/health", 5000, 10000, 3
-            };
-            hm->addHealthCheck(apiCheck);
-            
-            HealthCheckConfig mainCheck = {
-                "main-endpoint", "http", "http://localhost:8084/", 5000, 15000, 3
-            };
-            hm->addHealthCheck(mainCheck);
-            
-            std::cout << "📋 Added health checks for API server" << std::endl;
+
+        // Take the listening sockets over from a running predecessor, if there is one
+        std::string handoffPath = config.get("runtime", "handoff_socket");
+        auto* handoff = moduleManager.getSocketHandoff();
+        if (!handoffPath.empty() && !handoff->inherit(handoffPath, error)) {
+            std::cerr << "⚠️  Not taking over from the previous process: " << error << std::endl;
         }
-        
+
+        // Register modules; plugins are only loaded when the configuration lists them
+        AppModules::registerAll(moduleManager);
+        std::string pluginDir = config.get("runtime", "plugin_dir");
+        if (!pluginDir.empty()) {
+            size_t found = moduleManager.scanPluginDirectory(pluginDir);
+            std::cout << "🔌 Found " << found << " plugin(s) in " << pluginDir << std::endl;
+        }
+
+        // Load modules
+        auto modules = config.modules();
+        for (const auto& module : modules) {
+            if (!moduleManager.loadModule(module.name, module.config, module.replicas)) {
+                std::cerr << "❌ Failed to load module '" << module.name << "'" << std::endl;
+                return 1;
+            }
+        }
+        addHealthChecks(config, moduleManager);
+
         std::cout << "✅ Modules loaded successfully" << std::endl;
-        
+
         // Start all modules
-        moduleManager.startAllModules();
-        
-        std::cout << "🎯 Application is running..." << std::endl;
-        std::cout << "📊 Available endpoints:" << std::endl;
-        std::cout << "   API Server (Oat++):" << std::endl;
-        std::cout << "     GET http://localhost:8084/ - API information" << std::endl;
-        std::cout << "     GET http://localhost:8084/health - Health check" << std::endl;
-        std::cout << "     GET http://localhost:8084/status - Server status" << std::endl;
-        std::cout << "     GET http://localhost:8084/api/info - API information" << std::endl;
-        std::cout << "🔧 Press Ctrl+C to stop" << std::endl;
-        
-        // Keep the application running
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::seconds(10));
-            
-            // Print status every 10 seconds
-            auto statuses = moduleManager.getModuleStatuses();
-            std::cout << "\n📈 Module Status:" << std::endl;
-            for (const auto& [name, status] : statuses) {
-                std::cout << "   " << name << ": " << status << std::endl;
+        if (!modules.empty() && !moduleManager.startAllModules()) {
+            std::cerr << "❌ Failed to start modules" << std::endl;
+            return 1;
+        }
+
+        // Serving now: the predecessor drains, and a successor can take over from us
+        if (!handoffPath.empty()) {
+            if (handoff->complete()) {
+                std::cout << "🔁 Took over from the previous process" << std::endl;
+            }
+            if (!handoff->serve(handoffPath, [&runtime]() { runtime.requestStop(); }, error)) {
+                std::cerr << "⚠️  Restarts will refuse connections: " << error << std::endl;
             }
         }
-        
+
+        std::cout << "🎯 Application is running..." << std::endl;
+        if (moduleManager.getModule("api")) {
+            std::string address = config.get("module api", "host", "0.0.0.0") + ":" + config.get("module api", "port", "8080");
+            std::cout << "📊 API Server (Oat++) endpoints:" << std::endl;
+            std::cout << "     GET http://" << address << "/ - API information" << std::endl;
+            std::cout << "     GET http://" << address << "/health - Health check" << std::endl;
+            std::cout << "     GET http://" << address << "/status - Server status" << std::endl;
+            std::cout << "     GET http://" << address << "/api/info - API information" << std::endl;
+        }
+        std::cout << "🔧 Press Ctrl+C to stop" << std::endl;
+
+        // Serve until SIGTERM or SIGINT, then drain and shut down within the deadline
+        runtime.onTick([&moduleManager]() { printStatus(moduleManager); });
+        runtime.onDrain([&moduleManager](std::chrono::steady_clock::time_point deadline) {
+            bool drained = moduleManager.drain(deadline);
+            moduleManager.shutdownAllModules();
+            moduleManager.getProfiler()->reportIfRequested(std::cout);
+            return drained;
+        });
+        return runtime.run();
+
     } catch (const std::exception& e) {
         std::cerr << "💥 Fatal error: " << e.what() << std::endl;
         return 1;
     }
-    
+
     return 0;
 }
@@ -1,15 +1,37 @@
 #include "modules/api_module.h"
-#include <oatpp/network/Address.hpp>
+#include "core/module_manager.h"
+#include <oatpp/network/tcp/Connection.hpp>
 #include <oatpp/web/protocol/http/outgoing/ResponseFactory.hpp>
 #include <iostream>
 #include <sstream>
 #include <chrono>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace swarm {
 
 // Implementation of SimpleHttpHandler
+SimpleHttpHandler::SimpleHttpHandler(std::shared_ptr<std::atomic<int>> inFlight)
+    : m_inFlight(std::move(inFlight)) {
+}
+
 std::shared_ptr<oatpp::web::protocol::http::outgoing::Response> SimpleHttpHandler::handle(
     const std::shared_ptr<oatpp::web::protocol::http::incoming::Request>& request) {
+    // Counted until the response is built, so a drain waits for it
+    struct InFlight {
+        std::atomic<int>& count;
+        explicit InFlight(std::atomic<int>& c) : count(c) { count++; }
+        ~InFlight() { count--; }
+    } inFlight(*m_inFlight);
+    return respond(request);
+}
+
+std::shared_ptr<oatpp::web::protocol::http::outgoing::Response> SimpleHttpHandler::respond(
+    const std::shared_ptr<oatpp::web::protocol::http::incoming::Request>& request) {
     
     auto path = request->getStartingLine().path;
     auto method = request->getStartingLine().method;
@@ -59,6 +81,103 @@ std::shared_ptr<oatpp::web::protocol::http::outgoing::Response> SimpleHttpHandle
     }
 }
 
+// Implementation of ListenerConnectionProvider
+ListenerConnectionProvider::ListenerConnectionProvider(int listenerFd, const std::string& host, int port)
+    : m_listenerFd(listenerFd)
+    , m_wakeFd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_accepting(false)
+    , m_closed(false)
+    , m_invalidator(std::make_shared<ConnectionInvalidator>()) {
+    if (m_wakeFd < 0) {
+        ::close(m_listenerFd);
+        throw std::runtime_error("Cannot create eventfd for the API listener");
+    }
+    // Another process may accept the connection this one was woken for, so
+    // accept() must not block. The flag is shared with that process, which
+    // uses this provider as well.
+    ::fcntl(m_listenerFd, F_SETFL, ::fcntl(m_listenerFd, F_GETFL) | O_NONBLOCK);
+    setProperty(PROPERTY_HOST, host);
+    setProperty(PROPERTY_PORT, oatpp::String(std::to_string(port)));
+}
+
+ListenerConnectionProvider::~ListenerConnectionProvider() {
+    closeListener();
+    ::close(m_wakeFd);
+}
+
+oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream> ListenerConnectionProvider::get() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return {};
+        }
+        m_accepting = true;
+    }
+    
+    pollfd fds[] = {{m_listenerFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+    int ready = ::poll(fds, 2, -1);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_accepting = false;
+    if (m_closed) {
+        closeListener();
+        return {};
+    }
+    if (ready > 0 && (fds[1].revents & POLLIN)) {
+        uint64_t count = 0;
+        ssize_t received = ::read(m_wakeFd, &count, sizeof(count));
+        (void)received;
+    }
+    if (ready <= 0 || !(fds[0].revents & POLLIN)) {
+        return {};
+    }
+    // Accepted sockets are blocking, as the synchronous connection handler expects
+    int handle = ::accept4(m_listenerFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (handle < 0) {
+        // EAGAIN: another process accepted it first
+        return {};
+    }
+    return oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>(
+        std::make_shared<oatpp::network::tcp::Connection>(handle), m_invalidator);
+}
+
+oatpp::async::CoroutineStarterForResult<const oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>&>
+ListenerConnectionProvider::getAsync() {
+    // Only used with the synchronous HttpConnectionHandler, see the header
+    throw std::runtime_error("ListenerConnectionProvider supports the synchronous connection handler only");
+}
+
+void ListenerConnectionProvider::stop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    if (m_accepting) {
+        // get() closes the descriptor once poll() returns
+        interrupt();
+    } else {
+        closeListener();
+    }
+}
+
+void ListenerConnectionProvider::interrupt() {
+    uint64_t one = 1;
+    ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+void ListenerConnectionProvider::closeListener() {
+    if (m_listenerFd >= 0) {
+        // close(), not shutdown(): the socket may be open in another process
+        ::close(m_listenerFd);
+        m_listenerFd = -1;
+    }
+}
+
+void ListenerConnectionProvider::ConnectionInvalidator::invalidate(
+    const std::shared_ptr<oatpp::data::stream::IOStream>& connection) {
+    auto tcpConnection = std::static_pointer_cast<oatpp::network::tcp::Connection>(connection);
+    ::shutdown(tcpConnection->getHandle(), SHUT_RDWR);
+}
+
 ApiModule::ApiModule()
     : m_host("127.0.0.1")
     , m_port(8080)
@@ -66,7 +185,9 @@ ApiModule::ApiModule()
     , m_corsEnabled(true)
     , m_running(false)
     , m_requestCount(0)
-    , m_activeConnections(0) {
+    , m_activeConnections(0)
+    , m_requestsInFlight(std::make_shared<std::atomic<int>>(0))
+    , m_handoff(nullptr) {
 }
 
 ApiModule::~ApiModule() {
@@ -82,7 +203,7 @@ bool ApiModule::initialize() {
         m_router = oatpp::web::server::HttpRouter::createShared();
         
         // Create HTTP handler
-        m_httpHandler = std::make_shared<SimpleHttpHandler>();
+        m_httpHandler = std::make_shared<SimpleHttpHandler>(m_requestsInFlight);
         
         // Add handler to router for all paths
         m_router->route("GET", "/*", m_httpHandler);
@@ -93,10 +214,18 @@ bool ApiModule::initialize() {
         // Create connection handler
         m_connectionHandler = oatpp::web::server::HttpConnectionHandler::createShared(m_router);
         
-        // Create connection provider
-        m_connectionProvider = oatpp::network::tcp::server::ConnectionProvider::createShared(
-            {m_host, static_cast<v_uint16>(m_port)}
-        );
+        // Create connection provider. The listening socket comes from the manager's
+        // handoff, so a replacement process can inherit it without refusing connections.
+        std::string error;
+        m_handoff = moduleManager_ ? moduleManager_->getSocketHandoff() : nullptr;
+        int listenerFd = m_handoff ? m_handoff->acquireListener(m_host, m_port, error)
+                                   : SocketHandoff::bindTcpListener(m_host, m_port, error);
+        if (listenerFd < 0) {
+            m_handoff = nullptr;
+            std::cerr << "Failed to initialize API Module: " << error << std::endl;
+            return false;
+        }
+        m_connectionProvider = std::make_shared<ListenerConnectionProvider>(listenerFd, m_host, m_port);
         
         // Create server
         m_server = oatpp::network::Server::createShared(m_connectionProvider, m_connectionHandler);
@@ -112,32 +241,90 @@ bool ApiModule::initialize() {
 void ApiModule::start() {
     if (!m_server) {
         std::cerr << "API Module not initialized" << std::endl;
+        signalReady(false);
         return;
     }
     
-    try {
-        m_running = true;
-        std::cout << "Starting API Module server..." << std::endl;
-        
-        // Start server in a separate thread
-        m_server->run();
-        
-        std::cout << "API Module server started successfully" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to start API Module: " << e.what() << std::endl;
-        m_running = false;
+    if (m_running) {
+        return;
     }
+    
+    if (m_serverThread.joinable()) {
+        m_serverThread.join();
+    }
+    
+    m_running = true;
+    std::cout << "Starting API Module server..." << std::endl;
+    
+    // Run the accept loop on its own thread so start() returns immediately. The
+    // loop condition is evaluated before every accept, so its first evaluation
+    // marks the point where the server is serving.
+    m_serverThread = std::thread([this]() {
+        ResourceAccounting::attachThread(getName());
+        bool signalled = false;
+        try {
+            m_server->run([this, &signalled]() {
+                if (!signalled) {
+                    signalled = true;
+                    std::cout << "API Module server started successfully" << std::endl;
+                    signalReady(true);
+                }
+                return m_running.load();
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "API Module server error: " << e.what() << std::endl;
+        }
+        if (!signalled) {
+            signalReady(false);
+        }
+        m_running = false;
+    });
 }
 
 void ApiModule::stop() {
     if (m_server && m_running) {
         std::cout << "Stopping API Module server..." << std::endl;
-        m_server->stop();
         m_running = false;
+        m_server->stop();
+        m_connectionProvider->interrupt();
+    }
+    if (m_serverThread.joinable()) {
+        m_serverThread.join();
         std::cout << "API Module server stopped" << std::endl;
     }
 }
 
+bool ApiModule::drain(std::chrono::steady_clock::time_point deadline) {
+    if (!m_server || !m_running) {
+        return true;
+    }
+    
+    // Stop accepting; requests already being handled go on. The socket is only
+    // closed for good if no replacement process inherited it, which then accepts
+    // the new connections instead.
+    std::cout << "Draining API Module server..." << std::endl;
+    m_running = false;
+    m_server->stop();
+    m_connectionProvider->stop();
+    if (m_serverThread.joinable()) {
+        m_serverThread.join();
+    }
+    if (m_handoff) {
+        m_handoff->releaseListener(m_host, m_port);
+        m_handoff = nullptr;
+    }
+    
+    while (m_requestsInFlight->load() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    bool drained = m_requestsInFlight->load() == 0;
+    
+    // Close idle keep-alive connections
+    m_connectionHandler->stop();
+    std::cout << "API Module server drained" << (drained ? "" : " (requests still in progress)") << std::endl;
+    return drained;
+}
+
 void ApiModule::shutdown() {
     stop();
     
@@ -145,6 +332,10 @@ void ApiModule::shutdown() {
     m_server.reset();
     m_connectionHandler.reset();
     m_connectionProvider.reset();
+    if (m_handoff) {
+        m_handoff->releaseListener(m_host, m_port);
+        m_handoff = nullptr;
+    }
     m_router.reset();
     m_httpHandler.reset();
     
@@ -155,7 +346,7 @@ void ApiModule::shutdown() {
 }
 
 std::string ApiModule::getName() const {
-    return "api";
+    return kModuleName;
 }
 
 std::string ApiModule::getVersion() const {
@@ -180,6 +371,12 @@ std::string ApiModule::getStatus() const {
     return oss.str();
 }
 
+void ApiModule::fillStatus(ModuleStatus& status) const {
+    status.counters["requests"] = static_cast<uint64_t>(m_requestCount.load());
+    status.gauges["connections"] = m_activeConnections.load();
+    status.gauges["requests_in_flight"] = m_requestsInFlight->load();
+}
+
 bool ApiModule::configure(const std::map<std::string, std::string>& config) {
     try {
         // Parse configuration
@@ -205,8 +402,8 @@ bool ApiModule::configure(const std::map<std::string, std::string>& config) {
         
         std::cout << "API Module configured - Host: " << m_host 
                   << ", Port: " << m_port 
-                  << ", Max Connections: " << m_maxConnections
-                  << ", CORS: " << (m_corsEnabled ? "enabled" : "disabled") << std::endl;
+                  << ", Max Connections: " << m_maxConnections.load()
+                  << ", CORS: " << (m_corsEnabled.load() ? "enabled" : "disabled") << std::endl;
         
         return true;
     } catch (const std::exception& e) {
@@ -215,6 +412,48 @@ bool ApiModule::configure(const std::map<std::string, std::string>& config) {
     }
 }
 
+bool ApiModule::validateConfig(const ConfigDiff& diff, std::string& error) const {
+    for (const auto& change : diff.changes()) {
+        if (change.key == "host" || change.key == "port") {
+            error = change.key + " cannot be changed while the server is bound, reload the module instead";
+            return false;
+        } else if (change.key == "max_connections") {
+            try {
+                size_t used = 0;
+                int value = std::stoi(change.newValue, &used);
+                if (used != change.newValue.size() || value <= 0) {
+                    error = "max_connections must be a positive integer";
+                    return false;
+                }
+            } catch (const std::exception&) {
+                error = "max_connections must be a positive integer";
+                return false;
+            }
+        } else if (change.key == "enable_cors") {
+            if (change.newValue != "true" && change.newValue != "false" &&
+                change.newValue != "1" && change.newValue != "0") {
+                error = "enable_cors must be true or false";
+                return false;
+            }
+        } else {
+            error = "unknown configuration key '" + change.key + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+void ApiModule::applyConfig(const ConfigDiff& diff) noexcept {
+    if (auto change = diff.find("max_connections")) {
+        setMaxConnections(std::stoi(change->newValue));
+    }
+    if (auto change = diff.find("enable_cors")) {
+        setCorsEnabled(change->newValue == "true" || change->newValue == "1");
+    }
+    std::cout << "API Module reconfigured - Max Connections: " << m_maxConnections.load()
+              << ", CORS: " << (m_corsEnabled.load() ? "enabled" : "disabled") << std::endl;
+}
+
 void ApiModule::onMessage(const std::string& topic, const std::string& message) {
     // Handle incoming messages from other modules
     std::cout << "API Module received message on topic '" << topic << "': " << message << std::endl;
@@ -0,0 +1,4 @@
+#include "core/plugin_api.h"
+#include "modules/api_module.h"
+
+SWARM_DECLARE_PLUGIN(swarm::ApiModule, swarm::ApiModule::kModuleName, "1.0.0")
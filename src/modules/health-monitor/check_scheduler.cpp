@@ -0,0 +1,145 @@
+#include "../../../include/modules/check_scheduler.h"
+#include <algorithm>
+
+namespace swarm {
+
+CheckScheduler::CheckScheduler(uint64_t seed) : random_(seed) {
+}
+
+void CheckScheduler::setJitter(double jitter) {
+    jitter_ = std::min(std::max(jitter, 0.0), 1.0);
+}
+
+void CheckScheduler::schedule(const std::string& name, std::chrono::milliseconds interval, TimePoint now) {
+    interval = std::max(interval, std::chrono::milliseconds(1));
+    auto it = entries_.find(name);
+    if (it == entries_.end() || it->second.removed) {
+        // A check added again while its previous run is in progress starts
+        // afresh but keeps that run, so it does not run twice at once
+        Entry& entry = entries_[name];
+        Entry fresh;
+        fresh.running = entry.running;
+        fresh.started = entry.started;
+        entry = fresh;
+        entry.interval = interval;
+        entry.slot = now;
+        entry.stats.interval = interval;
+        push(name, entry);
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (entry.interval == interval) {
+        return;
+    }
+    // The previous grid point plus the new interval; a running check keeps
+    // its next slot until it is taken again
+    entry.slot = std::max(entry.slot - entry.interval + interval, now);
+    entry.interval = interval;
+    entry.stats.interval = interval;
+    push(name, entry);
+}
+
+void CheckScheduler::remove(const std::string& name) {
+    auto it = entries_.find(name);
+    if (it == entries_.end()) {
+        return;
+    }
+    if (it->second.running) {
+        // Still counted as running until its run completes
+        it->second.removed = true;
+        it->second.generation = 0;
+        return;
+    }
+    entries_.erase(it);
+}
+
+std::vector<std::string> CheckScheduler::takeDue(TimePoint now) {
+    std::vector<std::string> due;
+    while (true) {
+        dropStale();
+        if (heap_.empty() || std::get<0>(heap_.top()) > now) {
+            break;
+        }
+        std::string name = std::get<2>(heap_.top());
+        heap_.pop();
+        Entry& entry = entries_.at(name);
+
+        if (entry.running) {
+            entry.stats.overruns++;
+        } else {
+            auto drift = std::chrono::duration_cast<std::chrono::microseconds>(now - entry.due);
+            entry.stats.runs++;
+            entry.stats.lastDrift = drift;
+            entry.stats.maxDrift = std::max(entry.stats.maxDrift, drift);
+            entry.stats.totalDrift += drift;
+            entry.started = now;
+            entry.running = true;
+            running_++;
+            due.push_back(name);
+        }
+
+        // Stay on the grid; slots already behind us are skipped, not run in a burst
+        entry.slot += entry.interval;
+        if (entry.slot <= now) {
+            auto behind = (now - entry.slot) / entry.interval + 1;
+            entry.stats.overruns += static_cast<uint64_t>(behind);
+            entry.slot += entry.interval * behind;
+        }
+        push(name, entry);
+    }
+    return due;
+}
+
+void CheckScheduler::complete(const std::string& name, TimePoint now) {
+    auto it = entries_.find(name);
+    if (it == entries_.end() || !it->second.running) {
+        return;
+    }
+    it->second.running = false;
+    it->second.stats.lastDuration = std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.started);
+    running_--;
+    if (it->second.removed) {
+        entries_.erase(it);
+    }
+}
+
+CheckScheduler::TimePoint CheckScheduler::nextDue() {
+    dropStale();
+    return heap_.empty() ? TimePoint::max() : std::get<0>(heap_.top());
+}
+
+std::map<std::string, CheckScheduleStats> CheckScheduler::getStats() const {
+    std::map<std::string, CheckScheduleStats> stats;
+    for (const auto& [name, entry] : entries_) {
+        if (entry.removed) {
+            continue;
+        }
+        stats[name] = entry.stats;
+        stats[name].nextDue = entry.due;
+    }
+    return stats;
+}
+
+void CheckScheduler::push(const std::string& name, Entry& entry) {
+    auto spread = std::chrono::duration_cast<std::chrono::microseconds>(entry.interval * jitter_);
+    entry.due = entry.slot;
+    if (spread.count() > 0) {
+        entry.due += std::chrono::microseconds(
+            std::uniform_int_distribution<int64_t>(0, spread.count() - 1)(random_));
+    }
+    entry.generation = nextGeneration_++;
+    heap_.emplace(entry.due, entry.generation, name);
+}
+
+void CheckScheduler::dropStale() {
+    while (!heap_.empty()) {
+        auto it = entries_.find(std::get<2>(heap_.top()));
+        if (it != entries_.end() && it->second.generation == std::get<1>(heap_.top())) {
+            return;
+        }
+        heap_.pop();
+    }
+}
+
+} // namespace swarm
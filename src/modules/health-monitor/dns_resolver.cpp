@@ -0,0 +1,365 @@
+#include "../../../include/modules/dns_resolver.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+#include <netdb.h>
+
+namespace swarm {
+
+namespace {
+
+constexpr size_t kMaxResponseSize = 4096;               // Room for a few hundred replicas
+constexpr size_t kMaxEntries = 4096;                    // Expired names are dropped beyond this
+constexpr auto kMinTtl = std::chrono::seconds(1);       // TTL 0 would mean a lookup per check
+constexpr uint16_t kTypeA = 1;
+constexpr uint16_t kTypeAAAA = 28;
+constexpr uint16_t kClassIN = 1;
+
+uint16_t read16(const unsigned char* data) {
+    return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t read32(const unsigned char* data) {
+    return static_cast<uint32_t>(read16(data)) << 16 | read16(data + 2);
+}
+
+/** Step over a possibly compressed name; false if it runs past the end */
+bool skipName(const unsigned char* message, size_t length, size_t& offset) {
+    while (offset < length) {
+        unsigned char label = message[offset];
+        if (label == 0) {
+            offset++;
+            return true;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            offset += 2;
+            return offset <= length;
+        }
+        if (label & 0xC0) {
+            return false;
+        }
+        offset += 1 + label;
+    }
+    return false;
+}
+
+ResolvedAddress fromIPv4(const void* bytes) {
+    ResolvedAddress resolved;
+    auto* address = reinterpret_cast<struct sockaddr_in*>(&resolved.address);
+    address->sin_family = AF_INET;
+    std::memcpy(&address->sin_addr, bytes, sizeof(address->sin_addr));
+    resolved.length = sizeof(struct sockaddr_in);
+    return resolved;
+}
+
+ResolvedAddress fromIPv6(const void* bytes) {
+    ResolvedAddress resolved;
+    auto* address = reinterpret_cast<struct sockaddr_in6*>(&resolved.address);
+    address->sin6_family = AF_INET6;
+    std::memcpy(&address->sin6_addr, bytes, sizeof(address->sin6_addr));
+    resolved.length = sizeof(struct sockaddr_in6);
+    return resolved;
+}
+
+} // namespace
+
+void ResolvedAddress::setPort(uint16_t port) {
+    if (address.ss_family == AF_INET) {
+        reinterpret_cast<struct sockaddr_in*>(&address)->sin_port = htons(port);
+    } else if (address.ss_family == AF_INET6) {
+        reinterpret_cast<struct sockaddr_in6*>(&address)->sin6_port = htons(port);
+    }
+}
+
+std::string ResolvedAddress::toString() const {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (address.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(&address)->sin_addr, text, sizeof(text));
+    } else if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(&address)->sin6_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+DnsResolver::DnsResolver(size_t threads, std::shared_ptr<Clock> clock)
+    : clock_(std::move(clock)), threadCount_(std::max<size_t>(threads, 1)), lookup_(&DnsResolver::systemLookup) {
+}
+
+DnsResolver::~DnsResolver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+
+    // Nobody is left to look these up
+    DnsAnswer stopped;
+    stopped.error = "DNS resolver stopped";
+    for (auto& [host, callbacks] : waiting_) {
+        for (auto& callback : callbacks) {
+            callback(stopped);
+        }
+    }
+}
+
+bool DnsResolver::lookup(const std::string& host, DnsAnswer& answer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(host);
+    if (it == cache_.end() || it->second.expires <= clock_->now()) {
+        return false;
+    }
+    answer = it->second.answer;
+    if (answer.addresses.empty()) {
+        stats_.negativeHits++;
+    } else {
+        stats_.hits++;
+    }
+    return true;
+}
+
+void DnsResolver::resolve(const std::string& host, Callback onResolved) {
+    DnsAnswer cached;
+    if (lookup(host, cached)) {
+        onResolved(cached);
+        return;
+    }
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_) {
+            queued = true;
+            auto it = waiting_.find(host);
+            if (it != waiting_.end()) {
+                stats_.coalesced++;
+                it->second.push_back(std::move(onResolved));
+                return;
+            }
+            waiting_[host].push_back(std::move(onResolved));
+            queue_.push_back(host);
+            while (threads_.size() < threadCount_ && threads_.size() < queue_.size()) {
+                threads_.emplace_back([this]() { work(); });
+            }
+        }
+    }
+    if (!queued) {
+        cached.error = "DNS resolver stopped";
+        onResolved(cached);
+        return;
+    }
+    wake_.notify_one();
+}
+
+void DnsResolver::setLookup(Lookup lookup) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lookup_ = std::move(lookup);
+}
+
+void DnsResolver::setTtls(std::chrono::milliseconds maxTtl, std::chrono::milliseconds negativeTtl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxTtl_ = std::max<std::chrono::milliseconds>(maxTtl, kMinTtl);
+    negativeTtl_ = std::max<std::chrono::milliseconds>(negativeTtl, kMinTtl);
+}
+
+void DnsResolver::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+}
+
+DnsCacheStats DnsResolver::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DnsCacheStats stats = stats_;
+    stats.entries = cache_.size();
+    return stats;
+}
+
+void DnsResolver::work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (stopping_) {
+            return;
+        }
+        std::string host = queue_.front();
+        queue_.pop_front();
+        Lookup lookup = lookup_;
+
+        lock.unlock();
+        DnsAnswer answer;
+        try {
+            answer = lookup(host);
+        } catch (const std::exception& e) {
+            answer = DnsAnswer();
+            answer.error = e.what();
+        }
+        lock.lock();
+
+        stats_.lookups++;
+        store(host, answer);
+        std::vector<Callback> callbacks;
+        auto it = waiting_.find(host);
+        if (it != waiting_.end()) {
+            callbacks.swap(it->second);
+            waiting_.erase(it);
+        }
+
+        lock.unlock();
+        for (auto& callback : callbacks) {
+            try {
+                callback(answer);
+            } catch (const std::exception& e) {
+                std::cerr << "DnsResolver: callback for " << host << " failed: " << e.what() << std::endl;
+            }
+        }
+        lock.lock();
+    }
+}
+
+void DnsResolver::store(const std::string& host, DnsAnswer& answer) {
+    auto now = clock_->now();
+    if (cache_.size() >= kMaxEntries) {
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            it = it->second.expires <= now ? cache_.erase(it) : std::next(it);
+        }
+    }
+
+    Entry& entry = cache_[host];
+    if (!answer.addresses.empty()) {
+        std::chrono::milliseconds ttl = maxTtl_;
+        if (answer.ttl.count() >= 0) {
+            ttl = std::min<std::chrono::milliseconds>(std::max<std::chrono::milliseconds>(answer.ttl, kMinTtl), maxTtl_);
+        }
+        entry.answer = answer;
+        entry.expires = now + ttl;
+        return;
+    }
+
+    // The name may still exist while its servers do not answer
+    if (!answer.notFound && !entry.answer.addresses.empty()) {
+        stats_.stale++;
+        answer = entry.answer;
+    } else {
+        entry.answer = answer;
+    }
+    entry.expires = now + negativeTtl_;
+}
+
+DnsAnswer DnsResolver::systemLookup(const std::string& host) {
+    DnsAnswer answer;
+    int error = 0;
+    bool notFound = true;
+    struct __res_state state {};
+    if (res_ninit(&state) == 0) {
+        for (uint16_t type : {kTypeA, kTypeAAAA}) {
+            unsigned char response[kMaxResponseSize];
+            int length = res_nsearch(&state, host.c_str(), kClassIN, type, response, sizeof(response));
+            if (length > 0) {
+                parseResponse(response, static_cast<size_t>(std::min<int>(length, sizeof(response))), answer);
+                notFound = false;
+            } else {
+                error = state.res_h_errno;
+                notFound = notFound && (error == HOST_NOT_FOUND || error == NO_DATA);
+            }
+        }
+        res_nclose(&state);
+    }
+    if (!answer.addresses.empty()) {
+        return answer;
+    }
+
+    // /etc/hosts and other name services; no TTL
+    struct addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* found = nullptr;
+    int result = getaddrinfo(host.c_str(), nullptr, &hints, &found);
+    if (result != 0 || !found) {
+        answer.ttl = std::chrono::seconds(-1);
+        answer.notFound = notFound && (result == EAI_NONAME
+#ifdef EAI_NODATA
+                                       || result == EAI_NODATA
+#endif
+                                       );
+        answer.error = result != 0 ? gai_strerror(result) : "no addresses";
+        return answer;
+    }
+    for (struct addrinfo* entry = found; entry; entry = entry->ai_next) {
+        if (entry->ai_family == AF_INET) {
+            answer.addresses.push_back(fromIPv4(&reinterpret_cast<struct sockaddr_in*>(entry->ai_addr)->sin_addr));
+        } else if (entry->ai_family == AF_INET6) {
+            answer.addresses.push_back(fromIPv6(&reinterpret_cast<struct sockaddr_in6*>(entry->ai_addr)->sin6_addr));
+        }
+    }
+    freeaddrinfo(found);
+    std::stable_partition(answer.addresses.begin(), answer.addresses.end(),
+                          [](const ResolvedAddress& address) { return address.family() == AF_INET; });
+    answer.ttl = std::chrono::seconds(-1);
+    return answer;
+}
+
+bool DnsResolver::parseResponse(const unsigned char* message, size_t length, DnsAnswer& answer) {
+    if (length < 12 || (message[3] & 0x0F) != 0) {
+        return false;
+    }
+    size_t questions = read16(message + 4);
+    size_t records = read16(message + 6);
+    size_t offset = 12;
+    for (size_t i = 0; i < questions; i++) {
+        if (!skipName(message, length, offset) || offset + 4 > length) {
+            return false;
+        }
+        offset += 4;
+    }
+
+    // CNAME records lead to the addresses further down the answer section
+    for (size_t i = 0; i < records; i++) {
+        if (!skipName(message, length, offset) || offset + 10 > length) {
+            return false;
+        }
+        uint16_t type = read16(message + offset);
+        uint16_t recordClass = read16(message + offset + 2);
+        std::chrono::seconds ttl(read32(message + offset + 4) & 0x7FFFFFFF);
+        size_t dataLength = read16(message + offset + 8);
+        offset += 10;
+        if (offset + dataLength > length) {
+            return false;
+        }
+        if (recordClass == kClassIN && (type == kTypeA || type == kTypeAAAA)) {
+            if (type == kTypeA && dataLength == 4) {
+                answer.addresses.push_back(fromIPv4(message + offset));
+            } else if (type == kTypeAAAA && dataLength == 16) {
+                answer.addresses.push_back(fromIPv6(message + offset));
+            }
+        }
+        if (answer.ttl.count() < 0 || ttl < answer.ttl) {
+            answer.ttl = ttl;
+        }
+        offset += dataLength;
+    }
+    return true;
+}
+
+bool DnsResolver::parseLiteral(const std::string& host, ResolvedAddress& address) {
+    unsigned char bytes[16];
+    if (host == "localhost" || inet_pton(AF_INET, host.c_str(), bytes) == 1) {
+        if (host == "localhost") {
+            inet_pton(AF_INET, "127.0.0.1", bytes);
+        }
+        address = fromIPv4(bytes);
+        return true;
+    }
+    if (inet_pton(AF_INET6, host.c_str(), bytes) == 1) {
+        address = fromIPv6(bytes);
+        return true;
+    }
+    return false;
+}
+
+} // namespace swarm
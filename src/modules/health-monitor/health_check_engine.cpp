@@ -0,0 +1,1301 @@
+#include "../../../include/modules/health_check_engine.h"
+#include "../../../include/modules/io_uring_queue.h"
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <cctype>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace swarm {
+
+namespace {
+
+constexpr int kDefaultTimeoutMs = 5000;
+constexpr int kDefaultPort = 8081;                       // For targets without one; the port the docker deployments publish
+constexpr size_t kMaxEvents = 256;
+constexpr unsigned kRingEntries = 4096;
+constexpr size_t kBufferSize = 256;                      // Any response byte makes a check healthy
+constexpr size_t kBufferSlots = 1024;
+
+// Low bits of io_uring user data: what completed. The check's identifier is
+// shifted above them; identifier 0 is the wake-up read.
+constexpr uint64_t kOperation = 0;
+constexpr uint64_t kTimeout = 1;
+constexpr uint64_t kCancel = 2;
+constexpr uint64_t kResolveTimeout = 3;
+constexpr unsigned kKindBits = 2;
+
+// Keep-alive connections are told apart from checks in epoll data by this bit
+constexpr uint64_t kConnectionFlag = uint64_t(1) << 63;
+constexpr size_t kPipelineDepth = 8;                     // Requests queued on one connection
+constexpr auto kIdleTimeout = std::chrono::seconds(30);  // Below common server keep-alive timeouts
+constexpr unsigned kMaxAttempts = 3;                     // Connections a request is sent on
+
+/** In-flight limit for a requested limit of 0: half the descriptor limit */
+size_t resolveMaxInFlight(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    struct rlimit limit {};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+        return 65536;
+    }
+    return std::max<size_t>(limit.rlim_cur / 2, 16);
+}
+
+/** Split "http://host:port/path" or "host:port" */
+bool parseEndpoint(const std::string& endpoint, bool http, std::string& host, int& port, std::string& path) {
+    std::string rest = endpoint;
+    if (http && rest.compare(0, 7, "http://") == 0) {
+        rest = rest.substr(7);
+    }
+    path = "/health";
+    if (http) {
+        size_t slash = rest.find('/');
+        if (slash != std::string::npos) {
+            path = rest.substr(slash);
+            rest = rest.substr(0, slash);
+        }
+    }
+
+    // IPv6 addresses are bracketed, "[fd00::5]:8080"
+    port = kDefaultPort;
+    size_t colon = rest.rfind(':');
+    if (!rest.empty() && rest[0] == '[') {
+        size_t bracket = rest.find(']');
+        if (bracket == std::string::npos || (bracket + 1 < rest.size() && rest[bracket + 1] != ':')) {
+            return false;
+        }
+        host = rest.substr(1, bracket - 1);
+        colon = bracket + 1 < rest.size() ? bracket + 1 : std::string::npos;
+    } else {
+        host = rest.substr(0, colon);
+    }
+    if (colon != std::string::npos) {
+        try {
+            size_t used = 0;
+            port = std::stoi(rest.substr(colon + 1), &used);
+            if (used != rest.size() - colon - 1) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !host.empty() && port > 0 && port < 65536;
+}
+
+/** Whether a host could be a DNS name, so worth a lookup */
+bool isHostName(const std::string& host) {
+    if (host.empty() || host.size() > 253) {
+        return false;
+    }
+    return std::all_of(host.begin(), host.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '.' || c == '_';
+    });
+}
+
+} // namespace
+
+const char* toString(CheckBackend backend) {
+    switch (backend) {
+        case CheckBackend::Auto: return "auto";
+        case CheckBackend::Epoll: return "epoll";
+        case CheckBackend::IoUring: return "io_uring";
+    }
+    return "unknown";
+}
+
+bool parseCheckBackend(const std::string& name, CheckBackend& backend) {
+    for (CheckBackend candidate : {CheckBackend::Auto, CheckBackend::Epoll, CheckBackend::IoUring}) {
+        if (name == toString(candidate)) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+HealthCheckEngine::HealthCheckEngine(size_t maxInFlight, CheckBackend backend)
+    : maxInFlight_(resolveMaxInFlight(maxInFlight)), backend_(backend), resolver_(std::make_unique<DnsResolver>()) {
+}
+
+HealthCheckEngine::~HealthCheckEngine() {
+    // Its threads answer into resolved_ and wake the loop
+    resolver_.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        (void)write(wakeFd_, &one, sizeof(one));
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ring_.reset();
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+    }
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+    }
+}
+
+void HealthCheckEngine::submit(const HealthCheckConfig& config, CompletionHandler onComplete) {
+    auto check = std::make_unique<Check>();
+    check->config = config;
+    check->onComplete = std::move(onComplete);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_ && ensureStarted()) {
+            waiting_.push_back(std::move(check));
+            pending_++;
+        }
+    }
+
+    if (check) {
+        if (check->onComplete) {
+            check->onComplete({config.moduleName, false, "Error", std::chrono::system_clock::now(),
+                               std::chrono::milliseconds(0), "Health check engine unavailable"});
+        }
+        return;
+    }
+    uint64_t one = 1;
+    (void)write(wakeFd_, &one, sizeof(one));
+}
+
+std::vector<HealthCheckResult> HealthCheckEngine::runAll(const std::vector<HealthCheckConfig>& configs) {
+    std::vector<HealthCheckResult> results(configs.size());
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = configs.size();
+
+    for (size_t i = 0; i < configs.size(); i++) {
+        submit(configs[i], [&, i](const HealthCheckResult& result) {
+            // Notified under the lock, so the waiter cannot return and destroy
+            // the condition variable before notify_all() is done with it
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = result;
+            if (--remaining == 0) {
+                done.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining]() { return remaining == 0; });
+    return results;
+}
+
+void HealthCheckEngine::setMaxInFlight(size_t maxInFlight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxInFlight_ = resolveMaxInFlight(maxInFlight);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        (void)write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+size_t HealthCheckEngine::getPending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+bool HealthCheckEngine::setBackend(CheckBackend backend) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) {
+        return false;
+    }
+    backend_ = backend;
+    return true;
+}
+
+CheckBackend HealthCheckEngine::getBackend() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return backend_;
+}
+
+void HealthCheckEngine::setKeepAlive(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    keepAlive_ = enabled;
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        (void)write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+void HealthCheckEngine::setMaxConnectionsPerTarget(size_t maxConnections) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxConnectionsPerTarget_ = std::max<size_t>(maxConnections, 1);
+}
+
+ConnectionPoolStats HealthCheckEngine::getConnectionStats() const {
+    ConnectionPoolStats stats;
+    stats.opened = opened_;
+    stats.reused = reused_;
+    stats.pipelined = pipelined_;
+    stats.stale = stale_;
+    stats.retried = retried_;
+    stats.idle = idleCount_;
+    return stats;
+}
+
+bool HealthCheckEngine::ensureStarted() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    if (backend_ != CheckBackend::Epoll) {
+        std::string error = "not built with io_uring support";
+#ifdef SWARM_HAVE_IO_URING
+        auto ring = std::make_unique<IoUringQueue>();
+        if (ring->setup(kRingEntries, error)) {
+            // Blocking: io_uring would fail a read of a non-blocking eventfd
+            // instead of waiting for it
+            wakeFd_ = eventfd(0, EFD_CLOEXEC);
+            if (wakeFd_ >= 0) {
+                buffers_.resize(kBufferSize * kBufferSlots);
+                if (ring->registerBuffer(buffers_.data(), buffers_.size())) {
+                    for (size_t slot = kBufferSlots; slot > 0; slot--) {
+                        freeSlots_.push_back(static_cast<int>(slot - 1));
+                    }
+                }
+                ring_ = std::move(ring);
+                backend_ = CheckBackend::IoUring;
+                thread_ = std::thread([this]() { loop(); });
+                return true;
+            }
+            error = std::string("cannot create eventfd: ") + std::strerror(errno);
+        }
+#endif
+        if (backend_ == CheckBackend::IoUring) {
+            std::cerr << "HealthCheckEngine: io_uring unavailable, using epoll: " << error << std::endl;
+        }
+    }
+    backend_ = CheckBackend::Epoll;
+
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    if (epollFd_ < 0 || wakeFd_ < 0 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event) < 0) {
+        std::cerr << "HealthCheckEngine: cannot create epoll instance: " << std::strerror(errno) << std::endl;
+        if (epollFd_ >= 0) {
+            close(epollFd_);
+        }
+        if (wakeFd_ >= 0) {
+            close(wakeFd_);
+        }
+        epollFd_ = wakeFd_ = -1;
+        return false;
+    }
+
+    thread_ = std::thread([this]() { loop(); });
+    return true;
+}
+
+void HealthCheckEngine::loop() {
+    if (ring_) {
+        loopUring();
+    } else {
+        loopEpoll();
+    }
+    cancelAll();
+}
+
+bool HealthCheckEngine::takeStarting(std::vector<std::unique_ptr<Check>>& starting,
+                                     std::vector<std::pair<uint64_t, DnsAnswer>>& resolved) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return false;
+    }
+    resolved.swap(resolved_);
+    pooling_ = keepAlive_ && !ring_;
+    poolLimit_ = maxConnectionsPerTarget_;
+    while (!waiting_.empty() && active_.size() + starting.size() < maxInFlight_) {
+        starting.push_back(std::move(waiting_.front()));
+        waiting_.pop_front();
+    }
+    return true;
+}
+
+void HealthCheckEngine::loopEpoll() {
+    struct epoll_event events[kMaxEvents];
+    while (true) {
+        std::vector<std::unique_ptr<Check>> starting;
+        std::vector<std::pair<uint64_t, DnsAnswer>> resolved;
+        if (!takeStarting(starting, resolved)) {
+            break;
+        }
+        // Checks that timed out while resolving are gone
+        for (const auto& [id, answer] : resolved) {
+            auto it = active_.find(id);
+            if (it != active_.end() && it->second->phase == Phase::Resolving) {
+                useAnswer(*it->second, answer);
+            }
+        }
+        for (auto& check : starting) {
+            startCheck(std::move(check));
+        }
+        while (!pooling_ && !idleExpiry_.empty()) {
+            closeConnection(*connections_.at(idleExpiry_.begin()->second), false, "", "");
+        }
+
+        int timeout = -1;
+        if (!deadlines_.empty() || !idleExpiry_.empty()) {
+            auto next = std::chrono::steady_clock::time_point::max();
+            if (!deadlines_.empty()) {
+                next = deadlines_.begin()->first;
+            }
+            if (!idleExpiry_.empty()) {
+                next = std::min(next, idleExpiry_.begin()->first);
+            }
+            auto remaining = next - std::chrono::steady_clock::now();
+            // Rounded up, so an early wake-up does not spin until the deadline
+            timeout = static_cast<int>(std::max<int64_t>(
+                std::chrono::ceil<std::chrono::milliseconds>(remaining).count(), 0));
+        }
+
+        waits_++;
+        int count = epoll_wait(epollFd_, events, kMaxEvents, timeout);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "HealthCheckEngine: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 == 0) {
+                uint64_t value = 0;
+                (void)read(wakeFd_, &value, sizeof(value));
+                continue;
+            }
+            // A check or connection finished earlier in this batch is gone
+            if (events[i].data.u64 & kConnectionFlag) {
+                auto connection = connections_.find(events[i].data.u64 & ~kConnectionFlag);
+                if (connection != connections_.end()) {
+                    handleConnectionEvent(*connection->second, events[i].events);
+                }
+                continue;
+            }
+            auto it = active_.find(events[i].data.u64);
+            if (it != active_.end()) {
+                handleEvent(*it->second, events[i].events);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            timeOut(*active_.at(deadlines_.begin()->second));
+        }
+        while (!idleExpiry_.empty() && idleExpiry_.begin()->first <= now) {
+            closeConnection(*connections_.at(idleExpiry_.begin()->second), false, "", "");
+        }
+    }
+}
+
+void HealthCheckEngine::loopUring() {
+#ifdef SWARM_HAVE_IO_URING
+    auto reap = [this](uint64_t userData, int result) { handleCompletion(userData, result); };
+    queueWake();
+    while (true) {
+        std::vector<std::unique_ptr<Check>> starting;
+        std::vector<std::pair<uint64_t, DnsAnswer>> resolved;
+        if (!takeStarting(starting, resolved)) {
+            break;
+        }
+        // Checks that timed out while resolving are gone
+        for (const auto& [id, answer] : resolved) {
+            auto it = active_.find(id);
+            if (it != active_.end() && it->second->phase == Phase::Resolving) {
+                useAnswer(*it->second, answer);
+            }
+        }
+        for (auto& check : starting) {
+            startCheck(std::move(check));
+        }
+
+        // Every operation queued above goes to the kernel in this one call
+        waits_++;
+        int result = ring_->submit(1);
+        if (result < 0 && result != -EBUSY && result != -EAGAIN) {
+            std::cerr << "HealthCheckEngine: io_uring_enter failed: " << std::strerror(-result) << std::endl;
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            break;
+        }
+        ring_->reap(reap);
+    }
+
+    // The kernel still refers to the checks' addresses and buffers
+    draining_ = true;
+    std::vector<uint64_t> targets{kOperation};
+    for (const auto& [id, check] : active_) {
+        targets.push_back(id << kKindBits | (check->resolveTimer ? kResolveTimeout : kOperation));
+    }
+    for (uint64_t target : targets) {
+        struct io_uring_sqe* sqe = ring_->getSqe();
+        if (!sqe) {
+            ring_->submit(0);
+            sqe = ring_->getSqe();
+        }
+        if (sqe) {
+            bool timer = (target & ((1u << kKindBits) - 1)) == kResolveTimeout;
+            sqe->opcode = timer ? IORING_OP_TIMEOUT_REMOVE : IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = target;
+            sqe->user_data = kCancel;
+        }
+    }
+    while (ringInFlight_ > 0) {
+        if (ring_->submit(1) < 0) {
+            break;
+        }
+        ring_->reap(reap);
+    }
+#endif
+}
+
+void HealthCheckEngine::cancelAll() {
+    // Complete everything left, so no caller waits forever
+    draining_ = true;
+    std::deque<std::unique_ptr<Check>> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        waiting.swap(waiting_);
+    }
+    for (auto& check : waiting) {
+        check->id = nextId_++;
+        check->started = std::chrono::steady_clock::now();
+        active_[check->id] = std::move(check);
+    }
+    while (!active_.empty()) {
+        finish(*active_.begin()->second, false, "Cancelled", "Health check engine stopped");
+    }
+    while (!connections_.empty()) {
+        closeConnection(*connections_.begin()->second, false, "", "");
+    }
+}
+
+void HealthCheckEngine::startCheck(std::unique_ptr<Check> owned) {
+    Check& check = *owned;
+    check.id = nextId_++;
+    check.started = std::chrono::steady_clock::now();
+    check.deadline = check.started + std::chrono::milliseconds(
+        check.config.timeoutMs > 0 ? check.config.timeoutMs : kDefaultTimeoutMs);
+    active_[check.id] = std::move(owned);
+    if (!ring_) {
+        deadlines_.emplace(check.deadline, check.id);
+    }
+
+    bool http = check.config.checkType == "http";
+    if (!http && check.config.checkType != "tcp") {
+        finish(check, false, "Unknown check type", "Unsupported check type: " + check.config.checkType);
+        return;
+    }
+
+    std::string host, path;
+    int port = 0;
+    if (!parseEndpoint(check.config.endpoint, http, host, port, path)) {
+        finish(check, false, "Invalid address", "Invalid endpoint: " + check.config.endpoint);
+        return;
+    }
+    check.host = host;
+    check.port = static_cast<uint16_t>(port);
+    check.target = (host.find(':') != std::string::npos ? "[" + host + "]" : host) + ":" + std::to_string(port);
+
+    // Pooled checks share the connections of their target
+    check.pooled = http && pooling_;
+    if (check.pooled) {
+        check.request = "GET " + path + " HTTP/1.1\r\nHost: " + check.target + "\r\n\r\n";
+    } else if (http) {
+        check.request = "GET " + path + " HTTP/1.1\r\nHost: " + check.target + "\r\nConnection: close\r\n\r\n";
+    }
+    if (ring_) {
+        auto sinceEpoch = check.deadline.time_since_epoch();
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+        check.deadlineSpec.tv_sec = static_cast<time_t>(seconds.count());
+        check.deadlineSpec.tv_nsec = static_cast<long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch - seconds).count());
+    }
+
+    DnsAnswer answer;
+    ResolvedAddress literal;
+    if (DnsResolver::parseLiteral(host, literal)) {
+        answer.addresses.push_back(literal);
+        useAnswer(check, answer);
+        return;
+    }
+    if (!isHostName(host)) {
+        finish(check, false, "Invalid address", "Invalid address: " + host);
+        return;
+    }
+    if (resolver_->lookup(host, answer)) {
+        useAnswer(check, answer);
+        return;
+    }
+
+    // The answer comes back through resolved_; the deadline keeps running
+    check.phase = Phase::Resolving;
+    if (ring_) {
+        queueResolveTimeout(check, false);
+    }
+    uint64_t id = check.id;
+    resolver_->resolve(host, [this, id](const DnsAnswer& resolved) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            resolved_.emplace_back(id, resolved);
+        }
+        uint64_t one = 1;
+        (void)write(wakeFd_, &one, sizeof(one));
+    });
+}
+
+void HealthCheckEngine::useAnswer(Check& check, const DnsAnswer& answer) {
+    if (check.resolveTimer) {
+        queueResolveTimeout(check, true);
+    }
+    if (answer.addresses.empty()) {
+        finish(check, false, "DNS resolution failed", "Failed to resolve hostname " + check.host + ": " + answer.error);
+        return;
+    }
+    // The answer and the resolve timeout may have arrived in the same round
+    if (std::chrono::steady_clock::now() >= check.deadline) {
+        timeOut(check);
+        return;
+    }
+
+    check.addresses = answer.addresses;
+    for (auto& address : check.addresses) {
+        address.setPort(check.port);
+    }
+    // Successive checks of a name with several addresses start at the next one
+    if (check.addresses.size() > 1) {
+        check.firstAddress = rotation_[check.host]++ % check.addresses.size();
+    }
+    connectCheck(check);
+}
+
+void HealthCheckEngine::connectCheck(Check& check) {
+    check.address = check.addresses[(check.firstAddress + check.addressesTried) % check.addresses.size()];
+    check.phase = Phase::Connecting;
+    check.sent = 0;
+    if (check.pooled) {
+        dispatch(check);
+        return;
+    }
+
+    // io_uring waits for blocking sockets itself; it fails operations on
+    // non-blocking ones instead
+    check.fd = socket(check.address.family(), SOCK_STREAM | SOCK_CLOEXEC | (ring_ ? 0 : SOCK_NONBLOCK), 0);
+    if (check.fd < 0) {
+        finish(check, false, "Socket creation failed", std::string("Failed to create socket: ") + std::strerror(errno));
+        return;
+    }
+    if (ring_) {
+        queueOperation(check);
+        return;
+    }
+
+    if (connect(check.fd, reinterpret_cast<struct sockaddr*>(&check.address.address), check.address.length) < 0 &&
+        errno != EINPROGRESS) {
+        int error = errno;
+        if (!tryNextAddress(check)) {
+            finish(check, false, "Connection failed", "Connection failed to " + check.target + ": " + std::strerror(error));
+        }
+        return;
+    }
+
+    // Writable once connected, also when connect() completed right away
+    struct epoll_event event {};
+    event.events = EPOLLOUT;
+    event.data.u64 = check.id;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, check.fd, &event) < 0) {
+        finish(check, false, "Socket creation failed", std::string("Failed to watch socket: ") + std::strerror(errno));
+    }
+}
+
+bool HealthCheckEngine::tryNextAddress(Check& check) {
+    if (++check.addressesTried >= check.addresses.size()) {
+        return false;
+    }
+    // Closing the only descriptor of the socket also removes it from the epoll set
+    close(check.fd);
+    check.fd = -1;
+    connectCheck(check);
+    return true;
+}
+
+void HealthCheckEngine::handleEvent(Check& check, uint32_t events) {
+    (void)events; // The socket calls below report the errors themselves
+    if (check.phase == Phase::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(check.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            if (!tryNextAddress(check)) {
+                finish(check, false, "Connection failed", "Connection failed to " + check.target + ": " + std::strerror(error));
+            }
+            return;
+        }
+        if (check.request.empty()) {
+            finish(check, true, "Healthy");
+            return;
+        }
+        check.phase = Phase::Sending;
+    }
+
+    if (check.phase == Phase::Sending) {
+        sendRequest(check);
+        return;
+    }
+
+    // Any response counts as healthy
+    char buffer[1024];
+    ssize_t received = recv(check.fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+        finish(check, true, "Healthy");
+    } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    } else {
+        finish(check, false, "No response", "No HTTP response received");
+    }
+}
+
+void HealthCheckEngine::sendRequest(Check& check) {
+    while (check.sent < check.request.size()) {
+        ssize_t sent = send(check.fd, check.request.data() + check.sent, check.request.size() - check.sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            finish(check, false, "HTTP request failed", std::string("Failed to send HTTP request: ") + std::strerror(errno));
+            return;
+        }
+        check.sent += static_cast<size_t>(sent);
+    }
+
+    check.phase = Phase::Receiving;
+    struct epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = check.id;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, check.fd, &event) < 0) {
+        finish(check, false, "HTTP request failed", std::string("Failed to watch socket: ") + std::strerror(errno));
+    }
+}
+
+void HealthCheckEngine::queueOperation(Check& check) {
+#ifdef SWARM_HAVE_IO_URING
+    // The operation and its timeout must go to the kernel in the same call,
+    // or the link between them is lost
+    if (ring_->getSpace() < 2) {
+        ring_->submit(0);
+    }
+    if (ring_->getSpace() < 2) {
+        finish(check, false, "Socket creation failed", "io_uring submission queue is full");
+        return;
+    }
+
+    struct io_uring_sqe* sqe = ring_->getSqe();
+    sqe->fd = check.fd;
+    sqe->user_data = check.id << kKindBits | kOperation;
+    sqe->flags = IOSQE_IO_LINK;
+    if (check.phase == Phase::Connecting) {
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = reinterpret_cast<uint64_t>(&check.address.address);
+        sqe->off = check.address.length;
+    } else if (check.phase == Phase::Sending) {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->addr = reinterpret_cast<uint64_t>(check.request.data() + check.sent);
+        sqe->len = static_cast<uint32_t>(check.request.size() - check.sent);
+        sqe->msg_flags = MSG_NOSIGNAL;
+    } else if (check.bufferSlot >= 0 || !freeSlots_.empty()) {
+        if (check.bufferSlot < 0) {
+            check.bufferSlot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = reinterpret_cast<uint64_t>(buffers_.data() + check.bufferSlot * kBufferSize);
+        sqe->len = kBufferSize;
+        sqe->buf_index = 0;
+    } else {
+        if (!check.buffer) {
+            check.buffer = std::make_unique<char[]>(kBufferSize);
+        }
+        sqe->opcode = IORING_OP_RECV;
+        sqe->addr = reinterpret_cast<uint64_t>(check.buffer.get());
+        sqe->len = kBufferSize;
+    }
+    ringInFlight_++;
+
+    static_assert(sizeof(struct timespec) == sizeof(struct __kernel_timespec),
+                  "io_uring timeouts are passed as struct timespec");
+    struct io_uring_sqe* timeout = ring_->getSqe();
+    timeout->opcode = IORING_OP_LINK_TIMEOUT;
+    timeout->fd = -1;
+    timeout->addr = reinterpret_cast<uint64_t>(&check.deadlineSpec);
+    timeout->len = 1;
+    timeout->timeout_flags = IORING_TIMEOUT_ABS;
+    timeout->user_data = check.id << kKindBits | kTimeout;
+#else
+    finish(check, false, "Socket creation failed", "Not built with io_uring support");
+#endif
+}
+
+void HealthCheckEngine::queueResolveTimeout(Check& check, bool remove) {
+#ifdef SWARM_HAVE_IO_URING
+    struct io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) {
+        ring_->submit(0);
+        sqe = ring_->getSqe();
+    }
+    if (!sqe) {
+        // Without the timer the deadline is only checked once the answer arrives
+        std::cerr << "HealthCheckEngine: cannot queue resolve timeout of " << check.target << std::endl;
+        return;
+    }
+    uint64_t timer = check.id << kKindBits | kResolveTimeout;
+    sqe->fd = -1;
+    if (remove) {
+        sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        sqe->addr = timer;
+        sqe->user_data = kCancel;
+        check.resolveTimer = false;
+        return;
+    }
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = reinterpret_cast<uint64_t>(&check.deadlineSpec);
+    sqe->len = 1;
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+    sqe->user_data = timer;
+    check.resolveTimer = true;
+    ringInFlight_++;
+#else
+    (void)check;
+    (void)remove;
+#endif
+}
+
+void HealthCheckEngine::queueWake() {
+#ifdef SWARM_HAVE_IO_URING
+    struct io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) {
+        ring_->submit(0);
+        sqe = ring_->getSqe();
+    }
+    if (!sqe) {
+        std::cerr << "HealthCheckEngine: cannot queue wake-up read" << std::endl;
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue_);
+    sqe->len = sizeof(wakeValue_);
+    sqe->user_data = kOperation;
+    ringInFlight_++;
+#endif
+}
+
+void HealthCheckEngine::handleCompletion(uint64_t userData, int result) {
+    uint64_t kind = userData & ((1u << kKindBits) - 1);
+    uint64_t id = userData >> kKindBits;
+    if (kind == kResolveTimeout) {
+        // -ETIME when it fired; removed once the answer arrived
+        ringInFlight_--;
+        auto it = active_.find(id);
+        if (result == -ETIME && !draining_ && it != active_.end() && it->second->phase == Phase::Resolving) {
+            it->second->resolveTimer = false;
+            timeOut(*it->second);
+        }
+        return;
+    }
+    // Linked timeouts show up as cancelled operations, cancellations as their targets
+    if (kind != kOperation) {
+        return;
+    }
+    ringInFlight_--;
+    if (id == 0) {
+        if (!draining_) {
+            queueWake();
+        }
+        return;
+    }
+    auto it = active_.find(id);
+    if (it == active_.end()) {
+        return;
+    }
+    Check& check = *it->second;
+
+    if (draining_) {
+        finish(check, false, "Cancelled", "Health check engine stopped");
+    } else if (result == -ECANCELED) {
+        timeOut(check);
+    } else if (check.phase == Phase::Connecting) {
+        if (result < 0) {
+            if (!tryNextAddress(check)) {
+                finish(check, false, "Connection failed", "Connection failed to " + check.target + ": " + std::strerror(-result));
+            }
+        } else if (check.request.empty()) {
+            finish(check, true, "Healthy");
+        } else {
+            check.phase = Phase::Sending;
+            queueOperation(check);
+        }
+    } else if (check.phase == Phase::Sending) {
+        if (result < 0) {
+            finish(check, false, "HTTP request failed", std::string("Failed to send HTTP request: ") + std::strerror(-result));
+            return;
+        }
+        check.sent += static_cast<size_t>(result);
+        if (check.sent == check.request.size()) {
+            check.phase = Phase::Receiving;
+        }
+        queueOperation(check);
+    } else if (result > 0) {
+        // Any response counts as healthy
+        finish(check, true, "Healthy");
+    } else {
+        finish(check, false, "No response", "No HTTP response received");
+    }
+}
+
+void HealthCheckEngine::dispatch(Check& check) {
+    // An idle connection, unless the target closed it meanwhile. Closing one
+    // changes the pool, so it is looked up again every time. A request lost on
+    // a reused connection takes the place of an idle one instead.
+    Connection* chosen = nullptr;
+    for (size_t i = 0; !chosen;) {
+        auto pool = pools_.find(check.target);
+        if (pool == pools_.end() || i >= pool->second.size()) {
+            break;
+        }
+        Connection& connection = *connections_.at(pool->second[i]);
+        if (!connection.idle) {
+            i++;
+            continue;
+        }
+        if (check.fresh) {
+            if (pool->second.size() < poolLimit_) {
+                break;
+            }
+            closeConnection(connection, false, "", "");
+            continue;
+        }
+        char byte = 0;
+        ssize_t peeked = recv(connection.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            chosen = &connection;
+        } else {
+            // Closed, reset, or sending what nobody asked for
+            stale_++;
+            closeConnection(connection, false, "", "");
+        }
+    }
+
+    auto pool = pools_.find(check.target);
+    size_t open = pool != pools_.end() ? pool->second.size() : 0;
+    if (!chosen && open < poolLimit_) {
+        chosen = openConnection(check);
+        if (!chosen) {
+            return;
+        }
+    }
+
+    // The least busy connection known to keep responses alive
+    if (!chosen && !check.fresh && pool != pools_.end()) {
+        for (uint64_t id : pool->second) {
+            Connection& connection = *connections_.at(id);
+            if (connection.responses > 0 && connection.checks.size() < kPipelineDepth &&
+                (!chosen || connection.checks.size() < chosen->checks.size())) {
+                chosen = &connection;
+            }
+        }
+    }
+
+    if (!chosen) {
+        queued_[check.target].push_back(check.id);
+        check.queued = true;
+        return;
+    }
+    assign(check, *chosen);
+}
+
+HealthCheckEngine::Connection* HealthCheckEngine::openConnection(Check& check) {
+    auto owned = std::make_unique<Connection>();
+    Connection& connection = *owned;
+    connection.id = nextId_++;
+    connection.target = check.target;
+    connection.fd = socket(check.address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (connection.fd < 0) {
+        finish(check, false, "Socket creation failed", std::string("Failed to create socket: ") + std::strerror(errno));
+        return nullptr;
+    }
+    // Pipelined requests go out as they are assigned, Nagle would hold them
+    // back behind the unacknowledged first one
+    int noDelay = 1;
+    setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    if (connect(connection.fd, reinterpret_cast<struct sockaddr*>(&check.address.address), check.address.length) < 0 &&
+        errno != EINPROGRESS) {
+        int error = errno;
+        close(connection.fd);
+        finish(check, false, "Connection failed", "Connection failed to " + check.target + ": " + std::strerror(error));
+        return nullptr;
+    }
+
+    // Readable also while idle, so a close by the target is noticed
+    struct epoll_event event {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    event.data.u64 = connection.id | kConnectionFlag;
+    connection.writing = true;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, connection.fd, &event) < 0) {
+        int error = errno;
+        close(connection.fd);
+        finish(check, false, "Socket creation failed", std::string("Failed to watch socket: ") + std::strerror(error));
+        return nullptr;
+    }
+
+    opened_++;
+    pools_[connection.target].push_back(connection.id);
+    connections_[connection.id] = std::move(owned);
+    return &connection;
+}
+
+void HealthCheckEngine::assign(Check& check, Connection& connection) {
+    if (connection.responses > 0) {
+        reused_++;
+    }
+    if (!connection.checks.empty()) {
+        pipelined_++;
+    }
+    if (connection.idle) {
+        idleExpiry_.erase({connection.idleUntil, connection.id});
+        connection.idle = false;
+        idleCount_--;
+    }
+    check.connection = connection.id;
+    check.queued = false;
+    check.attempts++;
+    check.phase = Phase::Sending;
+    connection.checks.push_back(check.id);
+    connection.output += check.request;
+    if (connection.connected) {
+        flush(connection);
+    }
+}
+
+bool HealthCheckEngine::flush(Connection& connection) {
+    while (connection.sent < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.sent,
+                            connection.output.size() - connection.sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // A reused connection may have been closed by the target
+                closeConnection(connection, connection.responses > 0, "HTTP request failed",
+                                std::string("Failed to send HTTP request: ") + std::strerror(errno));
+                return false;
+            }
+            break;
+        }
+        connection.sent += static_cast<size_t>(sent);
+    }
+    if (connection.sent == connection.output.size()) {
+        connection.output.clear();
+        connection.sent = 0;
+    }
+
+    bool writing = !connection.output.empty();
+    if (writing != connection.writing) {
+        struct epoll_event event {};
+        event.events = EPOLLIN | EPOLLRDHUP | (writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.u64 = connection.id | kConnectionFlag;
+        epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.writing = writing;
+    }
+    return true;
+}
+
+void HealthCheckEngine::handleConnectionEvent(Connection& connection, uint32_t events) {
+    if (!connection.connected) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            // The request was never sent; the check moves on to the next address
+            bool retry = false;
+            if (!connection.checks.empty()) {
+                Check& check = *active_.at(connection.checks.front());
+                retry = ++check.addressesTried < check.addresses.size();
+                if (retry) {
+                    check.attempts--;
+                    check.address = check.addresses[(check.firstAddress + check.addressesTried) % check.addresses.size()];
+                }
+            }
+            closeConnection(connection, retry, "Connection failed",
+                            "Connection failed to " + connection.target + ": " + std::strerror(error));
+            return;
+        }
+        if (!(events & EPOLLOUT)) {
+            return;
+        }
+        connection.connected = true;
+    }
+    if ((events & EPOLLOUT) && !flush(connection)) {
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        readResponses(connection);
+    }
+}
+
+void HealthCheckEngine::readResponses(Connection& connection) {
+    uint64_t id = connection.id;
+    char buffer[4096];
+    while (true) {
+        ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (received <= 0) {
+            break;
+        }
+
+        size_t offset = 0;
+        while (offset < static_cast<size_t>(received)) {
+            if (connection.checks.empty()) {
+                closeConnection(connection, false, "", "");
+                return;
+            }
+            offset += connection.parser.feed(buffer + offset, static_cast<size_t>(received) - offset);
+            if (connection.parser.getState() == HttpResponseParser::State::Complete) {
+                if (!completeResponse(connection)) {
+                    return;
+                }
+            } else if (connection.parser.getState() == HttpResponseParser::State::Invalid) {
+                // Still a response, but the connection is out of step
+                Check& check = *active_.at(connection.checks.front());
+                connection.checks.pop_front();
+                check.connection = 0;
+                closeConnection(connection, true, "Connection failed", "Connection to " + connection.target + " closed");
+                finish(check, true, "Healthy");
+                return;
+            }
+        }
+        if (!connections_.count(id)) {
+            return;
+        }
+    }
+
+    // End of stream or error
+    connection.parser.finishAtClose();
+    if (!connection.checks.empty()) {
+        if (connection.parser.getState() == HttpResponseParser::State::Complete) {
+            completeResponse(connection);
+            return;
+        }
+        if (connection.parser.hasStarted()) {
+            // Any response counts as healthy
+            Check& check = *active_.at(connection.checks.front());
+            connection.checks.pop_front();
+            check.connection = 0;
+            closeConnection(connection, true, "No response", "No HTTP response received");
+            finish(check, true, "Healthy");
+            return;
+        }
+    } else {
+        stale_++;
+    }
+    // Without a response, requests on a reused connection are repeated
+    closeConnection(connection, connection.responses > 0, "No response", "No HTTP response received");
+}
+
+bool HealthCheckEngine::completeResponse(Connection& connection) {
+    uint64_t id = connection.id;
+    Check& check = *active_.at(connection.checks.front());
+    connection.checks.pop_front();
+    check.connection = 0;
+    bool reusable = connection.parser.isReusable() && pooling_;
+    connection.parser.reset();
+    connection.responses++;
+
+    if (reusable) {
+        release(connection);
+    } else {
+        // Requests pipelined behind this response are repeated
+        closeConnection(connection, true, "No response", "No HTTP response received");
+    }
+    finish(check, true, "Healthy");
+    return reusable && connections_.count(id) > 0;
+}
+
+void HealthCheckEngine::release(Connection& connection) {
+    uint64_t id = connection.id;
+    // Checks waiting for the target, pipelined now that the connection proved reusable
+    auto waiting = queued_.find(connection.target);
+    for (size_t i = 0; waiting != queued_.end() && i < waiting->second.size() &&
+                       connection.checks.size() < kPipelineDepth;) {
+        Check& check = *active_.at(waiting->second[i]);
+        if (check.fresh) {
+            i++;
+            continue;
+        }
+        waiting->second.erase(waiting->second.begin() + static_cast<std::ptrdiff_t>(i));
+        assign(check, connection);
+        if (!connections_.count(id)) {
+            return;
+        }
+        waiting = queued_.find(connection.target);
+    }
+    if (waiting != queued_.end() && waiting->second.empty()) {
+        queued_.erase(waiting);
+        waiting = queued_.end();
+    }
+    if (!connection.checks.empty() || connection.idle) {
+        return;
+    }
+    // Checks left waiting need a new connection, which takes this one's place
+    if (waiting != queued_.end() || pools_[connection.target].size() > poolLimit_) {
+        closeConnection(connection, false, "", "");
+        return;
+    }
+    connection.idle = true;
+    connection.idleUntil = std::chrono::steady_clock::now() + kIdleTimeout;
+    idleExpiry_.emplace(connection.idleUntil, connection.id);
+    idleCount_++;
+}
+
+void HealthCheckEngine::closeConnection(Connection& connection, bool retry, const std::string& status,
+                                        const std::string& error) {
+    auto it = connections_.find(connection.id);
+    std::unique_ptr<Connection> owned = std::move(it->second);
+    connections_.erase(it);
+    if (owned->idle) {
+        idleExpiry_.erase({owned->idleUntil, owned->id});
+        idleCount_--;
+    }
+    std::vector<uint64_t>& pool = pools_[owned->target];
+    pool.erase(std::find(pool.begin(), pool.end(), owned->id));
+    if (pool.empty()) {
+        pools_.erase(owned->target);
+    }
+    // Closing the only descriptor of the socket also removes it from the epoll set
+    close(owned->fd);
+
+    for (size_t i = 0; i < owned->checks.size(); i++) {
+        Check& check = *active_.at(owned->checks[i]);
+        check.connection = 0;
+        if (draining_) {
+            finish(check, false, "Cancelled", "Health check engine stopped");
+        } else if (i > 0) {
+            // Pipelined behind the lost response, so never looked at by the
+            // target; the repeat does not count as an attempt
+            check.attempts--;
+            retried_++;
+            dispatch(check);
+        } else if (retry && check.attempts < kMaxAttempts) {
+            retried_++;
+            check.fresh = true;
+            dispatch(check);
+        } else {
+            finish(check, false, status, error);
+        }
+    }
+
+    // A free place in the pool for a waiting check
+    std::string target = owned->target;
+    owned.reset();
+    auto waiting = queued_.find(target);
+    while (!draining_ && waiting != queued_.end() && !waiting->second.empty() &&
+           pools_[target].size() < poolLimit_) {
+        Check& check = *active_.at(waiting->second.front());
+        waiting->second.pop_front();
+        check.queued = false;
+        dispatch(check);
+        waiting = queued_.find(target);
+    }
+    if (waiting != queued_.end() && waiting->second.empty()) {
+        queued_.erase(waiting);
+    }
+    if (pools_.count(target) && pools_[target].empty()) {
+        pools_.erase(target);
+    }
+}
+
+void HealthCheckEngine::timeOut(Check& check) {
+    finish(check, false, "Timeout",
+           "No response from " + (check.target.empty() ? check.config.endpoint : check.target) +
+           " within " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+               check.deadline - check.started).count()) + " ms");
+}
+
+void HealthCheckEngine::finish(Check& check, bool healthy, const std::string& status, const std::string& error) {
+    auto it = active_.find(check.id);
+    std::unique_ptr<Check> owned = std::move(it->second);
+    active_.erase(it);
+    deadlines_.erase({owned->deadline, owned->id});
+    if (owned->bufferSlot >= 0) {
+        freeSlots_.push_back(owned->bufferSlot);
+    }
+    if (owned->queued) {
+        auto waiting = queued_.find(owned->target);
+        waiting->second.erase(std::find(waiting->second.begin(), waiting->second.end(), owned->id));
+        if (waiting->second.empty()) {
+            queued_.erase(waiting);
+        }
+    }
+    if (owned->connection != 0) {
+        // The response can no longer be told apart from the next one
+        Connection& connection = *connections_.at(owned->connection);
+        connection.checks.erase(std::find(connection.checks.begin(), connection.checks.end(), owned->id));
+        closeConnection(connection, true, "Connection failed", "Connection to " + connection.target + " closed");
+    }
+    // Closing the only descriptor of the socket also removes it from the epoll set
+    if (owned->fd >= 0) {
+        close(owned->fd);
+    }
+
+    HealthCheckResult result{owned->config.moduleName, healthy, status, std::chrono::system_clock::now(),
+                             std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - owned->started),
+                             error};
+    CompletionHandler onComplete = std::move(owned->onComplete);
+    owned.reset();
+    {
+        // Before the handler, which may be what a caller of getPending() waits for
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_--;
+    }
+
+    if (onComplete) {
+        try {
+            onComplete(result);
+        } catch (const std::exception& e) {
+            std::cerr << "HealthCheckEngine: completion handler failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+} // namespace swarm
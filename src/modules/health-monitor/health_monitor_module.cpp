@@ -1,25 +1,28 @@
 #include "../../../include/modules/health_monitor_module.h"
+#include "../../../include/modules/health_check_engine.h"
 #include "../../../include/core/message_bus.h"
+#include "../../../include/core/module_manager.h"
+#include "../../../include/core/state_codec.h"
 #include <iostream>
+#include <algorithm>
 #include <sstream>
-#include <cstring>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <netdb.h>
 #include <chrono>
 
 namespace swarm {
 
 HealthMonitorModule::HealthMonitorModule() 
-    : shouldStop_(false), totalChecks_(0), failedChecks_(0),
+    : clock_(Clock::system()), engine_(std::make_unique<HealthCheckEngine>()), shouldStop_(false), totalChecks_(0), failedChecks_(0),
       defaultTimeoutMs_(5000), defaultIntervalMs_(30000), maxFailures_(3),
       enableNotifications_(true) {
+    scheduler_.setJitter(0.1);
 }
 
 HealthMonitorModule::~HealthMonitorModule() {
     shutdown();
+    // Checks still in flight complete as cancelled while the members they
+    // report to still exist
+    discardResults_ = true;
+    engine_.reset();
 }
 
 bool HealthMonitorModule::initialize() {
@@ -31,7 +34,34 @@ void HealthMonitorModule::start() {
     
     running_ = true;
     shouldStop_ = false;
-    monitoringThread_ = std::thread(&HealthMonitorModule::monitoringLoop, this);
+    
+    if (moduleManager_) {
+        // Managed: checks run on the shared executor instead of a dedicated thread
+        clock_ = moduleManager_->getExecutor()->getClock();
+    }
+    {
+        // Start every check afresh in the clock's time
+        std::lock_guard<std::mutex> checksLock(healthChecksMutex_);
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        auto now = clock_->now();
+        for (const auto& [name, check] : healthChecks_) {
+            scheduler_.remove(name);
+            scheduler_.schedule(name, intervalOf(check), now);
+        }
+    }
+    
+    if (moduleManager_) {
+        if (!taskQueue_) {
+            taskQueue_ = moduleManager_->getExecutor()->createQueue(getName(), true);
+        }
+        taskQueue_->reopen();
+        taskQueue_->submit([this]() { runSupervised([this]() { runScheduledChecks(); }); });
+    } else {
+        monitoringThread_ = std::thread([this]() {
+            ResourceAccounting::attachThread(getName());
+            runSupervised([this]() { monitoringLoop(); });
+        });
+    }
     
     std::cout << "Health Monitor started" << std::endl;
 }
@@ -39,9 +69,16 @@ void HealthMonitorModule::start() {
 void HealthMonitorModule::stop() {
     if (!running_) return;
     
-    shouldStop_ = true;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        shouldStop_ = true;
+    }
+    wakeCondition_.notify_all();
     running_ = false;
     
+    if (taskQueue_) {
+        taskQueue_->close();
+    }
     if (monitoringThread_.joinable()) {
         monitoringThread_.join();
     }
@@ -49,6 +86,16 @@ void HealthMonitorModule::stop() {
     std::cout << "Health Monitor stopped" << std::endl;
 }
 
+bool HealthMonitorModule::drain(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    shouldStop_ = true;
+    if (taskQueue_ && nextChecks_ != 0 && taskQueue_->cancel(nextChecks_)) {
+        nextChecks_ = 0;
+    }
+    wakeCondition_.notify_all();
+    return wakeCondition_.wait_until(lock, deadline, [this]() { return scheduler_.getRunning() == 0; });
+}
+
 void HealthMonitorModule::shutdown() {
     stop();
 }
@@ -61,6 +108,46 @@ std::string HealthMonitorModule::getStatus() const {
     return status.str();
 }
 
+void HealthMonitorModule::fillStatus(ModuleStatus& status) const {
+    status.counters["checks"] = totalChecks_.load();
+    status.counters["failed_checks"] = failedChecks_.load();
+    status.gauges["success_rate"] = getSuccessRate();
+    
+    uint64_t overruns = 0;
+    std::chrono::microseconds maxDrift{0};
+    for (const auto& [name, stats] : getScheduleStats()) {
+        overruns += stats.overruns;
+        maxDrift = std::max(maxDrift, stats.maxDrift);
+    }
+    status.counters["check_overruns"] = overruns;
+    status.gauges["max_check_drift_ms"] = maxDrift.count() / 1000.0;
+    
+    ConnectionPoolStats connections = engine_->getConnectionStats();
+    status.counters["http_connections_opened"] = connections.opened;
+    status.counters["http_connections_reused"] = connections.reused;
+    status.gauges["http_connections_idle"] = static_cast<double>(connections.idle);
+    
+    DnsCacheStats dns = engine_->getResolver().getStats();
+    status.counters["dns_cache_hits"] = dns.hits + dns.negativeHits;
+    status.counters["dns_lookups"] = dns.lookups;
+    status.gauges["dns_cache_entries"] = static_cast<double>(dns.entries);
+    
+    std::lock_guard<std::mutex> lock(healthStatusMutex_);
+    size_t unhealthy = 0;
+    std::chrono::system_clock::time_point latestFailure;
+    for (const auto& [name, result] : healthStatus_) {
+        if (!result.healthy) {
+            unhealthy++;
+            if (result.lastCheck >= latestFailure) {
+                latestFailure = result.lastCheck;
+                status.lastError = name + ": " + result.errorMessage;
+            }
+        }
+    }
+    status.gauges["services"] = static_cast<double>(healthStatus_.size());
+    status.gauges["unhealthy_services"] = static_cast<double>(unhealthy);
+}
+
 bool HealthMonitorModule::configure(const std::map<std::string, std::string>& config) {
     auto it = config.find("default_timeout_ms");
     if (it != config.end()) {
@@ -82,19 +169,294 @@ bool HealthMonitorModule::configure(const std::map<std::string, std::string>& co
         enableNotifications_ = (it->second == "true" || it->second == "1");
     }
     
+    it = config.find("max_concurrent_checks");
+    if (it != config.end()) {
+        engine_->setMaxInFlight(std::stoul(it->second));
+    }
+    
+    it = config.find("check_jitter");
+    if (it != config.end()) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        scheduler_.setJitter(std::stod(it->second));
+    }
+    
+    it = config.find("http_keep_alive");
+    if (it != config.end()) {
+        engine_->setKeepAlive(it->second == "true" || it->second == "1");
+    }
+    
+    it = config.find("max_connections_per_target");
+    if (it != config.end()) {
+        engine_->setMaxConnectionsPerTarget(std::stoul(it->second));
+    }
+    
+    it = config.find("dns_max_ttl_ms");
+    if (it != config.end()) {
+        dnsMaxTtlMs_ = std::stoi(it->second);
+    }
+    
+    it = config.find("dns_negative_ttl_ms");
+    if (it != config.end()) {
+        dnsNegativeTtlMs_ = std::stoi(it->second);
+    }
+    engine_->getResolver().setTtls(std::chrono::milliseconds(dnsMaxTtlMs_.load()),
+                                   std::chrono::milliseconds(dnsNegativeTtlMs_.load()));
+    
+    it = config.find("check_backend");
+    if (it != config.end()) {
+        CheckBackend backend = CheckBackend::Epoll;
+        if (!parseCheckBackend(it->second, backend)) {
+            std::cerr << "Health Monitor: unknown check_backend '" << it->second << "'" << std::endl;
+            return false;
+        }
+        if (!engine_->setBackend(backend)) {
+            std::cerr << "Health Monitor: check_backend takes effect after a module reload" << std::endl;
+        }
+    }
+    
     return true;
 }
 
 void HealthMonitorModule::onMessage(const std::string& topic, const std::string& message) {
     if (topic == "health.check") {
-        // Handle manual health check requests
-        performHealthCheck(message);
+        // Handle manual health check requests off the publishing thread when managed
+        if (taskQueue_) {
+            taskQueue_->submit([this, message]() { performHealthCheck(message); });
+        } else {
+            performHealthCheck(message);
+        }
     } else if (topic == "health.add") {
         // Handle dynamic health check additions
         // Parse message as JSON and add health check
     }
 }
 
+namespace {
+
+/** Version of the blob written by HealthMonitorModule::exportState() */
+constexpr uint64_t kStateVersion = 1;
+
+/** Parse a fraction between 0 and 1 */
+bool parseFraction(const std::string& text, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used == text.size() && value >= 0.0 && value <= 1.0;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+/** Parse a strictly positive integer configuration value */
+bool parsePositive(const std::string& text, int& value) {
+    try {
+        size_t used = 0;
+        value = std::stoi(text, &used);
+        return used == text.size() && value > 0;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+} // namespace
+
+bool HealthMonitorModule::validateConfig(const ConfigDiff& diff, std::string& error) const {
+    for (const auto& change : diff.changes()) {
+        int value = 0;
+        if (change.key == "default_timeout_ms" || change.key == "default_interval_ms" ||
+            change.key == "max_failures" || change.key == "max_concurrent_checks" ||
+            change.key == "max_connections_per_target" || change.key == "dns_max_ttl_ms" ||
+            change.key == "dns_negative_ttl_ms") {
+            if (!parsePositive(change.newValue, value)) {
+                error = change.key + " must be a positive integer, got '" + change.newValue + "'";
+                return false;
+            }
+        } else if (change.key == "check_jitter") {
+            double jitter = 0.0;
+            if (!parseFraction(change.newValue, jitter)) {
+                error = "check_jitter must be between 0 and 1, got '" + change.newValue + "'";
+                return false;
+            }
+        } else if (change.key == "check_backend") {
+            error = "check_backend cannot be changed while checks run, reload the module instead";
+            return false;
+        } else if (change.key == "enable_notifications" || change.key == "http_keep_alive") {
+            if (change.newValue != "true" && change.newValue != "false" &&
+                change.newValue != "1" && change.newValue != "0") {
+                error = change.key + " must be true or false, got '" + change.newValue + "'";
+                return false;
+            }
+        } else {
+            error = "unknown configuration key '" + change.key + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+void HealthMonitorModule::applyConfig(const ConfigDiff& diff) noexcept {
+    for (const auto& change : diff.changes()) {
+        int value = 0;
+        double jitter = 0.0;
+        if (change.key == "enable_notifications") {
+            enableNotifications_ = (change.newValue == "true" || change.newValue == "1");
+        } else if (change.key == "http_keep_alive") {
+            engine_->setKeepAlive(change.newValue == "true" || change.newValue == "1");
+        } else if (change.key == "check_jitter" && parseFraction(change.newValue, jitter)) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            scheduler_.setJitter(jitter);
+        } else if (parsePositive(change.newValue, value)) {
+            if (change.key == "default_timeout_ms") {
+                defaultTimeoutMs_ = value;
+            } else if (change.key == "default_interval_ms") {
+                defaultIntervalMs_ = value;
+            } else if (change.key == "max_failures") {
+                maxFailures_ = value;
+            } else if (change.key == "max_concurrent_checks") {
+                engine_->setMaxInFlight(static_cast<size_t>(value));
+            } else if (change.key == "max_connections_per_target") {
+                engine_->setMaxConnectionsPerTarget(static_cast<size_t>(value));
+            } else if (change.key == "dns_max_ttl_ms") {
+                dnsMaxTtlMs_ = value;
+            } else if (change.key == "dns_negative_ttl_ms") {
+                dnsNegativeTtlMs_ = value;
+            }
+        }
+    }
+    engine_->getResolver().setTtls(std::chrono::milliseconds(dnsMaxTtlMs_.load()),
+                                   std::chrono::milliseconds(dnsNegativeTtlMs_.load()));
+    
+    // Checks without an interval of their own follow the default one.
+    // Taking the lock orders the notification after the monitoring thread's
+    // deadline computation, so the wake-up cannot be missed
+    {
+        std::lock_guard<std::mutex> checksLock(healthChecksMutex_);
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        auto now = clock_->now();
+        for (const auto& [name, check] : healthChecks_) {
+            scheduler_.schedule(name, intervalOf(check), now);
+        }
+        rescheduleLocked();
+    }
+    wakeCondition_.notify_all();
+}
+
+std::string HealthMonitorModule::exportState() const {
+    StateWriter writer;
+    writer.writeUInt(kStateVersion);
+    writer.writeUInt(totalChecks_.load());
+    writer.writeUInt(failedChecks_.load());
+    
+    {
+        std::lock_guard<std::mutex> lock(healthChecksMutex_);
+        writer.writeUInt(healthChecks_.size());
+        for (const auto& [name, check] : healthChecks_) {
+            writer.writeString(check.moduleName);
+            writer.writeString(check.checkType);
+            writer.writeString(check.endpoint);
+            writer.writeInt(check.timeoutMs);
+            writer.writeInt(check.intervalMs);
+            writer.writeInt(check.maxFailures);
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(healthStatusMutex_);
+    writer.writeUInt(healthStatus_.size());
+    for (const auto& [name, result] : healthStatus_) {
+        auto failures = failureCounts_.find(name);
+        writer.writeString(result.moduleName);
+        writer.writeBool(result.healthy);
+        writer.writeString(result.status);
+        writer.writeInt(std::chrono::duration_cast<std::chrono::milliseconds>(
+            result.lastCheck.time_since_epoch()).count());
+        writer.writeInt(result.responseTime.count());
+        writer.writeString(result.errorMessage);
+        writer.writeInt(failures != failureCounts_.end() ? failures->second : 0);
+    }
+    return writer.str();
+}
+
+bool HealthMonitorModule::importState(const std::string& state) {
+    if (state.empty()) {
+        return true;
+    }
+    
+    StateReader reader(state);
+    uint64_t version = 0, total = 0, failed = 0, count = 0;
+    if (!reader.readUInt(version) || version != kStateVersion) {
+        std::cerr << "Unsupported health monitor state version " << version << std::endl;
+        return false;
+    }
+    reader.readUInt(total);
+    reader.readUInt(failed);
+    
+    std::map<std::string, HealthCheckConfig> checks;
+    reader.readUInt(count);
+    for (uint64_t i = 0; i < count && reader.ok(); i++) {
+        HealthCheckConfig check;
+        int64_t timeoutMs = 0, intervalMs = 0, maxFailures = 0;
+        reader.readString(check.moduleName);
+        reader.readString(check.checkType);
+        reader.readString(check.endpoint);
+        reader.readInt(timeoutMs);
+        reader.readInt(intervalMs);
+        reader.readInt(maxFailures);
+        check.timeoutMs = static_cast<int>(timeoutMs);
+        check.intervalMs = static_cast<int>(intervalMs);
+        check.maxFailures = static_cast<int>(maxFailures);
+        checks[check.moduleName] = check;
+    }
+    
+    std::map<std::string, HealthCheckResult> statuses;
+    std::map<std::string, int> failureCounts;
+    reader.readUInt(count);
+    for (uint64_t i = 0; i < count && reader.ok(); i++) {
+        HealthCheckResult result;
+        int64_t lastCheckMs = 0, responseTimeMs = 0, failures = 0;
+        reader.readString(result.moduleName);
+        reader.readBool(result.healthy);
+        reader.readString(result.status);
+        reader.readInt(lastCheckMs);
+        reader.readInt(responseTimeMs);
+        reader.readString(result.errorMessage);
+        reader.readInt(failures);
+        result.lastCheck = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(lastCheckMs)));
+        result.responseTime = std::chrono::milliseconds(responseTimeMs);
+        failureCounts[result.moduleName] = static_cast<int>(failures);
+        statuses[result.moduleName] = result;
+    }
+    
+    if (!reader.ok() || !reader.atEnd()) {
+        std::cerr << "Malformed health monitor state" << std::endl;
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(healthChecksMutex_);
+    std::lock_guard<std::mutex> statusLock(healthStatusMutex_);
+    healthChecks_ = std::move(checks);
+    healthStatus_ = std::move(statuses);
+    failureCounts_ = std::move(failureCounts);
+    totalChecks_ = total;
+    failedChecks_ = failed;
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+        auto now = clock_->now();
+        for (const auto& [name, stats] : scheduler_.getStats()) {
+            if (!healthChecks_.count(name)) {
+                scheduler_.remove(name);
+            }
+        }
+        for (const auto& [name, check] : healthChecks_) {
+            scheduler_.schedule(name, intervalOf(check), now);
+        }
+        rescheduleLocked();
+    }
+    wakeCondition_.notify_all();
+    statusChanged();
+    return true;
+}
+
 void HealthMonitorModule::addHealthCheck(const HealthCheckConfig& config) {
     std::lock_guard<std::mutex> lock(healthChecksMutex_);
     healthChecks_[config.moduleName] = config;
@@ -103,24 +465,44 @@ void HealthMonitorModule::addHealthCheck(const HealthCheckConfig& config) {
     std::lock_guard<std::mutex> statusLock(healthStatusMutex_);
     healthStatus_[config.moduleName] = {
         config.moduleName, true, "Initialized", 
-        std::chrono::system_clock::now(), 
+        clock_->wallNow(), 
         std::chrono::milliseconds(0), ""
     };
     failureCounts_[config.moduleName] = 0;
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+        scheduler_.remove(config.moduleName);
+        scheduler_.schedule(config.moduleName, intervalOf(config), clock_->now());
+        rescheduleLocked();
+    }
+    wakeCondition_.notify_all();
+    statusChanged();
 }
 
 void HealthMonitorModule::removeHealthCheck(const std::string& moduleName) {
     std::lock_guard<std::mutex> lock(healthChecksMutex_);
     healthChecks_.erase(moduleName);
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+        scheduler_.remove(moduleName);
+    }
+    wakeCondition_.notify_all();
     
     std::lock_guard<std::mutex> statusLock(healthStatusMutex_);
     healthStatus_.erase(moduleName);
     failureCounts_.erase(moduleName);
+    statusChanged();
 }
 
 void HealthMonitorModule::updateHealthCheck(const HealthCheckConfig& config) {
     std::lock_guard<std::mutex> lock(healthChecksMutex_);
     healthChecks_[config.moduleName] = config;
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+        scheduler_.schedule(config.moduleName, intervalOf(config), clock_->now());
+        rescheduleLocked();
+    }
+    wakeCondition_.notify_all();
 }
 
 HealthCheckResult HealthMonitorModule::getModuleHealth(const std::string& moduleName) const {
@@ -141,22 +523,40 @@ bool HealthMonitorModule::isModuleHealthy(const std::string& moduleName) const {
 }
 
 HealthCheckResult HealthMonitorModule::performHealthCheck(const std::string& moduleName) {
-    std::lock_guard<std::mutex> lock(healthChecksMutex_);
-    auto it = healthChecks_.find(moduleName);
-    if (it == healthChecks_.end()) {
-        return {moduleName, false, "No health check configured", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Module not found"};
+    HealthCheckConfig config;
+    {
+        std::lock_guard<std::mutex> lock(healthChecksMutex_);
+        auto it = healthChecks_.find(moduleName);
+        if (it == healthChecks_.end()) {
+            return {moduleName, false, "No health check configured", 
+                    clock_->wallNow(), std::chrono::milliseconds(0), 
+                    "Module not found"};
+        }
+        config = it->second;
     }
     
-    return performHealthCheck(it->second);
+    return performHealthCheck(config);
 }
 
 void HealthMonitorModule::performAllHealthChecks() {
+    // The checks run without the lock, so adding or querying checks does not
+    // wait for a round
+    std::vector<HealthCheckConfig> configs;
+    {
+        std::lock_guard<std::mutex> lock(healthChecksMutex_);
+        for (const auto& [name, config] : healthChecks_) {
+            configs.push_back(config);
+        }
+    }
+    
+    auto results = runHealthChecks(configs);
+    
     std::lock_guard<std::mutex> lock(healthChecksMutex_);
-    for (const auto& [name, config] : healthChecks_) {
-        auto result = performHealthCheck(config);
-        updateHealthStatus(name, result);
+    for (size_t i = 0; i < configs.size(); i++) {
+        // Checks removed during the round keep no status
+        if (healthChecks_.count(configs[i].moduleName)) {
+            updateHealthStatus(configs[i].moduleName, results[i]);
+        }
     }
 }
 
@@ -168,6 +568,15 @@ size_t HealthMonitorModule::getFailedChecks() const {
     return failedChecks_.load();
 }
 
+std::map<std::string, CheckScheduleStats> HealthMonitorModule::getScheduleStats() const {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    return scheduler_.getStats();
+}
+
+void HealthMonitorModule::setClock(std::shared_ptr<Clock> clock) {
+    clock_ = clock ? std::move(clock) : Clock::system();
+}
+
 double HealthMonitorModule::getSuccessRate() const {
     size_t total = totalChecks_.load();
     if (total == 0) return 1.0;
@@ -175,202 +584,157 @@ double HealthMonitorModule::getSuccessRate() const {
 }
 
 void HealthMonitorModule::monitoringLoop() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
     while (!shouldStop_) {
-        performAllHealthChecks();
-        
-        // Sleep for the monitoring interval
-        std::this_thread::sleep_for(std::chrono::milliseconds(defaultIntervalMs_));
-    }
-}
-
-HealthCheckResult HealthMonitorModule::performHealthCheck(const HealthCheckConfig& config) {
-    auto startTime = std::chrono::high_resolution_clock::now();
-    totalChecks_++;
-    
-    HealthCheckResult result;
-    result.moduleName = config.moduleName;
-    result.lastCheck = std::chrono::system_clock::now();
-    
-    try {
-        if (config.checkType == "http") {
-            result = performHttpHealthCheck(config);
-        } else if (config.checkType == "tcp") {
-            result = performTcpHealthCheck(config);
+        // The deadline is recomputed on every wake-up, so added checks and
+        // changed intervals apply to the current wait
+        auto nextDue = scheduler_.nextDue();
+        if (nextDue <= clock_->now()) {
+            lock.unlock();
+            runDueChecks();
+            lock.lock();
+        } else if (nextDue == CheckScheduler::TimePoint::max()) {
+            wakeCondition_.wait(lock);
         } else {
-            result.healthy = false;
-            result.status = "Unknown check type";
-            result.errorMessage = "Unsupported check type: " + config.checkType;
+            clock_->waitUntil(lock, wakeCondition_, nextDue);
         }
-    } catch (const std::exception& e) {
-        result.healthy = false;
-        result.status = "Error";
-        result.errorMessage = e.what();
     }
-    
-    auto endTime = std::chrono::high_resolution_clock::now();
-    result.responseTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-    
-    if (!result.healthy) {
-        failedChecks_++;
-    }
-    
-    return result;
 }
 
-HealthCheckResult HealthMonitorModule::performHttpHealthCheck(const HealthCheckConfig& config) {
-    // Parse URL to extract host and port
-    std::string endpoint = config.endpoint;
-    std::string host = "127.0.0.1";
-    int port = 8081; // Default port for standalone
-    
-    // Simple URL parsing
-    if (endpoint.find("http://") == 0) {
-        endpoint = endpoint.substr(7); // Remove "http://"
-    }
-    
-    size_t colonPos = endpoint.find(':');
-    if (colonPos != std::string::npos) {
-        host = endpoint.substr(0, colonPos);
-        size_t slashPos = endpoint.find('/', colonPos);
-        if (slashPos != std::string::npos) {
-            port = std::stoi(endpoint.substr(colonPos + 1, slashPos - colonPos - 1));
-        } else {
-            port = std::stoi(endpoint.substr(colonPos + 1));
-        }
-    } else {
-        size_t slashPos = endpoint.find('/');
-        if (slashPos != std::string::npos) {
-            host = endpoint.substr(0, slashPos);
-        } else {
-            host = endpoint;
+void HealthMonitorModule::runDueChecks() {
+    std::vector<std::string> due;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        if (shouldStop_) {
+            return;
         }
+        due = scheduler_.takeDue(clock_->now());
+    }
+    if (due.empty()) {
+        return;
     }
     
-    // Simple HTTP health check implementation
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        return {config.moduleName, false, "Socket creation failed", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Failed to create socket"};
-    }
-    
-    struct sockaddr_in serv_addr;
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    
-    // Convert hostname to IP address using DNS resolution
-    std::string ipAddress = host;
-    if (host == "localhost") {
-        ipAddress = "127.0.0.1";
-    } else if (host != "127.0.0.1" && host != "localhost") {
-        // Use DNS resolution for hostnames
-        struct hostent *he = gethostbyname(host.c_str());
-        if (he == nullptr) {
-            close(sock);
-            return {config.moduleName, false, "DNS resolution failed", 
-                    std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                    "Failed to resolve hostname: " + host};
+    // Checks removed since have nothing to run; their runs end right away
+    std::vector<HealthCheckConfig> configs;
+    std::vector<std::string> removed;
+    {
+        std::lock_guard<std::mutex> lock(healthChecksMutex_);
+        for (const auto& name : due) {
+            auto it = healthChecks_.find(name);
+            if (it != healthChecks_.end()) {
+                configs.push_back(withDefaults(it->second));
+            } else {
+                removed.push_back(name);
+            }
         }
-        struct in_addr **addr_list = (struct in_addr **)he->h_addr_list;
-        if (addr_list[0] != nullptr) {
-            ipAddress = inet_ntoa(*addr_list[0]);
-        } else {
-            close(sock);
-            return {config.moduleName, false, "DNS resolution failed", 
-                    std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                    "No IP address found for hostname: " + host};
+    }
+    if (!removed.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            for (const auto& name : removed) {
+                scheduler_.complete(name, clock_->now());
+            }
         }
+        wakeCondition_.notify_all();
     }
-    
-    if (inet_pton(AF_INET, ipAddress.c_str(), &serv_addr.sin_addr) <= 0) {
-        close(sock);
-        return {config.moduleName, false, "Invalid address", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Invalid address: " + host + " (resolved to " + ipAddress + ")"};
+    for (const auto& config : configs) {
+        engine_->submit(config, [this, name = config.moduleName](const HealthCheckResult& result) {
+            completeCheck(name, result);
+        });
     }
-    
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        close(sock);
-        return {config.moduleName, false, "Connection failed", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Connection failed to " + host + ":" + std::to_string(port)};
+}
+
+void HealthMonitorModule::runScheduledChecks() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        nextChecks_ = 0;
+        dispatching_ = true;
     }
     
-    // Send a simple HTTP GET request
-    std::string request = "GET /health HTTP/1.1\r\nHost: " + host + ":" + std::to_string(port) + "\r\nConnection: close\r\n\r\n";
+    runDueChecks();
     
-    if (send(sock, request.c_str(), request.length(), 0) < 0) {
-        close(sock);
-        return {config.moduleName, false, "HTTP request failed", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Failed to send HTTP request"};
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    dispatching_ = false;
+    if (!shouldStop_) {
+        scheduleNextChecks();
     }
-    
-    // Read response (just check if we get any response)
-    char buffer[1024];
-    int bytesRead = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    close(sock);
-    
-    if (bytesRead > 0) {
-        return {config.moduleName, true, "Healthy", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), ""};
-    } else {
-        return {config.moduleName, false, "No response", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "No HTTP response received"};
+}
+
+void HealthMonitorModule::scheduleNextChecks() {
+    auto nextDue = scheduler_.nextDue();
+    if (nextDue == CheckScheduler::TimePoint::max()) {
+        nextChecks_ = 0;
+        return;
     }
+    // Rounded up, so the timer does not fire just before the check is due
+    auto delay = std::chrono::ceil<std::chrono::milliseconds>(nextDue - clock_->now());
+    nextChecks_ = taskQueue_->scheduleAfter(std::max(delay, std::chrono::milliseconds(0)),
+                                            [this]() { runSupervised([this]() { runScheduledChecks(); }); });
 }
 
-HealthCheckResult HealthMonitorModule::performTcpHealthCheck(const HealthCheckConfig& config) {
-    // Parse endpoint to extract host and port
-    std::string endpoint = config.endpoint;
-    std::string host = "127.0.0.1";
-    int port = 8081; // Default port for standalone
-    
-    // Simple endpoint parsing
-    size_t colonPos = endpoint.find(':');
-    if (colonPos != std::string::npos) {
-        host = endpoint.substr(0, colonPos);
-        port = std::stoi(endpoint.substr(colonPos + 1));
-    } else {
-        host = endpoint;
+void HealthMonitorModule::rescheduleLocked() {
+    if (!taskQueue_ || !running_ || shouldStop_ || dispatching_) {
+        // The monitoring thread is notified by the caller; a dispatch in
+        // progress schedules the next timer when it is done
+        return;
     }
-    
-    // Simple TCP health check implementation
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        return {config.moduleName, false, "Socket creation failed", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Failed to create socket"};
+    // If the timer already fired, that run schedules the next one itself
+    if (nextChecks_ == 0 || taskQueue_->cancel(nextChecks_)) {
+        scheduleNextChecks();
     }
-    
-    struct sockaddr_in serv_addr;
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    
-    // Convert hostname to IP address if needed
-    std::string ipAddress = host;
-    if (host == "localhost") {
-        ipAddress = "127.0.0.1";
+}
+
+void HealthMonitorModule::completeCheck(const std::string& name, HealthCheckResult result) {
+    if (!discardResults_) {
+        recordResult(result);
+        std::lock_guard<std::mutex> lock(healthChecksMutex_);
+        if (healthChecks_.count(name)) {
+            updateHealthStatus(name, result);
+        }
     }
-    
-    if (inet_pton(AF_INET, ipAddress.c_str(), &serv_addr.sin_addr) <= 0) {
-        close(sock);
-        return {config.moduleName, false, "Invalid address", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Invalid address: " + host + " (resolved to " + ipAddress + ")"};
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        scheduler_.complete(name, clock_->now());
     }
+    wakeCondition_.notify_all();
+}
+
+std::chrono::milliseconds HealthMonitorModule::intervalOf(const HealthCheckConfig& config) const {
+    return std::chrono::milliseconds(config.intervalMs > 0 ? config.intervalMs : defaultIntervalMs_.load());
+}
+
+HealthCheckConfig HealthMonitorModule::withDefaults(HealthCheckConfig config) const {
+    if (config.timeoutMs <= 0) {
+        config.timeoutMs = defaultTimeoutMs_.load();
+    }
+    return config;
+}
+
+void HealthMonitorModule::recordResult(HealthCheckResult& result) {
+    result.lastCheck = clock_->wallNow();
+    totalChecks_++;
+    if (!result.healthy) {
+        failedChecks_++;
+    }
+}
+
+HealthCheckResult HealthMonitorModule::performHealthCheck(const HealthCheckConfig& config) {
+    return runHealthChecks({config}).front();
+}
+
+std::vector<HealthCheckResult> HealthMonitorModule::runHealthChecks(std::vector<HealthCheckConfig> configs) {
+    for (auto& config : configs) {
+        config = withDefaults(config);
+    }
+    
+    auto results = engine_->runAll(configs);
     
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        close(sock);
-        return {config.moduleName, false, "Connection failed", 
-                std::chrono::system_clock::now(), std::chrono::milliseconds(0), 
-                "Connection failed to " + host + ":" + std::to_string(port)};
+    for (auto& result : results) {
+        recordResult(result);
     }
+    statusChanged();
     
-    close(sock);
-    return {config.moduleName, true, "Healthy", 
-            std::chrono::system_clock::now(), std::chrono::milliseconds(0), ""};
+    return results;
 }
 
 void HealthMonitorModule::updateHealthStatus(const std::string& moduleName, const HealthCheckResult& result) {
@@ -385,6 +749,7 @@ void HealthMonitorModule::updateHealthStatus(const std::string& moduleName, cons
     } else {
         failureCounts_[moduleName] = 0;
     }
+    statusChanged();
     
     // Notify if health status changed
     if (wasHealthy != result.healthy && enableNotifications_) {
@@ -0,0 +1,4 @@
+#include "../../../include/core/plugin_api.h"
+#include "../../../include/modules/health_monitor_module.h"
+
+SWARM_DECLARE_PLUGIN(swarm::HealthMonitorModule, swarm::HealthMonitorModule::kModuleName, "1.0.0")
@@ -0,0 +1,222 @@
+#include "../../../include/modules/http_response_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace swarm {
+
+namespace {
+
+constexpr size_t kMaxHeadSize = 16384;                   // Larger heads are not worth keeping a connection for
+constexpr size_t kMaxLineSize = 1024;                    // Chunk size lines and trailer fields
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+} // namespace
+
+size_t HttpResponseParser::feed(const char* data, size_t length) {
+    const char* begin = data;
+    const char* end = data + length;
+    if (length > 0) {
+        started_ = true;
+    }
+
+    while (data < end && state_ == State::Incomplete) {
+        switch (part_) {
+            case Part::Head: {
+                // The head is collected whole and parsed at the empty line
+                const char* stop = data;
+                while (stop < end) {
+                    line_ += *stop++;
+                    if (line_.size() >= 4 && line_.compare(line_.size() - 4, 4, "\r\n\r\n") == 0) {
+                        break;
+                    }
+                }
+                data = stop;
+                if (line_.size() >= 4 && line_.compare(line_.size() - 4, 4, "\r\n\r\n") == 0) {
+                    parseHead();
+                } else if (line_.size() > kMaxHeadSize) {
+                    state_ = State::Invalid;
+                }
+                break;
+            }
+            case Part::Body:
+            case Part::ChunkData: {
+                uint64_t take = std::min<uint64_t>(remaining_, static_cast<uint64_t>(end - data));
+                data += take;
+                remaining_ -= take;
+                if (remaining_ == 0) {
+                    if (part_ == Part::Body) {
+                        state_ = State::Complete;
+                    } else {
+                        part_ = Part::ChunkEnd;
+                    }
+                }
+                break;
+            }
+            case Part::ChunkSize: {
+                if (!takeLine(data, end)) {
+                    break;
+                }
+                char* parsedEnd = nullptr;
+                std::string size = line_.substr(0, line_.find(';'));
+                remaining_ = std::strtoull(size.c_str(), &parsedEnd, 16);
+                if (size.empty() || parsedEnd == size.c_str()) {
+                    state_ = State::Invalid;
+                    break;
+                }
+                line_.clear();
+                part_ = remaining_ == 0 ? Part::Trailer : Part::ChunkData;
+                break;
+            }
+            case Part::ChunkEnd: {
+                if (!takeLine(data, end)) {
+                    break;
+                }
+                if (!line_.empty()) {
+                    state_ = State::Invalid;
+                    break;
+                }
+                part_ = Part::ChunkSize;
+                break;
+            }
+            case Part::Trailer: {
+                if (!takeLine(data, end)) {
+                    break;
+                }
+                // Trailer fields are skipped up to the empty line
+                if (line_.empty()) {
+                    state_ = State::Complete;
+                }
+                line_.clear();
+                break;
+            }
+            case Part::UntilClose:
+                data = end;
+                break;
+        }
+    }
+    return static_cast<size_t>(data - begin);
+}
+
+void HttpResponseParser::finishAtClose() {
+    if (state_ == State::Incomplete && part_ == Part::UntilClose) {
+        closeDelimited_ = true;
+        state_ = State::Complete;
+    }
+}
+
+void HttpResponseParser::reset() {
+    bool head = head_;
+    *this = HttpResponseParser();
+    head_ = head;
+}
+
+bool HttpResponseParser::isReusable() const {
+    if (state_ != State::Complete || closeDelimited_ || closeRequested_) {
+        return false;
+    }
+    return http11_ || keepAliveRequested_;
+}
+
+bool HttpResponseParser::takeLine(const char*& data, const char* end) {
+    while (data < end) {
+        char c = *data++;
+        if (c == '\n') {
+            if (!line_.empty() && line_.back() == '\r') {
+                line_.pop_back();
+            }
+            return true;
+        }
+        line_ += c;
+        if (line_.size() > kMaxLineSize) {
+            state_ = State::Invalid;
+            return false;
+        }
+    }
+    return false;
+}
+
+void HttpResponseParser::parseHead() {
+    std::string head;
+    head.swap(line_);
+
+    size_t lineEnd = head.find("\r\n");
+    std::string statusLine = head.substr(0, lineEnd);
+    if (statusLine.compare(0, 5, "HTTP/") != 0 || statusLine.size() < 12) {
+        state_ = State::Invalid;
+        return;
+    }
+    http11_ = statusLine.compare(0, 8, "HTTP/1.0") != 0;
+    statusCode_ = std::atoi(statusLine.c_str() + 9);
+    if (statusCode_ < 100 || statusCode_ > 999) {
+        state_ = State::Invalid;
+        return;
+    }
+
+    bool chunked = false;
+    bool hasLength = false;
+    uint64_t contentLength = 0;
+    size_t position = lineEnd + 2;
+    while (position < head.size()) {
+        size_t next = head.find("\r\n", position);
+        std::string field = head.substr(position, next - position);
+        position = next + 2;
+        size_t colon = field.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = lowercase(trim(field.substr(0, colon)));
+        std::string value = lowercase(trim(field.substr(colon + 1)));
+        if (name == "content-length") {
+            char* parsedEnd = nullptr;
+            contentLength = std::strtoull(value.c_str(), &parsedEnd, 10);
+            if (value.empty() || *parsedEnd != '\0') {
+                state_ = State::Invalid;
+                return;
+            }
+            hasLength = true;
+        } else if (name == "transfer-encoding") {
+            chunked = value.size() >= 7 && value.compare(value.size() - 7, 7, "chunked") == 0;
+        } else if (name == "connection") {
+            closeRequested_ = closeRequested_ || value.find("close") != std::string::npos;
+            keepAliveRequested_ = keepAliveRequested_ || value.find("keep-alive") != std::string::npos;
+        }
+    }
+
+    // Interim responses carry no body; the final one follows on the connection
+    if (statusCode_ >= 100 && statusCode_ < 200) {
+        bool head = head_;
+        *this = HttpResponseParser();
+        head_ = head;
+        started_ = true;
+        return;
+    }
+    if (head_ || statusCode_ == 204 || statusCode_ == 304) {
+        state_ = State::Complete;
+    } else if (chunked) {
+        part_ = Part::ChunkSize;
+    } else if (hasLength) {
+        remaining_ = contentLength;
+        part_ = Part::Body;
+        if (remaining_ == 0) {
+            state_ = State::Complete;
+        }
+    } else {
+        part_ = Part::UntilClose;
+    }
+}
+
+} // namespace swarm
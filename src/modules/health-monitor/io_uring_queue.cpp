@@ -0,0 +1,135 @@
+#include "../../../include/modules/io_uring_queue.h"
+
+#ifdef SWARM_HAVE_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+namespace swarm {
+
+namespace {
+
+// Operations the health check engine submits
+constexpr uint8_t kRequiredOps[] = {
+    IORING_OP_CONNECT, IORING_OP_SEND, IORING_OP_RECV, IORING_OP_READ, IORING_OP_READ_FIXED,
+    IORING_OP_LINK_TIMEOUT, IORING_OP_TIMEOUT, IORING_OP_TIMEOUT_REMOVE, IORING_OP_ASYNC_CANCEL
+};
+
+constexpr unsigned kProbeOps = 256;
+
+} // namespace
+
+IoUringQueue::~IoUringQueue() {
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+    }
+    if (ringMemory_) {
+        munmap(ringMemory_, ringSize_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool IoUringQueue::setup(unsigned entries, std::string& error) {
+    struct io_uring_params params {};
+    params.flags = IORING_SETUP_CLAMP;
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+        error = std::string("io_uring_setup failed: ") + std::strerror(errno);
+        return false;
+    }
+
+    // Completions must never be dropped, and one mapping holds both rings
+    // (Linux 5.5 and later)
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP;
+    if ((params.features & required) != required) {
+        error = "kernel io_uring lacks single mapping or no-drop completions";
+        return false;
+    }
+
+    std::vector<uint8_t> probeMemory(sizeof(struct io_uring_probe) + kProbeOps * sizeof(struct io_uring_probe_op));
+    auto* probe = reinterpret_cast<struct io_uring_probe*>(probeMemory.data());
+    if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+        error = std::string("io_uring probe failed: ") + std::strerror(errno);
+        return false;
+    }
+    for (uint8_t op : kRequiredOps) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            error = "kernel io_uring lacks operation " + std::to_string(op);
+            return false;
+        }
+    }
+
+    ringSize_ = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                 params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ringMemory_ = mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (ringMemory_ == MAP_FAILED) {
+        ringMemory_ = nullptr;
+        error = std::string("cannot map io_uring: ") + std::strerror(errno);
+        return false;
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        error = std::string("cannot map io_uring entries: ") + std::strerror(errno);
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    auto* ring = static_cast<char*>(ringMemory_);
+    sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sqEntries_ = params.sq_entries;
+    sqeTail_ = *sqTail_;
+    cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUringQueue::registerBuffer(void* base, size_t length) {
+    struct iovec buffer {base, length};
+    return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, &buffer, 1) == 0;
+}
+
+struct io_uring_sqe* IoUringQueue::getSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqeTail_ - head >= sqEntries_) {
+        return nullptr;
+    }
+    unsigned index = sqeTail_ & *sqMask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqeTail_;
+    return sqe;
+}
+
+int IoUringQueue::submit(unsigned waitFor) {
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    // Entries the kernel did not take last time are still counted
+    unsigned queued = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (queued == 0 && waitFor == 0) {
+        return 0;
+    }
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+    long submitted = syscall(__NR_io_uring_enter, fd_, queued, waitFor, flags, nullptr, 0);
+    if (submitted < 0) {
+        return errno == EINTR ? 0 : -errno;
+    }
+    return static_cast<int>(submitted);
+}
+
+} // namespace swarm
+
+#endif // SWARM_HAVE_IO_URING
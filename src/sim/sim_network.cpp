@@ -0,0 +1,143 @@
+#include "../../include/sim/sim_network.h"
+#include <algorithm>
+#include <iostream>
+
+namespace swarm {
+
+SimNetwork::SimNetwork(size_t nodes, const LinkProfile& defaultLink, std::shared_ptr<Clock> clock,
+                       uint64_t seed, size_t threads)
+    : nodes_(nodes),
+      defaultLink_(defaultLink),
+      clock_(clock ? clock : Clock::system()),
+      random_(seed),
+      executor_(ExecutorOptions{std::max<size_t>(threads, 1), {}, clock_}) {
+}
+
+SimNetwork::~SimNetwork() {
+    // executor_ is declared last, so its workers are joined and pending
+    // deliveries dropped before the members they use go away
+}
+
+void SimNetwork::setDeliveryHandler(DeliveryHandler handler) {
+    deliveryHandler_ = std::move(handler);
+}
+
+void SimNetwork::setLink(size_t from, size_t to, const LinkProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    links_[{from, to}] = profile;
+}
+
+void SimNetwork::partition(const std::set<size_t>& side) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    partitionSide_.assign(nodes_, false);
+    for (size_t node : side) {
+        if (node < nodes_) {
+            partitionSide_[node] = true;
+        }
+    }
+}
+
+void SimNetwork::heal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    partitionSide_.clear();
+}
+
+bool SimNetwork::isReachable(size_t from, size_t to) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return partitionSide_.empty() || partitionSide_[from] == partitionSide_[to];
+}
+
+bool SimNetwork::send(size_t from, size_t to, const std::string& topic, const std::string& message) {
+    if (from >= nodes_ || to >= nodes_) {
+        std::cerr << "SimNetwork: no link from node " << from << " to node " << to << std::endl;
+        return false;
+    }
+
+    std::chrono::milliseconds delay{0};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.sent++;
+        if (!partitionSide_.empty() && partitionSide_[from] != partitionSide_[to]) {
+            stats_.partitioned++;
+            return false;
+        }
+        const LinkProfile& link = linkLocked(from, to);
+        if (link.lossRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < link.lossRate) {
+            stats_.lost++;
+            return false;
+        }
+        delay = link.latency;
+        if (link.jitter.count() > 0) {
+            delay += std::chrono::milliseconds(
+                std::uniform_int_distribution<int64_t>(0, link.jitter.count())(random_));
+        }
+        stats_.inFlight++;
+    }
+
+    auto sentAt = clock_->now();
+    auto task = [this, to, topic, message, sentAt]() { deliver(to, topic, message, sentAt); };
+    bool scheduled = delay.count() > 0 ? executor_.scheduleAfter(delay, std::move(task)) != 0
+                                       : executor_.submit(std::move(task));
+    if (!scheduled) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.inFlight--;
+        stats_.lost++;
+    }
+    return scheduled;
+}
+
+NetworkStats SimNetwork::getStats() const {
+    std::vector<std::chrono::microseconds> latencies;
+    NetworkStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = stats_;
+        latencies = latencies_;
+    }
+    if (latencies.empty()) {
+        return stats;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::chrono::microseconds total{0};
+    for (const auto& latency : latencies) {
+        total += latency;
+    }
+    stats.latencyMean = total / static_cast<int64_t>(latencies.size());
+    stats.latencyP50 = latencies[latencies.size() / 2];
+    stats.latencyP99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    stats.latencyMax = latencies.back();
+    return stats;
+}
+
+void SimNetwork::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t inFlight = stats_.inFlight;
+    stats_ = NetworkStats();
+    stats_.inFlight = inFlight;
+    latencies_.clear();
+}
+
+const LinkProfile& SimNetwork::linkLocked(size_t from, size_t to) const {
+    auto it = links_.find({from, to});
+    return it != links_.end() ? it->second : defaultLink_;
+}
+
+void SimNetwork::deliver(size_t to, const std::string& topic, const std::string& message,
+                         std::chrono::steady_clock::time_point sentAt) {
+    if (deliveryHandler_) {
+        try {
+            deliveryHandler_(to, topic, message);
+        } catch (const std::exception& e) {
+            std::cerr << "SimNetwork: delivery to node " << to << " failed: " << e.what() << std::endl;
+        }
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(clock_->now() - sentAt);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.inFlight--;
+    stats_.delivered++;
+    latencies_.push_back(latency);
+}
+
+} // namespace swarm
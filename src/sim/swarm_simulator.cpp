@@ -0,0 +1,222 @@
+#include "../../include/sim/swarm_simulator.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace swarm {
+
+namespace {
+
+// A message being published on a node's bus by the network; its own node's
+// bridge must not send it back out
+struct NetworkDelivery {
+    size_t node;
+    const std::string* topic;
+    const std::string* message;
+};
+
+thread_local const NetworkDelivery* tlsDelivery = nullptr;
+
+// Pause between the idle checks of settle()
+constexpr std::chrono::milliseconds kSettlePoll{1};
+
+} // namespace
+
+SwarmSimulator::SwarmSimulator(const SimulatorOptions& options)
+    : clock_(options.clock ? options.clock : Clock::system()),
+      virtualClock_(std::dynamic_pointer_cast<VirtualClock>(clock_)) {
+    MessageBusOptions busOptions;
+    busOptions.transport = BusTransport::Inproc;
+    nodes_.reserve(options.nodes);
+    for (size_t i = 0; i < options.nodes; ++i) {
+        nodes_.push_back(std::make_unique<ModuleManager>(
+            ExecutorOptions{std::max<size_t>(options.threadsPerNode, 1), {}, clock_}, busOptions));
+    }
+
+    network_ = std::make_unique<SimNetwork>(options.nodes, options.defaultLink, clock_,
+                                            options.seed, options.networkThreads);
+    network_->setDeliveryHandler([this](size_t to, const std::string& topic, const std::string& message) {
+        NetworkDelivery delivery{to, &topic, &message};
+        tlsDelivery = &delivery;
+        nodes_[to]->getMessageBus()->publish(topic, message);
+        tlsDelivery = nullptr;
+    });
+}
+
+SwarmSimulator::~SwarmSimulator() {
+    stopping_ = true;
+    for (const auto& [node, id] : bridges_) {
+        nodes_[node]->getMessageBus()->unsubscribe(id);
+    }
+    network_.reset();
+    nodes_.clear();
+}
+
+void SwarmSimulator::registerModule(const std::string& name, ModuleFactory factory) {
+    for (auto& node : nodes_) {
+        node->registerModule(name, factory);
+    }
+}
+
+bool SwarmSimulator::loadModule(const std::string& name, NodeConfig config, size_t replicas) {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        std::map<std::string, std::string> nodeConfig = config ? config(i) : std::map<std::string, std::string>();
+        if (!nodes_[i]->loadModule(name, nodeConfig, replicas)) {
+            std::cerr << "SwarmSimulator: failed to load " << name << " on node " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void SwarmSimulator::bridge(const std::string& topic, Route route) {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        auto id = nodes_[i]->getMessageBus()->subscribe(topic,
+            [this, i, route](const std::string& topic, const std::string& message) {
+                if (stopping_) {
+                    return;
+                }
+                if (tlsDelivery && tlsDelivery->node == i && *tlsDelivery->topic == topic &&
+                    *tlsDelivery->message == message) {
+                    return;
+                }
+                if (route) {
+                    for (size_t to : route(i)) {
+                        network_->send(i, to, topic, message);
+                    }
+                } else {
+                    for (size_t to = 0; to < nodes_.size(); ++to) {
+                        if (to != i) {
+                            network_->send(i, to, topic, message);
+                        }
+                    }
+                }
+            });
+        bridges_.emplace_back(i, id);
+    }
+}
+
+bool SwarmSimulator::start() {
+    bool started = true;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (!nodes_[i]->startAllModules()) {
+            std::cerr << "SwarmSimulator: node " << i << " failed to start its modules" << std::endl;
+            started = false;
+        }
+    }
+    network_->resetStats();
+    startTime_ = clock_->now();
+    return started;
+}
+
+void SwarmSimulator::publish(size_t node, const std::string& topic, const std::string& message) {
+    nodes_.at(node)->getMessageBus()->publishAsync(topic, message);
+}
+
+bool SwarmSimulator::settle(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    // Idle twice in a row with nothing run in between, so work handed from one
+    // node to another between the checks is not missed
+    uint64_t previous = activity();
+    bool wasIdle = false;
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (auto& node : nodes_) {
+            node->getMessageBus()->flush(deadline);
+        }
+        bool idle = isIdle();
+        uint64_t current = activity();
+        if (idle && wasIdle && current == previous) {
+            return true;
+        }
+        wasIdle = idle;
+        previous = current;
+        std::this_thread::sleep_for(kSettlePoll);
+    }
+    std::cerr << "SwarmSimulator: swarm did not settle within " << timeout.count() << " ms" << std::endl;
+    return false;
+}
+
+void SwarmSimulator::runFor(std::chrono::steady_clock::duration duration) {
+    if (!virtualClock_) {
+        std::this_thread::sleep_for(duration);
+        return;
+    }
+    auto end = virtualClock_->now() + duration;
+    do {
+        settle();
+    } while (virtualClock_->advanceToNextDeadline(end));
+    settle();
+}
+
+SimulationStats SwarmSimulator::getStats() const {
+    SimulationStats stats;
+    stats.nodes = nodes_.size();
+    stats.network = network_->getStats();
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        uint64_t messages = nodes_[i]->getMessageBus()->getMessageCount();
+        stats.busMessages += messages;
+        stats.minNodeMessages = i == 0 ? messages : std::min(stats.minNodeMessages, messages);
+        stats.maxNodeMessages = std::max(stats.maxNodeMessages, messages);
+    }
+    stats.elapsed = clock_->now() - startTime_;
+    double seconds = std::chrono::duration<double>(stats.elapsed).count();
+    if (seconds > 0.0) {
+        stats.deliveredPerSecond = stats.network.delivered / seconds;
+    }
+    return stats;
+}
+
+std::string SwarmSimulator::summary() const {
+    SimulationStats stats = getStats();
+    auto ms = [](std::chrono::microseconds time) { return time.count() / 1000.0; };
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "nodes            " << stats.nodes << "\n";
+    out << "elapsed          " << std::chrono::duration<double, std::milli>(stats.elapsed).count() << "\n";
+    out << "sent             " << stats.network.sent << "\n";
+    out << "delivered        " << stats.network.delivered << " (" << stats.deliveredPerSecond << "/s)\n";
+    out << "lost             " << stats.network.lost << "\n";
+    out << "partitioned      " << stats.network.partitioned << "\n";
+    out << "in flight        " << stats.network.inFlight << "\n";
+    out << "latency mean     " << ms(stats.network.latencyMean) << "\n";
+    out << "latency p50      " << ms(stats.network.latencyP50) << "\n";
+    out << "latency p99      " << ms(stats.network.latencyP99) << "\n";
+    out << "latency max      " << ms(stats.network.latencyMax) << "\n";
+    out << "bus messages     " << stats.busMessages << " (" << stats.minNodeMessages << "-"
+        << stats.maxNodeMessages << " per node)\n";
+    return out.str();
+}
+
+uint64_t SwarmSimulator::activity() const {
+    uint64_t total = network_->getExecutor().getStats().executed;
+    for (const auto& node : nodes_) {
+        total += node->getExecutor()->getStats().executed + node->getMessageBus()->getMessageCount();
+    }
+    return total;
+}
+
+bool SwarmSimulator::isIdle() const {
+    // An idle executor with timers has every worker waiting on the clock for
+    // the next one; with a VirtualClock, fewer waiters mean a worker is busy
+    size_t expectedWaiters = 0;
+    auto check = [&expectedWaiters](const ExecutorStats& stats) {
+        if (stats.timers > 0) {
+            expectedWaiters += stats.threads;
+        }
+        return stats.queued == 0;
+    };
+    if (!check(network_->getExecutor().getStats())) {
+        return false;
+    }
+    for (const auto& node : nodes_) {
+        if (!check(node->getExecutor()->getStats())) {
+            return false;
+        }
+    }
+    return !virtualClock_ || virtualClock_->getWaiterCount() >= expectedWaiters;
+}
+
+} // namespace swarm
@@ -0,0 +1,32 @@
+#include "core/plugin_api.h"
+#include "core/message_bus.h"
+
+namespace {
+
+// Minimal module used to exercise plugin loading in the unit tests
+class EchoModule : public swarm::Module {
+public:
+    bool initialize() override { return true; }
+    void start() override { running_ = true; }
+    void stop() override { running_ = false; }
+    void shutdown() override {}
+    std::string getName() const override { return "echo"; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    std::vector<std::string> getSubscriptions() const override { return {"echo"}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return running_ ? "echo running" : "echo stopped"; }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        if (messageBus_) {
+            messageBus_->publish(topic + ".echo", message);
+        }
+    }
+};
+
+} // namespace
+
+SWARM_DECLARE_PLUGIN(EchoModule, "echo", "1.0.0")
@@ -56,6 +56,20 @@ TEST_F(ApiModuleTest, InvalidConfiguration) {
     }
 }
 
+TEST_F(ApiModuleTest, LiveReconfiguration) {
+    std::map<std::string, std::string> current = {{"port", "8080"}, {"max_connections", "100"}};
+    std::string error;
+    
+    auto resize = ConfigDiff::between(current, {{"max_connections", "200"}, {"port", "8080"}});
+    ASSERT_EQ(resize.changes().size(), 1u);
+    EXPECT_TRUE(apiModule->validateConfig(resize, error));
+    apiModule->applyConfig(resize);
+    
+    EXPECT_FALSE(apiModule->validateConfig(ConfigDiff::between(current, {{"port", "9090"}}), error));
+    EXPECT_NE(error.find("port"), std::string::npos);
+    EXPECT_FALSE(apiModule->validateConfig(ConfigDiff::between(current, {{"max_connections", "0"}}), error));
+}
+
 TEST_F(ApiModuleTest, StatusReporting) {
     std::string status = apiModule->getStatus();
     EXPECT_FALSE(status.empty());
@@ -0,0 +1,886 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <stdexcept>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <csignal>
+#include <pthread.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Include the health monitor components
+#include "core/clock.h"
+#include "core/socket_handoff.h"
+#include "modules/health_check_engine.h"
+#include "modules/http_response_parser.h"
+#include "modules/dns_resolver.h"
+#include "modules/check_scheduler.h"
+#include "modules/health_monitor_module.h"
+
+using namespace swarm;
+
+// Test fixture for the health monitor and its check engine
+class HealthMonitorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Set up any common test data
+    }
+    
+    void TearDown() override {
+        // Clean up after each test
+    }
+};
+
+// Test concurrent health checks: one round of hundreds of checks, timeouts, failures and the in-flight limit
+TEST_F(HealthMonitorTest, HealthCheckEngineConcurrency) {
+    auto portOf = [](int fd) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        return std::to_string(ntohs(address.sin_port));
+    };
+    std::string error;
+    
+    // Connections complete in the backlog of a listener that never accepts, so
+    // TCP checks pass and HTTP checks wait for a response until their timeout
+    int silent = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+    ASSERT_GE(silent, 0) << error;
+    int refusing = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+    ASSERT_GE(refusing, 0) << error;
+    std::string refusedPort = portOf(refusing);
+    close(refusing);
+    
+    constexpr size_t kResponding = 5;
+    int responder = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+    ASSERT_GE(responder, 0) << error;
+    std::thread server([responder]() {
+        for (size_t i = 0; i < kResponding; i++) {
+            int client = accept(responder, nullptr, nullptr);
+            char request[1024];
+            (void)!recv(client, request, sizeof(request), 0);
+            const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+            (void)!send(client, response, sizeof(response) - 1, MSG_NOSIGNAL);
+            close(client);
+        }
+    });
+    
+    std::vector<HealthCheckConfig> checks;
+    for (size_t i = 0; i < 500; i++) {
+        checks.push_back({"tcp-" + std::to_string(i), "tcp", "127.0.0.1:" + portOf(silent), 2000, 1000, 3});
+    }
+    for (size_t i = 0; i < 20; i++) {
+        checks.push_back({"hung-" + std::to_string(i), "http", "http://127.0.0.1:" + portOf(silent) + "/health", 300, 1000, 3});
+    }
+    for (size_t i = 0; i < kResponding; i++) {
+        checks.push_back({"http-" + std::to_string(i), "http", "http://localhost:" + portOf(responder) + "/ready", 2000, 1000, 3});
+    }
+    checks.push_back({"refused", "tcp", "127.0.0.1:" + refusedPort, 2000, 1000, 3});
+    checks.push_back({"named", "tcp", "not an address:80", 2000, 1000, 3});
+    checks.push_back({"udp", "udp", "127.0.0.1:53", 2000, 1000, 3});
+    
+    // Run serially, the 20 hung checks alone would take 6 seconds
+    HealthCheckEngine engine;
+    auto begin = std::chrono::steady_clock::now();
+    auto results = engine.runAll(checks);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    server.join();
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1500));
+    EXPECT_EQ(engine.getPending(), 0u);
+    
+    ASSERT_EQ(results.size(), checks.size());
+    std::map<std::string, size_t> statuses;
+    for (size_t i = 0; i < results.size(); i++) {
+        EXPECT_EQ(results[i].moduleName, checks[i].moduleName);
+        statuses[results[i].status]++;
+    }
+    EXPECT_EQ(statuses["Healthy"], 500 + kResponding);
+    EXPECT_EQ(statuses["Timeout"], 20u);
+    EXPECT_GE(results[500].responseTime, std::chrono::milliseconds(300));
+    EXPECT_EQ(results[checks.size() - 3].status, "Connection failed");
+    EXPECT_EQ(results[checks.size() - 2].status, "Invalid address");
+    EXPECT_EQ(results[checks.size() - 1].status, "Unknown check type");
+    
+    // With two sockets at a time, four hung checks run in two waves
+    engine.setMaxInFlight(2);
+    std::vector<HealthCheckConfig> hung(checks.begin() + 500, checks.begin() + 504);
+    begin = std::chrono::steady_clock::now();
+    results = engine.runAll(hung);
+    EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(600));
+    for (const auto& result : results) {
+        EXPECT_EQ(result.status, "Timeout");
+    }
+    
+    // The monitor counts the engine's results and keeps its lock free during a round
+    HealthMonitorModule monitor;
+    monitor.addHealthCheck({"silent", "tcp", "127.0.0.1:" + portOf(silent), 0, 1000, 3});
+    monitor.addHealthCheck({"refused", "tcp", "127.0.0.1:" + refusedPort, 0, 1000, 3});
+    monitor.performAllHealthChecks();
+    EXPECT_TRUE(monitor.isModuleHealthy("silent"));
+    EXPECT_FALSE(monitor.isModuleHealthy("refused"));
+    EXPECT_EQ(monitor.getTotalChecks(), 2u);
+    EXPECT_EQ(monitor.getFailedChecks(), 1u);
+    
+    close(silent);
+    close(responder);
+}
+
+// Test the per-check schedule with synthetic time
+TEST_F(HealthMonitorTest, CheckSchedulerIntervals) {
+    using std::chrono::milliseconds;
+    const auto t0 = std::chrono::steady_clock::time_point() + std::chrono::hours(1);
+    
+    // Each check runs on its own interval, without drift when taken on time
+    CheckScheduler scheduler(1);
+    scheduler.setJitter(0.0);
+    scheduler.schedule("fast", milliseconds(100), t0);
+    scheduler.schedule("slow", milliseconds(1000), t0);
+    for (auto now = t0; now < t0 + milliseconds(2000); now += milliseconds(1)) {
+        for (const auto& name : scheduler.takeDue(now)) {
+            scheduler.complete(name, now);
+        }
+    }
+    auto stats = scheduler.getStats();
+    EXPECT_EQ(stats["fast"].runs, 20u);
+    EXPECT_EQ(stats["slow"].runs, 2u);
+    EXPECT_EQ(stats["fast"].maxDrift.count(), 0);
+    EXPECT_EQ(stats["fast"].overruns, 0u);
+    EXPECT_EQ(scheduler.nextDue(), t0 + milliseconds(2000));
+    
+    // A shorter interval applies from the last grid point on
+    scheduler.schedule("slow", milliseconds(300), t0 + milliseconds(2000));
+    EXPECT_EQ(scheduler.getStats()["slow"].nextDue, t0 + milliseconds(2000));
+    scheduler.remove("fast");
+    scheduler.remove("slow");
+    EXPECT_EQ(scheduler.nextDue(), CheckScheduler::TimePoint::max());
+    
+    // A check still running when due again skips that run
+    scheduler.schedule("stuck", milliseconds(100), t0);
+    EXPECT_EQ(scheduler.takeDue(t0).size(), 1u);
+    EXPECT_TRUE(scheduler.takeDue(t0 + milliseconds(100)).empty());
+    EXPECT_EQ(scheduler.getRunning(), 1u);
+    scheduler.complete("stuck", t0 + milliseconds(150));
+    EXPECT_EQ(scheduler.getRunning(), 0u);
+    EXPECT_EQ(scheduler.getStats()["stuck"].lastDuration, milliseconds(150));
+    EXPECT_EQ(scheduler.takeDue(t0 + milliseconds(200)).size(), 1u);
+    scheduler.complete("stuck", t0 + milliseconds(200));
+    EXPECT_EQ(scheduler.getStats()["stuck"].overruns, 1u);
+    
+    // A late start counts as drift; whole intervals missed are skipped, not run in a burst
+    EXPECT_EQ(scheduler.takeDue(t0 + milliseconds(350)).size(), 1u);
+    scheduler.complete("stuck", t0 + milliseconds(350));
+    EXPECT_EQ(scheduler.takeDue(t0 + milliseconds(1000)).size(), 1u);
+    stats = scheduler.getStats();
+    EXPECT_EQ(stats["stuck"].lastDrift, milliseconds(600));
+    EXPECT_EQ(stats["stuck"].maxDrift, milliseconds(600));
+    EXPECT_EQ(stats["stuck"].overruns, 7u);
+    EXPECT_EQ(stats["stuck"].nextDue, t0 + milliseconds(1100));
+    
+    // A check removed and added again while running keeps its run, and is
+    // only started again once that run completes
+    scheduler.remove("stuck");
+    EXPECT_EQ(scheduler.getRunning(), 1u);
+    EXPECT_EQ(scheduler.getStats().count("stuck"), 0u);
+    scheduler.schedule("stuck", milliseconds(100), t0 + milliseconds(1010));
+    EXPECT_TRUE(scheduler.takeDue(t0 + milliseconds(1010)).empty());
+    EXPECT_EQ(scheduler.getRunning(), 1u);
+    scheduler.complete("stuck", t0 + milliseconds(1020));
+    EXPECT_EQ(scheduler.getRunning(), 0u);
+    scheduler.complete("stuck", t0 + milliseconds(1030));
+    EXPECT_EQ(scheduler.getRunning(), 0u);
+    EXPECT_EQ(scheduler.takeDue(t0 + milliseconds(1110)).size(), 1u);
+    
+    // A removed check's run still counts until it completes
+    scheduler.remove("stuck");
+    EXPECT_EQ(scheduler.getRunning(), 1u);
+    EXPECT_EQ(scheduler.nextDue(), CheckScheduler::TimePoint::max());
+    scheduler.complete("stuck", t0 + milliseconds(1120));
+    EXPECT_EQ(scheduler.getRunning(), 0u);
+    scheduler.schedule("stuck", milliseconds(100), t0 + milliseconds(1200));
+    EXPECT_EQ(scheduler.takeDue(t0 + milliseconds(1200)).size(), 1u);
+    
+    // Jitter spreads checks with the same interval over it
+    CheckScheduler spread(7);
+    spread.setJitter(1.0);
+    for (int i = 0; i < 100; i++) {
+        spread.schedule("check-" + std::to_string(i), milliseconds(1000), t0);
+    }
+    std::vector<size_t> perTenth(10, 0);
+    for (const auto& [name, check] : spread.getStats()) {
+        auto offset = check.nextDue - t0;
+        ASSERT_GE(offset, milliseconds(0));
+        ASSERT_LT(offset, milliseconds(1000));
+        perTenth[offset / milliseconds(100)]++;
+    }
+    for (size_t count : perTenth) {
+        EXPECT_GT(count, 0u);
+        EXPECT_LT(count, 25u);
+    }
+}
+
+// Test that the monitor runs each check on its own interval
+TEST_F(HealthMonitorTest, HealthMonitorPerCheckIntervals) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(listen(listener, 64), 0);
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+    std::string endpoint = "127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+    
+    HealthMonitorModule monitor;
+    ASSERT_TRUE(monitor.configure({{"check_jitter", "0"}, {"default_interval_ms", "400"}}));
+    monitor.addHealthCheck({"fast", "tcp", endpoint, 0, 50, 3});
+    monitor.addHealthCheck({"default", "tcp", endpoint, 0, 0, 3});
+    monitor.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    monitor.stop();
+    
+    auto stats = monitor.getScheduleStats();
+    EXPECT_GE(stats["fast"].runs, 15u);
+    EXPECT_LE(stats["fast"].runs, 21u);
+    EXPECT_EQ(stats["default"].interval, std::chrono::milliseconds(400));
+    EXPECT_GE(stats["default"].runs, 2u);
+    EXPECT_LE(stats["default"].runs, 3u);
+    EXPECT_TRUE(monitor.isModuleHealthy("fast"));
+    EXPECT_EQ(monitor.getFailedChecks(), 0u);
+    
+    ModuleStatus status;
+    monitor.fillStatus(status);
+    EXPECT_EQ(status.counters.count("check_overruns"), 1u);
+    EXPECT_EQ(status.gauges.count("max_check_drift_ms"), 1u);
+    
+    close(listener);
+}
+
+// Benchmark the epoll and io_uring backends on 10,000 local targets
+TEST_F(HealthMonitorTest, HealthCheckEngineBackends) {
+    auto portOf = [](int fd) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        return std::to_string(ntohs(address.sin_port));
+    };
+    std::string error;
+    
+    // Stand-in targets: listeners that never accept, 500 connections each per
+    // round stay well within their backlogs
+    constexpr size_t kTargets = 10000;
+    constexpr size_t kListeners = 20;
+    std::vector<int> listeners;
+    for (size_t i = 0; i < kListeners; i++) {
+        int fd = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+        ASSERT_GE(fd, 0) << error;
+        listeners.push_back(fd);
+    }
+    int refusing = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+    ASSERT_GE(refusing, 0) << error;
+    std::string refusedPort = portOf(refusing);
+    close(refusing);
+    
+    constexpr size_t kResponding = 50;
+    int responder = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+    ASSERT_GE(responder, 0) << error;
+    std::thread server([responder]() {
+        for (size_t i = 0; i < 2 * kResponding; i++) {
+            int client = accept(responder, nullptr, nullptr);
+            char request[1024];
+            (void)!recv(client, request, sizeof(request), 0);
+            const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+            (void)!send(client, response, sizeof(response) - 1, MSG_NOSIGNAL);
+            close(client);
+        }
+    });
+    
+    std::vector<HealthCheckConfig> targets;
+    for (size_t i = 0; i < kTargets; i++) {
+        targets.push_back({"tcp-" + std::to_string(i), "tcp", "127.0.0.1:" + portOf(listeners[i % kListeners]), 5000, 1000, 3});
+    }
+    std::vector<HealthCheckConfig> mixed;
+    for (size_t i = 0; i < kResponding; i++) {
+        mixed.push_back({"http-" + std::to_string(i), "http", "http://127.0.0.1:" + portOf(responder) + "/health", 2000, 1000, 3});
+    }
+    for (size_t i = 0; i < 5; i++) {
+        mixed.push_back({"hung-" + std::to_string(i), "http", "http://127.0.0.1:" + portOf(listeners[0]) + "/health", 200, 1000, 3});
+    }
+    mixed.push_back({"refused", "tcp", "127.0.0.1:" + refusedPort, 2000, 1000, 3});
+    mixed.push_back({"invalid", "tcp", "not an address:80", 2000, 1000, 3});
+    
+    std::map<CheckBackend, std::vector<std::string>> statuses;
+    for (CheckBackend backend : {CheckBackend::Epoll, CheckBackend::IoUring}) {
+        HealthCheckEngine engine(0, backend);
+        auto cpuBegin = std::clock();
+        auto begin = std::chrono::steady_clock::now();
+        auto results = engine.runAll(targets);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuBegin) / CLOCKS_PER_SEC;
+        uint64_t waits = engine.getWaits();
+        
+        // A kernel without io_uring runs the round on epoll instead
+        std::cout << "[ BENCH    ] " << toString(backend) << " (ran on " << toString(engine.getBackend()) << "): "
+                  << kTargets << " checks in " << elapsed.count() << " ms, " << cpuMs << " ms CPU, "
+                  << waits << " waits" << std::endl;
+        ASSERT_EQ(results.size(), kTargets);
+        size_t healthy = std::count_if(results.begin(), results.end(),
+                                       [](const HealthCheckResult& result) { return result.healthy; });
+        EXPECT_EQ(healthy, kTargets);
+        EXPECT_LT(elapsed, std::chrono::milliseconds(5000));
+        
+        for (const auto& result : engine.runAll(mixed)) {
+            statuses[backend].push_back(result.status);
+        }
+        EXPECT_EQ(engine.getPending(), 0u);
+    }
+    
+    // Both backends report the same outcomes
+    EXPECT_EQ(statuses[CheckBackend::IoUring], statuses[CheckBackend::Epoll]);
+    std::vector<std::string>& outcomes = statuses[CheckBackend::Epoll];
+    ASSERT_EQ(outcomes.size(), mixed.size());
+    EXPECT_EQ(std::count(outcomes.begin(), outcomes.end(), "Healthy"), static_cast<long>(kResponding));
+    EXPECT_EQ(std::count(outcomes.begin(), outcomes.end(), "Timeout"), 5);
+    EXPECT_EQ(outcomes[mixed.size() - 2], "Connection failed");
+    EXPECT_EQ(outcomes[mixed.size() - 1], "Invalid address");
+    
+    CheckBackend parsed = CheckBackend::Epoll;
+    EXPECT_TRUE(parseCheckBackend("io_uring", parsed));
+    EXPECT_EQ(parsed, CheckBackend::IoUring);
+    EXPECT_FALSE(parseCheckBackend("kqueue", parsed));
+    
+    server.join();
+    for (int fd : listeners) {
+        close(fd);
+    }
+    close(responder);
+}
+
+// Test response framing on a reused connection
+TEST_F(HealthMonitorTest, HttpResponseParserFraming) {
+    auto feedAll = [](HttpResponseParser& parser, const std::string& bytes) {
+        return parser.feed(bytes.data(), bytes.size());
+    };
+    
+    // Two pipelined responses in one read: the first stops at its body's end
+    std::string pipelined = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello"
+                            "HTTP/1.1 503 Service Unavailable\r\ncontent-length:0\r\n\r\n";
+    HttpResponseParser parser;
+    size_t used = feedAll(parser, pipelined);
+    EXPECT_EQ(used, pipelined.find("HTTP/1.1 503"));
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Complete);
+    EXPECT_EQ(parser.getStatusCode(), 200);
+    EXPECT_TRUE(parser.isReusable());
+    parser.reset();
+    EXPECT_EQ(feedAll(parser, pipelined.substr(used)), pipelined.size() - used);
+    EXPECT_EQ(parser.getStatusCode(), 503);
+    
+    // Chunked body with a trailer, fed one byte at a time
+    std::string chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          "4;ext=1\r\nwiki\r\nA\r\n0123456789\r\n0\r\nX-Trailer: 1\r\n\r\n";
+    parser.reset();
+    for (size_t i = 0; i < chunked.size(); i++) {
+        EXPECT_EQ(parser.getState(), HttpResponseParser::State::Incomplete);
+        EXPECT_EQ(parser.feed(chunked.data() + i, 1), 1u);
+    }
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Complete);
+    EXPECT_TRUE(parser.isReusable());
+    
+    // Interim responses are skipped; the close-delimited body ends the connection
+    parser.reset();
+    feedAll(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n\r\nbody until close");
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Incomplete);
+    parser.finishAtClose();
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Complete);
+    EXPECT_EQ(parser.getStatusCode(), 200);
+    EXPECT_FALSE(parser.isReusable());
+    
+    // Connection: close and plain HTTP/1.0 end the connection, keep-alive keeps it
+    parser.reset();
+    feedAll(parser, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_FALSE(parser.isReusable());
+    parser.reset();
+    feedAll(parser, "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_FALSE(parser.isReusable());
+    parser.reset();
+    feedAll(parser, "HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_TRUE(parser.isReusable());
+    
+    // HEAD and 204 responses have no body despite Content-Length
+    parser.reset();
+    parser.setHeadRequest(true);
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Length: 42\r\n\r\n";
+    EXPECT_EQ(feedAll(parser, head + "HTTP/1.1"), head.size());
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Complete);
+    parser = HttpResponseParser();
+    feedAll(parser, "HTTP/1.1 204 No Content\r\nContent-Length: 42\r\n\r\n");
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Complete);
+    
+    // Anything else cannot be framed
+    parser.reset();
+    feedAll(parser, "SSH-2.0-OpenSSH_9.6\r\n\r\n");
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Invalid);
+    parser.reset();
+    feedAll(parser, "HTTP/1.1 200 OK\r\nContent-Length: ten\r\n\r\n");
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Invalid);
+    parser.reset();
+    feedAll(parser, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n");
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Invalid);
+    parser.reset();
+    feedAll(parser, "HTTP/1.1 200 OK\r\nX-Padding: " + std::string(20000, 'x'));
+    EXPECT_EQ(parser.getState(), HttpResponseParser::State::Invalid);
+}
+
+// Benchmark repeated HTTP rounds with and without keep-alive
+TEST_F(HealthMonitorTest, HealthCheckEngineKeepAlive) {
+    auto portOf = [](int fd) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        return std::to_string(ntohs(address.sin_port));
+    };
+    std::string error;
+    
+    // Keep-alive targets: one poll() thread answers every request and closes
+    // only when asked to
+    constexpr size_t kListeners = 20;
+    constexpr size_t kChecksPerTarget = 25;
+    constexpr size_t kRounds = 20;
+    std::vector<int> listeners;
+    for (size_t i = 0; i < kListeners; i++) {
+        int fd = SocketHandoff::bindTcpListener("127.0.0.1", 0, error);
+        ASSERT_GE(fd, 0) << error;
+        listeners.push_back(fd);
+    }
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> accepted{0};
+    std::thread server([&]() {
+        std::vector<pollfd> fds;
+        std::map<int, std::string> pending;
+        for (int fd : listeners) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+        while (!stop) {
+            if (poll(fds.data(), fds.size(), 20) <= 0) {
+                continue;
+            }
+            std::vector<pollfd> added;
+            for (auto& entry : fds) {
+                if (!(entry.revents & POLLIN)) {
+                    continue;
+                }
+                if (entry.fd >= 0 && std::find(listeners.begin(), listeners.end(), entry.fd) != listeners.end()) {
+                    int client = accept(entry.fd, nullptr, nullptr);
+                    if (client >= 0) {
+                        accepted++;
+                        added.push_back({client, POLLIN, 0});
+                    }
+                    continue;
+                }
+                char buffer[4096];
+                ssize_t received = recv(entry.fd, buffer, sizeof(buffer), 0);
+                std::string& input = pending[entry.fd];
+                if (received > 0) {
+                    input.append(buffer, static_cast<size_t>(received));
+                }
+                bool closing = received <= 0;
+                std::string output;
+                size_t end;
+                while (!closing && (end = input.find("\r\n\r\n")) != std::string::npos) {
+                    output += "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK";
+                    closing = input.substr(0, end).find("Connection: close") != std::string::npos;
+                    input.erase(0, end + 4);
+                }
+                // Pipelined requests are answered together
+                (void)!send(entry.fd, output.data(), output.size(), MSG_NOSIGNAL);
+                if (closing) {
+                    pending.erase(entry.fd);
+                    close(entry.fd);
+                    entry.fd = -1;
+                }
+            }
+            fds.erase(std::remove_if(fds.begin(), fds.end(), [](const pollfd& entry) { return entry.fd < 0; }),
+                      fds.end());
+            fds.insert(fds.end(), added.begin(), added.end());
+        }
+        for (auto& entry : fds) {
+            if (std::find(listeners.begin(), listeners.end(), entry.fd) == listeners.end()) {
+                close(entry.fd);
+            }
+        }
+    });
+    
+    std::vector<HealthCheckConfig> checks;
+    for (size_t i = 0; i < kListeners * kChecksPerTarget; i++) {
+        checks.push_back({"http-" + std::to_string(i), "http",
+                          "http://127.0.0.1:" + portOf(listeners[i % kListeners]) + "/health", 2000, 1000, 3});
+    }
+    
+    std::map<bool, size_t> connections;
+    for (bool keepAlive : {true, false}) {
+        HealthCheckEngine engine;
+        engine.setKeepAlive(keepAlive);
+        size_t acceptedBefore = accepted;
+        size_t healthy = 0;
+        auto cpuBegin = std::clock();
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < kRounds; round++) {
+            for (const auto& result : engine.runAll(checks)) {
+                healthy += result.healthy ? 1 : 0;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuBegin) / CLOCKS_PER_SEC;
+        connections[keepAlive] = accepted - acceptedBefore;
+        ConnectionPoolStats stats = engine.getConnectionStats();
+        
+        std::cout << "[ BENCH    ] keep-alive " << (keepAlive ? "on" : "off") << ": " << kRounds * checks.size()
+                  << " checks in " << elapsed.count() << " ms (" << elapsed.count() / static_cast<long>(kRounds)
+                  << " ms per round), " << cpuMs << " ms CPU, " << connections[keepAlive] << " connections, "
+                  << stats.reused << " reused, " << stats.pipelined << " pipelined" << std::endl;
+        EXPECT_EQ(healthy, kRounds * checks.size());
+        EXPECT_EQ(engine.getPending(), 0u);
+        if (keepAlive) {
+            EXPECT_GT(stats.reused, 0u);
+            EXPECT_EQ(stats.idle, connections[keepAlive]);
+        } else {
+            EXPECT_EQ(stats.reused, 0u);
+        }
+    }
+    
+    // Connections are bounded per target instead of opened per check
+    EXPECT_LE(connections[true], kListeners * 2);
+    EXPECT_EQ(connections[false], kRounds * checks.size());
+    
+    stop = true;
+    server.join();
+    for (int fd : listeners) {
+        close(fd);
+    }
+}
+
+// Test the resolver cache with synthetic time
+TEST_F(HealthMonitorTest, DnsResolverCache) {
+    auto address = [](const std::string& text) {
+        ResolvedAddress resolved;
+        EXPECT_TRUE(DnsResolver::parseLiteral(text, resolved)) << text;
+        return resolved;
+    };
+    auto clock = std::make_shared<VirtualClock>();
+    DnsResolver resolver(2, clock);
+    resolver.setTtls(std::chrono::seconds(60), std::chrono::seconds(5));
+    auto resolveNow = [&resolver](const std::string& host) {
+        auto promise = std::make_shared<std::promise<DnsAnswer>>();
+        std::future<DnsAnswer> answer = promise->get_future();
+        resolver.resolve(host, [promise](const DnsAnswer& resolved) { promise->set_value(resolved); });
+        return answer;
+    };
+    
+    // A stand-in for DNS that holds lookups until released
+    std::mutex mutex;
+    std::condition_variable released;
+    bool open = false;
+    std::map<std::string, DnsAnswer> table;
+    std::map<std::string, int> lookups;
+    resolver.setLookup([&](const std::string& host) {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&open]() { return open; });
+        lookups[host]++;
+        auto it = table.find(host);
+        if (it == table.end()) {
+            DnsAnswer missing;
+            missing.notFound = true;
+            missing.error = "Name or service not known";
+            return missing;
+        }
+        return it->second;
+    });
+    DnsAnswer replicas;
+    replicas.addresses = {address("10.0.1.5"), address("10.0.1.6"), address("fd00::7")};
+    replicas.ttl = std::chrono::seconds(10);
+    table["tasks.api"] = replicas;
+    
+    // Requests for a name being looked up wait for that one lookup
+    DnsAnswer answer;
+    EXPECT_FALSE(resolver.lookup("tasks.api", answer));
+    std::vector<std::future<DnsAnswer>> waiting;
+    for (int i = 0; i < 10; i++) {
+        waiting.push_back(resolveNow("tasks.api"));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+    }
+    released.notify_all();
+    for (auto& future : waiting) {
+        answer = future.get();
+        ASSERT_EQ(answer.addresses.size(), 3u);
+        EXPECT_EQ(answer.addresses[2].toString(), "fd00::7");
+    }
+    EXPECT_EQ(lookups["tasks.api"], 1);
+    EXPECT_EQ(resolver.getStats().coalesced, 9u);
+    
+    // Cached for the record TTL, then looked up again
+    clock->advance(std::chrono::seconds(9));
+    EXPECT_TRUE(resolver.lookup("tasks.api", answer));
+    EXPECT_EQ(answer.addresses.size(), 3u);
+    clock->advance(std::chrono::seconds(1));
+    EXPECT_FALSE(resolver.lookup("tasks.api", answer));
+    EXPECT_EQ(resolveNow("tasks.api").get().addresses.size(), 3u);
+    EXPECT_EQ(lookups["tasks.api"], 2);
+    
+    // Long TTLs are capped, so new replicas show up within a minute
+    table["api"].addresses = {address("10.0.0.2")};
+    table["api"].ttl = std::chrono::hours(1);
+    resolveNow("api").get();
+    clock->advance(std::chrono::seconds(59));
+    EXPECT_TRUE(resolver.lookup("api", answer));
+    clock->advance(std::chrono::seconds(1));
+    EXPECT_FALSE(resolver.lookup("api", answer));
+    
+    // Names that do not exist are remembered for the negative TTL
+    answer = resolveNow("missing").get();
+    EXPECT_TRUE(answer.addresses.empty());
+    EXPECT_TRUE(answer.notFound);
+    EXPECT_TRUE(resolver.lookup("missing", answer));
+    EXPECT_TRUE(answer.addresses.empty());
+    clock->advance(std::chrono::seconds(5));
+    EXPECT_FALSE(resolver.lookup("missing", answer));
+    
+    // A failed refresh keeps the expired addresses; a vanished name does not
+    DnsAnswer unreachable;
+    unreachable.error = "Temporary failure in name resolution";
+    table["api"] = unreachable;
+    answer = resolveNow("api").get();
+    ASSERT_EQ(answer.addresses.size(), 1u);
+    EXPECT_EQ(answer.addresses[0].toString(), "10.0.0.2");
+    EXPECT_EQ(resolver.getStats().stale, 1u);
+    clock->advance(std::chrono::seconds(5));
+    table.erase("api");
+    EXPECT_TRUE(resolveNow("api").get().addresses.empty());
+    
+    DnsCacheStats stats = resolver.getStats();
+    EXPECT_EQ(stats.lookups, 6u);
+    EXPECT_EQ(stats.entries, 3u);
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.negativeHits, 1u);
+    
+    // The records of a DNS response: a CNAME, two A and an AAAA record
+    auto name = [](std::vector<unsigned char>& message, const std::string& dotted) {
+        size_t begin = 0;
+        while (begin < dotted.size()) {
+            size_t end = std::min(dotted.find('.', begin), dotted.size());
+            message.push_back(static_cast<unsigned char>(end - begin));
+            message.insert(message.end(), dotted.begin() + begin, dotted.begin() + end);
+            begin = end + 1;
+        }
+        message.push_back(0);
+    };
+    auto record = [](std::vector<unsigned char>& message, uint16_t type, uint32_t ttl,
+                     const std::vector<unsigned char>& data) {
+        std::vector<unsigned char> fields = {0xC0, 0x0C, static_cast<unsigned char>(type >> 8),
+                                             static_cast<unsigned char>(type), 0, 1,
+                                             static_cast<unsigned char>(ttl >> 24), static_cast<unsigned char>(ttl >> 16),
+                                             static_cast<unsigned char>(ttl >> 8), static_cast<unsigned char>(ttl),
+                                             static_cast<unsigned char>(data.size() >> 8),
+                                             static_cast<unsigned char>(data.size())};
+        message.insert(message.end(), fields.begin(), fields.end());
+        message.insert(message.end(), data.begin(), data.end());
+    };
+    std::vector<unsigned char> response = {0x12, 0x34, 0x81, 0x80, 0, 1, 0, 4, 0, 0, 0, 0};
+    name(response, "tasks.api");
+    response.insert(response.end(), {0, 1, 0, 1});
+    std::vector<unsigned char> alias;
+    name(alias, "replicas.api");
+    record(response, 5, 300, alias);
+    record(response, 1, 30, {10, 0, 1, 5});
+    record(response, 1, 20, {10, 0, 1, 6});
+    record(response, 28, 600, {0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 7});
+    
+    DnsAnswer parsed;
+    ASSERT_TRUE(DnsResolver::parseResponse(response.data(), response.size(), parsed));
+    ASSERT_EQ(parsed.addresses.size(), 3u);
+    EXPECT_EQ(parsed.addresses[0].toString(), "10.0.1.5");
+    EXPECT_EQ(parsed.addresses[1].toString(), "10.0.1.6");
+    EXPECT_EQ(parsed.addresses[2].toString(), "fd00::7");
+    EXPECT_EQ(parsed.ttl, std::chrono::seconds(20));
+    
+    DnsAnswer broken;
+    EXPECT_FALSE(DnsResolver::parseResponse(response.data(), response.size() - 3, broken));
+    response[3] = 0x83;
+    EXPECT_FALSE(DnsResolver::parseResponse(response.data(), response.size(), broken));
+    
+    ResolvedAddress literal;
+    EXPECT_TRUE(DnsResolver::parseLiteral("localhost", literal));
+    EXPECT_EQ(literal.toString(), "127.0.0.1");
+    EXPECT_TRUE(DnsResolver::parseLiteral("::1", literal));
+    EXPECT_EQ(literal.family(), AF_INET6);
+    EXPECT_FALSE(DnsResolver::parseLiteral("tasks.api", literal));
+}
+
+// Test checks of names with several addresses, IPv6 and lookups slower than a check
+TEST_F(HealthMonitorTest, HealthCheckEngineDnsTargets) {
+    auto portOf = [](int fd) {
+        sockaddr_storage address{};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        return std::to_string(ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port));
+    };
+    auto accepted = [](int listener) {
+        size_t count = 0;
+        pollfd ready{listener, POLLIN, 0};
+        while (poll(&ready, 1, 0) > 0) {
+            close(accept(listener, nullptr, nullptr));
+            count++;
+        }
+        return count;
+    };
+    std::string error;
+    
+    // Replicas of a service on one port of several loopback addresses; nothing
+    // listens on 127.0.0.4, like a replica that went away
+    int first = SocketHandoff::bindTcpListener("127.0.0.2", 0, error);
+    ASSERT_GE(first, 0) << error;
+    std::string port = portOf(first);
+    int second = SocketHandoff::bindTcpListener("127.0.0.3", std::stoi(port), error);
+    ASSERT_GE(second, 0) << error;
+    int ipv6 = SocketHandoff::bindTcpListener("::1", std::stoi(port), error);
+    if (ipv6 < 0) {
+        close(first);
+        close(second);
+        GTEST_SKIP() << "No IPv6 loopback: " << error;
+    }
+    
+    constexpr size_t kResponding = 3;
+    int responder = SocketHandoff::bindTcpListener("::1", 0, error);
+    ASSERT_GE(responder, 0) << error;
+    std::thread server([responder]() {
+        for (size_t i = 0; i < kResponding; i++) {
+            int client = accept(responder, nullptr, nullptr);
+            char request[1024];
+            (void)!recv(client, request, sizeof(request), 0);
+            const char response[] = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+            (void)!send(client, response, sizeof(response) - 1, MSG_NOSIGNAL);
+            close(client);
+        }
+    });
+    
+    std::atomic<int> replicaLookups{0};
+    auto lookup = [&replicaLookups](const std::string& host) {
+        DnsAnswer answer;
+        answer.ttl = std::chrono::seconds(30);
+        std::vector<std::string> addresses;
+        if (host == "tasks.api") {
+            replicaLookups++;
+            addresses = {"127.0.0.2", "127.0.0.4", "127.0.0.3", "::1"};
+        } else if (host == "api") {
+            addresses = {"::1"};
+        } else if (host == "slow") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(400));
+            addresses = {"127.0.0.2"};
+        } else {
+            answer.notFound = true;
+            answer.error = "Name or service not known";
+        }
+        for (const auto& text : addresses) {
+            ResolvedAddress address;
+            DnsResolver::parseLiteral(text, address);
+            answer.addresses.push_back(address);
+        }
+        return answer;
+    };
+    
+    constexpr size_t kReplicaChecks = 30;
+    std::vector<HealthCheckConfig> checks;
+    for (size_t i = 0; i < kReplicaChecks; i++) {
+        checks.push_back({"replica-" + std::to_string(i), "tcp", "tasks.api:" + port, 2000, 1000, 3});
+    }
+    for (size_t i = 0; i < kResponding; i++) {
+        checks.push_back({"http-" + std::to_string(i), "http", "http://api:" + portOf(responder) + "/health", 2000, 1000, 3});
+    }
+    checks.push_back({"ipv6", "tcp", "[::1]:" + port, 2000, 1000, 3});
+    checks.push_back({"literal", "tcp", "127.0.0.2:" + port, 2000, 1000, 3});
+    checks.push_back({"missing", "tcp", "missing:" + port, 2000, 1000, 3});
+    checks.push_back({"slow", "tcp", "slow:" + port, 100, 1000, 3});
+    
+    {
+        HealthCheckEngine engine;
+        engine.getResolver().setLookup(lookup);
+        auto begin = std::chrono::steady_clock::now();
+        auto results = engine.runAll(checks);
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        
+        // The slow lookup holds up its own check only
+        EXPECT_LT(elapsed, std::chrono::milliseconds(350));
+        ASSERT_EQ(results.size(), checks.size());
+        for (size_t i = 0; i < kReplicaChecks + kResponding + 2; i++) {
+            EXPECT_EQ(results[i].status, "Healthy") << checks[i].moduleName << ": " << results[i].errorMessage;
+        }
+        EXPECT_LT(results[kReplicaChecks + kResponding + 1].responseTime, std::chrono::milliseconds(100));
+        EXPECT_EQ(results[checks.size() - 2].status, "DNS resolution failed");
+        EXPECT_EQ(results[checks.size() - 1].status, "Timeout");
+        
+        // Every check started at the next replica; those starting at the missing one moved on
+        size_t atFirst = accepted(first);
+        size_t atSecond = accepted(second);
+        size_t atIpv6 = accepted(ipv6);
+        EXPECT_EQ(atFirst + atSecond + atIpv6, kReplicaChecks + 2);
+        EXPECT_GE(atFirst, kReplicaChecks / 4);
+        EXPECT_GE(atSecond, kReplicaChecks / 2);
+        EXPECT_GE(atIpv6, kReplicaChecks / 4);
+        
+        // One lookup per name, answered from the cache afterwards
+        std::vector<HealthCheckConfig> replicas(checks.begin(), checks.begin() + kReplicaChecks);
+        for (const auto& result : engine.runAll(replicas)) {
+            EXPECT_TRUE(result.healthy);
+        }
+        EXPECT_EQ(accepted(first) + accepted(second) + accepted(ipv6), kReplicaChecks);
+        EXPECT_EQ(replicaLookups, 1);
+        EXPECT_GE(engine.getResolver().getStats().hits, kReplicaChecks);
+    }
+    
+    // The io_uring backend moves on to the next address the same way
+    {
+        HealthCheckEngine engine(0, CheckBackend::IoUring);
+        engine.getResolver().setLookup(lookup);
+        std::vector<HealthCheckConfig> replicas(checks.begin(), checks.begin() + kReplicaChecks);
+        replicas.push_back(checks[kReplicaChecks + kResponding]);
+        for (const auto& result : engine.runAll(replicas)) {
+            EXPECT_EQ(result.status, "Healthy") << result.moduleName << ": " << result.errorMessage;
+        }
+        EXPECT_EQ(accepted(first) + accepted(second) + accepted(ipv6), kReplicaChecks + 1);
+        
+        // A lookup outlasting the check's timeout does not hold up its timeout
+        auto begin = std::chrono::steady_clock::now();
+        auto slow = engine.runAll({checks.back()});
+        EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(350));
+        ASSERT_EQ(slow.size(), 1u);
+        EXPECT_EQ(slow.front().status, "Timeout");
+    }
+    
+    server.join();
+    close(first);
+    close(second);
+    close(ipv6);
+    close(responder);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
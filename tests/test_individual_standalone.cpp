@@ -253,7 +253,7 @@ TEST_F(IndividualStandaloneTest, CoreServiceStandaloneDetailed) {
     
     for (const auto& moduleName : moduleNames) {
         EXPECT_NE(statuses.find(moduleName), statuses.end());
-        EXPECT_EQ(statuses[moduleName], "running");
+        EXPECT_EQ(statuses[moduleName].summary, "running");
     }
     
     // Test 5: Message bus communication
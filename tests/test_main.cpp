@@ -5,11 +5,36 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <stdexcept>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <csignal>
+#include <pthread.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // Include SwarmApp core components
 #include "core/module.h"
 #include "core/message_bus.h"
 #include "core/module_manager.h"
+#include "core/static_module_set.h"
+#include "core/clock.h"
+#include "core/runtime.h"
+#include "core/runtime_config.h"
+#include "core/socket_handoff.h"
+#include "sim/swarm_simulator.h"
+#include "test_modules.h"
 
 using namespace swarm;
 
@@ -314,6 +339,321 @@ TEST_F(SwarmAppCoreTest, ZeroMQIntegration) {
     messageBus.stop();
 }
 
+// Test that held topics buffer messages and replay them in order on release
+TEST_F(SwarmAppCoreTest, MessageBusHoldTopic) {
+    MessageBus messageBus;
+    std::vector<std::string> received;
+    auto id = messageBus.subscribe("held.topic", [&](const std::string& topic, const std::string& message) {
+        (void)topic; // Suppress unused parameter warning
+        received.push_back(message);
+    });
+    
+    messageBus.holdTopic("held.topic");
+    messageBus.publish("held.topic", "first");
+    messageBus.publish("held.topic", "second");
+    EXPECT_TRUE(received.empty());
+    
+    messageBus.releaseTopic("held.topic");
+    EXPECT_EQ(received, (std::vector<std::string>{"first", "second"}));
+    
+    messageBus.unsubscribe(id);
+    messageBus.publish("held.topic", "third");
+    EXPECT_EQ(received.size(), 2u);
+    EXPECT_EQ(messageBus.getSubscriberCount("held.topic"), 0u);
+}
+
+// Test the compile-time module registry
+TEST_F(SwarmAppCoreTest, StaticModuleSetRegistry) {
+    using TestModules = StaticModuleSet<ListenerModule, StatusModule>;
+    static_assert(TestModules::kSize == 2, "two modules");
+    static_assert(TestModules::idOf<StatusModule>() == 1, "IDs follow the list order");
+    static_assert(TestModules::find("listener") == TestModules::idOf<ListenerModule>(), "lookup by name");
+    static_assert(TestModules::find("missing") == TestModules::kSize, "unknown names are not found");
+    static_assert(!TestModules::contains<CounterModule>(), "only listed modules are members");
+    static_assert(TestModules::With<CounterModule>::idOf<CounterModule>() == 2, "sets can be extended");
+    
+    ModuleManager manager;
+    TestModules::registerAll(manager);
+    std::vector<std::string> names;
+    TestModules::forEach([&](auto tag) {
+        using M = typename decltype(tag)::type;
+        names.push_back(M::kModuleName);
+        EXPECT_TRUE(manager.loadModule(M::kModuleName));
+    });
+    EXPECT_EQ(names, (std::vector<std::string>{"listener", "status"}));
+    
+    ListenerModule* listener = TestModules::get<ListenerModule>(manager);
+    ASSERT_NE(listener, nullptr);
+    EXPECT_EQ(listener, manager.getModule("listener"));
+    EXPECT_EQ(TestModules::acquire<StatusModule>(manager)->getName(), "status");
+    
+    ASSERT_TRUE(manager.unloadModule("status"));
+    EXPECT_EQ(TestModules::get<StatusModule>(manager), nullptr);
+}
+
+// Test runtime configuration parsing, environment overrides and bus transport selection
+TEST_F(SwarmAppCoreTest, RuntimeConfigDeployments) {
+    RuntimeConfig config;
+    std::string error;
+    ASSERT_TRUE(config.parse(R"(
+        # monolith
+        [runtime]
+        threads = 2
+
+        [module counter]
+        replicas = 2
+        step = 1
+
+        [module listener]
+
+        [check api-server]
+        endpoint = http://api:8083/#health   ; the '#' of the URL is kept
+    )", error)) << error;
+    
+    auto modules = config.modules();
+    ASSERT_EQ(modules.size(), 2u);
+    EXPECT_EQ(modules[0].name, "counter");
+    EXPECT_EQ(modules[0].replicas, 2u);
+    EXPECT_EQ(modules[0].config, (std::map<std::string, std::string>{{"step", "1"}}));
+    EXPECT_EQ(modules[1].name, "listener");
+    EXPECT_EQ(config.executorOptions().threadBudget, 2u);
+    ASSERT_EQ(config.sections("check").size(), 1u);
+    EXPECT_EQ(config.get("check api-server", "endpoint"), "http://api:8083/#health");
+    EXPECT_EQ(config.busOptions().transport, BusTransport::Inproc);
+    
+    // SWARM_ variables take precedence over the compose file variables
+    ASSERT_TRUE(config.applyEnvironment({
+        {"SWARM_MODULES", "listener, api:3"},
+        {"API_PORT", "8083"},
+        {"ZMQ_PUB_PORT", "6000"},
+        {"SWARM_BUS__PEERS", "localhost"},
+        {"SWARM_MODULE_API__PORT", "9000"},
+        {"SWARM_MODULE_API__ENABLE_CORS", "false"},
+        {"HEALTH_CHECK_INTERVAL", "500"},
+    }, error)) << error;
+    modules = config.modules();
+    ASSERT_EQ(modules.size(), 2u);
+    EXPECT_EQ(modules[0].name, "listener");
+    EXPECT_EQ(modules[1].name, "api");
+    EXPECT_EQ(modules[1].replicas, 3u);
+    EXPECT_EQ(modules[1].config.at("port"), "9000");
+    EXPECT_EQ(modules[1].config.at("enable_cors"), "false");
+    EXPECT_EQ(config.get("module health-monitor", "default_interval_ms", "none"), "none");
+    EXPECT_EQ(config.busOptions().publisherPort, 6000);
+    EXPECT_EQ(config.busOptions().transport, BusTransport::Ipc);
+    
+    ASSERT_TRUE(config.applyEnvironment({{"SWARM_BUS__PEERS", "localhost, api"}}, error));
+    EXPECT_EQ(config.busOptions().transport, BusTransport::Tcp);
+    ASSERT_TRUE(config.applyEnvironment({{"SWARM_BUS__TRANSPORT", "inproc"}}, error));
+    EXPECT_EQ(config.busOptions().transport, BusTransport::Inproc);
+    
+    // Invalid overrides leave the configuration unchanged
+    EXPECT_FALSE(config.applyEnvironment({{"SWARM_BUS__TRANSPORT", "shm"}}, error));
+    EXPECT_NE(error.find("transport"), std::string::npos);
+    EXPECT_FALSE(config.applyEnvironment({{"SWARM_MODULES", "listener:0"}}, error));
+    EXPECT_EQ(config.modules().size(), 2u);
+    
+    RuntimeConfig reparsed;
+    ASSERT_TRUE(reparsed.parse(config.toString(), error)) << error;
+    EXPECT_EQ(reparsed.toString(), config.toString());
+    EXPECT_FALSE(reparsed.parse("[module]\n", error));
+    EXPECT_FALSE(reparsed.parse("key = value\n", error));
+    EXPECT_FALSE(reparsed.parse("[runtime]\nthreads = many\n", error));
+    EXPECT_NE(error.find("threads"), std::string::npos);
+    
+    // Modules of the same process share an inproc bus
+    ModuleManager manager(ExecutorOptions{2, {}}, config.busOptions());
+    EXPECT_EQ(manager.getMessageBus()->getTransport(), BusTransport::Inproc);
+    EXPECT_EQ(manager.getMessageBus()->getPublisherEndpoint().rfind("inproc://", 0), 0u);
+    std::atomic<int> received{0};
+    manager.getMessageBus()->subscribe("runtime.test", [&](const std::string&, const std::string&) { received++; });
+    manager.getMessageBus()->publish("runtime.test", "hello");
+    EXPECT_EQ(received.load(), 1);
+}
+
+// Test the runtime loop: ticks, SIGTERM through the signalfd, lossless drain and the hard deadline
+TEST_F(SwarmAppCoreTest, RuntimeGracefulDrain) {
+    ModuleManager manager(ExecutorOptions{2, {}});
+    manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    ASSERT_TRUE(manager.loadModule("listener"));
+    ASSERT_TRUE(manager.startModule("listener"));
+    auto listener = std::static_pointer_cast<ListenerModule>(manager.acquireModule("listener"));
+    
+    Runtime runtime(RuntimeOptions{std::chrono::milliseconds(2000), std::chrono::milliseconds(5)});
+    int ticks = 0;
+    runtime.onTick([&]() {
+        if (++ticks == 3) {
+            // Queued messages must still be delivered after the signal
+            for (int i = 0; i < 200; i++) {
+                manager.getMessageBus()->publishAsync("listener.a", "message");
+            }
+            pthread_kill(pthread_self(), SIGTERM);
+        }
+    });
+    size_t receivedAtDrain = 0;
+    bool runningAtDrain = false;
+    runtime.onDrain([&](std::chrono::steady_clock::time_point deadline) {
+        bool drained = manager.drain(deadline);
+        receivedAtDrain = listener->getReceived();
+        runningAtDrain = manager.isModuleRunning("listener");
+        manager.shutdownAllModules();
+        return drained;
+    });
+    
+    auto begin = std::chrono::steady_clock::now();
+    EXPECT_EQ(runtime.run(), 0);
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+    EXPECT_EQ(ticks, 3);
+    EXPECT_EQ(runtime.getStopSignal(), SIGTERM);
+    EXPECT_EQ(receivedAtDrain, 200u);
+    EXPECT_TRUE(runningAtDrain);
+    EXPECT_TRUE(manager.getLoadedModules().empty());
+    
+    // requestStop() works from any thread
+    Runtime stopped;
+    std::thread([&stopped]() { stopped.requestStop(); }).join();
+    EXPECT_EQ(stopped.run(), 0);
+    EXPECT_EQ(stopped.getStopSignal(), 0);
+    
+    // A drain that overruns its deadline ends the process; re-exec rather than fork a threaded process
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EXPECT_EXIT({
+        Runtime overrun(RuntimeOptions{std::chrono::milliseconds(50), std::chrono::milliseconds(0)});
+        overrun.onDrain([](std::chrono::steady_clock::time_point) {
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+            return true;
+        });
+        overrun.requestStop();
+        overrun.run();
+    }, ::testing::ExitedWithCode(1), "deadline");
+}
+
+// Test the listening-socket handoff: inheritance over SCM_RIGHTS, takeover and an aborted successor
+TEST_F(SwarmAppCoreTest, SocketHandoffTakeover) {
+    auto portOf = [](int fd) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        return ntohs(address.sin_port);
+    };
+    std::string path = "/tmp/swarm-test-handoff-" + std::to_string(getpid()) + ".sock";
+    std::string error;
+    
+    // Without a predecessor nothing is inherited
+    SocketHandoff fresh;
+    EXPECT_TRUE(fresh.inherit(path, error)) << error;
+    EXPECT_TRUE(fresh.getInherited().empty());
+    EXPECT_FALSE(fresh.complete());
+    
+    std::atomic<bool> handedOff{false};
+    SocketHandoff oldProcess;
+    int oldFd = oldProcess.acquireListener("127.0.0.1", 0, error);
+    ASSERT_GE(oldFd, 0) << error;
+    ASSERT_TRUE(oldProcess.serve(path, [&handedOff]() { handedOff = true; }, error)) << error;
+    
+    // A successor that gives up before complete() leaves the predecessor serving
+    {
+        SocketHandoff aborted;
+        ASSERT_TRUE(aborted.inherit(path, error)) << error;
+        EXPECT_EQ(aborted.getInherited().size(), 1u);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(handedOff.load());
+    EXPECT_FALSE(oldProcess.isHandedOff());
+    
+    SocketHandoff newProcess;
+    ASSERT_TRUE(newProcess.inherit(path, error)) << error;
+    EXPECT_EQ(newProcess.getInherited(), std::vector<std::string>{"127.0.0.1:0"});
+    int newFd = newProcess.acquireListener("127.0.0.1", 0, error);
+    ASSERT_GE(newFd, 0) << error;
+    EXPECT_EQ(portOf(newFd), portOf(oldFd));
+    EXPECT_TRUE(newProcess.complete());
+    for (int i = 0; i < 100 && !handedOff; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(oldProcess.isHandedOff());
+    
+    // The predecessor closes its descriptors; connections still reach the successor
+    close(oldFd);
+    oldProcess.releaseListener("127.0.0.1", 0);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(portOf(newFd));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    int accepted = accept(newFd, nullptr, nullptr);
+    EXPECT_GE(accepted, 0);
+    close(accepted);
+    close(client);
+    close(newFd);
+    newProcess.releaseListener("127.0.0.1", 0);
+    unlink(path.c_str());
+}
+
+// Test a hundred simulated nodes exchanging messages over lossy, partitioned links
+TEST_F(SwarmAppCoreTest, SwarmSimulatorScale) {
+    constexpr size_t kNodes = 100;
+    SimulatorOptions options;
+    options.nodes = kNodes;
+    options.defaultLink.latency = std::chrono::milliseconds(20);
+    options.defaultLink.jitter = std::chrono::milliseconds(10);
+    options.seed = 7;
+    options.clock = std::make_shared<VirtualClock>();
+    
+    SwarmSimulator simulator(options);
+    simulator.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    ASSERT_TRUE(simulator.loadModule("listener"));
+    simulator.bridge("listener.a");
+    ASSERT_TRUE(simulator.start());
+    
+    auto received = [&simulator](size_t node) {
+        return dynamic_cast<ListenerModule*>(simulator.getNode(node).getModule("listener"))->getReceived();
+    };
+    
+    // A broadcast reaches every other node once, within latency plus jitter
+    simulator.publish(0, "listener.a", "ping");
+    simulator.runFor(std::chrono::seconds(1));
+    SimulationStats stats = simulator.getStats();
+    EXPECT_EQ(stats.network.sent, kNodes - 1);
+    EXPECT_EQ(stats.network.delivered, kNodes - 1);
+    EXPECT_EQ(stats.network.inFlight, 0u);
+    EXPECT_GE(stats.network.latencyP50, std::chrono::milliseconds(20));
+    EXPECT_LE(stats.network.latencyMax, std::chrono::milliseconds(30));
+    EXPECT_EQ(stats.elapsed, std::chrono::seconds(1));
+    EXPECT_DOUBLE_EQ(stats.deliveredPerSecond, kNodes - 1.0);
+    for (size_t node = 0; node < kNodes; node++) {
+        EXPECT_EQ(received(node), 1u) << "node " << node;
+    }
+    
+    // A partition keeps the message on its side
+    std::set<size_t> side;
+    for (size_t node = 0; node < kNodes / 2; node++) {
+        side.insert(node);
+    }
+    simulator.getNetwork().partition(side);
+    simulator.publish(10, "listener.a", "ping");
+    simulator.runFor(std::chrono::seconds(1));
+    stats = simulator.getStats();
+    EXPECT_EQ(stats.network.partitioned, kNodes / 2);
+    EXPECT_EQ(stats.network.delivered, kNodes - 1 + kNodes / 2 - 1);
+    EXPECT_EQ(received(0), 2u);
+    EXPECT_EQ(received(kNodes - 1), 1u);
+    
+    // A cut link loses its messages once healed
+    simulator.getNetwork().heal();
+    simulator.getNetwork().setLink(1, 2, LinkProfile{std::chrono::milliseconds(20), {}, 1.0});
+    simulator.publish(1, "listener.a", "ping");
+    simulator.runFor(std::chrono::seconds(1));
+    stats = simulator.getStats();
+    EXPECT_EQ(stats.network.lost, 1u);
+    EXPECT_EQ(received(2), 2u);
+    EXPECT_EQ(received(3), 3u);
+    EXPECT_EQ(stats.network.sent, 3 * (kNodes - 1));
+    EXPECT_EQ(stats.elapsed, std::chrono::seconds(3));
+    EXPECT_NE(simulator.summary().find("partitioned      50"), std::string::npos);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
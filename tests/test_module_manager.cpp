@@ -0,0 +1,912 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <csignal>
+#include <pthread.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Include SwarmApp core components
+#include "core/module.h"
+#include "core/message_bus.h"
+#include "core/module_manager.h"
+#include "core/clock.h"
+#include "core/rcu_ptr.h"
+#include "test_modules.h"
+
+using namespace swarm;
+
+// Test fixture for ModuleManager and executor functionality
+class ModuleManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Set up any common test data
+    }
+    
+    void TearDown() override {
+        // Clean up after each test
+    }
+};
+
+// Test that startAllModules honours declared dependencies
+TEST_F(ModuleManagerTest, ModuleManagerDependencyOrderedStartup) {
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    
+    // "a-frontend" sorts first alphabetically but depends on everything else
+    registerScripted(manager, "a-frontend", {"storage", "cache"}, journal);
+    registerScripted(manager, "cache", {"storage"}, journal);
+    registerScripted(manager, "storage", {}, journal);
+    
+    ASSERT_TRUE(manager.loadModule("a-frontend"));
+    ASSERT_TRUE(manager.loadModule("cache"));
+    ASSERT_TRUE(manager.loadModule("storage"));
+    
+    EXPECT_TRUE(manager.startAllModules());
+    EXPECT_LT(journal->indexOf("start:storage"), journal->indexOf("start:cache"));
+    EXPECT_LT(journal->indexOf("start:cache"), journal->indexOf("start:a-frontend"));
+    
+    const auto& report = manager.getStartupReport();
+    ASSERT_EQ(report.startOrder.size(), 3u);
+    EXPECT_EQ(report.startOrder.back(), "a-frontend");
+    EXPECT_TRUE(report.modules.at("a-frontend").started);
+    EXPECT_GE(report.modules.at("a-frontend").criticalPath, report.modules.at("cache").criticalPath);
+    
+    // Shutdown runs in reverse dependency order
+    manager.stopAllModules();
+    EXPECT_LT(journal->indexOf("stop:a-frontend"), journal->indexOf("stop:cache"));
+    EXPECT_LT(journal->indexOf("stop:cache"), journal->indexOf("stop:storage"));
+}
+
+// Test that independent modules start concurrently
+TEST_F(ModuleManagerTest, ModuleManagerParallelStartup) {
+    if (std::thread::hardware_concurrency() < 2) {
+        GTEST_SKIP() << "Parallel startup needs at least two hardware threads";
+    }
+    
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    const auto delay = std::chrono::milliseconds(200);
+    
+    registerScripted(manager, "left", {}, journal, delay);
+    registerScripted(manager, "right", {}, journal, delay);
+    ASSERT_TRUE(manager.loadModule("left"));
+    ASSERT_TRUE(manager.loadModule("right"));
+    
+    EXPECT_TRUE(manager.startAllModules());
+    EXPECT_TRUE(manager.isModuleRunning("left"));
+    EXPECT_TRUE(manager.isModuleRunning("right"));
+    EXPECT_LT(manager.getStartupReport().totalTime, delay * 2);
+}
+
+// Test that dependency cycles are rejected
+TEST_F(ModuleManagerTest, ModuleManagerDependencyCycle) {
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    
+    registerScripted(manager, "ping", {"pong"}, journal);
+    registerScripted(manager, "pong", {"ping"}, journal);
+    ASSERT_TRUE(manager.loadModule("ping"));
+    ASSERT_TRUE(manager.loadModule("pong"));
+    
+    EXPECT_FALSE(manager.startAllModules());
+    EXPECT_FALSE(manager.isModuleRunning("ping"));
+    EXPECT_FALSE(manager.isModuleRunning("pong"));
+}
+
+// Test that startModule waits for an asynchronous module to signal readiness
+TEST_F(ModuleManagerTest, ModuleManagerAsyncReadiness) {
+    ModuleManager manager;
+    manager.registerModule("async", []() {
+        return std::make_unique<AsyncReadyModule>(std::chrono::milliseconds(100), true);
+    });
+    ASSERT_TRUE(manager.loadModule("async"));
+    
+    auto before = std::chrono::steady_clock::now();
+    EXPECT_TRUE(manager.startModule("async"));
+    EXPECT_GE(std::chrono::steady_clock::now() - before, std::chrono::milliseconds(100));
+    EXPECT_TRUE(manager.isModuleRunning("async"));
+    
+    auto ready = manager.getModule("async")->getReadyFuture();
+    ASSERT_EQ(ready.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_TRUE(ready.get());
+}
+
+// Test that start and stop deadlines are enforced
+TEST_F(ModuleManagerTest, ModuleManagerLifecycleDeadlines) {
+    ModuleManager manager;
+    manager.registerModule("silent", []() {
+        return std::make_unique<AsyncReadyModule>(std::chrono::milliseconds(0), false);
+    });
+    manager.registerModule("slow-stop", []() {
+        return std::make_unique<AsyncReadyModule>(std::chrono::milliseconds(0), true,
+                                                  std::chrono::milliseconds(300));
+    });
+    
+    ASSERT_TRUE(manager.loadModule("silent", {{"start_timeout_ms", "100"}}));
+    EXPECT_FALSE(manager.startModule("silent"));
+    EXPECT_FALSE(manager.isModuleRunning("silent"));
+    
+    manager.setStopTimeout(std::chrono::milliseconds(50));
+    ASSERT_TRUE(manager.loadModule("slow-stop"));
+    ASSERT_TRUE(manager.startModule("slow-stop"));
+    EXPECT_FALSE(manager.stopModule("slow-stop"));
+    EXPECT_FALSE(manager.isModuleRunning("slow-stop"));
+    EXPECT_EQ(manager.getOverdueCallCount(), 1u);
+    
+    // The overrunning stop() call runs on the executor and shutdown waits for it
+    manager.setStopTimeout(std::chrono::seconds(5));
+    manager.shutdownAllModules();
+    EXPECT_EQ(manager.getOverdueCallCount(), 0u);
+}
+
+// Test that lookups are safe while other threads load and unload modules
+TEST_F(ModuleManagerTest, ModuleManagerConcurrentAccess) {
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    registerScripted(manager, "churn", {}, journal);
+    registerScripted(manager, "stable", {}, journal);
+    ASSERT_TRUE(manager.loadModule("stable"));
+    ASSERT_TRUE(manager.startModule("stable"));
+    
+    std::atomic<bool> done{false};
+    std::atomic<size_t> lookups{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                if (auto module = manager.acquireModule("churn")) {
+                    EXPECT_EQ(module->getName(), "churn");
+                }
+                EXPECT_TRUE(manager.isModuleRunning("stable"));
+                EXPECT_FALSE(manager.getModuleStatuses().empty());
+                lookups++;
+            }
+        });
+    }
+    
+    for (int i = 0; i < 50; i++) {
+        ASSERT_TRUE(manager.loadModule("churn"));
+        ASSERT_TRUE(manager.startModule("churn"));
+        ASSERT_TRUE(manager.unloadModule("churn"));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_GT(lookups.load(), 0u);
+}
+
+// Test that an acquired module outlives its unloading
+TEST_F(ModuleManagerTest, ModuleManagerAcquiredModuleOutlivesUnload) {
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    registerScripted(manager, "held", {}, journal);
+    ASSERT_TRUE(manager.loadModule("held"));
+    
+    auto held = manager.acquireModule("held");
+    ASSERT_NE(held, nullptr);
+    EXPECT_TRUE(manager.unloadModule("held"));
+    EXPECT_EQ(manager.getModule("held"), nullptr);
+    EXPECT_EQ(held->getName(), "held");
+    EXPECT_EQ(held.use_count(), 1);
+}
+
+// Test that retired registry snapshots are freed while readers keep overlapping
+TEST_F(ModuleManagerTest, RcuPtrBoundedRetirement) {
+    using Pointer = RcuPtr<std::vector<int>>;
+    Pointer pointer(std::make_unique<const std::vector<int>>(64, 0));
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> handoffs{0};
+    std::thread reader([&]() {
+        // Each section is entered before the previous one leaves, so a
+        // reader is active at every publish
+        std::optional<Pointer::Reader> sections[2];
+        sections[0].emplace(pointer);
+        for (size_t i = 1; !done; i++) {
+            sections[i % 2].emplace(pointer);
+            volatile int first = (*sections[i % 2])->front();
+            (void)first;
+            sections[(i + 1) % 2].reset();
+            handoffs++;
+        }
+    });
+    
+    size_t maxRetired = 0;
+    for (int i = 0; i < 500; i++) {
+        pointer.publish(std::make_unique<const std::vector<int>>(64, i));
+        maxRetired = std::max(maxRetired, pointer.getRetiredCount());
+        // Let the reader hand over to a new section before publishing again
+        for (uint64_t seen = handoffs; handoffs == seen;) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    reader.join();
+    EXPECT_LE(maxRetired, 2u);
+    
+    // Without readers, one publish frees everything retired before
+    pointer.publish(std::make_unique<const std::vector<int>>(64, -1));
+    EXPECT_EQ(pointer.getRetiredCount(), 0u);
+}
+
+// Test plugin file name conventions
+TEST_F(ModuleManagerTest, PluginModuleNames) {
+    EXPECT_EQ(ModuleManager::pluginModuleName("libswarm-health-monitor-plugin.so"), "health-monitor");
+    EXPECT_EQ(ModuleManager::pluginModuleName("libswarm-api-plugin.so"), "api");
+    EXPECT_EQ(ModuleManager::pluginModuleName("libmetrics.so"), "metrics");
+    EXPECT_EQ(ModuleManager::pluginModuleName("libswarm-core.a"), "");
+    EXPECT_EQ(ModuleManager::pluginModuleName("README.md"), "");
+}
+
+#ifdef SWARM_TEST_PLUGIN_DIR
+// Test that plugins are registered by a scan but only loaded on demand
+TEST_F(ModuleManagerTest, ModuleManagerLazyPluginLoading) {
+    auto pluginMapped = []() {
+        std::ifstream maps("/proc/self/maps");
+        std::string line;
+        while (std::getline(maps, line)) {
+            if (line.find("libswarm-echo-plugin.so") != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    ModuleManager manager;
+    EXPECT_GE(manager.scanPluginDirectory(SWARM_TEST_PLUGIN_DIR), 1u);
+    EXPECT_EQ(manager.getModule("echo"), nullptr);
+    EXPECT_FALSE(pluginMapped());
+    
+    ASSERT_TRUE(manager.loadModule("echo"));
+    EXPECT_TRUE(pluginMapped());
+    ASSERT_TRUE(manager.startModule("echo"));
+    EXPECT_EQ(manager.getModuleStatuses()["echo"].summary, "echo running");
+    
+    std::atomic<int> echoed{0};
+    manager.getMessageBus()->subscribe("echo.echo", [&](const std::string&, const std::string& message) {
+        if (message == "ping") {
+            echoed++;
+        }
+    });
+    manager.getMessageBus()->publish("echo", "ping");
+    EXPECT_EQ(echoed.load(), 1);
+    EXPECT_TRUE(manager.unloadModule("echo"));
+}
+#endif
+
+// Test that reloading a module under load neither drops nor duplicates messages
+TEST_F(ModuleManagerTest, ModuleManagerHotReload) {
+    ModuleManager manager;
+    manager.registerModule("counter", []() { return std::make_unique<CounterModule>(); });
+    ASSERT_TRUE(manager.loadModule("counter"));
+    ASSERT_TRUE(manager.startModule("counter"));
+    auto* bus = manager.getMessageBus();
+    
+    const size_t published = 5000;
+    std::thread publisher([bus, published]() {
+        for (size_t i = 0; i < published; i++) {
+            bus->publish("counter.tick", std::to_string(i));
+        }
+    });
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(manager.reloadModule("counter", {}));
+    }
+    // A reload whose new instance fails leaves the old instance serving
+    EXPECT_FALSE(manager.reloadModule("counter", {{"reject_state", "true"}}));
+    publisher.join();
+    
+    auto counter = manager.acquireModule("counter");
+    ASSERT_NE(counter, nullptr);
+    EXPECT_TRUE(counter->isRunning());
+    EXPECT_EQ(static_cast<CounterModule*>(counter.get())->getCount(), published);
+    EXPECT_EQ(bus->getSubscriberCount("counter.tick"), 1u);
+    EXPECT_FALSE(manager.reloadModule("missing", {}));
+}
+
+// Test live reconfiguration through the API and the configuration topic
+TEST_F(ModuleManagerTest, ModuleManagerReconfigure) {
+    ModuleManager manager;
+    auto journal = std::make_shared<ScriptedModule::Journal>();
+    manager.registerModule("counter", []() { return std::make_unique<CounterModule>(); });
+    registerScripted(manager, "fixed", {}, journal);
+    ASSERT_TRUE(manager.loadModule("counter", {{"step", "1"}, {"reject_state", "false"}}));
+    ASSERT_TRUE(manager.loadModule("fixed", {{"mode", "a"}}));
+    ASSERT_TRUE(manager.startModule("counter"));
+    
+    // Unchanged keys are not passed to the module, so this is a no-op
+    std::string error;
+    EXPECT_TRUE(manager.reconfigure("counter", {{"reject_state", "false"}}, &error));
+    
+    // A rejected change leaves the whole configuration untouched
+    EXPECT_FALSE(manager.reconfigure("counter", {{"step", "2"}, {"bogus", "x"}}, &error));
+    EXPECT_EQ(error, "invalid bogus");
+    EXPECT_EQ(manager.getModuleConfig("counter")["step"], "1");
+    EXPECT_FALSE(manager.reconfigure("fixed", {{"mode", "b"}}));
+    EXPECT_EQ(manager.getModuleConfig("fixed")["mode"], "a");
+    
+    // Deadline keys are handled by the manager and never reach the module
+    EXPECT_TRUE(manager.reconfigure("fixed", {{"stop_timeout_ms", "500"}}));
+    EXPECT_FALSE(manager.reconfigure("fixed", {{"stop_timeout_ms", "-1"}}));
+    EXPECT_EQ(manager.getModuleConfig("fixed")["stop_timeout_ms"], "500");
+    
+    auto* bus = manager.getMessageBus();
+    std::vector<std::string> results;
+    bus->subscribe("config.counter.result", [&](const std::string& topic, const std::string& message) {
+        (void)topic; // Suppress unused parameter warning
+        results.push_back(message);
+    });
+    bus->publish("config.counter", "# live change\nstep = 5\n");
+    bus->publish("config.counter", "step");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0], "ok");
+    EXPECT_EQ(results[1].rfind("error: ", 0), 0u);
+    EXPECT_EQ(manager.getModuleConfig("counter")["step"], "5");
+    
+    bus->publish("counter.tick", "");
+    auto counter = manager.acquireModule("counter");
+    EXPECT_EQ(static_cast<CounterModule*>(counter.get())->getCount(), 5u);
+}
+
+// Test the shared executor: work distribution, serial queues, timers and closing
+TEST_F(ModuleManagerTest, ExecutorTaskQueues) {
+    Executor executor(ExecutorOptions{2, {}});
+    EXPECT_EQ(executor.getThreadCount(), 2u);
+    
+    // Tasks spawned from workers land on local queues and are stolen by idle workers
+    std::atomic<int> counter{0};
+    std::promise<void> spawned;
+    executor.submit([&]() {
+        for (int i = 0; i < 1000; i++) {
+            executor.submit([&]() { counter++; });
+        }
+        spawned.set_value();
+    }, TaskPriority::High);
+    spawned.get_future().wait();
+    
+    // Serial queues run their tasks one at a time in submission order
+    auto serial = executor.createQueue("serial", true);
+    std::vector<int> order;
+    std::promise<void> serialDone;
+    for (int i = 0; i < 200; i++) {
+        serial->submit([&order, i]() { order.push_back(i); });
+    }
+    serial->submit([&]() { serialDone.set_value(); });
+    serialDone.get_future().wait();
+    ASSERT_EQ(order.size(), 200u);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    EXPECT_GE(serial->getCompletedCount(), 200u);
+    
+    // Timers fire after their delay unless cancelled or their queue is closed
+    std::promise<void> fired;
+    std::atomic<bool> cancelledRan{false};
+    auto timers = executor.createQueue("timers");
+    timers->scheduleAfter(std::chrono::milliseconds(20), [&]() { fired.set_value(); });
+    auto cancelled = timers->scheduleAfter(std::chrono::milliseconds(20), [&]() { cancelledRan = true; });
+    EXPECT_TRUE(timers->cancel(cancelled));
+    EXPECT_EQ(fired.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    
+    timers->scheduleAfter(std::chrono::milliseconds(10), [&]() { cancelledRan = true; });
+    timers->close();
+    EXPECT_FALSE(timers->submit([&]() { cancelledRan = true; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(cancelledRan.load());
+    
+    while (counter.load() < 1000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_GE(executor.getStats().executed, 1000u);
+    
+    ModuleManager manager(ExecutorOptions{3, {}});
+    EXPECT_EQ(manager.getExecutor()->getThreadCount(), 3u);
+}
+
+// Test that declared subscriptions are wired while a module runs
+TEST_F(ModuleManagerTest, ModuleManagerSubscriptionWiring) {
+    ModuleManager manager;
+    manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    ASSERT_TRUE(manager.loadModule("listener"));
+    auto module = dynamic_cast<ListenerModule*>(manager.getModule("listener"));
+    ASSERT_NE(module, nullptr);
+    auto bus = manager.getMessageBus();
+    
+    bus->publish("listener.a", "early");
+    EXPECT_EQ(bus->getSubscriberCount("listener.a"), 0u);
+    
+    ASSERT_TRUE(manager.startModule("listener"));
+    for (int i = 0; i < 10; i++) {
+        bus->publish(i % 2 ? "listener.a" : "listener.b", "message");
+    }
+    bus->publish("listener.a", "throw");
+    EXPECT_EQ(module->getReceived(), 10u);
+    
+    auto metrics = manager.getDeliveryMetrics()["listener"];
+    EXPECT_EQ(metrics.delivered, 10u);
+    EXPECT_EQ(metrics.failed, 1u);
+    EXPECT_GE(metrics.totalTime, metrics.maxTime);
+    
+    // Stopping unwires the topics and restarting does not duplicate them
+    ASSERT_TRUE(manager.stopModule("listener"));
+    bus->publish("listener.a", "late");
+    EXPECT_EQ(module->getReceived(), 10u);
+    ASSERT_TRUE(manager.startModule("listener"));
+    EXPECT_EQ(bus->getSubscriberCount("listener.a"), 1u);
+    bus->publish("listener.a", "again");
+    EXPECT_EQ(module->getReceived(), 11u);
+    
+    EXPECT_TRUE(manager.unloadModule("listener"));
+    EXPECT_EQ(bus->getSubscriberCount("listener.b"), 0u);
+}
+
+// Test that a replicated module's messages are spread across its instances
+TEST_F(ModuleManagerTest, ModuleManagerReplicas) {
+    // A single worker has to run the replicas' backlog while it stops them
+    ExecutorOptions options;
+    options.threadBudget = 1;
+    ModuleManager manager(options);
+    manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    EXPECT_FALSE(manager.loadModule("listener", {{"load_balancing", "random"}}, 4));
+    ASSERT_TRUE(manager.loadModule("listener", {}, 4));
+    auto replicas = manager.acquireReplicas("listener");
+    ASSERT_EQ(replicas.size(), 4u);
+    EXPECT_EQ(replicas.front().get(), manager.getModule("listener"));
+    auto received = [&replicas](size_t i) { return static_cast<ListenerModule&>(*replicas[i]).getReceived(); };
+    auto bus = manager.getMessageBus();
+    
+    // Round robin; stopping waits for the messages already handed to a replica
+    ASSERT_TRUE(manager.startModule("listener"));
+    EXPECT_EQ(bus->getSubscriberCount("listener.a"), 1u);
+    for (int i = 0; i < 400; i++) {
+        bus->publish("listener.a", std::to_string(i));
+    }
+    manager.stopAllModules();
+    EXPECT_FALSE(manager.isModuleRunning("listener"));
+    for (size_t i = 0; i < replicas.size(); i++) {
+        EXPECT_EQ(received(i), 100u);
+    }
+    
+    // Messages with the same key stay on one replica
+    ASSERT_TRUE(manager.reconfigure("listener", {{"load_balancing", "key_hash"}}));
+    ASSERT_TRUE(manager.startModule("listener"));
+    for (int i = 0; i < 40; i++) {
+        bus->publish("listener.b", "key\n" + std::to_string(i));
+    }
+    ASSERT_TRUE(manager.stopModule("listener"));
+    size_t grown = 0;
+    for (size_t i = 0; i < replicas.size(); i++) {
+        grown += (received(i) == 140u) ? 1 : 0;
+    }
+    EXPECT_EQ(grown, 1u);
+    EXPECT_EQ(manager.getDeliveryMetrics()["listener"].delivered, 440u);
+    
+    ASSERT_TRUE(manager.reloadModule("listener", {{"load_balancing", "least_loaded"}}));
+    EXPECT_EQ(manager.acquireReplicas("listener").size(), 4u);
+    EXPECT_TRUE(manager.unloadModule("listener"));
+    EXPECT_TRUE(manager.acquireReplicas("listener").empty());
+}
+
+// Test that a change one replica rejects is applied to none of them
+TEST_F(ModuleManagerTest, ModuleManagerReconfigureReplicas) {
+    ModuleManager manager;
+    int created = 0;
+    manager.registerModule("counter", [&created]() {
+        // The last of three replicas refuses step 7
+        return std::make_unique<CounterModule>(++created == 3 ? "7" : "");
+    });
+    ASSERT_TRUE(manager.loadModule("counter", {{"step", "1"}}, 3));
+    auto replicas = manager.acquireReplicas("counter");
+    ASSERT_EQ(replicas.size(), 3u);
+    auto step = [&replicas](size_t i) { return static_cast<CounterModule&>(*replicas[i]).getStep(); };
+    
+    std::string error;
+    EXPECT_FALSE(manager.reconfigure("counter", {{"step", "7"}}, &error));
+    EXPECT_EQ(error, "step 7 rejected");
+    EXPECT_EQ(manager.getModuleConfig("counter")["step"], "1");
+    for (size_t i = 0; i < replicas.size(); i++) {
+        EXPECT_EQ(step(i), 1u);
+    }
+    
+    EXPECT_TRUE(manager.reconfigure("counter", {{"step", "4"}}, &error));
+    EXPECT_EQ(manager.getModuleConfig("counter")["step"], "4");
+    for (size_t i = 0; i < replicas.size(); i++) {
+        EXPECT_EQ(step(i), 4u);
+    }
+}
+
+// Test that every lifecycle phase is profiled and exported as a Chrome trace
+TEST_F(ModuleManagerTest, ModuleManagerLifecycleProfile) {
+    const std::string tracePath = "/tmp/swarm_profile_test.json";
+    std::remove(tracePath.c_str());
+    setenv("SWARM_PROFILE_TRACE", tracePath.c_str(), 1);
+    {
+        ModuleManager manager;
+        manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+        ASSERT_TRUE(manager.loadModule("listener"));
+        ASSERT_TRUE(manager.startModule("listener"));
+        ASSERT_TRUE(manager.stopModule("listener"));
+        ASSERT_TRUE(manager.unloadModule("listener"));
+        
+        std::set<std::string> phases;
+        bool busSetup = false;
+        for (const auto& span : manager.getProfiler()->getSpans()) {
+            if (span.module == "listener") {
+                phases.insert(span.phase);
+            }
+            busSetup |= (span.module == "message-bus" && span.phase == "setup");
+        }
+        EXPECT_TRUE(busSetup);
+        EXPECT_EQ(phases, (std::set<std::string>{"factory", "configure", "initialize", "start",
+                                                 "ready", "stop", "shutdown"}));
+        
+        std::string trace = manager.getProfiler()->toChromeTrace();
+        EXPECT_NE(trace.find("\"traceEvents\""), std::string::npos);
+        EXPECT_NE(trace.find("\"name\":\"listener initialize\""), std::string::npos);
+        EXPECT_NE(manager.getProfiler()->summary().find("listener"), std::string::npos);
+    }
+    unsetenv("SWARM_PROFILE_TRACE");
+    
+    // The manager writes the trace when it goes away
+    std::ifstream written(tracePath);
+    std::string content((std::istreambuf_iterator<char>(written)), std::istreambuf_iterator<char>());
+    EXPECT_NE(content.find("message-bus stop"), std::string::npos);
+    std::remove(tracePath.c_str());
+}
+
+// Test that module state survives a restart through a snapshot file
+TEST_F(ModuleManagerTest, ModuleManagerSnapshots) {
+    const std::string path = "/tmp/swarm_snapshot_test.bin";
+    std::remove(path.c_str());
+    auto registerCounter = [](ModuleManager& manager) {
+        manager.registerModule("counter", []() { return std::make_unique<CounterModule>(); });
+    };
+    auto countOf = [](ModuleManager& manager) {
+        return static_cast<CounterModule*>(manager.getModule("counter"))->getCount();
+    };
+    
+    {
+        ModuleManager manager;
+        EXPECT_FALSE(manager.enableSnapshots(path));
+        registerCounter(manager);
+        ASSERT_TRUE(manager.loadModule("counter"));
+        ASSERT_TRUE(manager.startModule("counter"));
+        for (int i = 0; i < 7; i++) {
+            manager.getMessageBus()->publish("counter.tick", "tick");
+        }
+    }
+    
+    // The restored state is there before the module starts, and only once
+    {
+        ModuleManager manager;
+        EXPECT_TRUE(manager.enableSnapshots(path, std::chrono::milliseconds(20)));
+        registerCounter(manager);
+        ASSERT_TRUE(manager.loadModule("counter"));
+        EXPECT_EQ(countOf(manager), 7u);
+        ASSERT_TRUE(manager.unloadModule("counter"));
+        ASSERT_TRUE(manager.loadModule("counter"));
+        EXPECT_EQ(countOf(manager), 0u);
+        
+        // Periodic snapshots pick up the live state
+        ASSERT_TRUE(manager.startModule("counter"));
+        manager.getMessageBus()->publish("counter.tick", "tick");
+        StateSnapshot periodic;
+        std::string error;
+        for (int i = 0; i < 100; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (periodic.load(path, error) && periodic.find("counter") &&
+                periodic.find("counter")->front() == "1") {
+                break;
+            }
+        }
+        ASSERT_NE(periodic.find("counter"), nullptr);
+        EXPECT_EQ(periodic.find("counter")->front(), "1");
+    }
+    
+    // A damaged file is ignored
+    std::string data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        data.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+    ASSERT_GT(data.size(), 16u);
+    data[16] ^= 0x5a;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+    {
+        ModuleManager manager;
+        EXPECT_FALSE(manager.enableSnapshots(path));
+        registerCounter(manager);
+        ASSERT_TRUE(manager.loadModule("counter"));
+        EXPECT_EQ(countOf(manager), 0u);
+    }
+    std::remove(path.c_str());
+}
+
+// Test that a crashing module is restarted with backoff until it gives up, without
+// affecting the other modules
+TEST_F(ModuleManagerTest, ModuleManagerSupervision) {
+    ModuleManager manager;
+    RestartPolicy policy;
+    policy.initialBackoff = std::chrono::milliseconds(10);
+    policy.maxBackoff = std::chrono::milliseconds(20);
+    policy.maxRestarts = 2;
+    manager.setRestartPolicy(policy);
+    
+    auto starts = std::make_shared<std::atomic<int>>(0);
+    manager.registerModule("crashing", [starts]() { return std::make_unique<CrashingModule>(starts); });
+    manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    ASSERT_TRUE(manager.loadModule("crashing"));
+    ASSERT_TRUE(manager.loadModule("listener"));
+    ASSERT_TRUE(manager.startAllModules());
+    
+    for (int i = 0; i < 200 && !manager.getSupervisionStats()["crashing"].gaveUp; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < 100 && manager.isModuleRunning("crashing"); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto stats = manager.getSupervisionStats()["crashing"];
+    EXPECT_TRUE(stats.gaveUp);
+    EXPECT_EQ(stats.crashes, 3u);
+    EXPECT_EQ(stats.restarts, 2u);
+    EXPECT_EQ(stats.failedRestarts, 0u);
+    EXPECT_EQ(stats.lastFailure, "worker crashed");
+    EXPECT_GE(stats.lastRestartTime.count(), 10);
+    EXPECT_EQ(starts->load(), 3);
+    EXPECT_FALSE(manager.isModuleRunning("crashing"));
+    EXPECT_EQ(manager.getSupervisionStats().count("listener"), 0u);
+    
+    // The bus and the other modules kept serving
+    auto listener = static_cast<ListenerModule*>(manager.getModule("listener"));
+    manager.getMessageBus()->publish("listener.a", "still here");
+    for (int i = 0; i < 100 && listener->getReceived() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(listener->getReceived(), 1u);
+    
+    // Starting it again by hand gives it a fresh budget
+    ASSERT_TRUE(manager.unloadModule("crashing"));
+    ASSERT_TRUE(manager.loadModule("crashing"));
+    EXPECT_FALSE(manager.getSupervisionStats()["crashing"].gaveUp);
+    ASSERT_TRUE(manager.startModule("crashing"));
+    for (int i = 0; i < 100 && manager.getSupervisionStats()["crashing"].restarts < 3; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_GE(manager.getSupervisionStats()["crashing"].restarts, 3u);
+}
+
+// Test that CPU time, threads and backlog are attributed to modules
+TEST_F(ModuleManagerTest, ModuleManagerResourceAccounting) {
+    ModuleManager manager;
+    manager.registerModule("listener", []() { return std::make_unique<ListenerModule>(); });
+    ASSERT_TRUE(manager.loadModule("listener"));
+    ASSERT_TRUE(manager.startModule("listener"));
+    auto listener = static_cast<ListenerModule*>(manager.getModule("listener"));
+    for (int i = 0; i < 100; i++) {
+        manager.getMessageBus()->publish("listener.a", "message");
+    }
+    for (int i = 0; i < 100 && listener->getReceived() < 100; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto status = manager.getModuleStatuses()["listener"];
+    EXPECT_EQ(status.state, ModuleState::Running);
+    EXPECT_EQ(status.replicas, 1u);
+    EXPECT_GT(status.resources.cpuTime.count(), 0);
+    EXPECT_EQ(status.resources.threads, 0u);
+    
+    // Threads owned by a module are charged as a whole
+    std::promise<void> release;
+    std::promise<void> burned;
+    std::thread owned([&]() {
+        ResourceAccounting::attachThread("burner");
+        auto until = ResourceAccounting::threadCpuTime() + std::chrono::milliseconds(50);
+        while (ResourceAccounting::threadCpuTime() < until) {
+        }
+        burned.set_value();
+        release.get_future().wait();
+    });
+    burned.get_future().wait();
+    auto usage = ResourceAccounting::getUsage("burner");
+    EXPECT_EQ(usage.threads, 1u);
+    EXPECT_GE(usage.cpuTime, std::chrono::milliseconds(20));
+    release.set_value();
+    owned.join();
+    usage = ResourceAccounting::getUsage("burner");
+    EXPECT_EQ(usage.threads, 0u);
+    EXPECT_GE(usage.cpuTime, std::chrono::milliseconds(50));
+    
+    // CPU time from before a thread attaches is not the module's
+    std::promise<void> attached;
+    std::promise<void> detach;
+    std::thread late([&]() {
+        auto until = ResourceAccounting::threadCpuTime() + std::chrono::milliseconds(100);
+        while (ResourceAccounting::threadCpuTime() < until) {
+        }
+        ResourceAccounting::attachThread("late");
+        attached.set_value();
+        detach.get_future().wait();
+    });
+    attached.get_future().wait();
+    usage = ResourceAccounting::getUsage("late");
+    EXPECT_EQ(usage.threads, 1u);
+    EXPECT_LT(usage.cpuTime, std::chrono::milliseconds(50));
+    detach.set_value();
+    late.join();
+    EXPECT_LT(ResourceAccounting::getUsage("late").cpuTime, std::chrono::milliseconds(50));
+    
+    // Replica lanes and other queues named after the module count as its backlog
+    auto queue = manager.getExecutor()->createQueue("listener#7", true);
+    std::promise<void> unblock;
+    auto blocked = unblock.get_future().share();
+    for (int i = 0; i < 4; i++) {
+        queue->submit([blocked]() { blocked.wait(); });
+    }
+    EXPECT_EQ(manager.getModuleStatuses()["listener"].resources.queueBacklog, 4u);
+    unblock.set_value();
+    queue->drain();
+    EXPECT_EQ(manager.getModuleStatuses()["listener"].resources.queueBacklog, 0u);
+    
+    if (ResourceAccounting::tracksAllocations()) {
+        EXPECT_GT(manager.getModuleStatuses()["listener"].resources.allocations, 0u);
+        
+        // Freed memory leaves the live bytes of the module that allocated it
+        constexpr size_t kBlock = 1 << 20;
+        std::unique_ptr<std::vector<char>> kept;
+        {
+            ResourceAccounting::Scope scope(ResourceAccounting::accountFor("allocator"));
+            kept = std::make_unique<std::vector<char>>(kBlock);
+            std::vector<char> temporary(kBlock);
+        }
+        usage = ResourceAccounting::getUsage("allocator");
+        EXPECT_GE(usage.allocatedBytes, 2 * kBlock);
+        EXPECT_GE(usage.liveBytes, kBlock);
+        EXPECT_LT(usage.liveBytes, 2 * kBlock);
+        kept.reset();
+        EXPECT_LT(ResourceAccounting::getUsage("allocator").liveBytes, kBlock);
+    }
+}
+
+// Test that statuses carry typed fields and are only rebuilt when they change
+TEST_F(ModuleManagerTest, ModuleManagerStatusCache) {
+    ModuleManager manager;
+    manager.registerModule("status", []() { return std::make_unique<StatusModule>(); });
+    ASSERT_TRUE(manager.loadModule("status"));
+    auto module = static_cast<StatusModule*>(manager.getModule("status"));
+    
+    auto status = manager.getModuleStatuses()["status"];
+    EXPECT_EQ(status.state, ModuleState::Stopped);
+    EXPECT_EQ(status.summary, "ticks: 0");
+    EXPECT_EQ(status.counters["ticks"], 0u);
+    EXPECT_EQ(status.counters["messages_delivered"], 0u);
+    EXPECT_DOUBLE_EQ(status.gauges["load"], 0.5);
+    EXPECT_EQ(status.uptime.count(), 0);
+    
+    ASSERT_TRUE(manager.startModule("status"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    status = manager.getModuleStatuses()["status"];
+    EXPECT_EQ(status.state, ModuleState::Running);
+    EXPECT_STREQ(toString(status.state), "running");
+    EXPECT_GE(status.uptime.count(), 20);
+    size_t reads = module->getReads();
+    
+    // Polling an unchanged module does not call into it
+    uint64_t version = manager.getStatusVersion();
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(manager.getModuleStatuses()["status"].version, status.version);
+    }
+    EXPECT_EQ(manager.getStatusVersion(), version);
+    EXPECT_EQ(module->getReads(), reads);
+    
+    module->tick();
+    module->tick();
+    EXPECT_GT(manager.getStatusVersion(), version);
+    status = manager.getModuleStatuses()["status"];
+    EXPECT_EQ(module->getReads(), reads + 1);
+    EXPECT_EQ(status.summary, "ticks: 2");
+    EXPECT_EQ(status.counters["ticks"], 2u);
+    EXPECT_EQ(status.lastError, "too many ticks");
+    
+    version = manager.getStatusVersion();
+    ASSERT_TRUE(manager.stopModule("status"));
+    EXPECT_GT(manager.getStatusVersion(), version);
+    EXPECT_EQ(manager.getModuleStatuses()["status"].state, ModuleState::Stopped);
+    
+    version = manager.getStatusVersion();
+    ASSERT_TRUE(manager.unloadModule("status"));
+    EXPECT_GT(manager.getStatusVersion(), version);
+    EXPECT_TRUE(manager.getModuleStatuses().empty());
+}
+
+// Test that reconfiguring a running module keeps its uptime
+TEST_F(ModuleManagerTest, ModuleManagerReconfigureKeepsUptime) {
+    ModuleManager manager;
+    manager.registerModule("counter", []() { return std::make_unique<CounterModule>(); });
+    ASSERT_TRUE(manager.loadModule("counter", {{"step", "1"}}));
+    ASSERT_TRUE(manager.startModule("counter"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto before = manager.getModuleStatuses()["counter"].uptime;
+    EXPECT_GE(before.count(), 20);
+    
+    ASSERT_TRUE(manager.reconfigure("counter", {{"step", "2"}}));
+    EXPECT_TRUE(manager.isModuleRunning("counter"));
+    auto after = manager.getModuleStatuses()["counter"].uptime;
+    EXPECT_GE(after, before);
+    EXPECT_LT(after, before + std::chrono::seconds(5));
+}
+
+// Test virtual time: an hour of executor timers runs in milliseconds, on schedule and in order
+TEST_F(ModuleManagerTest, ExecutorVirtualTime) {
+    auto clock = std::make_shared<VirtualClock>();
+    auto start = clock->now();
+    auto end = start + std::chrono::hours(1);
+    auto realBegin = std::chrono::steady_clock::now();
+    
+    std::vector<std::chrono::steady_clock::duration> ticks;
+    std::chrono::steady_clock::duration oneOff{};
+    {
+        Executor executor(ExecutorOptions{1, {}, clock});
+        auto queue = executor.createQueue("simulated", true);
+        std::function<void()> tick = [&]() {
+            ticks.push_back(clock->now() - start);
+            queue->scheduleAfter(std::chrono::seconds(10), tick);
+        };
+        queue->scheduleAfter(std::chrono::seconds(10), tick);
+        queue->scheduleAfter(std::chrono::milliseconds(95500), [&]() { oneOff = clock->now() - start; });
+        
+        // The single worker waiting on the clock means all due work has run
+        while (clock->now() < end) {
+            ASSERT_TRUE(clock->waitForWaiters(1, std::chrono::seconds(5)));
+            clock->advanceToNextDeadline(end);
+        }
+        ASSERT_TRUE(clock->waitForWaiters(1, std::chrono::seconds(5)));
+        queue->close();
+    }
+    
+    ASSERT_EQ(ticks.size(), 360u);
+    for (size_t i = 0; i < ticks.size(); i++) {
+        EXPECT_EQ(ticks[i], std::chrono::seconds(10 * (i + 1)));
+    }
+    EXPECT_EQ(oneOff, std::chrono::milliseconds(95500));
+    EXPECT_LT(std::chrono::steady_clock::now() - realBegin, std::chrono::seconds(10));
+    
+    // Sleepers wake when the time passes their deadline
+    std::atomic<bool> woke{false};
+    std::thread sleeper([&]() {
+        clock->sleepFor(std::chrono::minutes(1));
+        woke = true;
+    });
+    ASSERT_TRUE(clock->waitForWaiters(1, std::chrono::seconds(5)));
+    clock->advance(std::chrono::seconds(59));
+    EXPECT_FALSE(woke.load());
+    clock->advance(std::chrono::seconds(1));
+    sleeper.join();
+    EXPECT_TRUE(woke.load());
+    EXPECT_EQ(clock->wallNow(), std::chrono::system_clock::time_point() + std::chrono::minutes(61));
+    
+    // A manager's bus stamps messages in its executor's time
+    ModuleManager manager(ExecutorOptions{1, {}, clock});
+    EXPECT_EQ(manager.getMessageBus()->getClock(), clock);
+    EXPECT_EQ(manager.getExecutor()->getClock(), clock);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,338 @@
+/**
+ * @file test_modules.h
+ * @brief Modules shared by the core and ModuleManager unit tests
+ */
+
+#ifndef TEST_MODULES_H
+#define TEST_MODULES_H
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stdexcept>
+
+#include "core/module.h"
+#include "core/message_bus.h"
+#include "core/module_manager.h"
+
+namespace swarm {
+
+// Configurable module used by the ModuleManager tests
+class ScriptedModule : public Module {
+public:
+    struct Journal {
+        std::mutex mutex;
+        std::vector<std::string> events;
+        
+        void record(const std::string& event) {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.push_back(event);
+        }
+        
+        size_t indexOf(const std::string& event) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = std::find(events.begin(), events.end(), event);
+            return it == events.end() ? events.size() : static_cast<size_t>(it - events.begin());
+        }
+    };
+    
+    ScriptedModule(std::string name, std::vector<std::string> dependencies,
+                   std::shared_ptr<Journal> journal,
+                   std::chrono::milliseconds startDelay = std::chrono::milliseconds(0))
+        : name_(std::move(name)), dependencies_(std::move(dependencies)),
+          journal_(std::move(journal)), startDelay_(startDelay) {}
+    
+    bool initialize() override { return true; }
+    void start() override {
+        std::this_thread::sleep_for(startDelay_);
+        journal_->record("start:" + name_);
+        running_ = true;
+    }
+    void stop() override {
+        journal_->record("stop:" + name_);
+        running_ = false;
+    }
+    void shutdown() override {}
+    std::string getName() const override { return name_; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return dependencies_; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return running_ ? "running" : "stopped"; }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        (void)message; // Suppress unused parameter warning
+    }
+    
+private:
+    std::string name_;
+    std::vector<std::string> dependencies_;
+    std::shared_ptr<Journal> journal_;
+    std::chrono::milliseconds startDelay_;
+};
+
+// Register a ScriptedModule factory with the given dependencies
+inline void registerScripted(ModuleManager& manager, const std::string& name,
+                             std::vector<std::string> dependencies,
+                             std::shared_ptr<ScriptedModule::Journal> journal,
+                             std::chrono::milliseconds startDelay = std::chrono::milliseconds(0)) {
+    manager.registerModule(name, [=]() {
+        return std::make_unique<ScriptedModule>(name, dependencies, journal, startDelay);
+    });
+}
+
+// Module that becomes ready on its own thread some time after start()
+class AsyncReadyModule : public Module {
+public:
+    AsyncReadyModule(std::chrono::milliseconds readyDelay, bool signals,
+                     std::chrono::milliseconds stopDelay = std::chrono::milliseconds(0))
+        : readyDelay_(readyDelay), signals_(signals), stopDelay_(stopDelay) {}
+    ~AsyncReadyModule() override {
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+    
+    bool initialize() override { return true; }
+    void start() override {
+        running_ = true;
+        worker_ = std::thread([this]() {
+            std::this_thread::sleep_for(readyDelay_);
+            if (signals_) {
+                signalReady(true);
+            }
+        });
+    }
+    void stop() override {
+        std::this_thread::sleep_for(stopDelay_);
+        running_ = false;
+    }
+    void shutdown() override {}
+    bool startsAsynchronously() const override { return true; }
+    std::string getName() const override { return "async"; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return running_ ? "running" : "stopped"; }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        (void)message; // Suppress unused parameter warning
+    }
+    
+private:
+    std::chrono::milliseconds readyDelay_;
+    bool signals_;
+    std::chrono::milliseconds stopDelay_;
+    std::thread worker_;
+};
+
+// Module that counts the messages of one topic and hands the count over on reload;
+// its live "step" setting can be told to reject one value
+class CounterModule : public Module {
+public:
+    static constexpr const char kModuleName[] = "counter";
+    
+    explicit CounterModule(std::string rejectedStep = "") : rejectedStep_(std::move(rejectedStep)) {}
+    
+    bool initialize() override {
+        subscribe("counter.tick", [this](const std::string& topic, const std::string& message) {
+            onMessage(topic, message);
+        });
+        return true;
+    }
+    void start() override { running_ = true; }
+    void stop() override { running_ = false; }
+    void shutdown() override {}
+    std::string getName() const override { return kModuleName; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return std::to_string(count_.load()); }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        auto it = config.find("reject_state");
+        rejectState_ = (it != config.end() && it->second == "true");
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        (void)message; // Suppress unused parameter warning
+        count_ += step_.load();
+    }
+    bool validateConfig(const ConfigDiff& diff, std::string& error) const override {
+        for (const auto& change : diff.changes()) {
+            if (change.key != "step" || change.newValue.empty() ||
+                change.newValue.find_first_not_of("0123456789") != std::string::npos) {
+                error = "invalid " + change.key;
+                return false;
+            }
+            if (change.newValue == rejectedStep_) {
+                error = "step " + rejectedStep_ + " rejected";
+                return false;
+            }
+        }
+        return true;
+    }
+    void applyConfig(const ConfigDiff& diff) noexcept override {
+        if (auto change = diff.find("step")) {
+            step_ = std::stoul(change->newValue);
+        }
+    }
+    std::string exportState() const override { return std::to_string(count_.load()); }
+    bool importState(const std::string& state) override {
+        if (rejectState_) {
+            return false;
+        }
+        count_ = std::stoul(state);
+        return true;
+    }
+    
+    size_t getCount() const { return count_.load(); }
+    size_t getStep() const { return step_.load(); }
+    
+private:
+    std::atomic<size_t> count_{0};
+    std::atomic<size_t> step_{1};
+    bool rejectState_ = false;
+    std::string rejectedStep_;
+};
+
+// Module that receives its declared topics through onMessage() and fails on "throw"
+class ListenerModule final : public Module {
+public:
+    static constexpr const char kModuleName[] = "listener";
+    
+    bool initialize() override { return true; }
+    void start() override { running_ = true; }
+    void stop() override { running_ = false; }
+    void shutdown() override {}
+    std::string getName() const override { return kModuleName; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    std::vector<std::string> getSubscriptions() const override { return {"listener.a", "listener.b"}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return std::to_string(received_.load()); }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        if (message == "throw") {
+            throw std::runtime_error("listener failure");
+        }
+        received_++;
+    }
+    
+    size_t getReceived() const { return received_.load(); }
+    
+private:
+    std::atomic<size_t> received_{0};
+};
+
+// Module whose own thread throws shortly after every start
+class CrashingModule : public Module {
+public:
+    explicit CrashingModule(std::shared_ptr<std::atomic<int>> starts) : starts_(std::move(starts)) {}
+    ~CrashingModule() override {
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+    
+    bool initialize() override { return true; }
+    void start() override {
+        running_ = true;
+        (*starts_)++;
+        worker_ = std::thread([this]() {
+            runSupervised([]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                throw std::runtime_error("worker crashed");
+            });
+        });
+    }
+    void stop() override {
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        running_ = false;
+    }
+    void shutdown() override {}
+    std::string getName() const override { return "crashing"; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override { return running_ ? "running" : "stopped"; }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        (void)message; // Suppress unused parameter warning
+    }
+    
+private:
+    std::shared_ptr<std::atomic<int>> starts_;
+    std::thread worker_;
+};
+
+// Module reporting typed status fields that counts how often its status is read
+class StatusModule final : public Module {
+public:
+    static constexpr const char kModuleName[] = "status";
+    
+    bool initialize() override { return true; }
+    void start() override { running_ = true; }
+    void stop() override { running_ = false; }
+    void shutdown() override {}
+    std::string getName() const override { return kModuleName; }
+    std::string getVersion() const override { return "1.0.0"; }
+    std::vector<std::string> getDependencies() const override { return {}; }
+    bool isRunning() const override { return running_; }
+    std::string getStatus() const override {
+        reads_++;
+        return "ticks: " + std::to_string(ticks_.load());
+    }
+    void fillStatus(ModuleStatus& status) const override {
+        status.counters["ticks"] = ticks_.load();
+        status.gauges["load"] = 0.5;
+        if (ticks_ > 1) {
+            status.lastError = "too many ticks";
+        }
+    }
+    bool configure(const std::map<std::string, std::string>& config) override {
+        (void)config; // Suppress unused parameter warning
+        return true;
+    }
+    void onMessage(const std::string& topic, const std::string& message) override {
+        (void)topic; // Suppress unused parameter warning
+        (void)message; // Suppress unused parameter warning
+    }
+    
+    void tick() {
+        ticks_++;
+        statusChanged();
+    }
+    size_t getReads() const { return reads_.load(); }
+    
+private:
+    std::atomic<uint64_t> ticks_{0};
+    mutable std::atomic<size_t> reads_{0};
+};
+
+} // namespace swarm
+
+#endif // TEST_MODULES_H